@@ -19,10 +19,27 @@
 
 #pragma once
 
+/* Sizes of audio buffers, in sectors (1 sector = 1/75th of second) */
+#define AUDIO_RING_SECTORS      150 /* Decoded audio buffered ahead of output */
+#define AUDIO_DECODE_BATCH      25  /* Sectors decoded per device lock */
+#define AUDIO_OUTPUT_PERIOD     5   /* Sectors written to libao at once */
+
 struct _CdemuAudioPrivate
 {
-    /* Thread */
+    /* Threads; the playback (output) thread owns the decoder thread */
     GThread *playback_thread;
+    GThread *decoder_thread;
+
+    /* Ring buffer of decoded sectors, shared by decoder and output
+     * stage; positions count sectors since the start of playback */
+    guint8 *ring_buffer;
+    gint ring_read;
+    gint ring_write;
+    gboolean decoder_finished;
+    gboolean decoder_error;
+
+    GMutex ring_mutex;
+    GCond ring_cond;
 
     /* libao device */
     gint driver_id;
@@ -32,10 +49,9 @@ struct _CdemuAudioPrivate
 
     /* Pointer to disc */
     MirageDisc *disc;
+    CdemuSharedDisc *shared_disc; /* Lock holder for disc; may be NULL */
 
-    GMutex *device_mutex;
-
-    /* Sector */
+    /* Sector; cur_sector follows the output, while decoder runs ahead */
     gint cur_sector;
     gint end_sector;
 
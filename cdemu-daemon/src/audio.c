@@ -30,9 +30,139 @@ G_DEFINE_TYPE_WITH_PRIVATE(CdemuAudio, cdemu_audio, MIRAGE_TYPE_OBJECT)
 /**********************************************************************\
  *                          Playback functions                        *
 \**********************************************************************/
+/* Sets the status and wakes up both stages, so that they notice it;
+ * decoder may also be waiting for the disc lock */
+static void cdemu_audio_set_status (CdemuAudio *self, gint status)
+{
+    g_mutex_lock(&self->priv->ring_mutex);
+    self->priv->status = status;
+    g_cond_broadcast(&self->priv->ring_cond);
+    g_mutex_unlock(&self->priv->ring_mutex);
+
+    if (self->priv->shared_disc) {
+        cdemu_shared_disc_wake_waiters(self->priv->shared_disc);
+    }
+}
+
+static gboolean cdemu_audio_is_playing (gpointer data)
+{
+    CdemuAudio *self = data;
+    return self->priv->status == AUDIO_STATUS_PLAYING;
+}
+
+/* Locks the disc. Public functions may be called by a command that holds
+ * the disc lock while they wait for playback to stop, so we block only
+ * for as long as we are playing; changing the status wakes us up. */
+static gboolean cdemu_audio_lock_disc (CdemuAudio *self)
+{
+    if (self->priv->shared_disc) {
+        return cdemu_shared_disc_lock_while(self->priv->shared_disc, cdemu_audio_is_playing, self);
+    }
+
+    return TRUE;
+}
+
+static void cdemu_audio_unlock_disc (CdemuAudio *self)
+{
+    if (self->priv->shared_disc) {
+        cdemu_shared_disc_unlock(self->priv->shared_disc);
+    }
+}
+
+
+static gpointer cdemu_audio_decoder_thread (CdemuAudio *self)
+{
+    gint start_sector = self->priv->cur_sector;
+
+    CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: decoder thread start", __debug__);
+
+    while (1) {
+        gint write_pos, next_sector, num_sectors, num_decoded;
+        gboolean failed = FALSE;
+
+        /* Wait for enough free space in the ring buffer */
+        g_mutex_lock(&self->priv->ring_mutex);
+        while (self->priv->status == AUDIO_STATUS_PLAYING && AUDIO_RING_SECTORS - (self->priv->ring_write - self->priv->ring_read) < AUDIO_DECODE_BATCH) {
+            g_cond_wait(&self->priv->ring_cond, &self->priv->ring_mutex);
+        }
+        write_pos = self->priv->ring_write;
+        g_mutex_unlock(&self->priv->ring_mutex);
+
+        if (self->priv->status != AUDIO_STATUS_PLAYING) {
+            break;
+        }
+
+        /* Decode next batch, up to the end of playing range */
+        next_sector = start_sector + write_pos;
+        num_sectors = MIN(AUDIO_DECODE_BATCH, self->priv->end_sector - next_sector + 1);
+        num_decoded = 0;
+
+        if (num_sectors > 0) {
+            if (!cdemu_audio_lock_disc(self)) {
+                break;
+            }
+
+            for (num_decoded = 0; num_decoded < num_sectors; num_decoded++) {
+                gint address = next_sector + num_decoded;
+                guint8 *slot = self->priv->ring_buffer + ((write_pos + num_decoded) % AUDIO_RING_SECTORS) * 2352;
+                MirageSector *sector;
+                GError *error = NULL;
+                const guint8 *tmp_buffer;
+                gint tmp_len;
+
+                sector = mirage_disc_get_sector(self->priv->disc, address, &error);
+                if (!sector) {
+                    CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: failed to get sector 0x%X: %s", __debug__, address, error->message);
+                    g_error_free(error);
+                    failed = TRUE;
+                    break;
+                }
+
+                /* This one covers both sector not being an audio one and sector
+                 * changing from audio to data one */
+                if (mirage_sector_get_sector_type(sector) != MIRAGE_SECTOR_AUDIO) {
+                    CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: non-audio sector 0x%X!", __debug__, address);
+                    g_object_unref(sector);
+                    failed = TRUE;
+                    break;
+                }
+
+                mirage_sector_get_data(sector, &tmp_buffer, &tmp_len, NULL);
+                memcpy(slot, tmp_buffer, MIN(tmp_len, 2352));
+                g_object_unref(sector);
+            }
+
+            cdemu_audio_unlock_disc(self);
+
+            CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: decoded sectors 0x%X-0x%X", __debug__, next_sector, next_sector + num_decoded - 1);
+        }
+
+        /* Hand decoded sectors over to the output stage */
+        g_mutex_lock(&self->priv->ring_mutex);
+        self->priv->ring_write += num_decoded;
+        if (failed || next_sector + num_decoded > self->priv->end_sector) {
+            self->priv->decoder_finished = TRUE;
+            self->priv->decoder_error = failed;
+        }
+        g_cond_broadcast(&self->priv->ring_cond);
+        g_mutex_unlock(&self->priv->ring_mutex);
+
+        if (self->priv->decoder_finished) {
+            break;
+        }
+    }
+
+    CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: decoder thread end", __debug__);
+
+    return NULL;
+}
+
 static gpointer cdemu_audio_playback_thread (CdemuAudio *self)
 {
     gint audio_driver_id = self->priv->driver_id;
+    GError *local_error = NULL;
+    gint64 clock_start = 0;
+    gint num_played = 0;
 
     /* Open audio device */
     CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: opening audio device", __debug__);
@@ -56,73 +186,67 @@ static gpointer cdemu_audio_playback_thread (CdemuAudio *self)
         self->priv->null_hack = FALSE;
     }
 
+    /* Start the decoder stage */
+    self->priv->ring_buffer = g_malloc(AUDIO_RING_SECTORS * 2352);
+    self->priv->ring_read = 0;
+    self->priv->ring_write = 0;
+    self->priv->decoder_finished = FALSE;
+    self->priv->decoder_error = FALSE;
+
+    self->priv->decoder_thread = g_thread_try_new("CDEmu Device Audio Decoder thread", (GThreadFunc)cdemu_audio_decoder_thread, self, &local_error);
+    if (!self->priv->decoder_thread) {
+        CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to create audio decoder thread: %s", __debug__, local_error->message);
+        g_error_free(local_error);
+        cdemu_audio_set_status(self, AUDIO_STATUS_ERROR);
+    }
+
     CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: playback thread start", __debug__);
 
     while (1) {
-        /* Process sectors; we go over playing range, check sectors' type, keep
-         * track of where we are and try to produce some sound. libao's play
-         * function should keep our timing */
-        MirageSector *sector;
-        GError *error = NULL;
-        const guint8 *tmp_buffer;
-        gint tmp_len;
-        gint type;
-
-        /* Make playback thread interruptible (i.e. if status is changed, it's
-         * going to end */
-        if (self->priv->status != AUDIO_STATUS_PLAYING) {
-            CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: playback thread interrupted", __debug__);
-            break;
-        }
-
-        /* Check if we have already reached the end */
-        if (self->priv->cur_sector > self->priv->end_sector) {
-            CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: playback thread reached the end", __debug__);
-            self->priv->status = AUDIO_STATUS_COMPLETED; /* Audio operation successfully completed */
-            break;
+        /* Play decoded sectors in periods; libao's play function should
+         * keep our timing, and position we report follows the output */
+        const guint8 *period;
+        gint num_sectors;
+
+        /* Wait for a full period (or whatever is left at the end); make
+         * playback thread interruptible (i.e. if status is changed, it's
+         * going to end) */
+        g_mutex_lock(&self->priv->ring_mutex);
+        while (self->priv->status == AUDIO_STATUS_PLAYING && !self->priv->decoder_finished && self->priv->ring_write - self->priv->ring_read < AUDIO_OUTPUT_PERIOD) {
+            g_cond_wait(&self->priv->ring_cond, &self->priv->ring_mutex);
         }
+        num_sectors = MIN(self->priv->ring_write - self->priv->ring_read, AUDIO_OUTPUT_PERIOD);
+        g_mutex_unlock(&self->priv->ring_mutex);
 
-
-        /*** Lock device mutex ***/
-        g_mutex_lock(self->priv->device_mutex);
-
-        /* Get sector */
-        CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: playing sector %d (0x%X)", __debug__, self->priv->cur_sector, self->priv->cur_sector);
-        sector = mirage_disc_get_sector(self->priv->disc, self->priv->cur_sector, &error);
-        if (!sector) {
-            CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: failed to get sector 0x%X: %s", __debug__, self->priv->cur_sector, error->message);
-            g_error_free(error);
-            self->priv->status = AUDIO_STATUS_ERROR; /* Audio operation stopped due to error */
-            g_mutex_unlock(self->priv->device_mutex);
+        if (self->priv->status != AUDIO_STATUS_PLAYING) {
+            CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: playback thread interrupted", __debug__);
             break;
         }
 
-        /* This one covers both sector not being an audio one and sector changing
-         * from audio to data one */
-        type = mirage_sector_get_sector_type(sector);
-        if (type != MIRAGE_SECTOR_AUDIO) {
-            CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: non-audio sector!", __debug__);
-            g_object_unref(sector); /* Unref here; we won't need it anymore... */
-            self->priv->status = AUDIO_STATUS_ERROR; /* Audio operation stopped due to error */
-            g_mutex_unlock(self->priv->device_mutex);
+        /* Check if we have reached the end (or the decoder failed) */
+        if (num_sectors == 0) {
+            if (self->priv->decoder_error) {
+                CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: playback thread stopped due to decoder error", __debug__);
+                cdemu_audio_set_status(self, AUDIO_STATUS_ERROR); /* Audio operation stopped due to error */
+            } else {
+                CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: playback thread reached the end", __debug__);
+                cdemu_audio_set_status(self, AUDIO_STATUS_COMPLETED); /* Audio operation successfully completed */
+            }
             break;
         }
 
-        /* Save current position */
+        /* Save current position; the ring holds a whole number of periods,
+         * so a period never wraps around */
+        CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: playing sectors 0x%X-0x%X", __debug__, self->priv->cur_sector, self->priv->cur_sector + num_sectors - 1);
         if (self->priv->cur_sector_ptr) {
-            *self->priv->cur_sector_ptr = self->priv->cur_sector;
+            g_atomic_int_set(self->priv->cur_sector_ptr, self->priv->cur_sector);
         }
-        self->priv->cur_sector++;
-
-        /*** Unlock device mutex ***/
-        g_mutex_unlock(self->priv->device_mutex);
 
-
-        /* Play sector */
-        mirage_sector_get_data(sector, &tmp_buffer, &tmp_len, NULL);
-        if (ao_play(self->priv->device, (gchar *)tmp_buffer, tmp_len) == 0) {
+        /* Play period */
+        period = self->priv->ring_buffer + (self->priv->ring_read % AUDIO_RING_SECTORS) * 2352;
+        if (ao_play(self->priv->device, (gchar *)period, num_sectors * 2352) == 0) {
             CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: playback error!", __debug__);
-            self->priv->status = AUDIO_STATUS_ERROR; /* Audio operation stopped due to error */
+            cdemu_audio_set_status(self, AUDIO_STATUS_ERROR); /* Audio operation stopped due to error */
             break;
         }
 
@@ -130,16 +254,40 @@ static gpointer cdemu_audio_playback_thread (CdemuAudio *self)
          * seems to return after the data is played, which is what we rely on for our
          * timing. However, null driver, as it has no device to write to, returns
          * immediately. Until this is fixed in libao, we'll have to emulate the delay
-         * ourselves */
+         * ourselves; we follow a clock, so that the delay does not drift */
+        num_played += num_sectors;
         if (self->priv->null_hack) {
-            g_usleep(1*G_USEC_PER_SEC/75); /* One sector = 1/75th of second */
+            gint64 now = g_get_monotonic_time();
+            gint64 due;
+
+            if (!clock_start) {
+                clock_start = now;
+            }
+
+            due = clock_start + (gint64)num_played * G_USEC_PER_SEC / 75; /* One sector = 1/75th of second */
+            if (due > now) {
+                g_usleep(due - now);
+            }
         }
 
-        g_object_unref(sector);
+        /* Release played sectors to the decoder */
+        g_mutex_lock(&self->priv->ring_mutex);
+        self->priv->ring_read += num_sectors;
+        self->priv->cur_sector += num_sectors;
+        g_cond_broadcast(&self->priv->ring_cond);
+        g_mutex_unlock(&self->priv->ring_mutex);
     }
 
     CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: playback thread end", __debug__);
 
+    /* Stop the decoder stage; the status is no longer "playing" */
+    if (self->priv->decoder_thread) {
+        g_thread_join(self->priv->decoder_thread);
+        self->priv->decoder_thread = NULL;
+    }
+    g_free(self->priv->ring_buffer);
+    self->priv->ring_buffer = NULL;
+
     /* Close audio device */
     CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: closing audio device", __debug__);
     ao_close(self->priv->device);
@@ -168,7 +316,7 @@ static void cdemu_audio_start_playing (CdemuAudio *self)
     cdemu_audio_join_thread(self);
 
     /* Set the status */
-    self->priv->status = AUDIO_STATUS_PLAYING;
+    cdemu_audio_set_status(self, AUDIO_STATUS_PLAYING);
 
     /* Start the playback thread; thread must be joinable, so we can wait for it
      * to end */
@@ -184,7 +332,7 @@ static void cdemu_audio_stop_playing (CdemuAudio *self, gint status)
 {
     /* We can't tell whether we're stopped or paused, so the upper layer needs
      * to provide us appropriate status */
-    self->priv->status = status;
+    cdemu_audio_set_status(self, status);
     cdemu_audio_join_thread(self);
 }
 
@@ -193,11 +341,10 @@ static void cdemu_audio_stop_playing (CdemuAudio *self, gint status)
  *                                 Public API                         *
 \**********************************************************************/
 /* NOTE: these functions are called from packet-command implementations,
- * and therefore with device_mutex held! */
-void cdemu_audio_initialize (CdemuAudio *self, const gchar *driver, gint *cur_sector_ptr, GMutex *device_mutex_ptr)
+ * and therefore with device_mutex (and possibly disc lock) held! */
+void cdemu_audio_initialize (CdemuAudio *self, const gchar *driver, gint *cur_sector_ptr)
 {
     self->priv->cur_sector_ptr = cur_sector_ptr;
-    self->priv->device_mutex = device_mutex_ptr;
 
     self->priv->status = AUDIO_STATUS_NOSTATUS;
 
@@ -222,7 +369,7 @@ void cdemu_audio_initialize (CdemuAudio *self, const gchar *driver, gint *cur_se
     /* *Don't* open the device here; we'll do it when we actually start playing */
 }
 
-gboolean cdemu_audio_start (CdemuAudio *self, gint start, gint end, MirageDisc *disc)
+gboolean cdemu_audio_start (CdemuAudio *self, gint start, gint end, MirageDisc *disc, CdemuSharedDisc *shared_disc)
 {
     gboolean succeeded = TRUE;
 
@@ -233,6 +380,7 @@ gboolean cdemu_audio_start (CdemuAudio *self, gint start, gint end, MirageDisc *
         self->priv->cur_sector = start;
         self->priv->end_sector = end;
         self->priv->disc = g_object_ref(disc); /* Reference disc for the time of playing */
+        self->priv->shared_disc = shared_disc ? cdemu_shared_disc_ref(shared_disc) : NULL;
 
         CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: starting playback (0x%X->0x%X)...", __debug__, self->priv->cur_sector, self->priv->end_sector);
         cdemu_audio_start_playing(self);
@@ -287,6 +435,11 @@ gboolean cdemu_audio_stop (CdemuAudio *self)
         /* Release disc reference */
         g_object_unref(self->priv->disc);
         self->priv->disc = NULL;
+
+        if (self->priv->shared_disc) {
+            cdemu_shared_disc_unref(self->priv->shared_disc);
+            self->priv->shared_disc = NULL;
+        }
     } else {
         CDEMU_DEBUG(self, DAEMON_DEBUG_AUDIOPLAY, "%s: stop called when not playing nor paused!", __debug__);
         succeeded = FALSE;
@@ -315,9 +468,14 @@ static void cdemu_audio_init (CdemuAudio *self)
     self->priv = cdemu_audio_get_instance_private(self);
 
     self->priv->playback_thread = NULL;
+    self->priv->decoder_thread = NULL;
+    self->priv->ring_buffer = NULL;
     self->priv->device = NULL;
     self->priv->disc = NULL;
-    self->priv->device_mutex = NULL;
+    self->priv->shared_disc = NULL;
+
+    g_mutex_init(&self->priv->ring_mutex);
+    g_cond_init(&self->priv->ring_cond);
 }
 
 static void cdemu_audio_finalize (GObject *gobject)
@@ -327,6 +485,9 @@ static void cdemu_audio_finalize (GObject *gobject)
     /* Force the playback to stop */
     cdemu_audio_stop(self);
 
+    g_cond_clear(&self->priv->ring_cond);
+    g_mutex_clear(&self->priv->ring_mutex);
+
     /* Chain up to the parent class */
     G_OBJECT_CLASS(cdemu_audio_parent_class)->finalize(gobject);
 }
@@ -42,6 +42,9 @@
 
 #include "types.h"
 
+#include "disc-cache.h"
+#include "reactor.h"
+#include "device-nodes.h"
 #include "audio.h"
 
 #include "mmc-features.h"
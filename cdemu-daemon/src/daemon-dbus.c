@@ -84,6 +84,14 @@ static const gchar introspection_xml[] =
     "            <arg name='loaded' type='b' direction='out'/>"
     "            <arg name='filenames' type='as' direction='out'/>"
     "        </method>"
+    "        <method name='DeviceGetStatistics'>"
+    "            <arg name='device_number' type='i' direction='in'/>"
+    "            <arg name='statistics' type='a{sv}' direction='out'/>"
+    "            <arg name='commands' type='a(yttttat)' direction='out'/>"
+    "        </method>"
+    "        <method name='DeviceResetStatistics'>"
+    "            <arg name='device_number' type='i' direction='in'/>"
+    "        </method>"
     "        <method name='DeviceLoad'>"
     "            <arg name='device_number' type='i' direction='in'/>"
     "            <arg name='filenames' type='as' direction='in'/>"
@@ -123,6 +131,13 @@ static const gchar introspection_xml[] =
     "        <signal name='DeviceMappingReady'>"
     "            <arg name='device_number' type='i' direction='out'/>"
     "        </signal>"
+    "        <signal name='DeviceLoadStarted'>"
+    "            <arg name='device_number' type='i' direction='out'/>"
+    "        </signal>"
+    "        <signal name='DeviceLoadFinished'>"
+    "            <arg name='device_number' type='i' direction='out'/>"
+    "            <arg name='succeeded' type='b' direction='out'/>"
+    "        </signal>"
     "        <signal name='DeviceAdded' />"
     "        <signal name='DeviceRemoved' />"
     "    </interface>"
@@ -255,6 +270,45 @@ static GVariantBuilder *encode_writer_parameter_sheet (MirageWriter *writer)
 }
 
 
+/* Returns error to the caller, mapping the error domain */
+static void cdemu_daemon_dbus_return_error (GDBusMethodInvocation *invocation, GError *error)
+{
+    /* We need to map the code */
+    if (error->domain == MIRAGE_ERROR) {
+        error->domain = g_quark_from_string(DBUS_ERROR_LIBMIRAGE);
+    } else if (error->domain == CDEMU_ERROR) {
+        error->domain = g_quark_from_string(DBUS_ERROR_CDEMU);
+    }
+    g_dbus_method_invocation_return_gerror(invocation, error);
+    g_error_free(error);
+}
+
+
+/* Completion of asynchronous DeviceLoad */
+typedef struct
+{
+    CdemuDaemon *daemon;
+    GDBusMethodInvocation *invocation;
+} CdemuDaemonLoadData;
+
+static void cdemu_daemon_dbus_device_load_finished (CdemuDevice *device, GAsyncResult *result, CdemuDaemonLoadData *data)
+{
+    GError *error = NULL;
+    gboolean succeeded = cdemu_device_load_disc_finish(device, result, &error);
+
+    cdemu_daemon_dbus_emit_device_load_finished(data->daemon, cdemu_device_get_device_number(device), succeeded);
+
+    if (succeeded) {
+        g_dbus_method_invocation_return_value(data->invocation, NULL);
+    } else {
+        cdemu_daemon_dbus_return_error(data->invocation, error);
+    }
+
+    g_object_unref(data->daemon);
+    g_free(data);
+}
+
+
 /* D-Bus method handler */
 static void cdemu_daemon_dbus_handle_method_call (GDBusConnection *connection G_GNUC_UNUSED, const gchar *sender G_GNUC_UNUSED, const gchar *object_path G_GNUC_UNUSED, const gchar *interface_name G_GNUC_UNUSED, const gchar *method_name, GVariant *parameters, GDBusMethodInvocation *invocation, CdemuDaemon *self)
 {
@@ -273,8 +327,20 @@ static void cdemu_daemon_dbus_handle_method_call (GDBusConnection *connection G_
         g_variant_get(parameters, "(i^as@a{sv})", &device_number, &filenames, &options);
         device = cdemu_daemon_get_device(self, device_number, &error);
         if (device) {
-            succeeded = cdemu_device_load_disc(device, filenames, options, &error);
+            /* Image is parsed on a worker thread; the reply is sent
+             * once loading completes, so that clients still receive
+             * errors (e.g., password requests) as method errors */
+            CdemuDaemonLoadData *data = g_new(CdemuDaemonLoadData, 1);
+            data->daemon = g_object_ref(self);
+            data->invocation = invocation;
+
+            cdemu_daemon_dbus_emit_device_load_started(self, device_number);
+            cdemu_device_load_disc_async(device, filenames, options, (GAsyncReadyCallback)cdemu_daemon_dbus_device_load_finished, data);
             g_object_unref(device);
+
+            g_strfreev(filenames);
+            g_variant_unref(options);
+            return;
         }
 
         g_strfreev(filenames);
@@ -322,6 +388,30 @@ static void cdemu_daemon_dbus_handle_method_call (GDBusConnection *connection G_
             ret = g_variant_new("(b^as)", loaded, filenames);
             g_strfreev(filenames);
 
+            succeeded = TRUE;
+            g_object_unref(device);
+        }
+    } else if (!g_strcmp0(method_name, "DeviceGetStatistics")) {
+        /* *** DeviceGetStatistics *** */
+        gint device_number;
+        CdemuDevice *device;
+
+        g_variant_get(parameters, "(i)", &device_number);
+        device = cdemu_daemon_get_device(self, device_number, &error);
+        if (device) {
+            ret = cdemu_device_get_statistics(device);
+            succeeded = TRUE;
+            g_object_unref(device);
+        }
+    } else if (!g_strcmp0(method_name, "DeviceResetStatistics")) {
+        /* *** DeviceResetStatistics *** */
+        gint device_number;
+        CdemuDevice *device;
+
+        g_variant_get(parameters, "(i)", &device_number);
+        device = cdemu_daemon_get_device(self, device_number, &error);
+        if (device) {
+            cdemu_device_reset_statistics(device);
             succeeded = TRUE;
             g_object_unref(device);
         }
@@ -484,14 +574,7 @@ static void cdemu_daemon_dbus_handle_method_call (GDBusConnection *connection G_
     if (succeeded) {
         g_dbus_method_invocation_return_value(invocation, ret);
     } else {
-        /* We need to map the code */
-        if (error->domain == MIRAGE_ERROR) {
-            error->domain = g_quark_from_string(DBUS_ERROR_LIBMIRAGE);
-        } else if (error->domain == CDEMU_ERROR) {
-            error->domain = g_quark_from_string(DBUS_ERROR_CDEMU);
-        }
-        g_dbus_method_invocation_return_gerror(invocation, error);
-        g_error_free(error);
+        cdemu_daemon_dbus_return_error(invocation, error);
     }
 }
 
@@ -673,6 +756,40 @@ void cdemu_daemon_dbus_emit_device_mapping_ready (CdemuDaemon *self, gint number
     );
 }
 
+void cdemu_daemon_dbus_emit_device_load_started (CdemuDaemon *self, gint number)
+{
+    if (!self->priv->connection) {
+        return;
+    }
+
+    g_dbus_connection_emit_signal(
+        self->priv->connection,
+        NULL,
+        "/Daemon",
+        CDEMU_DAEMON_DBUS_NAME,
+        "DeviceLoadStarted",
+        g_variant_new("(i)", number),
+        NULL
+    );
+}
+
+void cdemu_daemon_dbus_emit_device_load_finished (CdemuDaemon *self, gint number, gboolean succeeded)
+{
+    if (!self->priv->connection) {
+        return;
+    }
+
+    g_dbus_connection_emit_signal(
+        self->priv->connection,
+        NULL,
+        "/Daemon",
+        CDEMU_DAEMON_DBUS_NAME,
+        "DeviceLoadFinished",
+        g_variant_new("(ib)", number, succeeded),
+        NULL
+    );
+}
+
 void cdemu_daemon_dbus_emit_device_added (CdemuDaemon *self)
 {
     if (!self->priv->connection) {
@@ -32,12 +32,15 @@ struct _CdemuDaemonPrivate
     /* Options */
     gchar *ctl_device;
     gchar *audio_driver;
+    gchar *sysfs_root;
 
     guint cdemu_debug_mask; /* Default debug mask for CDEmu devices */
     guint mirage_debug_mask; /* Default debug mask for underlying libMirage context */
 
     /* Devices */
     GList *devices;
+    CdemuReactor *reactor; /* Shared I/O reactor; NULL when each device runs its own I/O thread */
+    CdemuUeventMonitor *uevent_monitor; /* Kernel uevents for device mapping; NULL if unavailable */
 
     /* D-Bus */
     GBusType bus_type;
@@ -69,5 +72,7 @@ void cdemu_daemon_dbus_cleanup (CdemuDaemon *self);
 void cdemu_daemon_dbus_emit_device_status_changed (CdemuDaemon *self, gint number);
 void cdemu_daemon_dbus_emit_device_option_changed (CdemuDaemon *self, gint number, const gchar *option);
 void cdemu_daemon_dbus_emit_device_mapping_ready (CdemuDaemon *self, gint number);
+void cdemu_daemon_dbus_emit_device_load_started (CdemuDaemon *self, gint number);
+void cdemu_daemon_dbus_emit_device_load_finished (CdemuDaemon *self, gint number, gboolean succeeded);
 void cdemu_daemon_dbus_emit_device_added (CdemuDaemon *self);
 void cdemu_daemon_dbus_emit_device_removed (CdemuDaemon *self);
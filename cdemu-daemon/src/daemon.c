@@ -67,7 +67,7 @@ static gboolean device_restart_callback (struct DaemonDevicePtr *data)
     cdemu_device_stop(device);
 
     /* Start the device */
-    if (!cdemu_device_start(device, self->priv->ctl_device)) {
+    if (!cdemu_device_start(device, self->priv->ctl_device, self->priv->reactor)) {
         CDEMU_DEBUG(device, DAEMON_DEBUG_WARNING, "%s: failed to restart device!", __debug__);
     } else {
         CDEMU_DEBUG(device, DAEMON_DEBUG_DEVICE, "%s: device started successfully", __debug__);
@@ -99,9 +99,11 @@ static void device_kernel_io_error_handler (CdemuDevice *device, CdemuDaemon *se
 gboolean cdemu_daemon_initialize_and_start (CdemuDaemon *self, const CdemuDaemonSettings *settings)
 {
     MirageContext *context;
+    GError *local_error = NULL;
 
     self->priv->ctl_device = g_strdup(settings->ctl_device);
     self->priv->audio_driver = g_strdup(settings->audio_driver);
+    self->priv->sysfs_root = g_strdup(settings->sysfs_root);
 
     self->priv->cdemu_debug_mask = settings->cdemu_debug_mask;
     self->priv->mirage_debug_mask = settings->mirage_debug_mask;
@@ -165,6 +167,29 @@ gboolean cdemu_daemon_initialize_and_start (CdemuDaemon *self, const CdemuDaemon
         CDEMU_DEBUG(self, DAEMON_DEBUG_SLEEP_HANDLER, "%s: system sleep handler is disabled via settings.", __debug__);
     }
 
+    /* Set up the shared I/O reactor, if requested */
+    if (settings->use_reactor) {
+        GError *error = NULL;
+
+        self->priv->reactor = cdemu_reactor_new(&error);
+        if (self->priv->reactor) {
+            CDEMU_DEBUG(self, DAEMON_DEBUG_DEVICE, "%s: devices will be served by shared I/O reactor", __debug__);
+        } else {
+            /* Non-fatal error - fall back to per-device I/O threads */
+            CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to set up I/O reactor: %s! Falling back to per-device I/O threads.", __debug__, error->message);
+            g_error_free(error);
+        }
+    }
+
+    /* Listen for kernel uevents on behalf of all devices, so that their
+     * mapping setup can complete as soon as device nodes are registered */
+    self->priv->uevent_monitor = cdemu_uevent_monitor_new(&local_error);
+    if (!self->priv->uevent_monitor) {
+        /* Non-fatal error - devices fall back to polling */
+        CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to set up uevent monitor: %s! Falling back to polling for device mapping.", __debug__, local_error->message);
+        g_clear_error(&local_error);
+    }
+
     /* Create desired number of devices */
     for (gint i = 0; i < settings->num_devices; i++) {
         if (!cdemu_daemon_add_device(self)) {
@@ -231,7 +256,7 @@ void cdemu_daemon_prepare_for_system_sleep (CdemuDaemon *self, gboolean start)
         /* Start devices. */
         CDEMU_DEBUG(self, DAEMON_DEBUG_SLEEP_HANDLER, "%s: re-starting devices...", __debug__);
         for (iter = self->priv->devices; iter != NULL; iter = g_list_next(iter)) {
-            if (!cdemu_device_start(iter->data, self->priv->ctl_device)) {
+            if (!cdemu_device_start(iter->data, self->priv->ctl_device, self->priv->reactor)) {
                 CDEMU_DEBUG(iter->data, DAEMON_DEBUG_WARNING, "%s: failed to start device after wake up!", __debug__);
             }
         }
@@ -287,7 +312,7 @@ gboolean cdemu_daemon_add_device (CdemuDaemon *self)
 
     /* Create and initialize device object */
     device = g_object_new(CDEMU_TYPE_DEVICE, NULL);
-    if (!cdemu_device_initialize(device, device_number, self->priv->audio_driver, self->priv->cdemu_debug_mask, self->priv->mirage_debug_mask)) {
+    if (!cdemu_device_initialize(device, device_number, self->priv->audio_driver, self->priv->sysfs_root, self->priv->uevent_monitor, self->priv->cdemu_debug_mask, self->priv->mirage_debug_mask)) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to initialize device #%i", __debug__, device_number);
         g_object_unref(device);
         return FALSE;
@@ -303,7 +328,7 @@ gboolean cdemu_daemon_add_device (CdemuDaemon *self)
     g_signal_connect(device, "mapping-ready", G_CALLBACK(device_mapping_ready_handler), self);
 
     /* Start device */
-    if (!cdemu_device_start(device, self->priv->ctl_device)) {
+    if (!cdemu_device_start(device, self->priv->ctl_device, self->priv->reactor)) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to start device #%i!", __debug__, device_number);
         g_object_unref(device);
         return FALSE;
@@ -358,8 +383,11 @@ static void cdemu_daemon_init (CdemuDaemon *self)
 
     self->priv->main_loop = NULL;
     self->priv->devices = NULL;
+    self->priv->reactor = NULL;
+    self->priv->uevent_monitor = NULL;
     self->priv->ctl_device = NULL;
     self->priv->audio_driver = NULL;
+    self->priv->sysfs_root = NULL;
 
     self->priv->cdemu_debug_mask = 0;
     self->priv->mirage_debug_mask = 0;
@@ -403,11 +431,25 @@ static void cdemu_daemon_dispose (GObject *gobject)
     for (GList *entry = self->priv->devices; entry; entry = entry->next) {
         CdemuDevice *dev = entry->data;
         if (dev) {
+            /* Stop explicitly, as the device may outlive the reactor */
+            cdemu_device_stop(dev);
             g_object_unref(dev);
             entry->data = NULL;
         }
     }
 
+    /* Free the I/O reactor, now that no device is registered with it */
+    if (self->priv->reactor) {
+        cdemu_reactor_free(self->priv->reactor);
+        self->priv->reactor = NULL;
+    }
+
+    /* Free the uevent monitor, now that no device is watching it */
+    if (self->priv->uevent_monitor) {
+        cdemu_uevent_monitor_free(self->priv->uevent_monitor);
+        self->priv->uevent_monitor = NULL;
+    }
+
     /* Chain up to the parent class */
     G_OBJECT_CLASS(cdemu_daemon_parent_class)->dispose(gobject);
 }
@@ -418,6 +460,7 @@ static void cdemu_daemon_finalize (GObject *gobject)
 
     g_free(self->priv->ctl_device);
     g_free(self->priv->audio_driver);
+    g_free(self->priv->sysfs_root);
 
     /* Free devices list */
     g_list_free(self->priv->devices);
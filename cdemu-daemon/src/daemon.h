@@ -29,8 +29,10 @@ struct _CdemuDaemonSettings
 
     gchar *ctl_device;
     gchar *audio_driver;
+    gchar *sysfs_root;
 
     gint num_devices;
+    gboolean use_reactor;
 
     guint cdemu_debug_mask;
     guint mirage_debug_mask;
@@ -161,6 +161,165 @@ static gint read_sector_data (MirageSector *sector, MirageDisc *disc, gint addre
 }
 
 
+/* Fast path for READ CD requests for all main channel fields (and,
+ * optionally, raw P-W subchannel) on images that store full raw sectors:
+ * contiguous runs are read straight from fragments' streams into the OUT
+ * buffer, bypassing sector objects. Returns the number of transferred
+ * sectors; the rest of request (if any) needs to be served via sector
+ * objects, which also take care of error reporting. */
+static gint read_cd_raw_sectors (CdemuDevice *self, MirageDisc *disc, gint start_address, gint num_sectors, gint exp_sect_type, gboolean subchannel)
+{
+    gint sector_size = subchannel ? 2352 + 96 : 2352;
+    gint address = start_address;
+
+    while (address < start_address + num_sectors) {
+        MirageTrack *track;
+        MirageFragment *fragment;
+        gint relative_address;
+        gint max_sectors, num_read;
+
+        /* Limit the run to the space left in OUT buffer */
+        max_sectors = (self->priv->cmd->out_len - self->priv->cmd_out_buffer_pos) / sector_size;
+        max_sectors = MIN(max_sectors, start_address + num_sectors - address);
+        if (max_sectors <= 0) {
+            break;
+        }
+
+        track = mirage_disc_get_track_by_address(disc, address, NULL);
+        if (!track) {
+            break;
+        }
+
+        /* Expected sector type must hold for the whole track */
+        if (exp_sect_type && (gint)mirage_track_get_sector_type(track) != exp_sect_type) {
+            g_object_unref(track);
+            break;
+        }
+
+        relative_address = address - mirage_track_layout_get_start_sector(track);
+        fragment = mirage_track_get_fragment_by_address(track, relative_address, NULL);
+        g_object_unref(track);
+        if (!fragment) {
+            break;
+        }
+
+        if (!mirage_fragment_can_read_raw_sectors(fragment, subchannel)) {
+            g_object_unref(fragment);
+            break;
+        }
+
+        num_read = mirage_fragment_read_raw_sectors(fragment, relative_address - mirage_fragment_get_address(fragment), max_sectors, subchannel, self->priv->cmd->out + self->priv->cmd_out_buffer_pos, NULL);
+        g_object_unref(fragment);
+        if (num_read <= 0) {
+            break;
+        }
+
+        CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: read %d raw sectors at 0x%X directly into OUT buffer", __debug__, num_read, address);
+
+        self->priv->cmd_out_buffer_pos += num_read * sector_size;
+        address += num_read;
+
+        /* Needed for some other commands */
+        self->priv->current_address = address - 1;
+    }
+
+    return address - start_address;
+}
+
+
+/**********************************************************************\
+ *                              Disc lock                             *
+\**********************************************************************/
+/* Loaded disc may be shared with other devices; commands that emulate
+ * access delay hold its lock only while calling into libMirage, so that
+ * other devices are not stalled while we sleep */
+static void cdemu_device_lock_disc (CdemuDevice *self)
+{
+    if (self->priv->shared_disc) {
+        cdemu_shared_disc_lock(self->priv->shared_disc);
+    }
+}
+
+static void cdemu_device_unlock_disc (CdemuDevice *self)
+{
+    if (self->priv->shared_disc) {
+        cdemu_shared_disc_unlock(self->priv->shared_disc);
+    }
+}
+
+
+/**********************************************************************\
+ *                           Response cache                           *
+\**********************************************************************/
+/* Responses to READ TOC/PMA/ATIP, READ DISC INFORMATION and READ TRACK
+ * INFORMATION depend only on the disc layout, which does not change
+ * once the disc is loaded (or closed, in case of recordable disc). Since
+ * these commands are polled frequently, we keep formatted responses,
+ * keyed by opcode and the relevant CDB fields. */
+#define RESPONSE_CACHE_MAX_ENTRIES 256
+
+static gboolean response_cache_is_usable (CdemuDevice *self)
+{
+    /* While disc is being recorded, the layout changes with every
+     * written sector */
+    return self->priv->loaded && (!self->priv->recordable_disc || self->priv->disc_closed);
+}
+
+static gint64 response_cache_key (guint8 opcode, guint8 param1, guint8 param2, guint32 param3)
+{
+    return ((gint64)opcode << 48) | ((gint64)param1 << 40) | ((gint64)param2 << 32) | param3;
+}
+
+static gboolean response_cache_lookup (CdemuDevice *self, gint64 key)
+{
+    GBytes *response;
+    gsize response_size;
+    const guint8 *response_data;
+
+    if (!response_cache_is_usable(self)) {
+        return FALSE;
+    }
+
+    response = g_hash_table_lookup(self->priv->response_cache, &key);
+    if (!response) {
+        return FALSE;
+    }
+
+    response_data = g_bytes_get_data(response, &response_size);
+
+    CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: returning cached response (%" G_GSIZE_FORMAT " bytes)", __debug__, response_size);
+
+    memcpy(self->priv->buffer, response_data, response_size);
+    self->priv->buffer_size = response_size;
+
+    return TRUE;
+}
+
+static void response_cache_store (CdemuDevice *self, gint64 key)
+{
+    if (!response_cache_is_usable(self)) {
+        return;
+    }
+
+    /* Track information can be requested by LBA, so bound the number
+     * of entries */
+    if (g_hash_table_size(self->priv->response_cache) >= RESPONSE_CACHE_MAX_ENTRIES) {
+        return;
+    }
+
+    gint64 *cache_key = g_new(gint64, 1);
+    *cache_key = key;
+
+    g_hash_table_insert(self->priv->response_cache, cache_key, g_bytes_new(self->priv->buffer, self->priv->buffer_size));
+}
+
+void cdemu_device_invalidate_response_cache (CdemuDevice *self)
+{
+    CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: invalidating response cache", __debug__);
+    g_hash_table_remove_all(self->priv->response_cache);
+}
+
+
 /**********************************************************************\
  *                     Packet command implementations                 *
 \**********************************************************************/
@@ -223,39 +382,42 @@ static gboolean command_get_configuration (CdemuDevice *self, const guint8 *raw_
 
     CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: requesting features from 0x%X on, with RT flag 0x%X", __debug__, GUINT16_FROM_BE(cdb->sfn), cdb->rt);
 
-    /* Go over *all* features, and copy them according to RT value */
-    for (GList *entry = self->priv->features_list; entry; entry = entry->next) {
-        struct FeatureGeneral *feature = entry->data;
-
-        /* We want this feature copied if:
-         *  a) RT is 0x00 and feature's code >= SFN
-         *  b) RT is 0x01, feature's code >= SFN and feature has 'current' bit set
-         *  c) RT is 0x02 and feature's code == SFN
-         *
-         * NOTE: because in case c) we break loop as soon as a feature is copied and
-         * because we have features sorted in ascending order, we can use comparison
-         * "feature's code >= SFN" in all cases. */
-        if (GUINT16_FROM_BE(feature->code) >= GUINT16_FROM_BE(cdb->sfn)) {
-            if ((cdb->rt == 0x00) ||
-                (cdb->rt == 0x01 && feature->cur) ||
-                (cdb->rt == 0x02 && GUINT16_FROM_BE(feature->code) == GUINT16_FROM_BE(cdb->sfn))) {
-
-                CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: copying feature 0x%X", __debug__, GUINT16_FROM_BE(feature->code));
-
-                /* Copy feature */
-                memcpy(ret_data, feature, feature->length + 4);
-                self->priv->buffer_size += feature->length + 4;
-                ret_data += feature->length + 4;
-
-                /* Break the loop if RT is 0x02 */
-                if (cdb->rt == 0x02) {
-                    CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: got the feature we wanted (0x%X), breaking the loop", __debug__, GUINT16_FROM_BE(cdb->sfn));
-                    break;
-                }
+    /* Copy pre-serialized feature descriptors according to RT value:
+     *  a) RT is 0x00: all features with code >= SFN
+     *  b) RT is 0x01: features with code >= SFN that have 'current' bit set
+     *  c) RT is 0x02: feature with code == SFN */
+    gint sfn = MIN(GUINT16_FROM_BE(cdb->sfn), NUM_FEATURE_CODES);
+    const struct FeatureDescriptors *descriptors = NULL;
+    gint offset = 0, length = 0;
+
+    switch (cdb->rt) {
+        case 0x00: {
+            descriptors = &self->priv->features_all;
+            offset = descriptors->offsets[sfn];
+            length = descriptors->size - offset;
+            break;
+        }
+        case 0x01: {
+            descriptors = &self->priv->features_current;
+            offset = descriptors->offsets[sfn];
+            length = descriptors->size - offset;
+            break;
+        }
+        case 0x02: {
+            descriptors = &self->priv->features_all;
+            if (sfn < NUM_FEATURE_CODES) {
+                offset = descriptors->offsets[sfn];
+                length = descriptors->offsets[sfn + 1] - offset;
             }
+            break;
         }
     }
 
+    if (length) {
+        memcpy(ret_data, descriptors->data + offset, length);
+        self->priv->buffer_size += length;
+    }
+
     /* Header */
     ret_header->length = GUINT32_TO_BE(self->priv->buffer_size - 4);
     ret_header->cur_profile = GUINT16_TO_BE(self->priv->current_profile);
@@ -295,13 +457,14 @@ static gboolean command_get_event_status_notification (CdemuDevice *self, const
         ret_header->nea = 0;
         ret_header->not_class = 4; /* Media notification class */
 
-        /* Report current media event and then reset it */
-        CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: reporting media event 0x%X", __debug__, self->priv->media_event);
-        ret_desc->event = self->priv->media_event;
-        self->priv->media_event = MEDIA_EVENT_NOCHANGE;
+        /* Report current media event and then reset it; the event is
+         * consumed before the medium status is read, so that a new-media
+         * event is never reported together with an empty drive */
+        ret_desc->event = cdemu_device_take_media_event(self);
+        CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: reporting media event 0x%X", __debug__, ret_desc->event);
 
         /* Media status */
-        ret_desc->present = self->priv->loaded;
+        ret_desc->present = g_atomic_int_get(&self->priv->loaded);
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: medium present: %d", __debug__, ret_desc->present);
     }
 
@@ -825,51 +988,44 @@ static gboolean command_mode_sense (CdemuDevice *self, const guint8 *raw_cdb)
         return FALSE;
     }
 
-    /* Go over *all* pages, and if we want all pages, copy 'em all, otherwise
-     * copy just the one we've got request for and break the loop */
-    gboolean page_found = FALSE;
-    for (GList *entry = self->priv->mode_pages_list; entry; entry = entry->next) {
-        struct ModePageEntry *page_entry = entry->data;
-        struct ModePageGeneral *mode_page = page_entry->page_current;
+    /* Copy either all pages (in ascending order of their codes), or just
+     * the one we've got request for */
+    gint first_code = (page_code == 0x3F) ? 0 : page_code;
+    gint last_code = (page_code == 0x3F) ? NUM_MODE_PAGE_CODES - 1 : page_code;
 
-        /* Check if we want this page copied */
-        if (page_code == 0x3F || (page_code == mode_page->code)) {
-            switch (pc) {
-                case 0x00: {
-                    /* Current values */
-                    mode_page = page_entry->page_current;
-                    break;
-                }
-                case 0x01: {
-                    /* Changeable values */
-                    mode_page = page_entry->page_mask;
-                    break;
-                }
-                case 0x02: {
-                    /* Default value */
-                    mode_page = page_entry->page_default;
-                    break;
-                }
-                default: {
-                    CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: PC value is 0x%X and it shouldn't be!", __debug__, pc);
-                    break;
-                }
-            }
+    for (gint code = first_code; code <= last_code; code++) {
+        struct ModePageEntry *page_entry = self->priv->mode_pages[code];
+        struct ModePageGeneral *mode_page;
 
-            memcpy(ret_data, mode_page, mode_page->length + 2);
-            self->priv->buffer_size += mode_page->length + 2;
-            ret_data += mode_page->length + 2;
+        if (!page_entry) {
+            continue;
+        }
 
-            if (page_code != 0x3F) {
-                CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: got the page we wanted (0x%X), breaking the loop", __debug__, page_code);
-                page_found = TRUE;
+        switch (pc) {
+            case 0x01: {
+                /* Changeable values */
+                mode_page = page_entry->page_mask;
+                break;
+            }
+            case 0x02: {
+                /* Default value */
+                mode_page = page_entry->page_default;
+                break;
+            }
+            default: {
+                /* Current values */
+                mode_page = page_entry->page_current;
                 break;
             }
         }
+
+        memcpy(ret_data, mode_page, mode_page->length + 2);
+        self->priv->buffer_size += mode_page->length + 2;
+        ret_data += mode_page->length + 2;
     }
 
     /* If we aren't returning all pages, check if page was found */
-    if (page_code != 0x3F && !page_found) {
+    if (page_code != 0x3F && !self->priv->mode_pages[page_code]) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: page 0x%X not found!", __debug__, page_code);
         cdemu_device_write_sense(self, ILLEGAL_REQUEST, INVALID_FIELD_IN_CDB);
         return FALSE;
@@ -968,7 +1124,7 @@ static gboolean command_play_audio (CdemuDevice *self, const guint8 *raw_cdb)
     CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: playing from sector 0x%X to sector 0x%X", __debug__, start_sector, end_sector);
 
     /* Play */
-    if (!cdemu_audio_start(CDEMU_AUDIO(self->priv->audio_play), start_sector, end_sector, self->priv->disc)) {
+    if (!cdemu_audio_start(CDEMU_AUDIO(self->priv->audio_play), start_sector, end_sector, self->priv->disc, self->priv->shared_disc)) {
         /* FIXME: write sense */
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: failed to start audio play!", __debug__);
         return FALSE;
@@ -1028,6 +1184,8 @@ static gboolean command_read (CdemuDevice *self, const guint8 *raw_cdb)
     }
     MirageDisc *disc = self->priv->disc;
 
+    cdemu_device_lock_disc(self);
+
     /* Set up delay emulation */
     cdemu_device_delay_begin(self, start_address, num_sectors);
 
@@ -1039,6 +1197,7 @@ static gboolean command_read (CdemuDevice *self, const guint8 *raw_cdb)
             CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: failed to read sector: %s", __debug__, error->message);
             g_error_free(error);
             cdemu_device_write_sense_full(self, ILLEGAL_REQUEST, LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE, 0, address);
+            cdemu_device_unlock_disc(self);
             return FALSE;
         }
 
@@ -1058,6 +1217,7 @@ static gboolean command_read (CdemuDevice *self, const guint8 *raw_cdb)
                 CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: bad sector detected, triggering read error!", __debug__);
                 g_object_unref(sector);
                 cdemu_device_write_sense_full(self, MEDIUM_ERROR, UNRECOVERED_READ_ERROR, 0, address);
+                cdemu_device_unlock_disc(self);
                 return FALSE;
             }
         }
@@ -1071,6 +1231,7 @@ static gboolean command_read (CdemuDevice *self, const guint8 *raw_cdb)
             CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: sector 0x%X does not have 2048-byte user data (%i)", __debug__, address, tmp_len);
             g_object_unref(sector);
             cdemu_device_write_sense_full(self, ILLEGAL_REQUEST, ILLEGAL_MODE_FOR_THIS_TRACK, 1, address);
+            cdemu_device_unlock_disc(self);
             return FALSE;
         }
 
@@ -1085,6 +1246,8 @@ static gboolean command_read (CdemuDevice *self, const guint8 *raw_cdb)
         cdemu_device_write_buffer(self, self->priv->buffer_size);
     }
 
+    cdemu_device_unlock_disc(self);
+
     /* Perform delay emulation */
     cdemu_device_delay_finalize(self);
 
@@ -1232,12 +1395,15 @@ static gboolean command_read_cd (CdemuDevice *self, const guint8 *raw_cdb)
     GError *error = NULL;
     gint prev_sector_type G_GNUC_UNUSED;
 
+    cdemu_device_lock_disc(self);
+
     /* Read first sector to determine its type */
     first_sector = mirage_disc_get_sector(disc, start_address, &error);
     if (!first_sector) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: failed to get start sector: %s", __debug__, error->message);
         g_error_free(error);
         cdemu_device_write_sense_full(self, ILLEGAL_REQUEST, LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE, 0, start_address);
+        cdemu_device_unlock_disc(self);
         return FALSE;
     }
     prev_sector_type = mirage_sector_get_sector_type(first_sector);
@@ -1246,9 +1412,20 @@ static gboolean command_read_cd (CdemuDevice *self, const guint8 *raw_cdb)
     /* Set up delay emulation */
     cdemu_device_delay_begin(self, start_address, num_sectors);
 
-    /* Process each sector */
+    /* Full raw sectors (optionally with raw P-W subchannel) can be read
+     * directly; bad sector emulation needs to verify each sector, though */
+    gint num_direct = 0;
+    const struct READ_CD_MSCB *mcsb = (const struct READ_CD_MSCB *)&raw_cdb[9];
+
+    if (mcsb->sync && mcsb->header && mcsb->subheader && mcsb->data && mcsb->edc_ecc && !mcsb->c2_error
+        && (subchannel_mode == 0x00 || subchannel_mode == 0x01)
+        && !(self->priv->bad_sector_emulation && !p_0x01->dcr)) {
+        num_direct = read_cd_raw_sectors(self, disc, start_address, num_sectors, exp_sect_type, subchannel_mode == 0x01);
+    }
+
+    /* Process each (remaining) sector */
     CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: start sector: 0x%X (%i); start + num: 0x%X (%i)", __debug__, start_address, start_address, start_address+num_sectors, start_address+num_sectors);
-    for (gint address = start_address; address < start_address + num_sectors; address++) {
+    for (gint address = start_address + num_direct; address < start_address + num_sectors; address++) {
         MirageSector *sector;
 
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: reading sector 0x%X (%i)", __debug__, address, address);
@@ -1258,6 +1435,7 @@ static gboolean command_read_cd (CdemuDevice *self, const guint8 *raw_cdb)
             CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: failed to get sector: %s!", __debug__, error->message);
             g_error_free(error);
             cdemu_device_write_sense_full(self, ILLEGAL_REQUEST, LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE, 0, address);
+            cdemu_device_unlock_disc(self);
             return FALSE;
         }
 
@@ -1274,6 +1452,7 @@ static gboolean command_read_cd (CdemuDevice *self, const guint8 *raw_cdb)
             CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: expected sector type mismatch (expecting %i, got %i)!", __debug__, exp_sect_type, sector_type);
             g_object_unref(sector);
             cdemu_device_write_sense_full(self, ILLEGAL_REQUEST, ILLEGAL_MODE_FOR_THIS_TRACK, 1, address);
+            cdemu_device_unlock_disc(self);
             return FALSE;
         }
 
@@ -1285,6 +1464,7 @@ static gboolean command_read_cd (CdemuDevice *self, const guint8 *raw_cdb)
                 CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: previous sector type (%i) different from current one (%i)!", __debug__, prev_sector_type, sector_type);
                 g_object_unref(sector);
                 cdemu_device_write_sense_full(self, ILLEGAL_REQUEST, ILLEGAL_MODE_FOR_THIS_TRACK, 0, address);
+                cdemu_device_unlock_disc(self);
                 return FALSE;
             }
         }
@@ -1301,6 +1481,7 @@ static gboolean command_read_cd (CdemuDevice *self, const guint8 *raw_cdb)
                 CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: bad sector detected, triggering read error!", __debug__);
                 g_object_unref(sector);
                 cdemu_device_write_sense_full(self, MEDIUM_ERROR, UNRECOVERED_READ_ERROR, 0, address);
+                cdemu_device_unlock_disc(self);
                 return FALSE;
             }
         }
@@ -1312,6 +1493,7 @@ static gboolean command_read_cd (CdemuDevice *self, const guint8 *raw_cdb)
             g_error_free(error);
             g_object_unref(sector);
             cdemu_device_write_sense_full(self, ILLEGAL_REQUEST, ILLEGAL_MODE_FOR_THIS_TRACK, 0, address);
+            cdemu_device_unlock_disc(self);
             return FALSE;
         }
 
@@ -1328,6 +1510,8 @@ static gboolean command_read_cd (CdemuDevice *self, const guint8 *raw_cdb)
         cdemu_device_write_buffer(self, self->priv->buffer_size);
     }
 
+    cdemu_device_unlock_disc(self);
+
     /* Perform delay emulation */
     cdemu_device_delay_finalize(self);
 
@@ -1338,6 +1522,7 @@ static gboolean command_read_cd (CdemuDevice *self, const guint8 *raw_cdb)
 static gboolean command_read_disc_information (CdemuDevice *self, const guint8 *raw_cdb)
 {
     struct READ_DISC_INFORMATION_CDB *cdb = (struct READ_DISC_INFORMATION_CDB *)raw_cdb;
+    gint64 cache_key = response_cache_key(READ_DISC_INFORMATION, cdb->type, 0, 0);
 
     /* Check if we have medium loaded */
     if (!self->priv->loaded) {
@@ -1346,6 +1531,12 @@ static gboolean command_read_disc_information (CdemuDevice *self, const guint8 *
         return FALSE;
     }
 
+    /* Try cached response first */
+    if (response_cache_lookup(self, cache_key)) {
+        cdemu_device_write_buffer(self, self->priv->buffer_size);
+        return TRUE;
+    }
+
     switch (cdb->type) {
         case 0x000: {
             struct READ_DISC_INFORMATION_Data *ret_data = (struct READ_DISC_INFORMATION_Data *)self->priv->buffer;
@@ -1493,6 +1684,8 @@ static gboolean command_read_disc_information (CdemuDevice *self, const guint8 *
         }
     }
 
+    response_cache_store(self, cache_key);
+
     /* Write data */
     cdemu_device_write_buffer(self, self->priv->buffer_size);
 
@@ -1816,6 +2009,13 @@ static gboolean command_read_toc_pma_atip (CdemuDevice *self, const guint8 *raw_
         }
     }
 
+    /* Try cached response first */
+    gint64 cache_key = response_cache_key(READ_TOC_PMA_ATIP, cdb->format, cdb->time, cdb->number);
+    if (response_cache_lookup(self, cache_key)) {
+        cdemu_device_write_buffer(self, GUINT16_FROM_BE(cdb->length));
+        return TRUE;
+    }
+
     switch (cdb->format) {
         case 0x00: {
             CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: formatted TOC", __debug__);
@@ -2237,6 +2437,8 @@ static gboolean command_read_toc_pma_atip (CdemuDevice *self, const guint8 *raw_
         }
     }
 
+    response_cache_store(self, cache_key);
+
     /* Write data */
     cdemu_device_write_buffer(self, GUINT16_FROM_BE(cdb->length));
 
@@ -2264,6 +2466,13 @@ static gboolean command_read_track_information (CdemuDevice *self, const guint8
 
     gint number = GUINT32_FROM_BE(cdb->number);
 
+    /* Try cached response first */
+    gint64 cache_key = response_cache_key(READ_TRACK_INFORMATION, cdb->type, 0, number);
+    if (response_cache_lookup(self, cache_key)) {
+        cdemu_device_write_buffer(self, GUINT16_FROM_BE(cdb->length));
+        return TRUE;
+    }
+
     if (cdb->type == 0x00) {
         /* LBA */
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: requested track containing sector 0x%X", __debug__, number);
@@ -2410,6 +2619,8 @@ static gboolean command_read_track_information (CdemuDevice *self, const guint8
     ret_data->track_number1 = track_number & 0xFF;
     ret_data->session_number1 = session_number & 0xFF;
 
+    response_cache_store(self, cache_key);
+
     /* Write data */
     cdemu_device_write_buffer(self, GUINT16_FROM_BE(cdb->length));
 
@@ -2538,6 +2749,8 @@ static gboolean command_seek (CdemuDevice *self, const guint8 *raw_cdb)
         return FALSE;
     }
 
+    cdemu_device_lock_disc(self);
+
     /* Set up delay emulation (0 sectors since we're not actually reading data) */
     cdemu_device_delay_begin(self, target_address, 0);
 
@@ -2547,6 +2760,7 @@ static gboolean command_seek (CdemuDevice *self, const guint8 *raw_cdb)
     if (!sector) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: failed to get sector: %s", __debug__, error->message);
         g_error_free(error);
+        cdemu_device_unlock_disc(self);
         cdemu_device_write_sense_full(self, ILLEGAL_REQUEST, LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE, 0, target_address);
         return FALSE;
     }
@@ -2556,6 +2770,8 @@ static gboolean command_seek (CdemuDevice *self, const guint8 *raw_cdb)
     /* Release sector */
     g_object_unref(sector);
 
+    cdemu_device_unlock_disc(self);
+
     /* Perform delay emulation */
     cdemu_device_delay_finalize(self);
 
@@ -2651,6 +2867,14 @@ static gboolean command_start_stop_unit (CdemuDevice *self, const guint8 *raw_cd
     if (cdb->lo_ej) {
         if (!cdb->start) {
 
+            /* Close the track that is being recorded first, so that
+             * failure to write out its data can be reported */
+            if (self->priv->open_track && self->priv->recording && !self->priv->locked) {
+                if (!self->priv->recording->close_track(self)) {
+                    return FALSE;
+                }
+            }
+
             CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: unloading disc...", __debug__);
             if (!cdemu_device_unload_disc_private(self, NULL)) {
                 CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: failed to unload disc", __debug__);
@@ -2691,7 +2915,7 @@ static gboolean command_test_unit_ready (CdemuDevice *self, const guint8 *raw_cd
     /*struct TEST_UNIT_READY_CDB *cdb = (struct TEST_UNIT_READY_CDB *)raw_cdb;*/
 
     /* Check if we have medium loaded */
-    if (!self->priv->loaded) {
+    if (!g_atomic_int_get(&self->priv->loaded)) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: medium not present", __debug__);
         cdemu_device_write_sense(self, NOT_READY, MEDIUM_NOT_PRESENT);
         return FALSE;
@@ -2700,9 +2924,8 @@ static gboolean command_test_unit_ready (CdemuDevice *self, const guint8 *raw_cd
     /* SCSI requires us to report UNIT ATTENTION with NOT READY TO READY CHANGE,
      * MEDIUM MAY HAVE CHANGED whenever medium changes... this is required for
      * linux SCSI layer to set medium block size properly upon disc insertion */
-    if (self->priv->media_event == MEDIA_EVENT_NEW_MEDIA) {
+    if (g_atomic_int_compare_and_exchange(&self->priv->media_event, MEDIA_EVENT_NEW_MEDIA, MEDIA_EVENT_NOCHANGE)) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: reporting media changed", __debug__);
-        self->priv->media_event = MEDIA_EVENT_NOCHANGE;
         cdemu_device_write_sense(self, UNIT_ATTENTION, NOT_READY_TO_READY_CHANGE_MEDIUM_MAY_HAVE_CHANGED);
         return FALSE;
     }
@@ -2746,9 +2969,224 @@ static gboolean command_write (CdemuDevice *self, const guint8 *raw_cdb)
 /**********************************************************************\
  *                      Packet command switch                         *
 \**********************************************************************/
+/* Packet command table, indexed by operation code, so that commands are
+ * dispatched in constant time; unimplemented opcodes have no handler.
+ * Lock-free commands touch only the atomically published device state
+ * (see cdemu_device_take_media_event()), and are executed without taking
+ * the device lock, so that polling does not stall behind data transfers.
+ * Commands that emulate access delay take the lock of (possibly shared)
+ * disc themselves, and release it before sleeping; all others are
+ * executed with the disc lock held */
+static const struct {
+    gchar *debug_name;
+    gboolean (*implementation)(CdemuDevice *, const guint8 *);
+    gboolean interrupt_audio_play;
+    gboolean lock_free;
+    gboolean own_disc_lock;
+} packet_commands[256] = {
+    [CLOSE_TRACK_SESSION] = {
+        "CLOSE TRACK/SESSION",
+        command_close_track_session,
+        TRUE,
+    },
+    [GET_EVENT_STATUS_NOTIFICATION] = {
+        "GET EVENT/STATUS NOTIFICATION",
+        command_get_event_status_notification,
+        FALSE,
+        TRUE,
+    },
+    [GET_CONFIGURATION] = {
+        "GET CONFIGURATION",
+        command_get_configuration,
+        FALSE,
+    },
+    [GET_PERFORMANCE] = {
+        "GET PERFORMANCE",
+        command_get_performance,
+        FALSE,
+    },
+    [INQUIRY] = {
+        "INQUIRY",
+        command_inquiry,
+        FALSE,
+    },
+    [MODE_SELECT_6] = {
+        "MODE SELECT (6)",
+        command_mode_select,
+        FALSE,
+    },
+    [MODE_SELECT_10] = {
+        "MODE SELECT (10)",
+        command_mode_select,
+        FALSE,
+    },
+    [MODE_SENSE_6] = {
+        "MODE SENSE (6)",
+        command_mode_sense,
+        FALSE,
+    },
+    [MODE_SENSE_10] = {
+        "MODE SENSE (10)",
+        command_mode_sense,
+        FALSE,
+    },
+    [PAUSE_RESUME] = {
+        "PAUSE/RESUME",
+        command_pause_resume,
+        FALSE, /* Well, it does... but in its own, unique way :P */
+    },
+    [PLAY_AUDIO_10] = {
+        "PLAY AUDIO (10)",
+        command_play_audio,
+        TRUE,
+    },
+    [PLAY_AUDIO_12] = {
+        "PLAY AUDIO (12)",
+        command_play_audio,
+        TRUE,
+    },
+    [PLAY_AUDIO_MSF] = {
+        "PLAY AUDIO MSF",
+        command_play_audio,
+        TRUE,
+    },
+    [PREVENT_ALLOW_MEDIUM_REMOVAL] = {
+        "PREVENT/ALLOW MEDIUM REMOVAL",
+        command_prevent_allow_medium_removal,
+        FALSE,
+    },
+    [READ_10] = {
+        "READ (10)",
+        command_read,
+        TRUE,
+        FALSE,
+        TRUE,
+    },
+    [READ_12] = {
+        "READ (12)",
+        command_read,
+        TRUE,
+        FALSE,
+        TRUE,
+    },
+    [READ_BUFFER_CAPACITY] = {
+        "READ BUFFER CAPACITY",
+        command_read_buffer_capacity,
+        FALSE,
+    },
+    [READ_CAPACITY] = {
+        "READ CAPACITY",
+        command_read_capacity,
+        FALSE,
+    },
+    [READ_CD] = {
+        "READ CD",
+        command_read_cd,
+        FALSE,
+        FALSE,
+        TRUE,
+    },
+    [READ_CD_MSF] = {
+        "READ CD MSF",
+        command_read_cd,
+        FALSE,
+        FALSE,
+        TRUE,
+    },
+    [READ_DISC_INFORMATION] = {
+        "READ DISC INFORMATION",
+        command_read_disc_information,
+        TRUE,
+    },
+    [READ_DISC_STRUCTURE] = {
+        "READ DISC STRUCTURE",
+        command_read_disc_structure,
+        TRUE,
+    },
+    [READ_TOC_PMA_ATIP] = {
+        "READ TOC/PMA/ATIP",
+        command_read_toc_pma_atip,
+        FALSE,
+    },
+    [READ_TRACK_INFORMATION] = {
+        "READ TRACK INFORMATION",
+        command_read_track_information,
+        TRUE,
+    },
+    [READ_SUBCHANNEL] = {
+        "READ SUBCHANNEL",
+        command_read_subchannel,
+        FALSE,
+    },
+    [REPORT_KEY] = {
+        "REPORT KEY",
+        command_report_key,
+        TRUE,
+    },
+    [REQUEST_SENSE] = {
+        "REQUEST SENSE",
+        command_request_sense,
+        FALSE,
+    },
+    [RESERVE_TRACK] = {
+        "RESERVE TRACK",
+        command_reserve_track,
+        TRUE,
+    },
+    [SEEK_10] = {
+        "SEEK (10)",
+        command_seek,
+        TRUE,
+        FALSE,
+        TRUE,
+    },
+    [SEND_CUE_SHEET] = {
+        "SEND CUE SHEET",
+        command_send_cue_sheet,
+        TRUE,
+    },
+    [SET_CD_SPEED] = {
+        "SET CD SPEED",
+        command_set_cd_speed,
+        TRUE,
+    },
+    [SET_STREAMING] = {
+        "SET STREAMING",
+        command_set_streaming,
+        TRUE,
+    },
+    [START_STOP_UNIT] = {
+        "START/STOP UNIT",
+        command_start_stop_unit,
+        TRUE,
+    },
+    [SYNCHRONIZE_CACHE] = {
+        "SYNCHRONIZE CACHE",
+        command_synchronize_cache,
+        FALSE,
+    },
+    [TEST_UNIT_READY] = {
+        "TEST UNIT READY",
+        command_test_unit_ready,
+        FALSE,
+        TRUE,
+    },
+    [WRITE_10] = {
+        "WRITE (10)",
+        command_write,
+        TRUE,
+    },
+    [WRITE_12] = {
+        "WRITE (12)",
+        command_write,
+        TRUE,
+    },
+};
+
 gint cdemu_device_execute_command (CdemuDevice *self, const guint8 *cdb)
 {
     SenseStatus status = CHECK_CONDITION;
+    gint64 command_begin = g_get_monotonic_time();
 
     /* Flush buffer */
     cdemu_device_flush_buffer(self);
@@ -2757,273 +3195,73 @@ gint cdemu_device_execute_command (CdemuDevice *self, const guint8 *cdb)
         cdb[0], cdb[1], cdb[2], cdb[3], cdb[4], cdb[5],
         cdb[6], cdb[7], cdb[8], cdb[9], cdb[10], cdb[11]);
 
-    /* Packet command table */
-    static const struct {
-        gchar *debug_name;
-        gboolean (*implementation)(CdemuDevice *, const guint8 *);
-        PacketCommand cmd;
-        gboolean interrupt_audio_play;
-    } packet_commands[] = {
-        {
-            "CLOSE TRACK/SESSION",
-            command_close_track_session,
-            CLOSE_TRACK_SESSION,
-            TRUE,
-        },
-        {
-            "GET EVENT/STATUS NOTIFICATION",
-            command_get_event_status_notification,
-            GET_EVENT_STATUS_NOTIFICATION,
-            FALSE,
-        },
-        {
-            "GET CONFIGURATION",
-            command_get_configuration,
-            GET_CONFIGURATION,
-            FALSE,
-        },
-        {
-            "GET PERFORMANCE",
-            command_get_performance,
-            GET_PERFORMANCE,
-            FALSE,
-        },
-        {
-            "INQUIRY",
-            command_inquiry,
-            INQUIRY,
-            FALSE,
-        },
-        {
-            "MODE SELECT (6)",
-            command_mode_select,
-            MODE_SELECT_6,
-            FALSE,
-        },
-        {
-            "MODE SELECT (10)",
-            command_mode_select,
-            MODE_SELECT_10,
-            FALSE,
-        },
-        {
-            "MODE SENSE (6)",
-            command_mode_sense,
-            MODE_SENSE_6,
-            FALSE,
-        },
-        {
-            "MODE SENSE (10)",
-            command_mode_sense,
-            MODE_SENSE_10,
-            FALSE,
-        },
-        {
-            "PAUSE/RESUME",
-            command_pause_resume,
-            PAUSE_RESUME,
-            FALSE, /* Well, it does... but in its own, unique way :P */
-        },
-        {
-            "PLAY AUDIO (10)",
-            command_play_audio,
-            PLAY_AUDIO_10,
-            TRUE,
-        },
-        {
-            "PLAY AUDIO (12)",
-            command_play_audio,
-            PLAY_AUDIO_12,
-            TRUE,
-        },
-        {
-            "PLAY AUDIO MSF",
-            command_play_audio,
-            PLAY_AUDIO_MSF,
-            TRUE,
-        },
-        {
-            "PREVENT/ALLOW MEDIUM REMOVAL",
-            command_prevent_allow_medium_removal,
-            PREVENT_ALLOW_MEDIUM_REMOVAL,
-            FALSE,
-        },
-        {
-            "READ (10)",
-            command_read,
-            READ_10,
-            TRUE,
-        },
-        {
-            "READ (12)",
-            command_read,
-            READ_12,
-            TRUE,
-        },
-        {
-            "READ BUFFER CAPACITY",
-            command_read_buffer_capacity,
-            READ_BUFFER_CAPACITY,
-            FALSE,
-        },
-        {
-            "READ CAPACITY",
-            command_read_capacity,
-            READ_CAPACITY,
-            FALSE,
-        },
-        {
-            "READ CD",
-            command_read_cd,
-            READ_CD,
-            FALSE,
-        },
-        {
-            "READ CD MSF",
-            command_read_cd,
-            READ_CD_MSF,
-            FALSE,
-        },
-        {
-            "READ DISC INFORMATION",
-            command_read_disc_information,
-            READ_DISC_INFORMATION,
-            TRUE,
-        },
-        {
-            "READ DISC STRUCTURE",
-            command_read_disc_structure,
-            READ_DISC_STRUCTURE,
-            TRUE,
-        },
-        {
-            "READ TOC/PMA/ATIP",
-            command_read_toc_pma_atip,
-            READ_TOC_PMA_ATIP,
-            FALSE,
-        },
-        {
-            "READ TRACK INFORMATION",
-            command_read_track_information,
-            READ_TRACK_INFORMATION,
-            TRUE,
-        },
-        {
-            "READ SUBCHANNEL",
-            command_read_subchannel,
-            READ_SUBCHANNEL,
-            FALSE,
-        },
-        {
-            "REPORT KEY",
-            command_report_key,
-            REPORT_KEY,
-            TRUE,
-        },
-        {
-            "REQUEST SENSE",
-            command_request_sense,
-            REQUEST_SENSE,
-            FALSE,
-        },
-        {
-            "RESERVE TRACK",
-            command_reserve_track,
-            RESERVE_TRACK,
-            TRUE,
-        },
-        {
-            "SEEK (10)",
-            command_seek,
-            SEEK_10,
-            TRUE,
-        },
-        {
-            "SEND CUE SHEET",
-            command_send_cue_sheet,
-            SEND_CUE_SHEET,
-            TRUE,
-        },
-        {
-            "SET CD SPEED",
-            command_set_cd_speed,
-            SET_CD_SPEED,
-            TRUE,
-        },
-        {
-            "SET STREAMING",
-            command_set_streaming,
-            SET_STREAMING,
-            TRUE,
-        },
-        {
-            "START/STOP UNIT",
-            command_start_stop_unit,
-            START_STOP_UNIT,
-            TRUE,
-        },
-        {
-            "SYNCHRONIZE CACHE",
-            command_synchronize_cache,
-            SYNCHRONIZE_CACHE,
-            FALSE,
-        },
-        {
-            "TEST UNIT READY",
-            command_test_unit_ready,
-            TEST_UNIT_READY,
-            FALSE,
-        },
-        {
-            "WRITE (10)",
-            command_write,
-            WRITE_10,
-            TRUE,
-        },
-        {
-            "WRITE (12)",
-            command_write,
-            WRITE_12,
-            TRUE,
-        },
-    };
-
-    /* Find the command and execute its implementation handler */
-    for (guint i = 0; i < G_N_ELEMENTS(packet_commands); i++) {
-        if (packet_commands[i].cmd == cdb[0]) {
-            gboolean succeeded = FALSE;
-
-            CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: command: %s", __debug__, packet_commands[i].debug_name);
-
-            /* Lock */
-            g_mutex_lock(self->priv->device_mutex);
-
-            /* FIXME: If there is deferred error sense available, return CHECK CONDITION
-             * with that sense. We do not execute requested command. */
-
-            /* Stop audio play if command interrupts it */
-            if (packet_commands[i].interrupt_audio_play) {
-                gint audio_status = cdemu_audio_get_status(CDEMU_AUDIO(self->priv->audio_play));
-                if (audio_status == AUDIO_STATUS_PLAYING || audio_status == AUDIO_STATUS_PAUSED) {
-                    cdemu_audio_stop(CDEMU_AUDIO(self->priv->audio_play));
-                }
-            }
-            /* Execute the command */
-            succeeded = packet_commands[i].implementation(self, cdb);
+    /* Look up the command and execute its implementation handler */
+    if (packet_commands[cdb[0]].implementation) {
+        gboolean succeeded = FALSE;
+        CdemuSharedDisc *shared_disc;
+
+        CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: command: %s", __debug__, packet_commands[cdb[0]].debug_name);
+
+        /* Status polling is answered from the published device state,
+         * without waiting for the command that currently holds the lock */
+        if (packet_commands[cdb[0]].lock_free) {
+            succeeded = packet_commands[cdb[0]].implementation(self, cdb);
             status = (succeeded) ? GOOD : CHECK_CONDITION;
 
-            /* Unlock */
-            g_mutex_unlock(self->priv->device_mutex);
+            cdemu_device_statistics_record_command(self, cdb[0], g_get_monotonic_time() - command_begin, succeeded ? self->priv->cmd_out_buffer_pos : 0);
 
             CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: command completed with status %d", __debug__, status);
 
             return status;
         }
+
+        /* Lock */
+        g_mutex_lock(self->priv->device_mutex);
+
+        /* Loaded disc may be shared with other devices; hold its lock
+         * (and a reference, in case the command unloads it), unless the
+         * command takes it only around its libMirage calls */
+        shared_disc = packet_commands[cdb[0]].own_disc_lock ? NULL : self->priv->shared_disc;
+        if (shared_disc) {
+            cdemu_shared_disc_ref(shared_disc);
+            cdemu_shared_disc_lock(shared_disc);
+        }
+
+        /* FIXME: If there is deferred error sense available, return CHECK CONDITION
+         * with that sense. We do not execute requested command. */
+
+        /* Stop audio play if command interrupts it */
+        if (packet_commands[cdb[0]].interrupt_audio_play) {
+            gint audio_status = cdemu_audio_get_status(CDEMU_AUDIO(self->priv->audio_play));
+            if (audio_status == AUDIO_STATUS_PLAYING || audio_status == AUDIO_STATUS_PAUSED) {
+                cdemu_audio_stop(CDEMU_AUDIO(self->priv->audio_play));
+            }
+        }
+        /* Execute the command */
+        succeeded = packet_commands[cdb[0]].implementation(self, cdb);
+        status = (succeeded) ? GOOD : CHECK_CONDITION;
+
+        /* Update statistics; on failure, the OUT buffer holds
+         * sense data, which we do not count as transferred data */
+        cdemu_device_statistics_record_command(self, cdb[0], g_get_monotonic_time() - command_begin, succeeded ? self->priv->cmd_out_buffer_pos + self->priv->cmd_in_buffer_pos : 0);
+
+        /* Unlock */
+        if (shared_disc) {
+            cdemu_shared_disc_unlock(shared_disc);
+            cdemu_shared_disc_unref(shared_disc);
+        }
+        g_mutex_unlock(self->priv->device_mutex);
+
+        CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: command completed with status %d", __debug__, status);
+
+        return status;
     }
 
     /* Command not found */
     CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: packet command %02Xh not implemented yet!", __debug__, cdb[0]);
     cdemu_device_write_sense(self, ILLEGAL_REQUEST, INVALID_COMMAND_OPERATION_CODE);
 
+    cdemu_device_statistics_record_command(self, cdb[0], g_get_monotonic_time() - command_begin, 0);
+
     return status;
 }
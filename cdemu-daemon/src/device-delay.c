@@ -129,18 +129,19 @@ void cdemu_device_delay_begin (CdemuDevice *self, gint address, gint num_sectors
 
 void cdemu_device_delay_finalize (CdemuDevice *self)
 {
+    /* Get current time */
+    gint64 delay_now = g_get_monotonic_time();
+
+    /* Calculate time difference; this is the time spent fetching data */
+    gint64 delay_diff = delay_now - self->priv->delay_begin;
+    self->priv->statistics_fetch_time += delay_diff;
+
     /* If there's no delay to perform, don't bother doing anything... */
     if (!self->priv->delay_amount) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_DELAY, "%s: no delay to perform", __debug__);
         return;
     }
 
-    /* Get current time */
-    gint64 delay_now = g_get_monotonic_time();
-
-    /* Calculate time difference */
-    gint64 delay_diff = delay_now - self->priv->delay_begin;
-
     CDEMU_DEBUG(self, DAEMON_DEBUG_DELAY, "%s: calculated delay: %" G_GINT64_FORMAT " microseconds", __debug__, self->priv->delay_amount);
     CDEMU_DEBUG(self, DAEMON_DEBUG_DELAY, "%s: processing time: %" G_GINT64_FORMAT " microseconds", __debug__, delay_diff);
 
@@ -153,6 +154,15 @@ void cdemu_device_delay_finalize (CdemuDevice *self)
         return;
     }
 
+    self->priv->statistics_delay_time += delay;
+
+    /* Reactor workers are shared by all devices, so the delay must not
+     * block them; instead, the reactor holds back the response */
+    if (self->priv->reactor) {
+        self->priv->delay_deferred = delay;
+        return;
+    }
+
     g_usleep(delay);
 }
 
@@ -24,53 +24,59 @@
 
 
 /**********************************************************************\
- *                                Helpers                             *
+ *                      Feature declaration helpers                   *
 \**********************************************************************/
-static gint compare_features (struct FeatureGeneral *feature1, struct FeatureGeneral *feature2)
+static struct FeatureGeneral *initialize_feature (gint code, gint size)
 {
-    gint code1 = GUINT16_FROM_BE(feature1->code);
-    gint code2 = GUINT16_FROM_BE(feature2->code);
+    struct FeatureGeneral *feature = g_malloc0(size);
 
-    if (code1 < code2) {
-        return -1;
-    } else if (code1 > code2) {
-        return 1;
-    } else {
-        return 0;
-    }
+    feature->code = GUINT16_TO_BE(code);
+    feature->length = size - 4;
+
+    return feature;
 }
 
-static gint find_feature (struct FeatureGeneral *feature, gconstpointer code_ptr)
+static void append_feature (CdemuDevice *self, struct FeatureGeneral *feature)
 {
-    gint feat_code = GUINT16_FROM_BE(feature->code);
-    gint code = GPOINTER_TO_INT(code_ptr);
-
-    if (feat_code < code) {
-        return -1;
-    } else if (feat_code > code) {
-        return 1;
-    } else {
-        return 0;
-    }
+    /* Store feature in the slot for its code */
+    self->priv->features[GUINT16_FROM_BE(feature->code)] = feature;
 }
 
 
 /**********************************************************************\
- *                      Feature declaration helpers                   *
+ *                   GET CONFIGURATION response data                  *
 \**********************************************************************/
-static struct FeatureGeneral *initialize_feature (gint code, gint size)
+static void serialize_features (struct FeatureDescriptors *descriptors, struct FeatureGeneral **features, gboolean current_only)
 {
-    struct FeatureGeneral *feature = g_malloc0(size);
+    gint size = 0;
 
-    feature->code = GUINT16_TO_BE(code);
-    feature->length = size - 4;
+    /* Compute offsets, and the total size */
+    for (gint code = 0; code < NUM_FEATURE_CODES; code++) {
+        descriptors->offsets[code] = size;
+        if (features[code] && (!current_only || features[code]->cur)) {
+            size += features[code]->length + 4;
+        }
+    }
+    descriptors->offsets[NUM_FEATURE_CODES] = size;
 
-    return feature;
+    /* Copy the descriptors */
+    g_free(descriptors->data);
+    descriptors->data = g_malloc(MAX(size, 1));
+    descriptors->size = size;
+
+    for (gint code = 0; code < NUM_FEATURE_CODES; code++) {
+        if (features[code] && (!current_only || features[code]->cur)) {
+            memcpy(descriptors->data + descriptors->offsets[code], features[code], features[code]->length + 4);
+        }
+    }
 }
 
-static GList *append_feature (GList *list, struct FeatureGeneral *feature)
+static void cdemu_device_features_serialize (CdemuDevice *self)
 {
-    return g_list_insert_sorted(list, feature, (GCompareFunc)compare_features);
+    /* Features change only along with the profile, so we keep their
+     * descriptors ready to be copied into GET CONFIGURATION response */
+    serialize_features(&self->priv->features_all, self->priv->features, FALSE);
+    serialize_features(&self->priv->features_current, self->priv->features, TRUE);
 }
 
 
@@ -79,14 +85,11 @@ static GList *append_feature (GList *list, struct FeatureGeneral *feature)
 \**********************************************************************/
 gpointer cdemu_device_get_feature (CdemuDevice *self, gint feature)
 {
-    GList *entry = NULL;
-    entry = g_list_find_custom(self->priv->features_list, GINT_TO_POINTER(feature), (GCompareFunc)find_feature);
-
-    if (entry) {
-        return entry->data;
+    if (feature < 0 || feature >= NUM_FEATURE_CODES) {
+        return NULL;
     }
 
-    return NULL;
+    return self->priv->features[feature];
 }
 
 void cdemu_device_features_init (CdemuDevice *self)
@@ -109,7 +112,7 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->profiles[ProfileIndex_BDROM].profile = GUINT16_TO_BE(PROFILE_BDROM);
         feature->profiles[ProfileIndex_BDR_SRM].profile = GUINT16_TO_BE(PROFILE_BDR_SRM);
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
     /* Feature 0x0001: Core Feature */
     /* IMPLEMENTATION NOTE: persistent; INF8090 requires us to set version to
@@ -125,7 +128,7 @@ void cdemu_device_features_init (CdemuDevice *self)
 
         feature->interface = GUINT32_TO_BE(0x02); /* ATAPI */
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x0002: Morphing Feature */
@@ -138,7 +141,7 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->per = 1;
         feature->ver = 0x01;
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x0003: Removable Medium Feature */
@@ -155,7 +158,7 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->eject = 1;
         feature->lock = 1;
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x0010: Random Readable Feature */
@@ -170,13 +173,13 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->blocking = GUINT16_TO_BE(1);
         feature->pp = 1;
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x001D: Multi-read Feature */
     /* IMPLEMENTATION NOTE: non-persistent; version left at 0x00. No other content. */
     general_feature = initialize_feature(0x001D, sizeof(struct Feature_0x001D));
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x001E: CD Read Feature */
@@ -191,7 +194,7 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->c2flags = 1;
         feature->cdtext = 1;
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x001F: DVD Read Feature */
@@ -207,7 +210,7 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->multi110 = 1;
         feature->dualr = 1;
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x0021: Incremental Streaming Writable Feature */
@@ -225,7 +228,7 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->num_link_sizes = 1; /* 1 for CD-R */
         feature->link_sizes[0] = 7; /* As per MMC3 */
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
     /* Feature 0x002B: DVD+R Feature */
     /* IMPLEMENTATION NOTE: non-persistent; version set to 0x00 as per MMC5 */
@@ -237,7 +240,7 @@ void cdemu_device_features_init (CdemuDevice *self)
 
         feature->write = 1; /* We support DVD+R writing */
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x002D: CD Track at Once Feature */
@@ -257,7 +260,7 @@ void cdemu_device_features_init (CdemuDevice *self)
 
         feature->data_type_supported = 0xFFFF; /* Support all */
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
     /* Feature 0x0040: BD Read Feature */
     /* IMPLEMENTATION NOTE: non-persistent; version set to 0x00 as per MMC5 */
@@ -283,7 +286,7 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->class2_bdrom_read_support = 0xFFFF;
         feature->class3_bdrom_read_support = 0xFFFF;
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
     /* Feature 0x0041: BD Write Feature */
     /* IMPLEMENTATION NOTE: non-persistent; version set to 0x00 as per MMC5 */
@@ -304,7 +307,7 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->class2_bdr_write_support = 0xFFFF;
         feature->class3_bdr_write_support = 0xFFFF;
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
     /* Feature 0x0100: Power Management Feature */
     /* IMPLEMENTATION NOTE: persistent; version left at 0x00. No other content. */
@@ -314,7 +317,7 @@ void cdemu_device_features_init (CdemuDevice *self)
 
         feature->per = 1;
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x0103: CD External Audio Play Feature */
@@ -330,7 +333,7 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->scan = 1;
         feature->vol_lvls = GUINT16_TO_BE(0x0100);
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x0106: DVD CSS Feature */
@@ -342,7 +345,7 @@ void cdemu_device_features_init (CdemuDevice *self)
 
         feature->css_ver = 0x01;
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
 
     /* Feature 0x0107: Real Time Streaming Feature */
@@ -360,7 +363,7 @@ void cdemu_device_features_init (CdemuDevice *self)
         feature->wspd = 1;
         feature->sw = 1;
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
 
     /* Feature 0x010A: Disc Control Blocks Feature */
     /* IMPLEMENTATION NOTE: non-persistent; version is set to 0x00 as per MMC3.
@@ -393,19 +396,23 @@ void cdemu_device_features_init (CdemuDevice *self)
         descriptor[2] = 0x43; /* C */
         descriptor[3] = 0x00; /* ver. 0 */
     }
-    self->priv->features_list = append_feature(self->priv->features_list, general_feature);
+    append_feature(self, general_feature);
+
+    cdemu_device_features_serialize(self);
 }
 
 
 void cdemu_device_features_cleanup (CdemuDevice *self)
 {
-    for (GList *entry = self->priv->features_list; entry; entry = entry->next) {
-        if (entry->data) {
-            g_free(entry->data);
-        }
+    for (gint i = 0; i < NUM_FEATURE_CODES; i++) {
+        g_free(self->priv->features[i]);
+        self->priv->features[i] = NULL;
     }
-    g_list_free(self->priv->features_list);
 
+    g_free(self->priv->features_all.data);
+    self->priv->features_all.data = NULL;
+    g_free(self->priv->features_current.data);
+    self->priv->features_current.data = NULL;
 }
 
 
@@ -631,8 +638,12 @@ static void cdemu_device_set_current_features (CdemuDevice *self, const guint32
 {
     /* Go over the features list and reset 'current' bits of features that
      * don't have 'persistent' bit set */
-    for (GList *entry = self->priv->features_list; entry; entry = entry->next) {
-        struct FeatureGeneral *feature = entry->data;
+    for (gint i = 0; i < NUM_FEATURE_CODES; i++) {
+        struct FeatureGeneral *feature = self->priv->features[i];
+
+        if (!feature) {
+            continue;
+        }
 
         if (!feature->per) {
             feature->cur = 0;
@@ -733,4 +744,7 @@ void cdemu_device_set_profile (CdemuDevice *self, ProfileIndex profile_index)
 
     /* Modify write speed descriptors */
     cdemu_device_set_write_speed_descriptors(self, profile_index);
+
+    /* Re-build GET CONFIGURATION response data */
+    cdemu_device_features_serialize(self);
 }
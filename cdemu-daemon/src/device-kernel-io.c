@@ -151,9 +151,16 @@ void cdemu_device_write_sense (CdemuDevice *self, SenseKey sense_key, guint16 as
 /**********************************************************************\
  *                    Kernel <-> userspace I/O                        *
 \**********************************************************************/
-static gboolean cdemu_device_io_handler (GIOChannel *source, GIOCondition condition G_GNUC_UNUSED, CdemuDevice *self)
+/* Reads a single request from the control device, executes it and writes
+ * back the response. Called either from the device's own I/O thread or
+ * from a reactor worker; never concurrently for the same device. In
+ * reactor mode, delay emulation does not sleep; instead, the delay is
+ * returned, and the caller sends the response using
+ * cdemu_device_send_response() once it has elapsed. Returns 0 if the
+ * response has been sent (or there was none to send). */
+gint64 cdemu_device_process_request (CdemuDevice *self)
 {
-    gint fd = g_io_channel_unix_get_fd(source);
+    gint fd = g_io_channel_unix_get_fd(self->priv->io_channel);
     gssize ret;
 
     CdemuCommand cmd;
@@ -166,11 +173,16 @@ static gboolean cdemu_device_io_handler (GIOChannel *source, GIOCondition condit
     CDEMU_DEBUG(self, DAEMON_DEBUG_KERNEL_IO, "%s: reading request", __debug__);
 
     ret = read(fd, vreq, BUF_SIZE);
+    if (ret < 0 && errno == EAGAIN) {
+        /* Spurious wake-up; nothing to do */
+        CDEMU_DEBUG(self, DAEMON_DEBUG_KERNEL_IO, "%s: no request pending", __debug__);
+        return 0;
+    }
     if (ret < (gssize)sizeof(struct vhba_request)) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to read request from control device (%" G_GSIZE_MODIFIER "d bytes; at least %" G_GSIZE_MODIFIER "d required)!", __debug__, ret, sizeof(struct vhba_request));
         /* Signal the kernel I/O error, so daemon can restart the device */
         g_signal_emit_by_name(self, "kernel-io-error", NULL);
-        return TRUE;
+        return 0;
     }
 
     CDEMU_DEBUG(self, DAEMON_DEBUG_KERNEL_IO, "%s: successfully read request; cmd %02Xh, in/out len %d, tag %d", __debug__, vreq->cdb[0], vreq->data_len, vreq->tag);
@@ -194,12 +206,33 @@ static gboolean cdemu_device_io_handler (GIOChannel *source, GIOCondition condit
     self->priv->cmd_out_buffer_pos = 0;
     self->priv->cmd_in_buffer_pos = 0;
 
+    self->priv->delay_deferred = 0;
+
     /* Note that vreq and vres share buffer */
     vres->tag = vreq->tag;
     vres->status = cdemu_device_execute_command(self, cmd.cdb);
 
     vres->data_len = self->priv->cmd_out_buffer_pos;
 
+    /* Response stays in the buffer until the delay elapses; no other
+     * request is read in the meantime */
+    if (self->priv->delay_deferred > 0) {
+        CDEMU_DEBUG(self, DAEMON_DEBUG_KERNEL_IO, "%s: deferring response by %" G_GINT64_FORMAT " microseconds", __debug__, self->priv->delay_deferred);
+        return self->priv->delay_deferred;
+    }
+
+    cdemu_device_send_response(self);
+
+    return 0;
+}
+
+/* Writes back the response of the last processed request */
+void cdemu_device_send_response (CdemuDevice *self)
+{
+    gint fd = g_io_channel_unix_get_fd(self->priv->io_channel);
+    struct vhba_response *vres = (gpointer)self->priv->kernel_io_buffer;
+    gssize ret;
+
     /* Write response */
     CDEMU_DEBUG(self, DAEMON_DEBUG_KERNEL_IO, "%s: writing response", __debug__);
 
@@ -208,11 +241,15 @@ static gboolean cdemu_device_io_handler (GIOChannel *source, GIOCondition condit
         CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to write response to control device (%" G_GSIZE_MODIFIER "d bytes; at least %" G_GSIZE_MODIFIER "d required)!", __debug__, ret, sizeof(struct vhba_response));
         /* Signal the kernel I/O error, so daemon can restart the device */
         g_signal_emit_by_name(self, "kernel-io-error", NULL);
-        return TRUE;
+        return;
     }
 
     CDEMU_DEBUG(self, DAEMON_DEBUG_KERNEL_IO, "%s: I/O handler done", __debug__);
+}
 
+static gboolean cdemu_device_io_handler (GIOChannel *source G_GNUC_UNUSED, GIOCondition condition G_GNUC_UNUSED, CdemuDevice *self)
+{
+    cdemu_device_process_request(self);
     return TRUE;
 }
 
@@ -230,7 +267,7 @@ static gpointer cdemu_device_io_thread (CdemuDevice *self)
 /**********************************************************************\
  *                      Start/stop functions                          *
 \**********************************************************************/
-gboolean cdemu_device_start (CdemuDevice *self, const gchar *ctl_device)
+gboolean cdemu_device_start (CdemuDevice *self, const gchar *ctl_device, CdemuReactor *reactor)
 {
     GError *local_error = NULL;
 
@@ -266,11 +303,30 @@ gboolean cdemu_device_start (CdemuDevice *self, const gchar *ctl_device)
         self->priv->device_serial = g_strdup_printf("%03d", device_number);
     }
 
+    /* In reactor mode, the control device is watched by the shared
+     * reactor, and the device has no I/O thread of its own */
+    if (reactor) {
+        if (!cdemu_reactor_add_device(reactor, self, g_io_channel_unix_get_fd(self->priv->io_channel), &local_error)) {
+            CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to register control device with reactor: %s", __debug__, local_error->message);
+            g_error_free(local_error);
+            return FALSE;
+        }
+        self->priv->reactor = reactor;
+
+        /* Set up device mapping; completes asynchronously in the main thread */
+        cdemu_device_start_mapping(self);
+
+        return TRUE;
+    }
+
     /* Create I/O watch */
     self->priv->io_watch = g_io_create_watch(self->priv->io_channel, G_IO_IN);
     g_source_set_callback(self->priv->io_watch, G_SOURCE_FUNC(cdemu_device_io_handler), self, NULL);
     g_source_attach(self->priv->io_watch, self->priv->main_context);
 
+    /* Set up device mapping; completes asynchronously in the I/O thread */
+    cdemu_device_start_mapping(self);
+
     /* Start I/O thread */
     self->priv->io_thread = g_thread_try_new("I/O thread", (GThreadFunc)cdemu_device_io_thread, self, &local_error);
 
@@ -285,6 +341,13 @@ gboolean cdemu_device_start (CdemuDevice *self, const gchar *ctl_device)
 
 void cdemu_device_stop (CdemuDevice *self)
 {
+    /* Unregister from the reactor; waits for the request that is being
+     * processed, if any */
+    if (self->priv->reactor) {
+        cdemu_reactor_remove_device(self->priv->reactor, self);
+        self->priv->reactor = NULL;
+    }
+
     /* Stop the I/O thread */
     if (self->priv->main_loop) {
         if (g_main_loop_is_running(self->priv->main_loop)) {
@@ -314,6 +377,9 @@ void cdemu_device_stop (CdemuDevice *self)
         self->priv->io_thread = NULL;
     }
 
+    /* Stop device mapping setup, if still in progress */
+    cdemu_device_stop_mapping(self);
+
     /* Clear device mappings */
     if (self->priv->device_sg) {
         g_free(self->priv->device_sg);
@@ -26,34 +26,36 @@
 /**********************************************************************\
  *                              Load disc                             *
 \**********************************************************************/
-static gboolean cdemu_device_load_disc_private (CdemuDevice *self, gchar **filenames, GVariant *options, GError **error)
+typedef struct
+{
+    gchar **filenames;
+    GVariant *options;
+} CdemuDeviceLoadData;
+
+static void cdemu_device_load_data_free (CdemuDeviceLoadData *data)
+{
+    g_strfreev(data->filenames);
+    g_variant_unref(data->options);
+    g_free(data);
+}
+
+/* Called with device mutex held; attaches the (possibly shared) disc to
+ * the device. The disc keeps the context it was loaded with, while the
+ * device keeps its own context for debug settings and blank discs */
+static gboolean cdemu_device_load_disc_private (CdemuDevice *self, CdemuSharedDisc *shared_disc, GError **error)
 {
     gint medium_type;
 
-    /* Well, we won't do anything if we're already loaded */
+    /* Device may have been loaded (e.g., blank disc created) while the
+     * image was being parsed */
     if (self->priv->loaded) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: device already loaded", __debug__);
         g_set_error(error, CDEMU_ERROR, CDEMU_ERROR_ALREADY_LOADED, Q_("Device is already loaded!"));
         return FALSE;
     }
 
-    /* Set options to the context */
-    mirage_context_clear_options(self->priv->mirage_context);
-    for (guint i = 0; i < g_variant_n_children(options); i++) {
-        gchar *key;
-        GVariant *value;
-
-        g_variant_get_child(options, i, "{sv}", &key, &value);
-        mirage_context_set_option(self->priv->mirage_context, key, value);
-    }
-
-    /* Load... */
-    self->priv->disc = mirage_context_load_image(self->priv->mirage_context, filenames, error);
-
-    /* Check if loading succeeded */
-    if (!self->priv->disc) {
-        return FALSE;
-    }
+    self->priv->shared_disc = cdemu_shared_disc_ref(shared_disc);
+    self->priv->disc = g_object_ref(shared_disc->disc);
 
     /* Mark loaded discs as non-writable */
     self->priv->recordable_disc = FALSE;
@@ -61,7 +63,7 @@ static gboolean cdemu_device_load_disc_private (CdemuDevice *self, gchar **filen
     self->priv->disc_closed = TRUE;
 
     /* Loading succeeded */
-    self->priv->loaded = TRUE;
+    g_atomic_int_set(&self->priv->loaded, TRUE);
 
     /* Set current profile (and modify feature flags accordingly */
     medium_type = mirage_disc_get_medium_type(self->priv->disc);
@@ -85,24 +87,112 @@ static gboolean cdemu_device_load_disc_private (CdemuDevice *self, gchar **filen
     }
 
     /* Signal event */
-    self->priv->media_event = MEDIA_EVENT_NEW_MEDIA;
+    g_atomic_int_set(&self->priv->media_event, MEDIA_EVENT_NEW_MEDIA);
+
+    return TRUE;
+}
+
+static void cdemu_device_load_disc_thread (GTask *task, CdemuDevice *self, CdemuDeviceLoadData *data, GCancellable *cancellable G_GNUC_UNUSED)
+{
+    MirageContext *context;
+    CdemuSharedDisc *shared_disc;
+    gchar *debug_name;
+    GError *error = NULL;
+    gboolean succeeded;
+
+    /* Parse the image into a fresh context, without holding the device
+     * mutex; the device keeps servicing commands in the meantime. If
+     * another device has the same image loaded, its disc is shared.
+     * Since the disc may outlive this device's use of it, its debug
+     * output is labelled with the image name instead of device name. */
+    g_mutex_lock(self->priv->device_mutex);
+    context = g_object_new(MIRAGE_TYPE_CONTEXT, NULL);
+    debug_name = data->filenames[0] ? g_path_get_basename(data->filenames[0]) : g_strdup(mirage_context_get_debug_name(self->priv->mirage_context));
+    mirage_context_set_debug_name(context, debug_name);
+    g_free(debug_name);
+    mirage_context_set_debug_domain(context, mirage_context_get_debug_domain(self->priv->mirage_context));
+    mirage_context_set_debug_mask(context, mirage_context_get_debug_mask(self->priv->mirage_context));
+    g_mutex_unlock(self->priv->device_mutex);
+
+    /* Set options to the context */
+    for (guint i = 0; i < g_variant_n_children(data->options); i++) {
+        gchar *key;
+        GVariant *value;
+
+        g_variant_get_child(data->options, i, "{sv}", &key, &value);
+        mirage_context_set_option(context, key, value);
+        g_free(key);
+        g_variant_unref(value);
+    }
+
+    CDEMU_DEBUG(self, DAEMON_DEBUG_DEVICE, "%s: loading image...", __debug__);
+
+    /* Load... */
+    shared_disc = cdemu_disc_cache_acquire(data->filenames, data->options, context, &error);
+    g_object_unref(context);
+
+    /* Check if loading succeeded */
+    if (!shared_disc) {
+        g_mutex_lock(self->priv->device_mutex);
+        self->priv->loading = FALSE;
+        g_mutex_unlock(self->priv->device_mutex);
+
+        g_task_return_error(task, error);
+        return;
+    }
+
+    CDEMU_DEBUG(self, DAEMON_DEBUG_DEVICE, "%s: image loaded; disc shared by %d device(s)", __debug__, cdemu_shared_disc_get_num_users(shared_disc));
+
+    /* Swap the disc in */
+    g_mutex_lock(self->priv->device_mutex);
+    succeeded = cdemu_device_load_disc_private(self, shared_disc, &error);
+    self->priv->loading = FALSE;
+    g_mutex_unlock(self->priv->device_mutex);
+
+    cdemu_shared_disc_unref(shared_disc);
+
+    if (!succeeded) {
+        g_task_return_error(task, error);
+        return;
+    }
 
     /* Send notification */
     g_signal_emit_by_name(self, "status-changed", NULL);
 
-    return TRUE;
+    g_task_return_boolean(task, TRUE);
 }
 
-gboolean cdemu_device_load_disc (CdemuDevice *self, gchar **filenames, GVariant *options, GError **error)
+void cdemu_device_load_disc_async (CdemuDevice *self, gchar **filenames, GVariant *options, GAsyncReadyCallback callback, gpointer user_data)
 {
-    gboolean succeeded = TRUE;
+    GTask *task = g_task_new(self, NULL, callback, user_data);
+    CdemuDeviceLoadData *data;
 
-    /* Load */
+    /* Well, we won't do anything if we're already loaded (or loading) */
     g_mutex_lock(self->priv->device_mutex);
-    succeeded = cdemu_device_load_disc_private(self, filenames, options, error);
+    if (self->priv->loaded || self->priv->loading) {
+        g_mutex_unlock(self->priv->device_mutex);
+        CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: device already loaded", __debug__);
+        g_task_return_new_error(task, CDEMU_ERROR, CDEMU_ERROR_ALREADY_LOADED, Q_("Device is already loaded!"));
+        g_object_unref(task);
+        return;
+    }
+    self->priv->loading = TRUE;
     g_mutex_unlock(self->priv->device_mutex);
 
-    return succeeded;
+    data = g_new(CdemuDeviceLoadData, 1);
+    data->filenames = g_strdupv(filenames);
+    data->options = g_variant_ref(options);
+    g_task_set_task_data(task, data, (GDestroyNotify)cdemu_device_load_data_free);
+
+    g_task_run_in_thread(task, (GTaskThreadFunc)cdemu_device_load_disc_thread);
+    g_object_unref(task);
+}
+
+gboolean cdemu_device_load_disc_finish (CdemuDevice *self, GAsyncResult *result, GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, self), FALSE);
+
+    return g_task_propagate_boolean(G_TASK(result), error);
 }
 
 /**********************************************************************\
@@ -190,6 +280,31 @@ static gboolean cdemu_device_create_blank_disc_private (CdemuDevice *self, const
         return FALSE;
     }
 
+    /* CHD image writer compresses hunks as soon as they are filled, and
+     * can neither read them back nor rewrite them; recorded data would
+     * be inaccessible until the image is finalized and reloaded */
+    if (!g_ascii_strcasecmp(writer_id, "WRITER-CHD")) {
+        CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: image writer '%s' cannot be used for recording!", __debug__, writer_id);
+        g_set_error(error, CDEMU_ERROR, CDEMU_ERROR_INVALID_ARGUMENT, Q_("Image writer '%s' cannot be used for blank disc creation!"), writer_id);
+        g_hash_table_unref(writer_parameters);
+        return FALSE;
+    }
+
+    /* Compressed image files are written through write-only filter
+     * streams; recorded sectors could not be read back until the image
+     * is finalized and reloaded */
+    GVariant *compression = g_hash_table_lookup(writer_parameters, "writer.compression");
+    if (compression && g_variant_is_of_type(compression, G_VARIANT_TYPE_STRING) && g_ascii_strcasecmp(g_variant_get_string(compression, NULL), "none")) {
+        const gchar *compression_string = g_variant_get_string(compression, NULL);
+        CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: compression '%s' cannot be used for recording!", __debug__, compression_string);
+        g_set_error(error, CDEMU_ERROR, CDEMU_ERROR_INVALID_ARGUMENT, Q_("Compression '%s' cannot be used for blank disc creation!"), compression_string);
+        g_hash_table_unref(writer_parameters);
+        return FALSE;
+    }
+
+    /* Our context may still hold options of a previously loaded image */
+    mirage_context_clear_options(self->priv->mirage_context);
+
     /* Create writer and attach our context to it */
     self->priv->image_writer = mirage_create_writer(writer_id, error);
     if (!self->priv->image_writer) {
@@ -205,6 +320,9 @@ static gboolean cdemu_device_create_blank_disc_private (CdemuDevice *self, const
     /* Set filenames */
     mirage_disc_set_filename(self->priv->disc, filename);
 
+    /* Blank disc is not shared, but is locked the same way */
+    self->priv->shared_disc = cdemu_shared_disc_new(self->priv->disc, self->priv->mirage_context);
+
     /* Emulate 80-min CD-R or DVD+R SL for now */
     self->priv->recordable_disc = TRUE;
     self->priv->rewritable_disc = FALSE;
@@ -225,6 +343,9 @@ static gboolean cdemu_device_create_blank_disc_private (CdemuDevice *self, const
         g_object_unref(self->priv->disc);
         self->priv->disc = NULL;
 
+        cdemu_shared_disc_unref(self->priv->shared_disc);
+        self->priv->shared_disc = NULL;
+
         g_object_unref(self->priv->image_writer);
         self->priv->image_writer = NULL;
 
@@ -241,7 +362,7 @@ static gboolean cdemu_device_create_blank_disc_private (CdemuDevice *self, const
     self->priv->open_track = NULL;
 
     /* Loading succeeded */
-    self->priv->loaded = TRUE;
+    g_atomic_int_set(&self->priv->loaded, TRUE);
 
     /* Set profile */
     cdemu_device_set_profile(self, profile_index);
@@ -250,7 +371,7 @@ static gboolean cdemu_device_create_blank_disc_private (CdemuDevice *self, const
     cdemu_device_recording_set_mode(self, 1); /* TAO */
 
     /* Signal event */
-    self->priv->media_event = MEDIA_EVENT_NEW_MEDIA;
+    g_atomic_int_set(&self->priv->media_event, MEDIA_EVENT_NEW_MEDIA);
 
     /* Send notification */
     g_signal_emit_by_name(self, "status-changed", NULL);
@@ -272,11 +393,32 @@ gboolean cdemu_device_create_blank_disc (CdemuDevice *self, const gchar *filenam
 }
 
 
+/**********************************************************************\
+ *                             Media events                           *
+\**********************************************************************/
+/* Returns pending media event and resets it; may be called without the
+ * device lock. Loaded flag is always published before the event that
+ * accompanies it, so a reader that takes the event first and reads the
+ * loaded flag afterwards sees a consistent pair */
+gint cdemu_device_take_media_event (CdemuDevice *self)
+{
+    gint event;
+
+    do {
+        event = g_atomic_int_get(&self->priv->media_event);
+    } while (!g_atomic_int_compare_and_exchange(&self->priv->media_event, event, MEDIA_EVENT_NOCHANGE));
+
+    return event;
+}
+
+
 /**********************************************************************\
  *                              Unload disc                           *
 \**********************************************************************/
 gboolean cdemu_device_unload_disc_private (CdemuDevice *self, GError **error)
 {
+    gboolean succeeded = TRUE;
+
     /* Check if the door is locked */
     if (self->priv->locked) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: device is locked", __debug__);
@@ -286,13 +428,38 @@ gboolean cdemu_device_unload_disc_private (CdemuDevice *self, GError **error)
 
     /* Unload only if we're loaded */
     if (self->priv->loaded) {
+        /* Stop audio play; it keeps its own references to the disc, but
+         * must not read it while recorded data is being written out */
+        cdemu_audio_stop(CDEMU_AUDIO(self->priv->audio_play));
+
+        /* Write out sectors that are still buffered while the disc is
+         * still loaded; the disc is unloaded regardless, but the failure
+         * is reported */
+        if (self->priv->open_track) {
+            GError *local_error = NULL;
+            if (!mirage_track_flush(self->priv->open_track, &local_error)) {
+                CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to flush track data: %s!", __debug__, local_error->message);
+                g_set_error(error, CDEMU_ERROR, CDEMU_ERROR_DAEMON_ERROR, Q_("Failed to write out recorded data: %s"), local_error->message);
+                g_error_free(local_error);
+                succeeded = FALSE;
+            }
+        }
+
         /* Delete disc */
         g_object_unref(self->priv->disc);
         self->priv->disc = NULL;
 
+        if (self->priv->shared_disc) {
+            cdemu_shared_disc_unref(self->priv->shared_disc);
+            self->priv->shared_disc = NULL;
+        }
+
         /* We're not loaded anymore, and media got changed */
-        self->priv->loaded = FALSE;
-        self->priv->media_event = MEDIA_EVENT_MEDIA_REMOVAL;
+        g_atomic_int_set(&self->priv->loaded, FALSE);
+        g_atomic_int_set(&self->priv->media_event, MEDIA_EVENT_MEDIA_REMOVAL);
+
+        /* Drop cached responses that describe the old disc */
+        cdemu_device_invalidate_response_cache(self);
 
         /* Clear burning emulation stuff */
         if (self->priv->open_track) {
@@ -338,7 +505,7 @@ gboolean cdemu_device_unload_disc_private (CdemuDevice *self, GError **error)
         g_signal_emit_by_name(self, "status-changed", NULL);
     }
 
-    return TRUE;
+    return succeeded;
 }
 
 gboolean cdemu_device_unload_disc (CdemuDevice *self, GError **error)
@@ -351,7 +518,7 @@ gboolean cdemu_device_unload_disc (CdemuDevice *self, GError **error)
      * likely not happen at this point, due to device being locked;
      * instead, HAL/udev/udisksd2 may pick up the request, unlock the
      * device, and proceed with ejection again... */
-    self->priv->media_event = MEDIA_EVENT_EJECTREQUEST;
+    g_atomic_int_set(&self->priv->media_event, MEDIA_EVENT_EJECTREQUEST);
 
     /* Attempt the actual unload */
     cdemu_device_unload_disc_private(self, error);
@@ -23,7 +23,16 @@
 #define __debug__ "Mapping"
 
 
-gboolean cdemu_device_setup_mapping (CdemuDevice *self)
+/* Retry intervals for mapping setup when no uevent arrives; the
+ * interval is doubled after each unsuccessful attempt */
+#define MAPPING_RETRY_INTERVAL_MIN 10 /* ms */
+#define MAPPING_RETRY_INTERVAL_MAX 1000 /* ms */
+
+
+/**********************************************************************\
+ *                         Mapping lookup                             *
+\**********************************************************************/
+static gboolean cdemu_device_setup_mapping (CdemuDevice *self)
 {
     gboolean try_again = FALSE;
     gint ioctl_ret;
@@ -39,104 +48,122 @@ gboolean cdemu_device_setup_mapping (CdemuDevice *self)
         /* Other errors */
         CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: error while performing ioctl (%d); device mapping info will not be available", __debug__, ioctl_ret);
     } else {
-        /* FIXME: until we figure how to get SCSI CD-ROM and SCSI Generic Device
-         * device paths directly from kernel, we'll have to live with parsing of the
-         * sysfs dir :/ */
-        gchar *sysfs_dev_path = g_strdup_printf("/sys/bus/scsi/devices/%i:%i:%i:%i", id[0], id[1], id[2], id[3]);
-        GDir *dir_dev = g_dir_open(sysfs_dev_path, 0, NULL);
-
-        gchar path_sr[16] = "";
-        gchar path_sg[16] = "";
-
-        if (!dir_dev) {
-            CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: sysfs device for device #%i (%s) could not be opened; device mapping info for this device will not be available", __debug__, self->priv->number, sysfs_dev_path);
-        } else {
-            /* Iterate through sysfs dir */
-            const gchar *entry_name;
-            while ((entry_name = g_dir_read_name(dir_dev))) {
-                /* SCSI CD-ROM device */
-                if (!strlen(path_sr)) {
-                    if (sscanf(entry_name, "block:%s", path_sr) == 1) {
-                        continue;
-                    }
-
-                    if (!g_ascii_strcasecmp(entry_name, "block")) {
-                        gchar *dirpath = g_build_filename(sysfs_dev_path, entry_name, NULL);
-                        GDir *tmp_dir = g_dir_open(dirpath, 0, NULL);
-                        if (tmp_dir) {
-                            const gchar *tmp_sr = g_dir_read_name(tmp_dir);
-                            if (tmp_sr) {
-                                g_strlcpy(path_sr, tmp_sr, sizeof(path_sr));
-                            } else {
-                                /* block dir exists but is empty: kernel still registering -- retry */
-                                try_again = TRUE;
-                            }
-                            g_dir_close(tmp_dir);
-                        } else {
-                            try_again = TRUE;
-                        }
-                        g_free(dirpath);
-                        if (try_again) {
-                            break;
-                        }
-                        continue;
-                    }
-                }
-
-                /* SCSI generic device */
-                if (!strlen(path_sg)) {
-                    if (sscanf(entry_name, "scsi_generic:%s", path_sg) == 1) {
-                        continue;
-                    }
-
-                    if (!g_ascii_strcasecmp(entry_name, "generic")) {
-                        gchar *symlink = g_build_filename(sysfs_dev_path, entry_name, NULL);
-                        gchar *tmp_path = g_file_read_link(symlink, NULL);
-                        if (tmp_path) {
-                            gchar *tmp_sg = g_path_get_basename(tmp_path);
-                            g_strlcpy(path_sg, tmp_sg, sizeof(path_sg));
-                            g_free(tmp_sg);
-                            g_free(tmp_path);
-                        } else {
-                            try_again = TRUE;
-                        }
-                        g_free(symlink);
-                        if (try_again) {
-                            break;
-                        }
-                        continue;
-                    }
-                }
-            }
-            g_dir_close(dir_dev);
-
-            /* Actual path building */
-            if (strlen(path_sr)) {
-                self->priv->device_sr = g_strconcat("/dev/", path_sr, NULL);
-            } else {
-                CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: device mapping (SCSI CD-ROM) for device #%i could not be determined; device mapping info for this device will not be available", __debug__, self->priv->number);
-                self->priv->device_sr = NULL;
-            }
+        /* From now on, only uevents for our own SCSI device are of interest */
+        if (self->priv->mapping_uevent_watch) {
+            cdemu_uevent_monitor_add_watch(self->priv->uevent_monitor, self->priv->mapping_uevent_watch, id);
+        }
 
-            if (strlen(path_sg)) {
-                self->priv->device_sg = g_strconcat("/dev/", path_sg, NULL);
-            } else {
-                CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: device mapping (SCSI generic) for device #%i could not be determined; device mapping info for this device will not be available", __debug__, self->priv->number);
-                self->priv->device_sg = NULL;
+        try_again = cdemu_device_nodes_lookup(self->priv->sysfs_root, id, &self->priv->device_sr, &self->priv->device_sg);
+        if (!try_again) {
+            if (!self->priv->device_sr) {
+                CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: device mapping (SCSI CD-ROM) for device #%i could not be determined under '%s'; device mapping info for this device will not be available", __debug__, self->priv->number, self->priv->sysfs_root);
+            }
+            if (!self->priv->device_sg) {
+                CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: device mapping (SCSI generic) for device #%i could not be determined under '%s'; device mapping info for this device will not be available", __debug__, self->priv->number, self->priv->sysfs_root);
             }
         }
-
-        g_free(sysfs_dev_path);
     }
 
-    /* If we won't be repeating the callback, emit the 'ready' signal */
+    /* If we won't be repeating the attempt, emit the 'ready' signal */
     if (!try_again) {
+        self->priv->mapping_complete = TRUE;
         g_signal_emit_by_name(self, "mapping-ready", NULL);
     }
 
     return try_again;
 }
 
+
+/**********************************************************************\
+ *                    Kernel uevents and retries                      *
+\**********************************************************************/
+static void cdemu_device_mapping_attempt (CdemuDevice *self);
+
+static gboolean cdemu_device_mapping_retry_handler (CdemuDevice *self)
+{
+    cdemu_device_mapping_attempt(self);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean cdemu_device_mapping_uevent_handler (CdemuDevice *self)
+{
+    CDEMU_DEBUG(self, DAEMON_DEBUG_DEVICE, "%s: received device uevent; retrying mapping setup", __debug__);
+    cdemu_device_mapping_attempt(self);
+    return G_SOURCE_CONTINUE;
+}
+
+/* Mapping sources run in the device's I/O thread; in reactor mode, there
+ * is none, so they are attached to the daemon's main context instead */
+static GMainContext *cdemu_device_mapping_get_context (CdemuDevice *self)
+{
+    return self->priv->reactor ? NULL : self->priv->main_context;
+}
+
+static void cdemu_device_mapping_cancel_retry (CdemuDevice *self)
+{
+    if (self->priv->mapping_retry_source) {
+        g_source_destroy(self->priv->mapping_retry_source);
+        g_source_unref(self->priv->mapping_retry_source);
+        self->priv->mapping_retry_source = NULL;
+    }
+}
+
+static void cdemu_device_mapping_attempt (CdemuDevice *self)
+{
+    /* This attempt supersedes any pending retry */
+    cdemu_device_mapping_cancel_retry(self);
+
+    if (!cdemu_device_setup_mapping(self)) {
+        /* Done; we do not need uevents anymore */
+        cdemu_device_stop_mapping(self);
+        return;
+    }
+
+    /* Schedule a retry, in case the uevent is missed or unavailable */
+    self->priv->mapping_retry_source = g_timeout_source_new(self->priv->mapping_retry_interval);
+    g_source_set_callback(self->priv->mapping_retry_source, G_SOURCE_FUNC(cdemu_device_mapping_retry_handler), self, NULL);
+    g_source_attach(self->priv->mapping_retry_source, cdemu_device_mapping_get_context(self));
+
+    self->priv->mapping_retry_interval = MIN(2*self->priv->mapping_retry_interval, MAPPING_RETRY_INTERVAL_MAX);
+}
+
+
+/**********************************************************************\
+ *                         Mapping setup                              *
+\**********************************************************************/
+void cdemu_device_start_mapping (CdemuDevice *self)
+{
+    self->priv->mapping_complete = FALSE;
+    self->priv->mapping_retry_interval = MAPPING_RETRY_INTERVAL_MIN;
+
+    /* Watch for kernel uevents, so that we can finish the setup as soon
+     * as the SCSI CD-ROM and generic devices are registered; until our
+     * SCSI address is known, any such device wakes us up */
+    if (self->priv->uevent_monitor) {
+        self->priv->mapping_uevent_watch = cdemu_uevent_monitor_create_watch();
+        g_source_set_callback(self->priv->mapping_uevent_watch, G_SOURCE_FUNC(cdemu_device_mapping_uevent_handler), self, NULL);
+        g_source_attach(self->priv->mapping_uevent_watch, cdemu_device_mapping_get_context(self));
+        cdemu_uevent_monitor_add_watch(self->priv->uevent_monitor, self->priv->mapping_uevent_watch, NULL);
+    }
+
+    /* First attempt is made right away, from the I/O (or main) thread */
+    self->priv->mapping_retry_source = g_idle_source_new();
+    g_source_set_callback(self->priv->mapping_retry_source, G_SOURCE_FUNC(cdemu_device_mapping_retry_handler), self, NULL);
+    g_source_attach(self->priv->mapping_retry_source, cdemu_device_mapping_get_context(self));
+}
+
+void cdemu_device_stop_mapping (CdemuDevice *self)
+{
+    cdemu_device_mapping_cancel_retry(self);
+
+    if (self->priv->mapping_uevent_watch) {
+        cdemu_uevent_monitor_remove_watch(self->priv->uevent_monitor, self->priv->mapping_uevent_watch);
+        g_source_destroy(self->priv->mapping_uevent_watch);
+        g_source_unref(self->priv->mapping_uevent_watch);
+        self->priv->mapping_uevent_watch = NULL;
+    }
+}
+
 void cdemu_device_get_mapping (CdemuDevice *self, gchar **sr_device, gchar **sg_device)
 {
     /* Return values, if applicable */
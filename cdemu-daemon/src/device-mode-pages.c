@@ -32,34 +32,6 @@
 /**********************************************************************\
  *                    Mode page declaration helpers                   *
 \**********************************************************************/
-static inline gint compare_mode_pages (struct ModePageEntry *entry1, struct ModePageEntry *entry2)
-{
-    struct ModePageGeneral *page1 = entry1->page_default;
-    struct ModePageGeneral *page2 = entry2->page_default;
-
-    if (page1->code < page2->code) {
-        return -1;
-    } else if (page1->code > page2->code) {
-        return 1;
-    } else {
-        return 0;
-    }
-}
-
-static inline gint find_mode_page (struct ModePageEntry *entry, gconstpointer code_ptr)
-{
-    struct ModePageGeneral *page = entry->page_default;
-    gint code = GPOINTER_TO_INT(code_ptr);
-
-    if (page->code < code) {
-        return -1;
-    } else if (page->code > code) {
-        return 1;
-    } else {
-        return 0;
-    }
-}
-
 static inline struct ModePageEntry *initialize_mode_page (gint code, gint size, gboolean (*validator) (CdemuDevice *, const guint8 *))
 {
     struct ModePageEntry *entry = g_new0(struct ModePageEntry, 1);
@@ -82,13 +54,15 @@ static inline struct ModePageEntry *initialize_mode_page (gint code, gint size,
     return entry;
 }
 
-static inline GList *append_mode_page (GList *list, struct ModePageEntry *entry)
+static inline void append_mode_page (CdemuDevice *self, struct ModePageEntry *entry)
 {
+    struct ModePageGeneral *page_default = entry->page_default;
+
     /* Make a copy of MODE_PAGE_DEFAULT to MODE_PAGE_CURRENT */
-    memcpy(entry->page_current, entry->page_default, ((struct ModePageGeneral *)entry->page_default)->length + 2);
+    memcpy(entry->page_current, entry->page_default, page_default->length + 2);
 
-    /* Append mode page entry to the list */
-    return g_list_insert_sorted(list, entry, (GCompareFunc)compare_mode_pages);
+    /* Store mode page entry in the slot for its code */
+    self->priv->mode_pages[page_default->code] = entry;
 }
 
 
@@ -165,12 +139,11 @@ static gboolean mode_page_0x05_validator (CdemuDevice *self, const guint8 *new_d
 \**********************************************************************/
 gpointer cdemu_device_get_mode_page (CdemuDevice *self, gint page, ModePageType type)
 {
-    GList *entry = g_list_find_custom(self->priv->mode_pages_list, GINT_TO_POINTER(page), (GCompareFunc)find_mode_page);
-    if (!entry) {
+    if (page < 0 || page >= NUM_MODE_PAGE_CODES || !self->priv->mode_pages[page]) {
         return NULL;
     }
 
-    struct ModePageEntry *page_entry = entry->data;
+    struct ModePageEntry *page_entry = self->priv->mode_pages[page];
     switch (type) {
         case MODE_PAGE_CURRENT: {
             return page_entry->page_current;
@@ -207,7 +180,7 @@ void cdemu_device_mode_pages_init (CdemuDevice *self)
         mask->dcr = 1;
         mask->read_retry = 0xFF;
     }
-    self->priv->mode_pages_list = append_mode_page(self->priv->mode_pages_list, mode_page);
+    append_mode_page(self, mode_page);
 
 
     /*** Mode page 0x05: Write Parameters Mode Page ***/
@@ -263,7 +236,7 @@ void cdemu_device_mode_pages_init (CdemuDevice *self)
         memset(mask->isrc, 0xFF, sizeof(mask->isrc));
         memset(mask->subheader, 0xFF, sizeof(mask->subheader));
     }
-    self->priv->mode_pages_list = append_mode_page(self->priv->mode_pages_list, mode_page);
+    append_mode_page(self, mode_page);
 
 
     /*** Mode Page 0x0D: CD Device Parameters Mode Page ****/
@@ -277,7 +250,7 @@ void cdemu_device_mode_pages_init (CdemuDevice *self)
         page->spm = GUINT16_TO_BE(60);
         page->fps = GUINT16_TO_BE(75);
     }
-    self->priv->mode_pages_list = append_mode_page(self->priv->mode_pages_list, mode_page);
+    append_mode_page(self, mode_page);
 
 
     /*** Mode Page 0x0E: CD Audio Control Mode Page ***/
@@ -308,7 +281,7 @@ void cdemu_device_mode_pages_init (CdemuDevice *self)
         mask->port3csel = 0xF;
         mask->port3vol  = 0xFF;
     }
-    self->priv->mode_pages_list = append_mode_page(self->priv->mode_pages_list, mode_page);
+    append_mode_page(self, mode_page);
 
 
     /*** Mode Page 0x1A: Power Condition Mode Page ***/
@@ -322,7 +295,7 @@ void cdemu_device_mode_pages_init (CdemuDevice *self)
         mask->idle_timer  = 0xFFFFFFFF;
         mask->stdby_timer = 0xFFFFFFFF;
     }
-    self->priv->mode_pages_list = append_mode_page(self->priv->mode_pages_list, mode_page);
+    append_mode_page(self, mode_page);
 
 
     /*** Mode Page 0x2A: CD/DVD Capabilities and Mechanical Status Mode Page ***/
@@ -382,7 +355,7 @@ void cdemu_device_mode_pages_init (CdemuDevice *self)
 
         page->num_wsp_descriptors = GUINT16_TO_BE(0); /* NOTE: write speed performance descriptors are initialized dynamically when profile changes! */
     }
-    self->priv->mode_pages_list = append_mode_page(self->priv->mode_pages_list, mode_page);
+    append_mode_page(self, mode_page);
 
     /* We resize the "current" Mode Page 0x2A to provide space for
      * maximum of 6 Write Speed Performance Descriptors, which are then
@@ -399,18 +372,18 @@ void cdemu_device_mode_pages_init (CdemuDevice *self)
 
 void cdemu_device_mode_pages_cleanup (CdemuDevice *self)
 {
-    for (GList *entry = self->priv->mode_pages_list; entry; entry = entry->next) {
-        if (entry->data) {
-            struct ModePageEntry *mode_page = entry->data;
+    for (gint i = 0; i < NUM_MODE_PAGE_CODES; i++) {
+        struct ModePageEntry *mode_page = self->priv->mode_pages[i];
 
+        if (mode_page) {
             g_free(mode_page->page_current);
             g_free(mode_page->page_default);
             g_free(mode_page->page_mask);
 
             g_free(mode_page);
+            self->priv->mode_pages[i] = NULL;
         }
     }
-    g_list_free(self->priv->mode_pages_list);
 }
 
 gboolean cdemu_device_modify_mode_page (CdemuDevice *self, const guint8 *new_data, gint page_size)
@@ -418,14 +391,13 @@ gboolean cdemu_device_modify_mode_page (CdemuDevice *self, const guint8 *new_dat
     struct ModePageGeneral *page_new = (struct ModePageGeneral *)(new_data);
 
     /* Get page's entry */
-    GList *raw_entry = g_list_find_custom(self->priv->mode_pages_list, GINT_TO_POINTER((gint)page_new->code), (GCompareFunc)find_mode_page);
-    if (!raw_entry) {
+    struct ModePageEntry *page_entry = self->priv->mode_pages[page_new->code]; /* Code is 6-bit */
+    if (!page_entry) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_MMC, "%s: we don't have mode page 0x%X", __debug__, page_new->code);
         return FALSE;
     }
 
     /* Validate page size */
-    struct ModePageEntry *page_entry = raw_entry->data;
     struct ModePageGeneral *page_current = page_entry->page_current;
 
     if (page_size - 2 != page_current->length) {
@@ -0,0 +1,325 @@
+/*
+ *  CDEmu daemon: SCSI device node discovery
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cdemu.h"
+
+#include <string.h>
+#include <glib-unix.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+
+/**********************************************************************\
+ *                            sysfs lookup                            *
+\**********************************************************************/
+gboolean cdemu_device_nodes_lookup (const gchar *sysfs_root, const gint32 address[4], gchar **device_sr, gchar **device_sg)
+{
+    gboolean try_again = FALSE;
+
+    /* FIXME: until we figure how to get SCSI CD-ROM and SCSI Generic Device
+     * device paths directly from kernel, we'll have to live with parsing of the
+     * sysfs dir :/ */
+    gchar *sysfs_dev_path = g_strdup_printf("%s/bus/scsi/devices/%i:%i:%i:%i", sysfs_root, address[0], address[1], address[2], address[3]);
+    GDir *dir_dev = g_dir_open(sysfs_dev_path, 0, NULL);
+
+    gchar path_sr[16] = "";
+    gchar path_sg[16] = "";
+
+    *device_sr = NULL;
+    *device_sg = NULL;
+
+    if (!dir_dev) {
+        g_free(sysfs_dev_path);
+        return FALSE;
+    }
+
+    /* Iterate through sysfs dir */
+    const gchar *entry_name;
+    while ((entry_name = g_dir_read_name(dir_dev))) {
+        /* SCSI CD-ROM device */
+        if (!strlen(path_sr)) {
+            if (sscanf(entry_name, "block:%15s", path_sr) == 1) {
+                continue;
+            }
+
+            if (!g_ascii_strcasecmp(entry_name, "block")) {
+                gchar *dirpath = g_build_filename(sysfs_dev_path, entry_name, NULL);
+                GDir *tmp_dir = g_dir_open(dirpath, 0, NULL);
+                if (tmp_dir) {
+                    const gchar *tmp_sr = g_dir_read_name(tmp_dir);
+                    if (tmp_sr) {
+                        g_strlcpy(path_sr, tmp_sr, sizeof(path_sr));
+                    } else {
+                        /* block dir exists but is empty: kernel still registering -- retry */
+                        try_again = TRUE;
+                    }
+                    g_dir_close(tmp_dir);
+                } else {
+                    try_again = TRUE;
+                }
+                g_free(dirpath);
+                if (try_again) {
+                    break;
+                }
+                continue;
+            }
+        }
+
+        /* SCSI generic device */
+        if (!strlen(path_sg)) {
+            if (sscanf(entry_name, "scsi_generic:%15s", path_sg) == 1) {
+                continue;
+            }
+
+            if (!g_ascii_strcasecmp(entry_name, "generic")) {
+                gchar *symlink = g_build_filename(sysfs_dev_path, entry_name, NULL);
+                gchar *tmp_path = g_file_read_link(symlink, NULL);
+                if (tmp_path) {
+                    gchar *tmp_sg = g_path_get_basename(tmp_path);
+                    g_strlcpy(path_sg, tmp_sg, sizeof(path_sg));
+                    g_free(tmp_sg);
+                    g_free(tmp_path);
+                } else {
+                    try_again = TRUE;
+                }
+                g_free(symlink);
+                if (try_again) {
+                    break;
+                }
+                continue;
+            }
+        }
+    }
+    g_dir_close(dir_dev);
+
+    /* Actual path building; only once the lookup is final */
+    if (!try_again) {
+        if (strlen(path_sr)) {
+            *device_sr = g_strconcat("/dev/", path_sr, NULL);
+        }
+        if (strlen(path_sg)) {
+            *device_sg = g_strconcat("/dev/", path_sg, NULL);
+        }
+    }
+
+    g_free(sysfs_dev_path);
+
+    return try_again;
+}
+
+
+/**********************************************************************\
+ *                           Uevent parsing                           *
+\**********************************************************************/
+/* Parses a kernel uevent message; it starts with "action@devpath" header,
+ * followed by NUL-separated KEY=value pairs. Returns TRUE if the message
+ * announces addition of a block or SCSI generic device node under a SCSI
+ * device (e.g., DEVPATH=/devices/.../host3/target3:0:0/3:0:0:0/block/sr1),
+ * and stores the SCSI device's address. */
+gboolean cdemu_device_nodes_parse_uevent (const gchar *message, gsize length, gint32 address[4])
+{
+    const gchar *action = NULL;
+    const gchar *devpath = NULL;
+    gchar **components;
+    gboolean found = FALSE;
+
+    for (gsize offset = 0; offset < length; offset += strnlen(message + offset, length - offset) + 1) {
+        const gchar *field = message + offset;
+
+        /* Fields must be NUL-terminated within the message */
+        if (!memchr(field, 0, length - offset)) {
+            break;
+        }
+
+        if (g_str_has_prefix(field, "ACTION=")) {
+            action = field + strlen("ACTION=");
+        } else if (g_str_has_prefix(field, "DEVPATH=")) {
+            devpath = field + strlen("DEVPATH=");
+        }
+    }
+
+    if (!action || !devpath || strcmp(action, "add")) {
+        return FALSE;
+    }
+
+    /* Look for "h:c:t:l" component, followed by "block" or "scsi_generic"
+     * class directory */
+    components = g_strsplit(devpath, "/", -1);
+    for (gint i = 0; components[i] && components[i + 1]; i++) {
+        gint32 tmp[4];
+        gint consumed = 0;
+
+        if (sscanf(components[i], "%d:%d:%d:%d%n", &tmp[0], &tmp[1], &tmp[2], &tmp[3], &consumed) != 4 || components[i][consumed]) {
+            continue;
+        }
+
+        if (!strcmp(components[i + 1], "block") || !strcmp(components[i + 1], "scsi_generic")) {
+            memcpy(address, tmp, sizeof(tmp));
+            found = TRUE;
+            break;
+        }
+    }
+    g_strfreev(components);
+
+    return found;
+}
+
+
+/**********************************************************************\
+ *                           Uevent monitor                           *
+\**********************************************************************/
+typedef struct
+{
+    gboolean has_address;
+    gint32 address[4];
+} CdemuUeventWatch;
+
+struct _CdemuUeventMonitor
+{
+    gint fd;
+    GSource *source;
+
+    /* Registered watches; keyed by watch source */
+    GMutex mutex;
+    GHashTable *watches;
+};
+
+static gboolean cdemu_uevent_watch_dispatch (GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    /* Disarm until the next matching uevent */
+    g_source_set_ready_time(source, -1);
+
+    return callback ? callback(user_data) : G_SOURCE_REMOVE;
+}
+
+static GSourceFuncs cdemu_uevent_watch_funcs = {
+    NULL,
+    NULL,
+    cdemu_uevent_watch_dispatch,
+    NULL,
+    NULL,
+    NULL,
+};
+
+static gboolean cdemu_uevent_monitor_handler (gint fd, GIOCondition condition G_GNUC_UNUSED, CdemuUeventMonitor *self)
+{
+    gchar message[4096];
+    gssize length;
+
+    /* Drain pending messages */
+    while ((length = recv(fd, message, sizeof(message) - 1, 0)) > 0) {
+        gint32 address[4];
+        GHashTableIter iter;
+        gpointer watch_source, watch_data;
+
+        message[length] = 0;
+        if (!cdemu_device_nodes_parse_uevent(message, length + 1, address)) {
+            continue;
+        }
+
+        /* Wake up watches of the device the node belongs to, and those
+         * that do not know their address yet */
+        g_mutex_lock(&self->mutex);
+        g_hash_table_iter_init(&iter, self->watches);
+        while (g_hash_table_iter_next(&iter, &watch_source, &watch_data)) {
+            CdemuUeventWatch *watch = watch_data;
+            if (!watch->has_address || !memcmp(watch->address, address, sizeof(address))) {
+                g_source_set_ready_time(watch_source, 0);
+            }
+        }
+        g_mutex_unlock(&self->mutex);
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+CdemuUeventMonitor *cdemu_uevent_monitor_new (GError **error)
+{
+    CdemuUeventMonitor *self = g_new0(CdemuUeventMonitor, 1);
+    struct sockaddr_nl address = {
+        .nl_family = AF_NETLINK,
+        .nl_groups = 1, /* Kernel uevents */
+    };
+
+    g_mutex_init(&self->mutex);
+    self->watches = g_hash_table_new_full(g_direct_hash, g_direct_equal, (GDestroyNotify)g_source_unref, g_free);
+
+    self->fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (self->fd < 0 || bind(self->fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        g_set_error(error, CDEMU_ERROR, CDEMU_ERROR_DAEMON_ERROR, Q_("Failed to set up uevent socket: %s"), g_strerror(errno));
+        cdemu_uevent_monitor_free(self);
+        return NULL;
+    }
+
+    /* Watched from the main context */
+    self->source = g_unix_fd_source_new(self->fd, G_IO_IN);
+    g_source_set_callback(self->source, G_SOURCE_FUNC(cdemu_uevent_monitor_handler), self, NULL);
+    g_source_attach(self->source, NULL);
+
+    return self;
+}
+
+void cdemu_uevent_monitor_free (CdemuUeventMonitor *self)
+{
+    if (self->source) {
+        g_source_destroy(self->source);
+        g_source_unref(self->source);
+    }
+
+    if (self->fd >= 0) {
+        close(self->fd);
+    }
+
+    g_hash_table_unref(self->watches);
+    g_mutex_clear(&self->mutex);
+
+    g_free(self);
+}
+
+
+/* Creates a watch source; the caller sets its callback and attaches it
+ * to the context in which the callback should run */
+GSource *cdemu_uevent_monitor_create_watch (void)
+{
+    return g_source_new(&cdemu_uevent_watch_funcs, sizeof(GSource));
+}
+
+/* Registers the watch, or updates its address; address may be NULL if
+ * it is not known yet */
+void cdemu_uevent_monitor_add_watch (CdemuUeventMonitor *self, GSource *watch, const gint32 *address)
+{
+    CdemuUeventWatch *entry = g_new0(CdemuUeventWatch, 1);
+
+    if (address) {
+        entry->has_address = TRUE;
+        memcpy(entry->address, address, sizeof(entry->address));
+    }
+
+    /* Table holds a reference; replacing an entry releases the old one */
+    g_mutex_lock(&self->mutex);
+    g_hash_table_replace(self->watches, g_source_ref(watch), entry);
+    g_mutex_unlock(&self->mutex);
+}
+
+void cdemu_uevent_monitor_remove_watch (CdemuUeventMonitor *self, GSource *watch)
+{
+    g_mutex_lock(&self->mutex);
+    g_hash_table_remove(self->watches, watch);
+    g_mutex_unlock(&self->mutex);
+}
@@ -0,0 +1,56 @@
+/*
+ *  CDEmu daemon: SCSI device node discovery
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+G_BEGIN_DECLS
+
+
+/**********************************************************************\
+ *                            sysfs lookup                            *
+\**********************************************************************/
+/* Looks up SCSI CD-ROM and SCSI generic device nodes of the SCSI device
+ * with given address (host, channel, target, lun) under given sysfs root.
+ * Returns TRUE if kernel has not finished registering the device yet and
+ * lookup should be repeated; otherwise, the found nodes are returned
+ * (or NULL, if they could not be determined). */
+gboolean cdemu_device_nodes_lookup (const gchar *sysfs_root, const gint32 address[4], gchar **device_sr, gchar **device_sg);
+
+
+/**********************************************************************\
+ *                           Uevent monitor                           *
+\**********************************************************************/
+/* A single daemon-wide NETLINK_KOBJECT_UEVENT socket, watched from the
+ * main context. Devices that wait for their device nodes register a
+ * watch source; it is dispatched (in whichever context it is attached
+ * to) when a block or SCSI generic device is added under the SCSI device
+ * with the watched address. Watches without an address yet are woken by
+ * additions under any SCSI device. */
+
+gboolean cdemu_device_nodes_parse_uevent (const gchar *message, gsize length, gint32 address[4]);
+
+CdemuUeventMonitor *cdemu_uevent_monitor_new (GError **error);
+void cdemu_uevent_monitor_free (CdemuUeventMonitor *self);
+
+GSource *cdemu_uevent_monitor_create_watch (void);
+void cdemu_uevent_monitor_add_watch (CdemuUeventMonitor *self, GSource *watch, const gint32 *address);
+void cdemu_uevent_monitor_remove_watch (CdemuUeventMonitor *self, GSource *watch);
+
+
+G_END_DECLS
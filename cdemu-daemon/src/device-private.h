@@ -28,6 +28,18 @@ struct _CdemuCommand
     guint out_len;
 };
 
+/* Mode page codes are 6-bit; feature codes we implement are below 0x0110 */
+#define NUM_MODE_PAGE_CODES 0x40
+#define NUM_FEATURE_CODES 0x0110
+
+/* Feature descriptors, serialized in ascending order of feature codes */
+struct FeatureDescriptors
+{
+    guint8 *data;
+    gint size;
+    gint offsets[NUM_FEATURE_CODES + 1]; /* Offset of first descriptor with code >= index */
+};
+
 struct _CdemuDevicePrivate
 {
     /* Device I/O thread */
@@ -38,6 +50,8 @@ struct _CdemuDevicePrivate
     GMainLoop *main_loop;
     GSource *io_watch;
 
+    CdemuReactor *reactor; /* Shared reactor, if used instead of I/O thread */
+
     /* Device stuff */
     gint number;
     gchar *device_name;
@@ -60,33 +74,44 @@ struct _CdemuDevicePrivate
     guint buffer_size;
     guint buffer_capacity;
 
+    /* Cached responses of disc layout queries */
+    GHashTable *response_cache;
+
     /* Audio play */
     CdemuAudio *audio_play;
 
-    /* Disc */
+    /* Disc; loaded flag is also read without the device lock, so it
+     * is written with g_atomic_int_set() */
     gboolean loaded;
+    gboolean loading; /* Image is being parsed by DeviceLoad worker */
     MirageDisc *disc;
+    CdemuSharedDisc *shared_disc; /* Lock holder for disc; shared for loaded (read-only) discs */
     MirageContext *mirage_context; /* libMirage context */
 
     /* Locked flag */
     gboolean locked;
-    /* Media changed flag */
+    /* Media changed flag; accessed atomically */
     gint media_event;
 
     /* Last accessed sector */
     gint current_address;
 
-    /* Mode pages */
-    GList *mode_pages_list;
+    /* Mode pages; indexed by page code */
+    struct ModePageEntry *mode_pages[NUM_MODE_PAGE_CODES];
 
     /* Current device profile */
     ProfileCode current_profile;
-    /* Features */
-    GList *features_list;
+    /* Features; indexed by feature code */
+    struct FeatureGeneral *features[NUM_FEATURE_CODES];
+    /* GET CONFIGURATION response data for all and for current features;
+     * re-built whenever the profile changes */
+    struct FeatureDescriptors features_all;
+    struct FeatureDescriptors features_current;
 
     /* Delay emulation */
     gint64 delay_begin;
     gint64 delay_amount;
+    gint64 delay_deferred; /* Delay left to the reactor (reactor mode only) */
     gdouble current_angle;
 
     gboolean dpm_emulation;
@@ -106,6 +131,12 @@ struct _CdemuDevicePrivate
     gchar *device_sr;
     gchar *device_sg;
 
+    gchar *sysfs_root;
+    CdemuUeventMonitor *uevent_monitor; /* Daemon-wide; may be NULL */
+    GSource *mapping_uevent_watch;
+    GSource *mapping_retry_source;
+    guint mapping_retry_interval;
+
     /* Recording emulation */
     MirageWriter *image_writer;
     const CdemuRecording *recording;
@@ -133,6 +164,14 @@ struct _CdemuDevicePrivate
     /* Raw burning emulation */
     guint8 last_recorded_tno;
     guint8 last_recorded_idx;
+
+    /* Statistics; per-command counters have their own lock, as they
+     * are also updated by commands that run without the device lock */
+    GMutex statistics_mutex;
+    struct CommandStatistics *command_statistics; /* Indexed by opcode */
+    gint64 statistics_begin;
+    gint64 statistics_delay_time;
+    gint64 statistics_fetch_time;
 };
 
 struct _CdemuRecording
@@ -144,6 +183,18 @@ struct _CdemuRecording
     gboolean (*reserve_track) (CdemuDevice *self, guint length);
 };
 
+/* Latency histogram buckets; log2-spaced, in microseconds */
+#define STATISTICS_NUM_BUCKETS 24
+
+struct CommandStatistics
+{
+    guint64 count;
+    guint64 bytes;
+    guint64 total_time;
+    guint64 max_time;
+    guint64 histogram[STATISTICS_NUM_BUCKETS];
+};
+
 struct ModePageEntry
 {
     gpointer page_current;
@@ -160,6 +211,7 @@ struct ModePageEntry
 /* Commands */
 gint cdemu_device_execute_command (CdemuDevice *self, const guint8 *cdb);
 void cdemu_device_dump_buffer (CdemuDevice *self, gint debug_level, const gchar *prefix, gint width, const guint8 *buffer, gint length);
+void cdemu_device_invalidate_response_cache (CdemuDevice *self);
 
 /* Delay emulation */
 void cdemu_device_delay_begin (CdemuDevice *self, gint address, gint num_sectors);
@@ -186,6 +238,11 @@ void cdemu_device_write_sense (CdemuDevice *self, SenseKey sense_key, guint16 as
 
 /* Load/unload */
 gboolean cdemu_device_unload_disc_private (CdemuDevice *self, GError **error);
+gint cdemu_device_take_media_event (CdemuDevice *self);
+
+/* Mapping */
+void cdemu_device_start_mapping (CdemuDevice *self);
+void cdemu_device_stop_mapping (CdemuDevice *self);
 
 /* Mode pages */
 gpointer cdemu_device_get_mode_page (CdemuDevice *self, gint page, ModePageType type);
@@ -193,6 +250,11 @@ void cdemu_device_mode_pages_init (CdemuDevice *self);
 void cdemu_device_mode_pages_cleanup (CdemuDevice *self);
 gboolean cdemu_device_modify_mode_page (CdemuDevice *self, const guint8 *new_data, gint page_size);
 
+/* Statistics */
+void cdemu_device_statistics_init (CdemuDevice *self);
+void cdemu_device_statistics_cleanup (CdemuDevice *self);
+void cdemu_device_statistics_record_command (CdemuDevice *self, guint8 opcode, gint64 duration, guint64 bytes);
+
 /* Recording */
 gboolean cdemu_device_sao_recording_parse_cue_sheet (CdemuDevice *self, const guint8 *cue_sheet, gint cue_sheet_size);
 void cdemu_device_recording_set_mode (CdemuDevice *self, gint mode);
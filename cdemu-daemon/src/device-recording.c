@@ -65,27 +65,43 @@ static gboolean cdemu_device_recording_write_sector (CdemuDevice *self, MirageSe
 
 static gboolean cdemu_device_recording_close_track (CdemuDevice *self)
 {
+    gboolean succeeded = TRUE;
+
     if (self->priv->open_track) {
+        GError *local_error = NULL;
+
         CDEMU_DEBUG(self, DAEMON_DEBUG_RECORDING, "%s: closing track", __debug__);
 
+        /* Write out sectors that are still buffered; the track is closed
+         * regardless, but the host needs to know its data was lost */
+        if (!mirage_track_flush(self->priv->open_track, &local_error)) {
+            CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to flush track data: %s!", __debug__, local_error->message);
+            g_error_free(local_error);
+            cdemu_device_write_sense(self, MEDIUM_ERROR, WRITE_ERROR);
+            succeeded = FALSE;
+        }
+
         /* Release the reference we hold */
         g_object_unref(self->priv->open_track);
         self->priv->open_track = NULL;
     }
 
-    return TRUE;
+    return succeeded;
 }
 
 static gboolean cdemu_device_recording_close_session (CdemuDevice *self)
 {
+    gboolean succeeded = TRUE;
+
     if (self->priv->open_session) {
         const struct ModePage_0x05 *p_0x05 = cdemu_device_get_mode_page(self, 0x05, MODE_PAGE_CURRENT);
 
         CDEMU_DEBUG(self, DAEMON_DEBUG_RECORDING, "%s: closing session", __debug__);
 
-        /* If we have an open track, close it */
+        /* If we have an open track, close it; on failure, the sense data
+         * is already set, but we still close the session */
         if (self->priv->open_track) {
-            cdemu_device_recording_close_track(self);
+            succeeded = cdemu_device_recording_close_track(self);
         }
 
         /* CD-TEXT */
@@ -126,18 +142,30 @@ static gboolean cdemu_device_recording_close_session (CdemuDevice *self)
 
         /* Should we finalize the disc, as well? */
         if (!p_0x05->multisession) {
+            GError *local_error = NULL;
+
             self->priv->disc_closed = TRUE;
 
-            mirage_writer_finalize_image(self->priv->image_writer, self->priv->disc, NULL);
+            if (!mirage_writer_finalize_image(self->priv->image_writer, self->priv->disc, &local_error)) {
+                CDEMU_DEBUG(self, DAEMON_DEBUG_WARNING, "%s: failed to finalize image: %s!", __debug__, local_error->message);
+                g_error_free(local_error);
+                if (succeeded) {
+                    cdemu_device_write_sense(self, MEDIUM_ERROR, WRITE_ERROR);
+                    succeeded = FALSE;
+                }
+            }
 
             /* Send notification */
             g_signal_emit_by_name(self, "status-changed", NULL);
         }
 
         self->priv->num_written_sectors = 0; /* Reset */
+
+        /* Disc layout has changed */
+        cdemu_device_invalidate_response_cache(self);
     }
 
-    return TRUE;
+    return succeeded;
 }
 
 static gboolean cdemu_device_recording_open_session (CdemuDevice *self)
@@ -156,7 +184,9 @@ static gboolean cdemu_device_recording_open_track (CdemuDevice *self, MirageSect
 {
     /* Close old track, if it is opened */
     if (self->priv->open_track) {
-        cdemu_device_recording_close_track(self);
+        if (!cdemu_device_recording_close_track(self)) {
+            return FALSE;
+        }
     }
 
     /* Create new track */
@@ -519,7 +549,7 @@ static gboolean cdemu_device_raw_recording_write_sector (CdemuDevice *self, gint
     if (tno == 0xAA) {
         if (self->priv->open_session) {
             CDEMU_DEBUG(self, DAEMON_DEBUG_RECORDING, "%s: first lead-out sector; closing session", __debug__);
-            cdemu_device_recording_close_session(self);
+            return cdemu_device_recording_close_session(self);
         }
 
         return TRUE;
@@ -543,12 +573,10 @@ static gboolean cdemu_device_raw_recording_write_sector (CdemuDevice *self, gint
         if (tno != self->priv->last_recorded_tno) {
             CDEMU_DEBUG(self, DAEMON_DEBUG_RECORDING, "%s: TNO changed; open new track (mode: %d)", __debug__, mirage_sector_get_sector_type(sector));
 
-            if (self->priv->open_track) {
-                cdemu_device_recording_close_track(self);
+            if (!cdemu_device_recording_open_track(self, mirage_sector_get_sector_type(sector))) {
+                return FALSE;
             }
 
-            cdemu_device_recording_open_track(self, mirage_sector_get_sector_type(sector));
-
             mirage_track_set_ctl(self->priv->open_track, ctl);
 
             GError *local_error = NULL;
@@ -1050,7 +1078,9 @@ finish:
     /* Check if we have reached end of session */
     if (start_address + num_sectors >= mirage_session_layout_get_start_sector(self->priv->cue_sheet) + mirage_session_layout_get_length(self->priv->cue_sheet)) {
         CDEMU_DEBUG(self, DAEMON_DEBUG_RECORDING, "%s: end of session reached; closing", __debug__);
-        cdemu_device_recording_close_session(self);
+        if (!cdemu_device_recording_close_session(self)) {
+            succeeded = FALSE;
+        }
     }
 
     g_object_unref(sector);
@@ -0,0 +1,131 @@
+/*
+ *  CDEmu daemon: device - command statistics
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cdemu.h"
+#include "device-private.h"
+
+#define __debug__ "Statistics"
+
+
+/**********************************************************************\
+ *                        Statistics collection                       *
+\**********************************************************************/
+void cdemu_device_statistics_init (CdemuDevice *self)
+{
+    g_mutex_init(&self->priv->statistics_mutex);
+
+    /* One entry per opcode */
+    self->priv->command_statistics = g_new0(struct CommandStatistics, 256);
+    self->priv->statistics_begin = g_get_monotonic_time();
+    self->priv->statistics_delay_time = 0;
+    self->priv->statistics_fetch_time = 0;
+}
+
+void cdemu_device_statistics_cleanup (CdemuDevice *self)
+{
+    g_free(self->priv->command_statistics);
+    self->priv->command_statistics = NULL;
+
+    g_mutex_clear(&self->priv->statistics_mutex);
+}
+
+void cdemu_device_statistics_record_command (CdemuDevice *self, guint8 opcode, gint64 duration, guint64 bytes)
+{
+    struct CommandStatistics *statistics = &self->priv->command_statistics[opcode];
+    gint bucket = 0;
+
+    /* Bucket i holds latencies below 2^i microseconds; the last bucket
+     * also collects everything above */
+    while (bucket < STATISTICS_NUM_BUCKETS - 1 && duration >= ((gint64)1 << bucket)) {
+        bucket++;
+    }
+
+    g_mutex_lock(&self->priv->statistics_mutex);
+    statistics->count++;
+    statistics->bytes += bytes;
+    statistics->total_time += duration;
+    statistics->max_time = MAX(statistics->max_time, (guint64)duration);
+    statistics->histogram[bucket]++;
+    g_mutex_unlock(&self->priv->statistics_mutex);
+}
+
+
+/**********************************************************************\
+ *                           Public API                               *
+\**********************************************************************/
+GVariant *cdemu_device_get_statistics (CdemuDevice *self)
+{
+    GVariantBuilder general_builder;
+    GVariantBuilder commands_builder;
+    guint64 num_commands = 0;
+
+    g_variant_builder_init(&general_builder, G_VARIANT_TYPE("a{sv}"));
+    g_variant_builder_init(&commands_builder, G_VARIANT_TYPE("a(yttttat)"));
+
+    /* Lock */
+    g_mutex_lock(self->priv->device_mutex);
+    g_mutex_lock(&self->priv->statistics_mutex);
+
+    for (gint opcode = 0; opcode < 256; opcode++) {
+        const struct CommandStatistics *statistics = &self->priv->command_statistics[opcode];
+        GVariantBuilder histogram_builder;
+
+        if (!statistics->count) {
+            continue;
+        }
+        num_commands += statistics->count;
+
+        g_variant_builder_init(&histogram_builder, G_VARIANT_TYPE("at"));
+        for (gint i = 0; i < STATISTICS_NUM_BUCKETS; i++) {
+            g_variant_builder_add(&histogram_builder, "t", statistics->histogram[i]);
+        }
+
+        g_variant_builder_add(&commands_builder, "(yttttat)", (guint8)opcode, statistics->count, statistics->bytes, statistics->total_time, statistics->max_time, &histogram_builder);
+    }
+
+    g_variant_builder_add(&general_builder, "{sv}", "collection-time", g_variant_new_int64(g_get_monotonic_time() - self->priv->statistics_begin));
+    g_variant_builder_add(&general_builder, "{sv}", "num-commands", g_variant_new_uint64(num_commands));
+    g_variant_builder_add(&general_builder, "{sv}", "delay-time", g_variant_new_int64(self->priv->statistics_delay_time));
+    g_variant_builder_add(&general_builder, "{sv}", "data-fetch-time", g_variant_new_int64(self->priv->statistics_fetch_time));
+    g_variant_builder_add(&general_builder, "{sv}", "num-buckets", g_variant_new_int32(STATISTICS_NUM_BUCKETS));
+
+    /* Unlock */
+    g_mutex_unlock(&self->priv->statistics_mutex);
+    g_mutex_unlock(self->priv->device_mutex);
+
+    return g_variant_new("(a{sv}a(yttttat))", &general_builder, &commands_builder);
+}
+
+void cdemu_device_reset_statistics (CdemuDevice *self)
+{
+    /* Lock */
+    g_mutex_lock(self->priv->device_mutex);
+
+    CDEMU_DEBUG(self, DAEMON_DEBUG_DEVICE, "%s: resetting statistics", __debug__);
+
+    g_mutex_lock(&self->priv->statistics_mutex);
+    memset(self->priv->command_statistics, 0, 256 * sizeof(struct CommandStatistics));
+    g_mutex_unlock(&self->priv->statistics_mutex);
+    self->priv->statistics_begin = g_get_monotonic_time();
+    self->priv->statistics_delay_time = 0;
+    self->priv->statistics_fetch_time = 0;
+
+    /* Unlock */
+    g_mutex_unlock(self->priv->device_mutex);
+}
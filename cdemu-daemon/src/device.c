@@ -49,10 +49,9 @@ static void cdemu_device_set_device_id (CdemuDevice *self, const gchar *vendor_i
 /**********************************************************************\
  *                            Device init                             *
 \**********************************************************************/
-gboolean cdemu_device_initialize (CdemuDevice *self, gint number, const gchar *audio_driver, guint cdemu_debug_mask, guint mirage_debug_mask)
+gboolean cdemu_device_initialize (CdemuDevice *self, gint number, const gchar *audio_driver, const gchar *sysfs_root, CdemuUeventMonitor *uevent_monitor, guint cdemu_debug_mask, guint mirage_debug_mask)
 {
     MirageContext *context;
-    GSource *source;
     gint buffer_size;
 
     self->priv->mapping_complete = FALSE;
@@ -61,6 +60,12 @@ gboolean cdemu_device_initialize (CdemuDevice *self, gint number, const gchar *a
     self->priv->number = number;
     self->priv->device_name = g_strdup_printf("cdemu%i", number);
 
+    /* Device mapping is looked up under this sysfs root once the device
+     * is started, and retried on uevents reported by daemon's monitor;
+     * see cdemu_device_start_mapping() */
+    self->priv->sysfs_root = g_strdup(sysfs_root);
+    self->priv->uevent_monitor = uevent_monitor;
+
     /* NOTE: self->priv->device_serial is generated in cdemu_device_start(),
      * once the control device is opened and global device number is
      * obtained from it */
@@ -73,12 +78,6 @@ gboolean cdemu_device_initialize (CdemuDevice *self, gint number, const gchar *a
     self->priv->main_context = g_main_context_new();
     self->priv->main_loop = g_main_loop_new(self->priv->main_context, FALSE);
 
-    /* Create mapping setup timer with 1-second granularity */
-    source = g_timeout_source_new_seconds(1);
-    g_source_set_callback(source, G_SOURCE_FUNC(cdemu_device_setup_mapping), self, NULL);
-    g_source_attach(source, self->priv->main_context);
-    g_source_unref(source);
-
     /* Create a MirageContext to use as a debug context for device */
     context = g_object_new(MIRAGE_TYPE_CONTEXT, NULL);
     mirage_context_set_debug_name(context, self->priv->device_name);
@@ -104,12 +103,15 @@ gboolean cdemu_device_initialize (CdemuDevice *self, gint number, const gchar *a
         return FALSE;
     }
 
+    /* Create cache for disc layout query responses */
+    self->priv->response_cache = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, (GDestroyNotify)g_bytes_unref);
+
     /* Create audio play object */
     self->priv->audio_play = g_object_new(CDEMU_TYPE_AUDIO, NULL);
     /* Set parent */
     mirage_object_set_parent(MIRAGE_OBJECT(self->priv->audio_play), self);
     /* Initialize */
-    cdemu_audio_initialize(self->priv->audio_play, audio_driver, &self->priv->current_address, self->priv->device_mutex);
+    cdemu_audio_initialize(self->priv->audio_play, audio_driver, &self->priv->current_address);
 
     /* Create debug context for disc */
     self->priv->mirage_context = g_object_new(MIRAGE_TYPE_CONTEXT, NULL);
@@ -125,6 +127,9 @@ gboolean cdemu_device_initialize (CdemuDevice *self, gint number, const gchar *a
     cdemu_device_features_init(self);
     cdemu_device_set_profile(self, ProfileIndex_NONE);
 
+    /* Initialize command statistics */
+    cdemu_device_statistics_init(self);
+
     /* Enable DPM and disable transfer rate emulation by default */
     self->priv->dpm_emulation = FALSE;
     self->priv->tr_emulation = FALSE;
@@ -334,6 +339,7 @@ static void cdemu_device_init (CdemuDevice *self)
     self->priv->main_context = NULL;
     self->priv->main_loop = NULL;
     self->priv->io_watch = NULL;
+    self->priv->reactor = NULL;
 
     self->priv->device_name = NULL;
     self->priv->device_serial = NULL;
@@ -342,15 +348,20 @@ static void cdemu_device_init (CdemuDevice *self)
 
     self->priv->kernel_io_buffer = NULL;
     self->priv->buffer = NULL;
+    self->priv->response_cache = NULL;
 
     self->priv->audio_play = NULL;
 
+    self->priv->loading = FALSE;
     self->priv->disc = NULL;
+    self->priv->shared_disc = NULL;
     self->priv->mirage_context = NULL;
 
-    self->priv->mode_pages_list = NULL;
+    memset(self->priv->mode_pages, 0, sizeof(self->priv->mode_pages));
 
-    self->priv->features_list = NULL;
+    memset(self->priv->features, 0, sizeof(self->priv->features));
+    self->priv->features_all.data = NULL;
+    self->priv->features_current.data = NULL;
 
     self->priv->id_vendor_id = NULL;
     self->priv->id_product_id = NULL;
@@ -360,6 +371,11 @@ static void cdemu_device_init (CdemuDevice *self)
     self->priv->device_sg = NULL;
     self->priv->device_sr = NULL;
 
+    self->priv->sysfs_root = NULL;
+    self->priv->uevent_monitor = NULL;
+    self->priv->mapping_uevent_watch = NULL;
+    self->priv->mapping_retry_source = NULL;
+
     self->priv->write_descriptors = NULL;
 
     self->priv->image_writer = NULL;
@@ -367,6 +383,8 @@ static void cdemu_device_init (CdemuDevice *self)
 
     self->priv->leadin_cdtext_packs = NULL;
     self->priv->num_leadin_cdtext_packs = 0;
+
+    self->priv->command_statistics = NULL;
 }
 
 static void cdemu_device_dispose (GObject *gobject)
@@ -417,6 +435,9 @@ static void cdemu_device_finalize (GObject *gobject)
     /* Free features */
     cdemu_device_features_cleanup(self);
 
+    /* Free statistics */
+    cdemu_device_statistics_cleanup(self);
+
     /* Free write speed descriptors */
     if (self->priv->write_descriptors) {
         g_list_free_full(self->priv->write_descriptors, g_free);
@@ -425,6 +446,7 @@ static void cdemu_device_finalize (GObject *gobject)
     /* Free device map */
     g_free(self->priv->device_sg);
     g_free(self->priv->device_sr);
+    g_free(self->priv->sysfs_root);
 
     /* Free kernel I/O buffer */
     g_free(self->priv->kernel_io_buffer);
@@ -432,6 +454,11 @@ static void cdemu_device_finalize (GObject *gobject)
     /* Free buffer/"cache" */
     g_free(self->priv->buffer);
 
+    /* Free response cache */
+    if (self->priv->response_cache) {
+        g_hash_table_unref(self->priv->response_cache);
+    }
+
     /* Free device name */
     g_free(self->priv->device_name);
 
@@ -53,24 +53,30 @@ struct _CdemuDeviceClass
 GType cdemu_device_get_type (void);
 
 /* Public API */
-gboolean cdemu_device_initialize (CdemuDevice *self, gint number, const gchar *audio_driver, guint cdemu_debug_mask, guint mirage_debug_mask);
+gboolean cdemu_device_initialize (CdemuDevice *self, gint number, const gchar *audio_driver, const gchar *sysfs_root, CdemuUeventMonitor *uevent_monitor, guint cdemu_debug_mask, guint mirage_debug_mask);
 
 gint cdemu_device_get_device_number (CdemuDevice *self);
 
 gboolean cdemu_device_get_status (CdemuDevice *self, gchar ***filenames);
 
-gboolean cdemu_device_load_disc (CdemuDevice *self, gchar **filenames, GVariant *options, GError **error);
+void cdemu_device_load_disc_async (CdemuDevice *self, gchar **filenames, GVariant *options, GAsyncReadyCallback callback, gpointer user_data);
+gboolean cdemu_device_load_disc_finish (CdemuDevice *self, GAsyncResult *result, GError **error);
 gboolean cdemu_device_create_blank_disc (CdemuDevice *self, const gchar *filename, GVariant *options, GError **error);
 gboolean cdemu_device_unload_disc (CdemuDevice *self, GError **error);
 
 GVariant *cdemu_device_get_option (CdemuDevice *self, gchar *option_name, GError **error);
 gboolean cdemu_device_set_option (CdemuDevice *self, gchar *option_name, GVariant *option_value, GError **error);
 
-gboolean cdemu_device_setup_mapping (CdemuDevice *self);
+GVariant *cdemu_device_get_statistics (CdemuDevice *self);
+void cdemu_device_reset_statistics (CdemuDevice *self);
+
 void cdemu_device_get_mapping (CdemuDevice *self, gchar **sr_device, gchar **sg_device);
 
-gboolean cdemu_device_start (CdemuDevice *self, const gchar *ctl_device);
+gboolean cdemu_device_start (CdemuDevice *self, const gchar *ctl_device, CdemuReactor *reactor);
 void cdemu_device_stop (CdemuDevice *self);
 
+gint64 cdemu_device_process_request (CdemuDevice *self);
+void cdemu_device_send_response (CdemuDevice *self);
+
 
 G_END_DECLS
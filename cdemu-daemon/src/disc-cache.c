@@ -0,0 +1,406 @@
+/*
+ *  CDEmu daemon: shared disc cache
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cdemu.h"
+
+#include <sys/stat.h>
+
+
+/* Daemon-wide table of loaded discs, keyed by canonical filenames,
+ * their inodes, modification times and sizes, and loading options. Data
+ * files that the image files refer to are validated on every lookup. */
+static GMutex cache_mutex;
+static GCond cache_cond;
+static GHashTable *cache_table = NULL;
+
+
+/**********************************************************************\
+ *                          Key construction                          *
+\**********************************************************************/
+static gint compare_strings (gconstpointer a, gconstpointer b)
+{
+    return g_strcmp0(*(const gchar * const *)a, *(const gchar * const *)b);
+}
+
+/* Appends identification of given files (canonical path, inode,
+ * modification time with nanoseconds, and size) to the string; returns
+ * FALSE if any of them cannot be identified */
+static gboolean cdemu_disc_cache_stamp_files (GString *stamp, gchar **filenames)
+{
+    for (gint i = 0; filenames[i]; i++) {
+        gchar *path = realpath(filenames[i], NULL);
+        struct stat st;
+
+        if (!path || stat(path, &st) < 0) {
+            free(path);
+            return FALSE;
+        }
+
+        g_string_append_printf(stamp, "%s:%" G_GUINT64_FORMAT ":%" G_GINT64_FORMAT ".%09ld:%" G_GINT64_FORMAT "\n", path, (guint64)st.st_ino, (gint64)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec, (gint64)st.st_size);
+        free(path);
+    }
+
+    return TRUE;
+}
+
+static gchar *cdemu_disc_cache_make_key (gchar **filenames, GVariant *options)
+{
+    GString *key = g_string_new(NULL);
+    GPtrArray *option_names;
+
+    /* Image files; do not cache what we cannot identify */
+    if (!cdemu_disc_cache_stamp_files(key, filenames)) {
+        g_string_free(key, TRUE);
+        return NULL;
+    }
+
+    /* Options, in sorted order */
+    option_names = g_ptr_array_new_with_free_func(g_free);
+    for (guint i = 0; i < g_variant_n_children(options); i++) {
+        gchar *name;
+        g_variant_get_child(options, i, "{sv}", &name, NULL);
+        g_ptr_array_add(option_names, name);
+    }
+    g_ptr_array_sort(option_names, compare_strings);
+
+    for (guint i = 0; i < option_names->len; i++) {
+        const gchar *name = g_ptr_array_index(option_names, i);
+        GVariant *value = g_variant_lookup_value(options, name, NULL);
+        gchar *value_str = g_variant_print(value, TRUE);
+
+        g_string_append_printf(key, "%s=%s\n", name, value_str);
+
+        g_free(value_str);
+        g_variant_unref(value);
+    }
+    g_ptr_array_free(option_names, TRUE);
+
+    return g_string_free(key, FALSE);
+}
+
+/* Collects names of data files that disc's fragments read from; these
+ * may differ from the image files (e.g., BIN files of a CUE sheet) */
+static gchar **cdemu_disc_cache_get_data_files (MirageDisc *disc)
+{
+    GHashTable *files = g_hash_table_new(g_str_hash, g_str_equal);
+    GPtrArray *filenames = g_ptr_array_new();
+    gint num_tracks = mirage_disc_get_number_of_tracks(disc);
+
+    for (gint i = 0; i < num_tracks; i++) {
+        MirageTrack *track = mirage_disc_get_track_by_index(disc, i, NULL);
+        gint num_fragments;
+
+        if (!track) {
+            continue;
+        }
+
+        num_fragments = mirage_track_get_number_of_fragments(track);
+        for (gint j = 0; j < num_fragments; j++) {
+            MirageFragment *fragment = mirage_track_get_fragment_by_index(track, j, NULL);
+            const gchar *fragment_files[2];
+
+            if (!fragment) {
+                continue;
+            }
+
+            fragment_files[0] = mirage_fragment_main_data_get_filename(fragment);
+            fragment_files[1] = mirage_fragment_subchannel_data_get_filename(fragment);
+
+            for (gint k = 0; k < 2; k++) {
+                if (fragment_files[k] && !g_hash_table_contains(files, fragment_files[k])) {
+                    gchar *filename = g_strdup(fragment_files[k]);
+                    g_hash_table_add(files, filename);
+                    g_ptr_array_add(filenames, filename);
+                }
+            }
+
+            g_object_unref(fragment);
+        }
+
+        g_object_unref(track);
+    }
+
+    g_hash_table_unref(files);
+    g_ptr_array_add(filenames, NULL);
+
+    return (gchar **)g_ptr_array_free(filenames, FALSE);
+}
+
+static gchar *cdemu_disc_cache_make_data_stamp (gchar **data_files)
+{
+    GString *stamp = g_string_new(NULL);
+
+    if (!cdemu_disc_cache_stamp_files(stamp, data_files)) {
+        g_string_free(stamp, TRUE);
+        return NULL;
+    }
+
+    return g_string_free(stamp, FALSE);
+}
+
+/* Checks that data files of a loaded disc have not changed since it was
+ * loaded; called without cache mutex, since data files are not modified
+ * once the disc is loaded */
+static gboolean cdemu_disc_cache_data_files_unchanged (CdemuSharedDisc *entry)
+{
+    gchar *stamp = cdemu_disc_cache_make_data_stamp(entry->data_files);
+    gboolean unchanged = stamp && !g_strcmp0(stamp, entry->data_stamp);
+
+    g_free(stamp);
+
+    return unchanged;
+}
+
+
+/**********************************************************************\
+ *                            Shared disc                             *
+\**********************************************************************/
+static void cdemu_shared_disc_free (CdemuSharedDisc *self)
+{
+    if (self->disc) {
+        g_object_unref(self->disc);
+    }
+    if (self->context) {
+        g_object_unref(self->context);
+    }
+    if (self->error) {
+        g_error_free(self->error);
+    }
+    g_cond_clear(&self->cond);
+    g_mutex_clear(&self->mutex);
+    g_strfreev(self->data_files);
+    g_free(self->data_stamp);
+    g_free(self->key);
+    g_free(self);
+}
+
+/* Wraps a disc that is not shared with other devices (i.e., a blank
+ * disc being recorded), so that it can be locked the same way */
+CdemuSharedDisc *cdemu_shared_disc_new (MirageDisc *disc, MirageContext *context)
+{
+    CdemuSharedDisc *self = g_new0(CdemuSharedDisc, 1);
+
+    g_mutex_init(&self->mutex);
+    g_cond_init(&self->cond);
+    self->ref_count = 1;
+    self->disc = g_object_ref(disc);
+    self->context = g_object_ref(context);
+
+    return self;
+}
+
+CdemuSharedDisc *cdemu_shared_disc_ref (CdemuSharedDisc *self)
+{
+    g_mutex_lock(&cache_mutex);
+    self->ref_count++;
+    g_mutex_unlock(&cache_mutex);
+
+    return self;
+}
+
+void cdemu_shared_disc_unref (CdemuSharedDisc *self)
+{
+    g_mutex_lock(&cache_mutex);
+    if (--self->ref_count > 0) {
+        g_mutex_unlock(&cache_mutex);
+        return;
+    }
+
+    /* Last user is gone; remove the disc from cache */
+    if (self->cached) {
+        g_hash_table_remove(cache_table, self->key);
+        self->cached = FALSE;
+    }
+    g_mutex_unlock(&cache_mutex);
+
+    cdemu_shared_disc_free(self);
+}
+
+gint cdemu_shared_disc_get_num_users (CdemuSharedDisc *self)
+{
+    gint ref_count;
+
+    g_mutex_lock(&cache_mutex);
+    ref_count = self->ref_count;
+    g_mutex_unlock(&cache_mutex);
+
+    return ref_count;
+}
+
+
+/**********************************************************************\
+ *                              Disc lock                             *
+\**********************************************************************/
+void cdemu_shared_disc_lock (CdemuSharedDisc *self)
+{
+    g_mutex_lock(&self->mutex);
+    while (self->locked) {
+        g_cond_wait(&self->cond, &self->mutex);
+    }
+    self->locked = TRUE;
+    g_mutex_unlock(&self->mutex);
+}
+
+/* Waits for the lock for as long as keep_waiting() returns TRUE; the
+ * condition is re-evaluated whenever the lock is released, or when
+ * cdemu_shared_disc_wake_waiters() is called. Returns TRUE if the lock
+ * was acquired. */
+gboolean cdemu_shared_disc_lock_while (CdemuSharedDisc *self, gboolean (*keep_waiting) (gpointer data), gpointer data)
+{
+    gboolean acquired = FALSE;
+
+    g_mutex_lock(&self->mutex);
+    while (self->locked && keep_waiting(data)) {
+        g_cond_wait(&self->cond, &self->mutex);
+    }
+    if (!self->locked) {
+        self->locked = TRUE;
+        acquired = TRUE;
+    }
+    g_mutex_unlock(&self->mutex);
+
+    return acquired;
+}
+
+void cdemu_shared_disc_unlock (CdemuSharedDisc *self)
+{
+    g_mutex_lock(&self->mutex);
+    self->locked = FALSE;
+    g_cond_broadcast(&self->cond);
+    g_mutex_unlock(&self->mutex);
+}
+
+void cdemu_shared_disc_wake_waiters (CdemuSharedDisc *self)
+{
+    g_mutex_lock(&self->mutex);
+    g_cond_broadcast(&self->cond);
+    g_mutex_unlock(&self->mutex);
+}
+
+
+/**********************************************************************\
+ *                               Cache                                *
+\**********************************************************************/
+/* Returns shared disc for given image; if the same image (with the same
+ * options) is already loaded or being loaded by another device, its disc
+ * is reused. Otherwise, the image is loaded using given context. */
+CdemuSharedDisc *cdemu_disc_cache_acquire (gchar **filenames, GVariant *options, MirageContext *context, GError **error)
+{
+    gchar *key = cdemu_disc_cache_make_key(filenames, options);
+    CdemuSharedDisc *entry;
+    GError *local_error = NULL;
+    MirageDisc *disc;
+
+    g_mutex_lock(&cache_mutex);
+
+    if (!cache_table) {
+        cache_table = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+
+    /* Look up existing entry */
+    entry = key ? g_hash_table_lookup(cache_table, key) : NULL;
+    if (entry) {
+        entry->ref_count++;
+
+        /* Wait for another device to finish loading the image */
+        while (entry->loading) {
+            g_cond_wait(&cache_cond, &cache_mutex);
+        }
+        g_mutex_unlock(&cache_mutex);
+
+        if (!entry->disc) {
+            g_free(key);
+            g_propagate_error(error, g_error_copy(entry->error));
+            cdemu_shared_disc_unref(entry);
+            return NULL;
+        }
+
+        if (cdemu_disc_cache_data_files_unchanged(entry)) {
+            g_free(key);
+            return entry;
+        }
+
+        /* Data files were modified behind unchanged image files; retire
+         * the stale entry (its current users keep it) and load anew */
+        g_mutex_lock(&cache_mutex);
+        if (entry->cached) {
+            g_hash_table_remove(cache_table, entry->key);
+            entry->cached = FALSE;
+        }
+        g_mutex_unlock(&cache_mutex);
+
+        cdemu_shared_disc_unref(entry);
+
+        g_mutex_lock(&cache_mutex);
+    }
+
+    /* Create new entry; uncacheable images get a private one, and so do
+     * images that another device has started reloading meanwhile */
+    entry = g_new0(CdemuSharedDisc, 1);
+    g_mutex_init(&entry->mutex);
+    g_cond_init(&entry->cond);
+    entry->ref_count = 1;
+    entry->key = key;
+    entry->loading = TRUE;
+
+    if (key && !g_hash_table_contains(cache_table, key)) {
+        g_hash_table_insert(cache_table, entry->key, entry);
+        entry->cached = TRUE;
+    }
+
+    g_mutex_unlock(&cache_mutex);
+
+    /* Load image, and identify the data files it uses */
+    disc = mirage_context_load_image(context, filenames, &local_error);
+    if (disc) {
+        entry->data_files = cdemu_disc_cache_get_data_files(disc);
+        entry->data_stamp = cdemu_disc_cache_make_data_stamp(entry->data_files);
+    }
+
+    g_mutex_lock(&cache_mutex);
+    entry->loading = FALSE;
+    if (disc) {
+        entry->disc = disc;
+        entry->context = g_object_ref(context);
+
+        /* Disc whose data files cannot be identified is not shared */
+        if (!entry->data_stamp && entry->cached) {
+            g_hash_table_remove(cache_table, entry->key);
+            entry->cached = FALSE;
+        }
+    } else {
+        /* Keep the error for devices waiting on this entry, but do not
+         * serve it to later requests */
+        entry->error = g_error_copy(local_error);
+        if (entry->cached) {
+            g_hash_table_remove(cache_table, entry->key);
+            entry->cached = FALSE;
+        }
+    }
+    g_cond_broadcast(&cache_cond);
+    g_mutex_unlock(&cache_mutex);
+
+    if (!disc) {
+        g_propagate_error(error, local_error);
+        cdemu_shared_disc_unref(entry);
+        return NULL;
+    }
+
+    return entry;
+}
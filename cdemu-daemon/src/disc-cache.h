@@ -0,0 +1,69 @@
+/*
+ *  CDEmu daemon: shared disc cache
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+G_BEGIN_DECLS
+
+
+/**********************************************************************\
+ *                            Shared disc                             *
+\**********************************************************************/
+/* A loaded (read-only) disc that may be shared between several devices,
+ * or a device's private blank disc. MirageDisc and the streams beneath it
+ * are not thread-safe, so devices must hold the disc lock while accessing
+ * the disc. The lock is a flag guarded by the mutex, so that waiters can
+ * also be woken up for reasons other than the lock being released. */
+typedef struct _CdemuSharedDisc CdemuSharedDisc;
+
+struct _CdemuSharedDisc
+{
+    MirageDisc *disc;
+    MirageContext *context; /* Context the disc was loaded with */
+
+    /*< private >*/
+    GMutex mutex;
+    GCond cond;
+    gboolean locked;
+
+    gint ref_count;
+    gchar *key;
+    gchar **data_files; /* Files the disc reads its data from */
+    gchar *data_stamp; /* Identification of data files at load time */
+    gboolean cached;
+    gboolean loading;
+    GError *error;
+};
+
+CdemuSharedDisc *cdemu_disc_cache_acquire (gchar **filenames, GVariant *options, MirageContext *context, GError **error);
+
+CdemuSharedDisc *cdemu_shared_disc_new (MirageDisc *disc, MirageContext *context);
+
+CdemuSharedDisc *cdemu_shared_disc_ref (CdemuSharedDisc *self);
+void cdemu_shared_disc_unref (CdemuSharedDisc *self);
+
+gint cdemu_shared_disc_get_num_users (CdemuSharedDisc *self);
+
+void cdemu_shared_disc_lock (CdemuSharedDisc *self);
+gboolean cdemu_shared_disc_lock_while (CdemuSharedDisc *self, gboolean (*keep_waiting) (gpointer data), gpointer data);
+void cdemu_shared_disc_unlock (CdemuSharedDisc *self);
+void cdemu_shared_disc_wake_waiters (CdemuSharedDisc *self);
+
+
+G_END_DECLS
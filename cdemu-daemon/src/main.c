@@ -87,9 +87,11 @@ struct _ProgramOptions
     gchar *log_filename;
 
     gint num_devices;
+    gint use_reactor;
     gchar *ctl_device;
     gchar *audio_driver;
     gchar *bus;
+    gchar *sysfs_root;
     gint cdemu_debug_mask;
     gint mirage_debug_mask;
 
@@ -107,9 +109,11 @@ static gboolean _collect_program_options (int argc, char **argv, struct _Program
     const GOptionEntry option_entries[] = {
         {"config-file", 0, 0, G_OPTION_ARG_FILENAME, &options->config_filename, N_("Config file"), N_("filename")},
         {"num-devices", 'n', 0, G_OPTION_ARG_INT, &options->num_devices, N_("Number of devices"), N_("N")},
+        {"reactor", 0, 0, G_OPTION_ARG_INT, &options->use_reactor, N_("Serve all devices from a single epoll loop and a shared worker pool instead of per-device I/O threads (0=disable, 1=enable)"), "0|1"},
         {"ctl-device", 'c', 0, G_OPTION_ARG_STRING, &options->ctl_device, N_("Control device"), N_("path")},
         {"audio-driver", 'a', 0, G_OPTION_ARG_STRING, &options->audio_driver, N_("Audio driver"), N_("driver")},
         {"bus", 'b', 0, G_OPTION_ARG_STRING, &options->bus, N_("Bus type to use"), N_("bus_type")},
+        {"sysfs-root", 0, 0, G_OPTION_ARG_FILENAME, &options->sysfs_root, N_("Root of sysfs tree used for device mapping"), N_("path")},
         {"logfile", 'l', 0, G_OPTION_ARG_FILENAME, &options->log_filename, N_("Logfile"), N_("logfile")},
         {"default-cdemu-debug-mask", 0, 0, G_OPTION_ARG_INT, &options->cdemu_debug_mask, N_("Default debug mask for CDEmu devices"), N_("mask")},
         {"default-mirage-debug-mask", 0, 0, G_OPTION_ARG_INT, &options->mirage_debug_mask, N_("Default debug mask for underlying libMirage"), N_("mask")},
@@ -125,9 +129,11 @@ static gboolean _collect_program_options (int argc, char **argv, struct _Program
     options->log_filename = NULL;
 
     options->num_devices = -1;
+    options->use_reactor = -1;
     options->ctl_device = NULL;
     options->audio_driver = NULL;
     options->bus = NULL;
+    options->sysfs_root = NULL;
     options->cdemu_debug_mask = -1;
     options->mirage_debug_mask = -1;
     options->use_system_sleep_handler = -1;
@@ -175,6 +181,16 @@ static gboolean _collect_program_options (int argc, char **argv, struct _Program
         }
     }
 
+    /* Shared I/O reactor */
+    if (options->use_reactor == -1) {
+        gint value = _get_config_int(config_file, "settings", "reactor");
+        if (value < 0) {
+            options->use_reactor = 0; /* Default: 0 (= disable) */
+        } else {
+            options->use_reactor = value;
+        }
+    }
+
     /* Control device */
     if (options->ctl_device == NULL) {
         gchar *value = _get_config_str(config_file, "settings", "ctl-device");
@@ -205,6 +221,16 @@ static gboolean _collect_program_options (int argc, char **argv, struct _Program
         }
     }
 
+    /* sysfs root */
+    if (options->sysfs_root == NULL) {
+        gchar *value = _get_config_str(config_file, "settings", "sysfs-root");
+        if (value == NULL) {
+            options->sysfs_root = g_strdup("/sys"); /* Default */
+        } else {
+            options->sysfs_root = value;
+        }
+    }
+
     /* Log filename */
     if (options->log_filename == NULL) {
         gchar *value = _get_config_str(config_file, "settings", "logfile");
@@ -352,9 +378,11 @@ int main (int argc, char **argv)
         g_message(Q_(" - config file: N/A"));
     }
     g_message(Q_(" - num devices: %i"), program_options.num_devices);
+    g_message(Q_(" - use I/O reactor: %d"), program_options.use_reactor);
     g_message(Q_(" - control device: %s"), program_options.ctl_device);
     g_message(Q_(" - audio driver: %s"), program_options.audio_driver);
     g_message(Q_(" - bus type: %s"), program_options.bus);
+    g_message(Q_(" - sysfs root: %s"), program_options.sysfs_root);
     g_message(Q_(" - default CDEmu debug mask: 0x%X"), program_options.cdemu_debug_mask);
     g_message(Q_(" - default libMirage debug mask: 0x%X"), program_options.mirage_debug_mask);
     g_message(Q_(" - enable system sleep handler: %d"), program_options.use_system_sleep_handler);
@@ -371,8 +399,10 @@ int main (int argc, char **argv)
 
     daemon_settings.ctl_device = program_options.ctl_device; /* no ownership transfer! */
     daemon_settings.audio_driver = program_options.audio_driver; /* no ownership transfer! */
+    daemon_settings.sysfs_root = program_options.sysfs_root; /* no ownership transfer! */
 
     daemon_settings.num_devices = program_options.num_devices;
+    daemon_settings.use_reactor = program_options.use_reactor != 0;
 
     daemon_settings.cdemu_debug_mask = program_options.cdemu_debug_mask;
     daemon_settings.mirage_debug_mask = program_options.mirage_debug_mask;
@@ -424,6 +454,7 @@ int main (int argc, char **argv)
     g_free(program_options.ctl_device);
     g_free(program_options.audio_driver);
     g_free(program_options.bus);
+    g_free(program_options.sysfs_root);
     g_free(program_options.log_filename);
 
     return succeeded ? 0 : -1;
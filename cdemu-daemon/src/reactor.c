@@ -0,0 +1,369 @@
+/*
+ *  CDEmu daemon: shared I/O reactor
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cdemu.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#define __debug__ "Reactor"
+
+
+/* Maximum number of events fetched by a single epoll_wait() call */
+#define REACTOR_MAX_EVENTS 64
+
+/* Event data of the wake-up eventfd; device registrations start at 1 */
+#define REACTOR_WAKEUP_ID 0
+
+/* Flag in event data of a device's delay timer */
+#define REACTOR_TIMER_FLAG (G_GUINT64_CONSTANT(1) << 63)
+
+
+/**********************************************************************\
+ *                          Reactor structure                         *
+\**********************************************************************/
+typedef struct
+{
+    guint64 id;
+    CdemuDevice *device;
+    gint fd;
+    gint timer_fd; /* Delay emulation timer */
+    gint pending; /* Dispatched to the pool, but not yet processed */
+    gboolean deferred; /* Response held back until the timer expires */
+    gboolean completing; /* Timer expired; worker sends the response */
+} CdemuReactorEntry;
+
+struct _CdemuReactor
+{
+    gint epoll_fd;
+    gint wakeup_fd;
+
+    GThread *thread;
+    GThreadPool *pool;
+
+    /* Registered devices, keyed by registration ID; IDs are never
+     * reused, so a stale event cannot be mistaken for a new device */
+    GMutex mutex;
+    GCond cond;
+    GHashTable *entries;
+    guint64 next_id;
+};
+
+
+/**********************************************************************\
+ *                        Event loop and workers                      *
+\**********************************************************************/
+static gboolean cdemu_reactor_arm (CdemuReactor *self, CdemuReactorEntry *entry, gint op)
+{
+    struct epoll_event event;
+
+    /* One-shot watch: once the event is reported, the control device is
+     * not watched again until the request has been processed. This way,
+     * only one worker at a time serves a given device, and its requests
+     * are processed in order. */
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = entry->id;
+
+    return epoll_ctl(self->epoll_fd, op, entry->fd, &event) == 0;
+}
+
+/* Holds back the response until the emulated delay elapses, so that the
+ * worker is not blocked for its duration. Called with mutex held. */
+static gboolean cdemu_reactor_defer_response (CdemuReactorEntry *entry, gint64 delay)
+{
+    struct itimerspec spec = {
+        .it_value = {
+            .tv_sec = delay / G_USEC_PER_SEC,
+            .tv_nsec = (delay % G_USEC_PER_SEC) * 1000,
+        },
+    };
+
+    if (timerfd_settime(entry->timer_fd, 0, &spec, NULL) < 0) {
+        g_warning("%s: failed to arm delay timer: %s", __debug__, g_strerror(errno));
+        return FALSE;
+    }
+
+    entry->deferred = TRUE;
+
+    return TRUE;
+}
+
+static void cdemu_reactor_worker (CdemuReactorEntry *entry, CdemuReactor *self)
+{
+    gint64 delay = 0;
+
+    if (entry->completing) {
+        cdemu_device_send_response(entry->device);
+    } else {
+        delay = cdemu_device_process_request(entry->device);
+    }
+
+    g_mutex_lock(&self->mutex);
+
+    entry->completing = FALSE;
+
+    /* Request remains pending until its response is sent */
+    if (delay > 0) {
+        if (cdemu_reactor_defer_response(entry, delay)) {
+            /* Device removal may be waiting for this request */
+            g_cond_broadcast(&self->cond);
+            g_mutex_unlock(&self->mutex);
+            return;
+        }
+
+        /* Send it right away if the timer cannot be used */
+        g_mutex_unlock(&self->mutex);
+        cdemu_device_send_response(entry->device);
+        g_mutex_lock(&self->mutex);
+    }
+
+    /* Re-arm the watch, unless the device is being removed */
+    if (g_hash_table_lookup(self->entries, &entry->id) == entry) {
+        if (!cdemu_reactor_arm(self, entry, EPOLL_CTL_MOD)) {
+            g_warning("%s: failed to re-arm watch on control device: %s", __debug__, g_strerror(errno));
+        }
+    }
+
+    entry->pending--;
+    g_cond_broadcast(&self->cond);
+
+    g_mutex_unlock(&self->mutex);
+}
+
+static gpointer cdemu_reactor_thread (CdemuReactor *self)
+{
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    for (;;) {
+        gint num_events = epoll_wait(self->epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+
+        if (num_events < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            g_warning("%s: epoll_wait() failed: %s", __debug__, g_strerror(errno));
+            return NULL;
+        }
+
+        g_mutex_lock(&self->mutex);
+        for (gint i = 0; i < num_events; i++) {
+            guint64 id = events[i].data.u64; /* struct epoll_event may be packed */
+            CdemuReactorEntry *entry;
+
+            if (id == REACTOR_WAKEUP_ID) {
+                g_mutex_unlock(&self->mutex);
+                return NULL;
+            }
+
+            /* Delay timer expired; have the held-back response sent */
+            if (id & REACTOR_TIMER_FLAG) {
+                guint64 id_device = id & ~REACTOR_TIMER_FLAG;
+                guint64 expirations;
+
+                entry = g_hash_table_lookup(self->entries, &id_device);
+                if (!entry) {
+                    continue;
+                }
+
+                if (read(entry->timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+                    g_warning("%s: failed to read delay timer: %s", __debug__, g_strerror(errno));
+                }
+
+                if (entry->deferred) {
+                    entry->deferred = FALSE;
+                    entry->completing = TRUE;
+                    g_thread_pool_push(self->pool, entry, NULL);
+                }
+                continue;
+            }
+
+            /* The device might have been removed in the meantime */
+            entry = g_hash_table_lookup(self->entries, &id);
+            if (!entry) {
+                continue;
+            }
+
+            entry->pending++;
+            g_thread_pool_push(self->pool, entry, NULL);
+        }
+        g_mutex_unlock(&self->mutex);
+    }
+}
+
+
+/**********************************************************************\
+ *                              Public API                            *
+\**********************************************************************/
+CdemuReactor *cdemu_reactor_new (GError **error)
+{
+    CdemuReactor *self = g_new0(CdemuReactor, 1);
+    struct epoll_event event;
+
+    g_mutex_init(&self->mutex);
+    g_cond_init(&self->cond);
+    self->entries = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+    self->next_id = REACTOR_WAKEUP_ID + 1;
+
+    /* Epoll instance, and eventfd used to stop the event loop */
+    self->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    self->wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    event.events = EPOLLIN;
+    event.data.u64 = REACTOR_WAKEUP_ID;
+
+    if (self->epoll_fd < 0 || self->wakeup_fd < 0 || epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, self->wakeup_fd, &event) < 0) {
+        g_set_error(error, CDEMU_ERROR, CDEMU_ERROR_DAEMON_ERROR, Q_("Failed to set up epoll instance: %s"), g_strerror(errno));
+        cdemu_reactor_free(self);
+        return NULL;
+    }
+
+    /* Worker pool, sized to the number of cores */
+    self->pool = g_thread_pool_new((GFunc)cdemu_reactor_worker, self, MAX(g_get_num_processors(), 1), TRUE, error);
+    if (!self->pool) {
+        cdemu_reactor_free(self);
+        return NULL;
+    }
+
+    /* Event loop thread */
+    self->thread = g_thread_try_new("Reactor thread", (GThreadFunc)cdemu_reactor_thread, self, error);
+    if (!self->thread) {
+        cdemu_reactor_free(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+void cdemu_reactor_free (CdemuReactor *self)
+{
+    /* Stop the event loop */
+    if (self->thread) {
+        guint64 value = 1;
+        if (write(self->wakeup_fd, &value, sizeof(value)) != sizeof(value)) {
+            g_warning("%s: failed to signal event loop: %s", __debug__, g_strerror(errno));
+        }
+        g_thread_join(self->thread);
+    }
+
+    /* Wait for outstanding requests */
+    if (self->pool) {
+        g_thread_pool_free(self->pool, FALSE, TRUE);
+    }
+
+    if (self->wakeup_fd >= 0) {
+        close(self->wakeup_fd);
+    }
+    if (self->epoll_fd >= 0) {
+        close(self->epoll_fd);
+    }
+
+    g_hash_table_unref(self->entries);
+    g_cond_clear(&self->cond);
+    g_mutex_clear(&self->mutex);
+
+    g_free(self);
+}
+
+
+gboolean cdemu_reactor_add_device (CdemuReactor *self, CdemuDevice *device, gint fd, GError **error)
+{
+    CdemuReactorEntry *entry = g_new0(CdemuReactorEntry, 1);
+    struct epoll_event event;
+
+    entry->device = device;
+    entry->fd = fd;
+
+    g_mutex_lock(&self->mutex);
+
+    entry->id = self->next_id++;
+
+    /* Delay emulation timer */
+    event.events = EPOLLIN;
+    event.data.u64 = entry->id | REACTOR_TIMER_FLAG;
+
+    entry->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (entry->timer_fd < 0 || epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, entry->timer_fd, &event) < 0) {
+        g_set_error(error, CDEMU_ERROR, CDEMU_ERROR_DAEMON_ERROR, Q_("Failed to set up delay timer: %s"), g_strerror(errno));
+        g_mutex_unlock(&self->mutex);
+        if (entry->timer_fd >= 0) {
+            close(entry->timer_fd);
+        }
+        g_free(entry);
+        return FALSE;
+    }
+
+    if (!cdemu_reactor_arm(self, entry, EPOLL_CTL_ADD)) {
+        g_set_error(error, CDEMU_ERROR, CDEMU_ERROR_DAEMON_ERROR, Q_("Failed to watch control device: %s"), g_strerror(errno));
+        epoll_ctl(self->epoll_fd, EPOLL_CTL_DEL, entry->timer_fd, NULL);
+        g_mutex_unlock(&self->mutex);
+        close(entry->timer_fd);
+        g_free(entry);
+        return FALSE;
+    }
+
+    g_hash_table_insert(self->entries, &entry->id, entry);
+
+    g_mutex_unlock(&self->mutex);
+
+    return TRUE;
+}
+
+void cdemu_reactor_remove_device (CdemuReactor *self, CdemuDevice *device)
+{
+    CdemuReactorEntry *entry = NULL;
+    GHashTableIter iter;
+    gpointer value;
+
+    g_mutex_lock(&self->mutex);
+
+    g_hash_table_iter_init(&iter, self->entries);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        if (((CdemuReactorEntry *)value)->device == device) {
+            entry = value;
+            g_hash_table_iter_steal(&iter);
+            break;
+        }
+    }
+
+    if (entry) {
+        epoll_ctl(self->epoll_fd, EPOLL_CTL_DEL, entry->fd, NULL);
+
+        /* Wait for the request that is being processed, if any; a
+         * held-back response is sent right away */
+        while (entry->pending > 0) {
+            if (entry->deferred) {
+                entry->deferred = FALSE;
+                g_mutex_unlock(&self->mutex);
+                cdemu_device_send_response(device);
+                g_mutex_lock(&self->mutex);
+                entry->pending--;
+                continue;
+            }
+            g_cond_wait(&self->cond, &self->mutex);
+        }
+
+        epoll_ctl(self->epoll_fd, EPOLL_CTL_DEL, entry->timer_fd, NULL);
+        close(entry->timer_fd);
+    }
+
+    g_mutex_unlock(&self->mutex);
+
+    g_free(entry);
+}
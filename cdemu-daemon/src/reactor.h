@@ -0,0 +1,43 @@
+/*
+ *  CDEmu daemon: shared I/O reactor
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#pragma once
+
+G_BEGIN_DECLS
+
+
+/**********************************************************************\
+ *                            I/O reactor                             *
+\**********************************************************************/
+/* A single epoll loop that watches the control devices of all emulated
+ * devices and dispatches their requests to a shared worker pool, as an
+ * alternative to one I/O thread per device. Requests of a single device
+ * are still processed one at a time and in order. Delay emulation does
+ * not occupy a worker; the response is held back by a timer instead, so
+ * a few delayed devices cannot stall the others. */
+
+CdemuReactor *cdemu_reactor_new (GError **error);
+void cdemu_reactor_free (CdemuReactor *self);
+
+gboolean cdemu_reactor_add_device (CdemuReactor *self, CdemuDevice *device, gint fd, GError **error);
+void cdemu_reactor_remove_device (CdemuReactor *self, CdemuDevice *device);
+
+
+G_END_DECLS
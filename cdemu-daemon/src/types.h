@@ -29,6 +29,8 @@ typedef struct _CdemuAudio CdemuAudio;
 typedef struct _CdemuDevice CdemuDevice;
 typedef struct _CdemuCommand CdemuCommand;
 typedef struct _CdemuRecording CdemuRecording;
+typedef struct _CdemuReactor CdemuReactor;
+typedef struct _CdemuUeventMonitor CdemuUeventMonitor;
 
 
 G_END_DECLS
@@ -0,0 +1,269 @@
+/*
+ *  CDEmu daemon: SCSI device node discovery tests
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cdemu.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+
+/**********************************************************************\
+ *                             Fake sysfs                             *
+\**********************************************************************/
+typedef struct
+{
+    gchar *sysfs_root;
+} FakeSysfs;
+
+static gchar *fake_sysfs_device_path (FakeSysfs *fixture, const gchar *address)
+{
+    return g_build_filename(fixture->sysfs_root, "bus", "scsi", "devices", address, NULL);
+}
+
+static void fake_sysfs_add_device (FakeSysfs *fixture, const gchar *address)
+{
+    gchar *path = fake_sysfs_device_path(fixture, address);
+    g_assert_cmpint(g_mkdir_with_parents(path, 0755), ==, 0);
+    g_free(path);
+}
+
+static void fake_sysfs_add_dir (FakeSysfs *fixture, const gchar *address, const gchar *name)
+{
+    gchar *device_path = fake_sysfs_device_path(fixture, address);
+    gchar *path = g_build_filename(device_path, name, NULL);
+    g_assert_cmpint(g_mkdir_with_parents(path, 0755), ==, 0);
+    g_free(path);
+    g_free(device_path);
+}
+
+static void fake_sysfs_add_link (FakeSysfs *fixture, const gchar *address, const gchar *name, const gchar *target)
+{
+    gchar *device_path = fake_sysfs_device_path(fixture, address);
+    gchar *path = g_build_filename(device_path, name, NULL);
+    g_assert_cmpint(symlink(target, path), ==, 0);
+    g_free(path);
+    g_free(device_path);
+}
+
+static void fake_sysfs_remove (const gchar *path)
+{
+    GDir *dir;
+
+    if (!g_file_test(path, G_FILE_TEST_IS_SYMLINK) && (dir = g_dir_open(path, 0, NULL))) {
+        const gchar *name;
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+            fake_sysfs_remove(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+    }
+
+    g_remove(path);
+}
+
+static void fake_sysfs_setup (FakeSysfs *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    GError *error = NULL;
+
+    fixture->sysfs_root = g_dir_make_tmp("cdemu-sysfs-XXXXXX", &error);
+    g_assert_no_error(error);
+}
+
+static void fake_sysfs_teardown (FakeSysfs *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    fake_sysfs_remove(fixture->sysfs_root);
+    g_free(fixture->sysfs_root);
+}
+
+
+/**********************************************************************\
+ *                         sysfs lookup tests                         *
+\**********************************************************************/
+static void test_lookup_class_dirs (FakeSysfs *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    const gint32 address[4] = { 3, 0, 0, 0 };
+    gchar *device_sr, *device_sg;
+
+    /* Current kernels: block/<name> directory and generic symlink */
+    fake_sysfs_add_device(fixture, "3:0:0:0");
+    fake_sysfs_add_dir(fixture, "3:0:0:0", "block/sr1");
+    fake_sysfs_add_link(fixture, "3:0:0:0", "generic", "scsi_generic/sg3");
+
+    g_assert_false(cdemu_device_nodes_lookup(fixture->sysfs_root, address, &device_sr, &device_sg));
+    g_assert_cmpstr(device_sr, ==, "/dev/sr1");
+    g_assert_cmpstr(device_sg, ==, "/dev/sg3");
+
+    g_free(device_sr);
+    g_free(device_sg);
+}
+
+static void test_lookup_legacy_links (FakeSysfs *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    const gint32 address[4] = { 5, 0, 2, 1 };
+    gchar *device_sr, *device_sg;
+
+    /* Older kernels: block:<name> and scsi_generic:<name> entries */
+    fake_sysfs_add_device(fixture, "5:0:2:1");
+    fake_sysfs_add_dir(fixture, "5:0:2:1", "block:sr0");
+    fake_sysfs_add_dir(fixture, "5:0:2:1", "scsi_generic:sg7");
+
+    g_assert_false(cdemu_device_nodes_lookup(fixture->sysfs_root, address, &device_sr, &device_sg));
+    g_assert_cmpstr(device_sr, ==, "/dev/sr0");
+    g_assert_cmpstr(device_sg, ==, "/dev/sg7");
+
+    g_free(device_sr);
+    g_free(device_sg);
+}
+
+static void test_lookup_registering (FakeSysfs *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    const gint32 address[4] = { 3, 0, 0, 0 };
+    gchar *device_sr, *device_sg;
+
+    /* Block class directory exists, but its device is not there yet */
+    fake_sysfs_add_device(fixture, "3:0:0:0");
+    fake_sysfs_add_dir(fixture, "3:0:0:0", "block");
+    fake_sysfs_add_link(fixture, "3:0:0:0", "generic", "scsi_generic/sg3");
+
+    g_assert_true(cdemu_device_nodes_lookup(fixture->sysfs_root, address, &device_sr, &device_sg));
+    g_assert_null(device_sr);
+    g_assert_null(device_sg);
+
+    /* Once it appears, lookup completes */
+    fake_sysfs_add_dir(fixture, "3:0:0:0", "block/sr2");
+
+    g_assert_false(cdemu_device_nodes_lookup(fixture->sysfs_root, address, &device_sr, &device_sg));
+    g_assert_cmpstr(device_sr, ==, "/dev/sr2");
+    g_assert_cmpstr(device_sg, ==, "/dev/sg3");
+
+    g_free(device_sr);
+    g_free(device_sg);
+}
+
+static void test_lookup_missing (FakeSysfs *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    const gint32 address[4] = { 3, 0, 0, 0 };
+    const gint32 other_address[4] = { 4, 0, 0, 0 };
+    gchar *device_sr, *device_sg;
+
+    /* Device without class entries; lookup is final, but yields nothing */
+    fake_sysfs_add_device(fixture, "3:0:0:0");
+
+    g_assert_false(cdemu_device_nodes_lookup(fixture->sysfs_root, address, &device_sr, &device_sg));
+    g_assert_null(device_sr);
+    g_assert_null(device_sg);
+
+    /* Device that does not exist at all */
+    g_assert_false(cdemu_device_nodes_lookup(fixture->sysfs_root, other_address, &device_sr, &device_sg));
+    g_assert_null(device_sr);
+    g_assert_null(device_sg);
+}
+
+
+/**********************************************************************\
+ *                         Uevent parsing tests                       *
+\**********************************************************************/
+/* Builds a uevent message out of NUL-separated fields */
+#define UEVENT(str) str, sizeof(str)
+
+static void test_parse_uevent_block (void)
+{
+    gint32 address[4] = { 0 };
+
+    g_assert_true(cdemu_device_nodes_parse_uevent(UEVENT(
+        "add@/devices/pseudo_0/adapter0/host3/target3:0:0/3:0:0:0/block/sr1\0"
+        "ACTION=add\0"
+        "DEVPATH=/devices/pseudo_0/adapter0/host3/target3:0:0/3:0:0:0/block/sr1\0"
+        "SUBSYSTEM=block\0"
+        "DEVNAME=sr1\0"
+        "SEQNUM=1234"), address));
+    g_assert_cmpint(address[0], ==, 3);
+    g_assert_cmpint(address[1], ==, 0);
+    g_assert_cmpint(address[2], ==, 0);
+    g_assert_cmpint(address[3], ==, 0);
+}
+
+static void test_parse_uevent_generic (void)
+{
+    gint32 address[4] = { 0 };
+
+    g_assert_true(cdemu_device_nodes_parse_uevent(UEVENT(
+        "add@/devices/pseudo_0/adapter0/host12/target12:1:4/12:1:4:7/scsi_generic/sg12\0"
+        "ACTION=add\0"
+        "DEVPATH=/devices/pseudo_0/adapter0/host12/target12:1:4/12:1:4:7/scsi_generic/sg12\0"
+        "SUBSYSTEM=scsi_generic"), address));
+    g_assert_cmpint(address[0], ==, 12);
+    g_assert_cmpint(address[1], ==, 1);
+    g_assert_cmpint(address[2], ==, 4);
+    g_assert_cmpint(address[3], ==, 7);
+}
+
+static void test_parse_uevent_irrelevant (void)
+{
+    gint32 address[4] = { 0 };
+
+    /* Removal */
+    g_assert_false(cdemu_device_nodes_parse_uevent(UEVENT(
+        "remove@/devices/pseudo_0/adapter0/host3/target3:0:0/3:0:0:0/block/sr1\0"
+        "ACTION=remove\0"
+        "DEVPATH=/devices/pseudo_0/adapter0/host3/target3:0:0/3:0:0:0/block/sr1"), address));
+
+    /* SCSI device itself, and its target */
+    g_assert_false(cdemu_device_nodes_parse_uevent(UEVENT(
+        "add@/devices/pseudo_0/adapter0/host3/target3:0:0/3:0:0:0\0"
+        "ACTION=add\0"
+        "DEVPATH=/devices/pseudo_0/adapter0/host3/target3:0:0/3:0:0:0"), address));
+    g_assert_false(cdemu_device_nodes_parse_uevent(UEVENT(
+        "add@/devices/pseudo_0/adapter0/host3/target3:0:0\0"
+        "ACTION=add\0"
+        "DEVPATH=/devices/pseudo_0/adapter0/host3/target3:0:0"), address));
+
+    /* Block device that is not a SCSI device */
+    g_assert_false(cdemu_device_nodes_parse_uevent(UEVENT(
+        "add@/devices/virtual/block/loop0\0"
+        "ACTION=add\0"
+        "DEVPATH=/devices/virtual/block/loop0"), address));
+
+    /* Header only, without DEVPATH */
+    g_assert_false(cdemu_device_nodes_parse_uevent(UEVENT(
+        "add@/devices/pseudo_0/adapter0/host3/target3:0:0/3:0:0:0/block/sr1"), address));
+
+    g_assert_cmpint(address[0], ==, 0);
+}
+
+
+/**********************************************************************\
+ *                                Main                                *
+\**********************************************************************/
+int main (int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add("/device-nodes/lookup/class-dirs", FakeSysfs, NULL, fake_sysfs_setup, test_lookup_class_dirs, fake_sysfs_teardown);
+    g_test_add("/device-nodes/lookup/legacy-links", FakeSysfs, NULL, fake_sysfs_setup, test_lookup_legacy_links, fake_sysfs_teardown);
+    g_test_add("/device-nodes/lookup/registering", FakeSysfs, NULL, fake_sysfs_setup, test_lookup_registering, fake_sysfs_teardown);
+    g_test_add("/device-nodes/lookup/missing", FakeSysfs, NULL, fake_sysfs_setup, test_lookup_missing, fake_sysfs_teardown);
+
+    g_test_add_func("/device-nodes/uevent/block", test_parse_uevent_block);
+    g_test_add_func("/device-nodes/uevent/generic", test_parse_uevent_generic);
+    g_test_add_func("/device-nodes/uevent/irrelevant", test_parse_uevent_irrelevant);
+
+    return g_test_run();
+}
@@ -24,6 +24,9 @@
 
 #include <glib/gi18n-lib.h>
 #include <zlib.h>
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
 
 #include "filter-stream.h"
 
@@ -34,7 +37,7 @@ G_BEGIN_DECLS
 
 typedef struct
 {
-    gchar magic[4]; /* "CISO" signature */
+    gchar magic[4]; /* "CISO" or "ZISO" signature */
     guint32 header_size; /* One tool fail to set this value */
     guint64 total_bytes; /* Uncompressed data size */
     guint32 block_size; /* Uncompressed sector size */
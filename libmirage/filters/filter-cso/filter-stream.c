@@ -21,6 +21,27 @@
 
 #define __debug__ "CSO-FilterStream"
 
+/* When writing, data is split into blocks of this size, which are
+ * compressed in batches by a pool of worker threads */
+#define WRITE_BLOCK_SIZE 2048
+#define JOB_NUM_BLOCKS 512 /* 1 MiB of data per compression job */
+#define JOB_SIZE (WRITE_BLOCK_SIZE*JOB_NUM_BLOCKS)
+
+/* Index entries hold 31-bit offsets; larger files need alignment. Keep
+ * the alignment at most the block size, so that a padded block is never
+ * larger than the block size itself */
+#define MAX_INDEX_ALIGN 11
+
+#define INDEX_RAW_FLAG 0x80000000
+
+/* Space for the index is reserved in front of the compressed blocks,
+ * so that they can be written out as they are compressed; this covers
+ * 1 GiB of data. Larger images have their blocks moved further back once
+ * the final index size is known */
+#define RESERVED_INDEX_BLOCKS 524288
+
+#define COPY_BUFFER_SIZE 1048576
+
 typedef struct
 {
     goffset offset;
@@ -28,7 +49,20 @@ typedef struct
     gboolean raw;
 } CSO_Part;
 
+typedef struct
+{
+    /* Input */
+    guint8 *data;
+    gint num_blocks;
+
+    /* Output */
+    guint8 *output;
+    gsize output_size;
+    guint32 *block_sizes; /* Raw blocks are marked with INDEX_RAW_FLAG */
+} CSO_Job;
+
 static const guint8 ciso_signature[4] = {'C', 'I', 'S', 'O'};
+static const guint8 ziso_signature[4] = {'Z', 'I', 'S', 'O'};
 
 
 /**********************************************************************\
@@ -38,6 +72,9 @@ struct _MirageFilterStreamCsoPrivate
 {
     ciso_header_t header;
 
+    /* ZSO files use LZ4 instead of deflate */
+    gboolean lz4;
+
     /* Part list */
     CSO_Part *parts;
     gint num_parts;
@@ -54,6 +91,24 @@ struct _MirageFilterStreamCsoPrivate
 
     /* Zlib stream */
     z_stream zlib_stream;
+
+    /* Compression (write mode) */
+    gboolean write_mode;
+    gboolean write_failed;
+
+    guint8 *job_buffer; /* Data of job that is being filled */
+    goffset job_offset; /* Its offset within uncompressed stream */
+    gsize job_fill;
+
+    MirageJobQueue *job_queue;
+
+    guint64 total_bytes; /* Length of uncompressed data */
+
+    /* Compressed blocks are written back-to-back, starting after the
+     * reserved index space; index is kept in memory until the end */
+    goffset blocks_start;
+    goffset blocks_end;
+    GArray *block_sizes;
 };
 
 
@@ -84,13 +139,8 @@ static gboolean mirage_filter_stream_cso_read_index (MirageFilterStreamCso *self
 
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: reading part index", __debug__);
 
-    if (header->total_bytes % header->block_size) {
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: original stream size (%" G_GUINT64_FORMAT ") is not a multiple of block size (%d)!", __debug__, header->total_bytes, header->block_size);
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Invalid CSO file!"));
-        return FALSE;
-    }
-
-    self->priv->num_parts = header->total_bytes / header->block_size;
+    /* Last part may be only partially used */
+    self->priv->num_parts = (header->total_bytes + header->block_size - 1) / header->block_size;
     self->priv->num_indices = self->priv->num_parts + 1; /* Contains EOF offset */
 
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: number of parts: %d", __debug__, self->priv->num_parts);
@@ -133,7 +183,7 @@ static gboolean mirage_filter_stream_cso_read_index (MirageFilterStreamCso *self
         buf = GUINT32_FROM_LE(buf);
 
         /* Calculate part info */
-        cur_part->offset = (buf & 0x7FFFFFFF) << header->idx_align;
+        cur_part->offset = (goffset)(buf & 0x7FFFFFFF) << header->idx_align;
         cur_part->raw = buf >> 31;
         if (i > 0) {
             CSO_Part *prev_part = &self->priv->parts[i-1];
@@ -192,6 +242,420 @@ static gboolean mirage_filter_stream_cso_read_index (MirageFilterStreamCso *self
 }
 
 
+/**********************************************************************\
+ *                            Compression                             *
+\**********************************************************************/
+static inline goffset mirage_filter_stream_cso_align_offset (goffset offset, gint align)
+{
+    goffset mask = ((goffset)1 << align) - 1;
+    return (offset + mask) & ~mask;
+}
+
+static gboolean mirage_filter_stream_cso_compress_blocks (CSO_Job *job, gboolean lz4)
+{
+    z_stream zlib_stream;
+    gint ret;
+
+    job->output = g_try_malloc(job->num_blocks * WRITE_BLOCK_SIZE);
+    job->block_sizes = g_try_new(guint32, job->num_blocks);
+    if (!job->output || !job->block_sizes) {
+        return FALSE;
+    }
+    job->output_size = 0;
+
+    memset(&zlib_stream, 0, sizeof(zlib_stream));
+
+    if (!lz4) {
+        ret = deflateInit2(&zlib_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        if (ret != Z_OK) {
+            return FALSE;
+        }
+    }
+
+    for (gint i = 0; i < job->num_blocks; i++) {
+        const guint8 *data = job->data + i*WRITE_BLOCK_SIZE;
+        guint8 *output = job->output + job->output_size;
+        gint compressed_size = 0;
+
+        /* Compressed block must be smaller than the block itself,
+         * otherwise it is stored raw */
+        if (lz4) {
+#ifdef HAVE_LZ4
+            compressed_size = LZ4_compress_default((const char *)data, (char *)output, WRITE_BLOCK_SIZE, WRITE_BLOCK_SIZE - 1);
+#endif
+        } else {
+            deflateReset(&zlib_stream);
+
+            zlib_stream.next_in = (Bytef *)data;
+            zlib_stream.avail_in = WRITE_BLOCK_SIZE;
+            zlib_stream.next_out = output;
+            zlib_stream.avail_out = WRITE_BLOCK_SIZE - 1;
+
+            ret = deflate(&zlib_stream, Z_FINISH);
+            if (ret == Z_STREAM_END) {
+                compressed_size = zlib_stream.total_out;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                deflateEnd(&zlib_stream);
+                return FALSE;
+            }
+        }
+
+        if (compressed_size > 0) {
+            job->block_sizes[i] = compressed_size;
+        } else {
+            memcpy(output, data, WRITE_BLOCK_SIZE);
+            job->block_sizes[i] = WRITE_BLOCK_SIZE | INDEX_RAW_FLAG;
+        }
+
+        job->output_size += job->block_sizes[i] & ~INDEX_RAW_FLAG;
+    }
+
+    if (!lz4) {
+        deflateEnd(&zlib_stream);
+    }
+
+    return TRUE;
+}
+
+static void mirage_filter_stream_cso_free_job (CSO_Job *job)
+{
+    g_free(job->data);
+    g_free(job->output);
+    g_free(job->block_sizes);
+    g_free(job);
+}
+
+static gboolean mirage_filter_stream_cso_compress_job (CSO_Job *job, MirageFilterStreamCso *self)
+{
+    gboolean succeeded = mirage_filter_stream_cso_compress_blocks(job, self->priv->lz4);
+
+    g_free(job->data);
+    job->data = NULL;
+
+    if (!succeeded) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to compress blocks!", __debug__);
+    }
+
+    return succeeded;
+}
+
+static gboolean mirage_filter_stream_cso_write_data (MirageFilterStreamCso *self, const guint8 *data, gsize size)
+{
+    MirageStream *stream = mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self));
+
+    if (mirage_stream_write(stream, data, size, NULL) != (gssize)size) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to write %" G_GSIZE_MODIFIER "d bytes to underlying stream!", __debug__, size);
+        self->priv->write_failed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_cso_complete_job (CSO_Job *job, MirageFilterStreamCso *self)
+{
+    /* Compressed blocks are completed in stream order, and appended to
+     * the ones that were written before */
+    if (!mirage_filter_stream_cso_write_data(self, job->output, job->output_size)) {
+        return FALSE;
+    }
+
+    g_array_append_vals(self->priv->block_sizes, job->block_sizes, job->num_blocks);
+    self->priv->blocks_end += job->output_size;
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_cso_submit_job (MirageFilterStreamCso *self)
+{
+    CSO_Job *job = g_new0(CSO_Job, 1);
+    gsize padded_fill = (self->priv->job_fill + WRITE_BLOCK_SIZE - 1) / WRITE_BLOCK_SIZE * WRITE_BLOCK_SIZE;
+
+    /* Last block is zero-padded to the block size */
+    memset(self->priv->job_buffer + self->priv->job_fill, 0, padded_fill - self->priv->job_fill);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: submitting job at offset %" G_GOFFSET_MODIFIER "d (%" G_GSIZE_MODIFIER "d bytes)", __debug__, self->priv->job_offset, self->priv->job_fill);
+
+    /* Job takes over the job buffer */
+    job->data = self->priv->job_buffer;
+    job->num_blocks = padded_fill / WRITE_BLOCK_SIZE;
+
+    self->priv->job_buffer = g_malloc(JOB_SIZE);
+    self->priv->total_bytes = self->priv->job_offset + self->priv->job_fill;
+    self->priv->job_offset += padded_fill;
+    self->priv->job_fill = 0;
+
+    if (!mirage_helper_job_queue_push(self->priv->job_queue, job)) {
+        self->priv->write_failed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_cso_layout_fits (MirageFilterStreamCso *self, goffset data_start, gint align)
+{
+    goffset offset = data_start;
+
+    for (guint i = 0; i < self->priv->block_sizes->len; i++) {
+        offset = mirage_filter_stream_cso_align_offset(offset, align);
+        if ((offset >> align) > 0x7FFFFFFF) {
+            return FALSE;
+        }
+        offset += g_array_index(self->priv->block_sizes, guint32, i) & ~INDEX_RAW_FLAG;
+    }
+
+    /* EOF entry */
+    offset = mirage_filter_stream_cso_align_offset(offset, align);
+    return (offset >> align) <= 0x7FFFFFFF;
+}
+
+static inline gsize mirage_filter_stream_cso_get_block_size (MirageFilterStreamCso *self, guint block)
+{
+    return g_array_index(self->priv->block_sizes, guint32, block) & ~INDEX_RAW_FLAG;
+}
+
+static gboolean mirage_filter_stream_cso_move_blocks (MirageFilterStreamCso *self, const goffset *offsets)
+{
+    MirageStream *stream = mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self));
+    guint8 *read_buffer = g_malloc(COPY_BUFFER_SIZE);
+    guint8 *write_buffer = g_malloc(COPY_BUFFER_SIZE);
+    goffset src_end = self->priv->blocks_end;
+    gint last = self->priv->block_sizes->len - 1;
+    gboolean succeeded = TRUE;
+
+    /* Blocks can only move towards the end of file; move them in chunks,
+     * starting with the last one, so that none of them is overwritten
+     * before it has been moved */
+    while (succeeded && last >= 0) {
+        goffset dst_end = offsets[last] + mirage_filter_stream_cso_get_block_size(self, last);
+        goffset src_start = src_end;
+        gint first = last;
+        gsize dst_size;
+        gsize src_pos;
+
+        while (first >= 0 && dst_end - offsets[first] <= COPY_BUFFER_SIZE) {
+            src_start -= mirage_filter_stream_cso_get_block_size(self, first);
+            first--;
+        }
+        first++;
+
+        if (!mirage_stream_seek(stream, src_start, G_SEEK_SET, NULL) || mirage_stream_read(stream, read_buffer, src_end - src_start, NULL) != src_end - src_start) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read blocks #%d-#%d from underlying stream!", __debug__, first, last);
+            succeeded = FALSE;
+            break;
+        }
+
+        /* Lay the blocks out at their new offsets, zero-padding them to
+         * the alignment */
+        dst_size = dst_end - offsets[first];
+        memset(write_buffer, 0, dst_size);
+
+        src_pos = 0;
+        for (gint i = first; i <= last; i++) {
+            gsize block_size = mirage_filter_stream_cso_get_block_size(self, i);
+            memcpy(write_buffer + (offsets[i] - offsets[first]), read_buffer + src_pos, block_size);
+            src_pos += block_size;
+        }
+
+        if (!mirage_stream_seek(stream, offsets[first], G_SEEK_SET, NULL)) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to seek to %" G_GOFFSET_MODIFIER "d in underlying stream!", __debug__, offsets[first]);
+            succeeded = FALSE;
+            break;
+        }
+        succeeded = mirage_filter_stream_cso_write_data(self, write_buffer, dst_size);
+
+        src_end = src_start;
+        last = first - 1;
+    }
+
+    g_free(write_buffer);
+    g_free(read_buffer);
+
+    return succeeded;
+}
+
+static gboolean mirage_filter_stream_cso_write_image (MirageFilterStreamCso *self)
+{
+    MirageStream *stream = mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self));
+    guint num_blocks = self->priv->block_sizes->len;
+    goffset data_start = sizeof(ciso_header_t) + (num_blocks + 1) * sizeof(guint32);
+    ciso_header_t header;
+    goffset *offsets;
+    guint32 *index_entries;
+    goffset data_end;
+    gint align;
+
+    /* Blocks stay where they are unless the index has outgrown its
+     * reserved space */
+    data_start = MAX(data_start, self->priv->blocks_start);
+
+    /* Find the smallest index alignment that can address all blocks */
+    for (align = 0; align <= MAX_INDEX_ALIGN; align++) {
+        if (mirage_filter_stream_cso_layout_fits(self, data_start, align)) {
+            break;
+        }
+    }
+    if (align > MAX_INDEX_ALIGN) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: compressed data is too large to be indexed!", __debug__);
+        return FALSE;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: writing %s file with %d blocks (%" G_GUINT64_FORMAT " bytes); index alignment: %d", __debug__, self->priv->lz4 ? "ZSO" : "CSO", num_blocks, self->priv->total_bytes, 1 << align);
+
+    /* Final block offsets; last one is EOF offset */
+    offsets = g_new(goffset, num_blocks + 1);
+    data_end = data_start;
+    for (guint i = 0; i < num_blocks; i++) {
+        offsets[i] = mirage_filter_stream_cso_align_offset(data_end, align);
+        data_end = offsets[i] + mirage_filter_stream_cso_get_block_size(self, i);
+    }
+    offsets[num_blocks] = mirage_filter_stream_cso_align_offset(data_end, align);
+
+    /* Blocks only move if they are padded or shifted; in either case,
+     * the end of the last one moves as well */
+    if (data_end != self->priv->blocks_end) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: moving compressed blocks from %" G_GOFFSET_MODIFIER "d to %" G_GOFFSET_MODIFIER "d", __debug__, self->priv->blocks_start, data_start);
+        if (!mirage_filter_stream_cso_move_blocks(self, offsets)) {
+            g_free(offsets);
+            return FALSE;
+        }
+    }
+
+    /* Pad last block to the alignment */
+    if (offsets[num_blocks] > data_end) {
+        guint8 padding[1 << MAX_INDEX_ALIGN] = { 0 };
+
+        if (!mirage_stream_seek(stream, data_end, G_SEEK_SET, NULL) || !mirage_filter_stream_cso_write_data(self, padding, offsets[num_blocks] - data_end)) {
+            g_free(offsets);
+            return FALSE;
+        }
+    }
+
+    /* Header */
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, self->priv->lz4 ? ziso_signature : ciso_signature, sizeof(header.magic));
+    header.header_size = GUINT32_TO_LE(sizeof(ciso_header_t));
+    header.total_bytes = GUINT64_TO_LE(self->priv->total_bytes);
+    header.block_size = GUINT32_TO_LE(WRITE_BLOCK_SIZE);
+    header.version = 1;
+    header.idx_align = align;
+
+    if (!mirage_stream_seek(stream, 0, G_SEEK_SET, NULL)) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to seek to the beginning of underlying stream!", __debug__);
+        g_free(offsets);
+        return FALSE;
+    }
+    if (!mirage_filter_stream_cso_write_data(self, (const guint8 *)&header, sizeof(header))) {
+        g_free(offsets);
+        return FALSE;
+    }
+
+    /* Index */
+    index_entries = g_new(guint32, num_blocks + 1);
+    for (guint i = 0; i <= num_blocks; i++) {
+        guint32 raw_flag = (i < num_blocks) ? g_array_index(self->priv->block_sizes, guint32, i) & INDEX_RAW_FLAG : 0;
+        index_entries[i] = GUINT32_TO_LE((offsets[i] >> align) | raw_flag);
+    }
+    g_free(offsets);
+
+    if (!mirage_filter_stream_cso_write_data(self, (const guint8 *)index_entries, (num_blocks + 1) * sizeof(guint32))) {
+        g_free(index_entries);
+        return FALSE;
+    }
+    g_free(index_entries);
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_cso_finish (MirageFilterStream *_self, GError **error)
+{
+    MirageFilterStreamCso *self = MIRAGE_FILTER_STREAM_CSO(_self);
+
+    if (!self->priv->write_mode) {
+        return TRUE;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: finishing compressed stream", __debug__);
+
+    /* Compress remaining data and wait for all jobs */
+    if (self->priv->job_fill) {
+        mirage_filter_stream_cso_submit_job(self);
+    }
+    if (!mirage_helper_job_queue_wait(self->priv->job_queue)) {
+        self->priv->write_failed = TRUE;
+    }
+
+    mirage_helper_job_queue_free(self->priv->job_queue);
+    self->priv->job_queue = NULL;
+
+    /* Write header and index, and move blocks into place */
+    if (!self->priv->write_failed) {
+        if (!mirage_filter_stream_cso_write_image(self)) {
+            self->priv->write_failed = TRUE;
+        }
+    }
+
+    self->priv->write_mode = FALSE;
+
+    if (self->priv->write_failed) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write compressed file!"));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_cso_open_for_writing (MirageFilterStreamCso *self, MirageStream *stream, GError **error)
+{
+    const gchar *filename = mirage_stream_get_filename(stream);
+    gint num_threads = MAX(g_get_num_processors(), 1);
+
+    /* Files with .zso suffix use LZ4 compression */
+    if (filename) {
+        gchar *filename_lower = g_ascii_strdown(filename, -1);
+        self->priv->lz4 = g_str_has_suffix(filename_lower, ".zso");
+        g_free(filename_lower);
+    }
+
+#ifndef HAVE_LZ4
+    if (self->priv->lz4) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("ZSO files cannot be created without LZ4 support!"));
+        return FALSE;
+    }
+#endif
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: creating %s file; %d compression thread(s)", __debug__, self->priv->lz4 ? "ZSO" : "CSO", num_threads);
+
+    /* Compressed blocks are written after the reserved index space;
+     * header and index are written when the file is finished */
+    self->priv->blocks_start = mirage_filter_stream_cso_align_offset(sizeof(ciso_header_t) + (RESERVED_INDEX_BLOCKS + 1) * sizeof(guint32), MAX_INDEX_ALIGN);
+    self->priv->blocks_end = self->priv->blocks_start;
+
+    if (!mirage_stream_seek(stream, self->priv->blocks_start, G_SEEK_SET, NULL)) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to seek to the beginning of compressed data!"));
+        return FALSE;
+    }
+
+    /* Bound the memory used by jobs in flight */
+    self->priv->job_queue = mirage_helper_job_queue_new((MirageJobFunc)mirage_filter_stream_cso_compress_job, (MirageJobFunc)mirage_filter_stream_cso_complete_job, (GDestroyNotify)mirage_filter_stream_cso_free_job, self, num_threads, 2*num_threads, error);
+    if (!self->priv->job_queue) {
+        return FALSE;
+    }
+
+    self->priv->block_sizes = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    self->priv->job_buffer = g_malloc(JOB_SIZE);
+    self->priv->job_offset = 0;
+    self->priv->job_fill = 0;
+    self->priv->total_bytes = 0;
+
+    self->priv->write_mode = TRUE;
+
+    return TRUE;
+}
+
+
 /**********************************************************************\
  *              MirageFilterStream methods implementations            *
 \**********************************************************************/
@@ -204,12 +668,17 @@ static void mirage_filter_stream_fixup_header(MirageFilterStreamCso *self)
     header->block_size  = GUINT32_FROM_LE(header->block_size);
 }
 
-static gboolean mirage_filter_stream_cso_open (MirageFilterStream *_self, MirageStream *stream, gboolean writable G_GNUC_UNUSED, GError **error)
+static gboolean mirage_filter_stream_cso_open (MirageFilterStream *_self, MirageStream *stream, gboolean writable, GError **error)
 {
     MirageFilterStreamCso *self = MIRAGE_FILTER_STREAM_CSO(_self);
 
     ciso_header_t *header = &self->priv->header;
 
+    /* In write mode, we create a new file */
+    if (writable) {
+        return mirage_filter_stream_cso_open_for_writing(self, stream, error);
+    }
+
     /* Read CISO header */
     mirage_stream_seek(stream, 0, G_SEEK_SET, NULL);
     if (mirage_stream_read(stream, header, sizeof(ciso_header_t), NULL) != sizeof(ciso_header_t)) {
@@ -221,14 +690,27 @@ static gboolean mirage_filter_stream_cso_open (MirageFilterStream *_self, Mirage
     mirage_filter_stream_fixup_header(self);
 
     /* Validate CISO header */
-    if (memcmp(&header->magic, ciso_signature, sizeof(ciso_signature)) || header->version > 1 ||
-        header->total_bytes == 0 || header->block_size == 0) {
+    if (!memcmp(&header->magic, ziso_signature, sizeof(ziso_signature))) {
+        self->priv->lz4 = TRUE;
+    } else if (memcmp(&header->magic, ciso_signature, sizeof(ciso_signature))) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_CANNOT_HANDLE, Q_("Filter cannot handle given data: invalid header!"));
+        return FALSE;
+    }
+
+    if (header->version > 1 || header->total_bytes == 0 || header->block_size == 0) {
         g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_CANNOT_HANDLE, Q_("Filter cannot handle given data: invalid header!"));
         return FALSE;
     }
 
+#ifndef HAVE_LZ4
+    if (self->priv->lz4) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_CANNOT_HANDLE, Q_("Filter cannot handle given data: ZSO files require LZ4 support!"));
+        return FALSE;
+    }
+#endif
+
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: parsing the underlying stream data...", __debug__);
-    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: CISO file alignment: %d.", __debug__, 1 << header->idx_align);
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: %s file alignment: %d.", __debug__, self->priv->lz4 ? "ZISO" : "CISO", 1 << header->idx_align);
 
     /* Read index */
     if (!mirage_filter_stream_cso_read_index(self, error)) {
@@ -249,6 +731,10 @@ static gssize mirage_filter_stream_cso_partial_read (MirageFilterStream *_self,
     goffset position = mirage_filter_stream_simplified_get_position(_self);
     gint part_idx;
 
+    if (self->priv->write_mode) {
+        return -1;
+    }
+
     /* Find part that corresponds tho current position */
     part_idx = position / self->priv->header.block_size;
 
@@ -284,6 +770,23 @@ static gssize mirage_filter_stream_cso_partial_read (MirageFilterStream *_self,
                 MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: unexpectedly reached EOF!", __debug__);
                 return -1;
             }
+        } else if (self->priv->lz4) {
+#ifdef HAVE_LZ4
+            /* Read whole compressed part */
+            ret = mirage_stream_read(stream, self->priv->io_buffer, part->comp_size, NULL);
+            if (ret != (gint)part->comp_size) {
+                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read %" G_GINT64_MODIFIER "d bytes from underlying stream!", __debug__, part->comp_size);
+                return -1;
+            }
+
+            /* Part may be followed by alignment padding, so decode only
+             * until the output is full */
+            ret = LZ4_decompress_safe_partial((const char *)self->priv->io_buffer, (char *)self->priv->inflate_buffer, part->comp_size, self->priv->inflate_buffer_size, self->priv->inflate_buffer_size);
+            if (ret != self->priv->inflate_buffer_size) {
+                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to decompress LZ4 part!", __debug__);
+                return -1;
+            }
+#endif
         } else {
             /* Reset inflate engine */
             ret = inflateReset2(zlib_stream, -15);
@@ -329,9 +832,10 @@ static gssize mirage_filter_stream_cso_partial_read (MirageFilterStream *_self,
     }
 
 
-    /* Copy data */
+    /* Copy data; do not go past the end of stream within the last part */
     gsize part_offset = position % self->priv->header.block_size;
     count = MIN(count, self->priv->header.block_size - part_offset);
+    count = MIN(count, self->priv->header.total_bytes - position);
 
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: offset within part: %" G_GSIZE_MODIFIER "d, copying %" G_GSIZE_MODIFIER "d bytes", __debug__, part_offset, count);
 
@@ -341,6 +845,51 @@ static gssize mirage_filter_stream_cso_partial_read (MirageFilterStream *_self,
 }
 
 
+static gssize mirage_filter_stream_cso_partial_write (MirageFilterStream *_self, const void *buffer, gsize count)
+{
+    MirageFilterStreamCso *self = MIRAGE_FILTER_STREAM_CSO(_self);
+    goffset position = mirage_filter_stream_simplified_get_position(_self);
+    gsize job_position;
+
+    if (!self->priv->write_mode || self->priv->write_failed) {
+        return -1;
+    }
+
+    /* Data that has already been handed over for compression cannot
+     * be changed anymore; only the job being filled can be */
+    if (position < self->priv->job_offset) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: cannot write at position %" G_GOFFSET_MODIFIER "d; data up to %" G_GOFFSET_MODIFIER "d has already been compressed!", __debug__, position, self->priv->job_offset);
+        return -1;
+    }
+
+    /* Writing beyond the current job; zero-fill and submit it */
+    if (position >= self->priv->job_offset + JOB_SIZE) {
+        memset(self->priv->job_buffer + self->priv->job_fill, 0, JOB_SIZE - self->priv->job_fill);
+        self->priv->job_fill = JOB_SIZE;
+        return mirage_filter_stream_cso_submit_job(self) ? 0 : -1;
+    }
+
+    /* Copy data into job, zero-filling the gap, if any */
+    job_position = position - self->priv->job_offset;
+    count = MIN(count, JOB_SIZE - job_position);
+
+    if (job_position > self->priv->job_fill) {
+        memset(self->priv->job_buffer + self->priv->job_fill, 0, job_position - self->priv->job_fill);
+    }
+    memcpy(self->priv->job_buffer + job_position, buffer, count);
+    self->priv->job_fill = MAX(self->priv->job_fill, job_position + count);
+
+    /* Submit full job */
+    if (self->priv->job_fill == JOB_SIZE) {
+        if (!mirage_filter_stream_cso_submit_job(self)) {
+            return -1;
+        }
+    }
+
+    return count;
+}
+
+
 /**********************************************************************\
  *                             Object init                            *
 \**********************************************************************/
@@ -351,17 +900,38 @@ static void mirage_filter_stream_cso_init (MirageFilterStreamCso *self)
     mirage_filter_stream_generate_info(MIRAGE_FILTER_STREAM(self),
         "FILTER-CSO",
         Q_("CSO File Filter"),
-        FALSE,
-        1,
-        Q_("Compressed ISO images (*.ciso, *.cso)"), "application/x-cso"
+        TRUE,
+        2,
+        Q_("Compressed ISO images (*.ciso, *.cso)"), "application/x-cso",
+        Q_("LZ4-compressed ISO images (*.zso)"), "application/x-ziso"
     );
 
+    self->priv->lz4 = FALSE;
+
     self->priv->num_parts = 0;
     self->priv->parts = NULL;
 
     self->priv->cached_part = -1;
     self->priv->inflate_buffer = NULL;
     self->priv->io_buffer = NULL;
+
+    self->priv->write_mode = FALSE;
+    self->priv->write_failed = FALSE;
+    self->priv->job_buffer = NULL;
+    self->priv->job_queue = NULL;
+    self->priv->block_sizes = NULL;
+}
+
+static void mirage_filter_stream_cso_dispose (GObject *gobject)
+{
+    MirageFilterStreamCso *self = MIRAGE_FILTER_STREAM_CSO(gobject);
+
+    /* Complete the compressed file while we still have the underlying
+     * stream; parent's dispose releases it */
+    mirage_filter_stream_cso_finish(MIRAGE_FILTER_STREAM(self), NULL);
+
+    /* Chain up to the parent class */
+    G_OBJECT_CLASS(mirage_filter_stream_cso_parent_class)->dispose(gobject);
 }
 
 static void mirage_filter_stream_cso_finalize (GObject *gobject)
@@ -372,6 +942,11 @@ static void mirage_filter_stream_cso_finalize (GObject *gobject)
     g_free(self->priv->inflate_buffer);
     g_free(self->priv->io_buffer);
 
+    g_free(self->priv->job_buffer);
+    if (self->priv->block_sizes) {
+        g_array_free(self->priv->block_sizes, TRUE);
+    }
+
     inflateEnd(&self->priv->zlib_stream);
 
     /* Chain up to the parent class */
@@ -383,11 +958,14 @@ static void mirage_filter_stream_cso_class_init (MirageFilterStreamCsoClass *kla
     GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
     MirageFilterStreamClass *filter_stream_class = MIRAGE_FILTER_STREAM_CLASS(klass);
 
+    gobject_class->dispose = mirage_filter_stream_cso_dispose;
     gobject_class->finalize = mirage_filter_stream_cso_finalize;
 
     filter_stream_class->open = mirage_filter_stream_cso_open;
 
     filter_stream_class->simplified_partial_read = mirage_filter_stream_cso_partial_read;
+    filter_stream_class->simplified_partial_write = mirage_filter_stream_cso_partial_write;
+    filter_stream_class->finish = mirage_filter_stream_cso_finish;
 }
 
 static void mirage_filter_stream_cso_class_finalize (MirageFilterStreamCsoClass *klass G_GNUC_UNUSED)
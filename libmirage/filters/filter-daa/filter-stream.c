@@ -59,6 +59,7 @@ typedef struct
     guint64 offset;
     guint32 length;
     CompressionType compression;
+    gint part; /* Part in which the chunk starts */
 } DAA_Chunk;
 
 typedef struct
@@ -69,6 +70,13 @@ typedef struct
     guint64 end;
 } DAA_Part;
 
+typedef struct
+{
+    gint index;
+    guint64 length;
+    GError *error;
+} DAA_PartOpenTask;
+
 typedef gchar * (*DAA_create_filename_func) (const gchar *main_filename, gint index);
 
 
@@ -114,6 +122,16 @@ struct _MirageFilterStreamDaaPrivate
     gint cached_chunk; /* Index of currently cached chunk */
     gsize cached_chunk_size;
 
+    /* Read-ahead of next chunk's raw data */
+    GThreadPool *readahead_pool;
+    GMutex readahead_mutex;
+    GCond readahead_cond;
+    guint8 *readahead_buffer;
+    gint readahead_chunk; /* Chunk held in (or being read into) read-ahead buffer */
+    gboolean readahead_pending;
+    gboolean readahead_succeeded;
+    gint last_read_chunk;
+
     /* Compression */
     z_stream zlib_stream;
 
@@ -592,10 +610,11 @@ static gboolean mirage_filter_stream_daa_read_part_header (MirageFilterStreamDaa
     return TRUE;
 }
 
-static gboolean mirage_filter_stream_daa_read_from_stream (MirageFilterStreamDaa *self, guint64 offset, guint32 length, guint8 *buffer, GError **error)
+static gboolean mirage_filter_stream_daa_read_from_stream (MirageFilterStreamDaa *self, gint part_index, guint64 offset, guint32 length, guint8 *buffer, GError **error)
 {
     /* A rather complex loop, thanks to the possibility that a chunk spans across
-     * multiple part files... */
+     * multiple part files; the starting part is given by the chunk table, and
+     * the remaining data is in the subsequent parts */
     while (length > 0) {
         guint64 local_offset, file_offset;
         guint32 read_length;
@@ -603,13 +622,10 @@ static gboolean mirage_filter_stream_daa_read_from_stream (MirageFilterStreamDaa
 
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: reading 0x%X bytes from stream at offset 0x%" G_GINT64_MODIFIER "X", __debug__, length, offset);
 
-        /* Find the part to which the given offset belongs */
-        for (gint i = 0; i < self->priv->num_parts; i++) {
-            if (offset >= self->priv->part_table[i].start && offset < self->priv->part_table[i].end) {
-                part = &self->priv->part_table[i];
-                MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: using part #%i", __debug__, i);
-                break;
-            }
+        /* Validate the part to which the given offset belongs */
+        if (part_index < self->priv->num_parts && offset >= self->priv->part_table[part_index].start && offset < self->priv->part_table[part_index].end) {
+            part = &self->priv->part_table[part_index];
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: using part #%i", __debug__, part_index);
         }
         if (!part) {
             MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to find part for offset 0x%" G_GINT64_MODIFIER "X!", __debug__, offset);
@@ -649,15 +665,72 @@ static gboolean mirage_filter_stream_daa_read_from_stream (MirageFilterStreamDaa
             return FALSE;
         }
 
-        /* Update length and offset */
+        /* Update length and offset; any remaining data is in next part */
         length -= read_length;
         offset += read_length;
         buffer += read_length;
+        part_index++;
     }
 
     return TRUE;
 }
 
+/**********************************************************************\
+ *                         Chunk read-ahead                           *
+\**********************************************************************/
+static void mirage_filter_stream_daa_readahead_chunk (gpointer data, MirageFilterStreamDaa *self)
+{
+    const DAA_Chunk *chunk = &self->priv->chunk_table[GPOINTER_TO_INT(data) - 1];
+    gboolean succeeded;
+
+    succeeded = mirage_filter_stream_daa_read_from_stream(self, chunk->part, chunk->offset, chunk->length, self->priv->readahead_buffer, NULL);
+
+    g_mutex_lock(&self->priv->readahead_mutex);
+    self->priv->readahead_succeeded = succeeded;
+    self->priv->readahead_pending = FALSE;
+    g_cond_signal(&self->priv->readahead_cond);
+    g_mutex_unlock(&self->priv->readahead_mutex);
+}
+
+static void mirage_filter_stream_daa_readahead_wait (MirageFilterStreamDaa *self)
+{
+    g_mutex_lock(&self->priv->readahead_mutex);
+    while (self->priv->readahead_pending) {
+        g_cond_wait(&self->priv->readahead_cond, &self->priv->readahead_mutex);
+    }
+    g_mutex_unlock(&self->priv->readahead_mutex);
+}
+
+static gboolean mirage_filter_stream_daa_read_chunk_data (MirageFilterStreamDaa *self, gint chunk_index, guint8 *buffer)
+{
+    const DAA_Chunk *chunk = &self->priv->chunk_table[chunk_index];
+    gboolean sequential = chunk_index == self->priv->last_read_chunk + 1;
+
+    /* Part streams are shared with read-ahead; wait for it to finish */
+    mirage_filter_stream_daa_readahead_wait(self);
+
+    if (chunk_index == self->priv->readahead_chunk && self->priv->readahead_succeeded) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: using read-ahead data for chunk #%d", __debug__, chunk_index);
+        memcpy(buffer, self->priv->readahead_buffer, chunk->length);
+    } else if (!mirage_filter_stream_daa_read_from_stream(self, chunk->part, chunk->offset, chunk->length, buffer, NULL)) {
+        return FALSE;
+    }
+
+    self->priv->readahead_chunk = -1;
+    self->priv->last_read_chunk = chunk_index;
+
+    /* On sequential access, read next chunk's data (which may reside in
+     * next part file) while the current one is being decompressed */
+    if (sequential && self->priv->readahead_pool && chunk_index + 1 < self->priv->num_chunks) {
+        self->priv->readahead_chunk = chunk_index + 1;
+        self->priv->readahead_pending = TRUE;
+        g_thread_pool_push(self->priv->readahead_pool, GINT_TO_POINTER(chunk_index + 2), NULL);
+    }
+
+    return TRUE;
+}
+
+
 /**********************************************************************\
  *                         Descriptor parsing                         *
 \**********************************************************************/
@@ -1089,14 +1162,79 @@ static gboolean mirage_filter_stream_daa_parse_chunk_table (MirageFilterStreamDa
 /**********************************************************************\
  *                       Part table construction                      *
 \**********************************************************************/
+static void mirage_filter_stream_daa_open_part (DAA_PartOpenTask *task, MirageFilterStreamDaa *self)
+{
+    DAA_Part *part = &self->priv->part_table[task->index];
+    gchar *part_filename;
+    gchar part_signature[16];
+
+    /* If we have create_filename_func set, use it... otherwise we're a
+     * non-split image and should be using self->priv->main_filename anyway */
+    if (self->priv->create_filename_func) {
+        part_filename = self->priv->create_filename_func(self->priv->main_filename, task->index);
+    } else {
+        part_filename = g_strdup(self->priv->main_filename);
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: part #%i: %s", __debug__, task->index, part_filename);
+
+    /* Create stream; we directly create an instance of MirageFileStream
+     * instead of going through mirage_contextual_create_input_stream(),
+     * because parts are opened in parallel and context's stream cache
+     * is not meant to be accessed from multiple threads. Part files
+     * are plain files anyway. */
+    part->stream = g_object_new(MIRAGE_TYPE_FILE_STREAM, NULL);
+    mirage_contextual_inherit_context(MIRAGE_CONTEXTUAL(part->stream), MIRAGE_CONTEXTUAL(self));
+
+    if (!mirage_file_stream_open(MIRAGE_FILE_STREAM(part->stream), part_filename, FALSE, &task->error)) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to open stream on file '%s'!", __debug__, part_filename);
+        g_free(part_filename);
+        return;
+    }
+    g_free(part_filename);
+
+    /* Read signature */
+    if (mirage_stream_read(part->stream, part_signature, sizeof(part_signature), NULL) != sizeof(part_signature)) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read part's signature!", __debug__);
+        g_set_error(&task->error, MIRAGE_ERROR, MIRAGE_ERROR_DATA_FILE_ERROR, Q_("Failed to read part's signature!"));
+        return;
+    }
+
+    /* Read header */
+    if (!memcmp(part_signature, daa_part_signature, sizeof(daa_part_signature))
+        || !memcmp(part_signature, gbi_part_signature, sizeof(gbi_part_signature))) {
+        DAA_PartHeader part_header;
+        if (!mirage_filter_stream_daa_read_part_header(self, part->stream, &part_header, &task->error)) {
+            return;
+        }
+        part->offset = part_header.chunk_data_offset & 0x00FFFFFF;
+    } else {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: invalid part's signature!", __debug__);
+        g_set_error(&task->error, MIRAGE_ERROR, MIRAGE_ERROR_PARSER_ERROR, Q_("Part's signature is invalid!"));
+        return;
+    }
+
+    /* We could parse part descriptor here; it's present in both main and part
+     * files, and it has same format. It appears to contain previous
+     * and current part's index, and the length of current part (with some
+     * other fields in between). However, those part lengths are literal part
+     * files' lengths, and we actually need the lengths of zipped streams
+     * they contain. So we'll calculate that ourselves and leave part descriptor
+     * alone... Part indices aren't of any use to us either, because I
+     * haven't seen any DAA image having them mixed up... */
+    mirage_stream_seek(part->stream, 0, G_SEEK_END, NULL);
+    task->length = mirage_stream_tell(part->stream) - part->offset;
+}
+
 static gboolean mirage_filter_stream_daa_build_part_table (MirageFilterStreamDaa *self, GError **error)
 {
     guint64 tmp_offset = 0;
     guint64 part_length;
     guint64 tmp_position;
     DAA_Part *part;
-    gchar *part_filename;
-    gchar part_signature[16];
+    DAA_PartOpenTask *tasks;
+    GThreadPool *pool;
+    gboolean succeeded = TRUE;
 
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: building parts table (%d entries)...", __debug__, self->priv->num_parts);
 
@@ -1130,72 +1268,64 @@ static gboolean mirage_filter_stream_daa_build_part_table (MirageFilterStreamDaa
     part->end = tmp_offset;
 
 
-    /* Add the rest of the parts */
-    for (gint i = 1; i < self->priv->num_parts; i++) {
-        part = &self->priv->part_table[i];
+    /* Open the rest of the parts in parallel; with many parts on slow
+     * (e.g., network) storage, the open latency would otherwise add up */
+    tasks = g_new0(DAA_PartOpenTask, self->priv->num_parts);
+    pool = g_thread_pool_new((GFunc)mirage_filter_stream_daa_open_part, self, MAX(g_get_num_processors(), 1), FALSE, NULL);
 
-        /* If we have create_filename_func set, use it... otherwise we're a
-         * non-split image and should be using self->priv->main_filename anyway */
-        if (self->priv->create_filename_func) {
-            part_filename = self->priv->create_filename_func(self->priv->main_filename, i);
+    for (gint i = 1; i < self->priv->num_parts; i++) {
+        tasks[i].index = i;
+        if (pool) {
+            g_thread_pool_push(pool, &tasks[i], NULL);
         } else {
-            part_filename = g_strdup(self->priv->main_filename);
+            mirage_filter_stream_daa_open_part(&tasks[i], self);
         }
+    }
 
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: part #%i: %s", __debug__, i, part_filename);
-
-        /* Create stream */
-        part->stream = mirage_contextual_create_input_stream(MIRAGE_CONTEXTUAL(self), part_filename, error);
-        if (!part->stream) {
-            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to open stream on file '%s'!", __debug__, part_filename);
-            g_free(part_filename);
-            return FALSE;
-        }
-        g_free(part_filename);
+    if (pool) {
+        g_thread_pool_free(pool, FALSE, TRUE);
+    }
 
-        /* Read signature */
-        if (mirage_stream_read(part->stream, part_signature, sizeof(part_signature), NULL) != sizeof(part_signature)) {
-            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read part's signature!", __debug__);
-            g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_DATA_FILE_ERROR, Q_("Failed to read part's signature!"));
-            return FALSE;
-        }
+    /* Compute parts' ranges */
+    for (gint i = 1; i < self->priv->num_parts; i++) {
+        part = &self->priv->part_table[i];
 
-        /* Read header */
-        if (!memcmp(part_signature, daa_part_signature, sizeof(daa_part_signature))
-            || !memcmp(part_signature, gbi_part_signature, sizeof(gbi_part_signature))) {
-            DAA_PartHeader part_header;
-            if (!mirage_filter_stream_daa_read_part_header(self, part->stream, &part_header, error)) {
-                return FALSE;
+        if (tasks[i].error) {
+            if (succeeded) {
+                g_propagate_error(error, tasks[i].error);
+                succeeded = FALSE;
+            } else {
+                g_error_free(tasks[i].error);
             }
-            part->offset = part_header.chunk_data_offset & 0x00FFFFFF;
-        } else {
-            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: invalid part's signature!", __debug__);
-            g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_PARSER_ERROR, Q_("Part's signature is invalid!"));
-            return FALSE;
+            continue;
         }
 
-        /* We could parse part descriptor here; it's present in both main and part
-         * files, and it has same format. It appears to contain previous
-         * and current part's index, and the length of current part (with some
-         * other fields in between). However, those part lengths are literal part
-         * files' lengths, and we actually need the lengths of zipped streams
-         * they contain. So we'll calculate that ourselves and leave part descriptor
-         * alone... Part indices aren't of any use to us either, because I
-         * haven't seen any DAA image having them mixed up... */
-        mirage_stream_seek(part->stream, 0, G_SEEK_END, NULL);
-        part_length = mirage_stream_tell(part->stream);
-
-        part_length -= part->offset;
-
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: part length: 0x%" G_GINT64_MODIFIER "X", __debug__, part_length);
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: part #%i length: 0x%" G_GINT64_MODIFIER "X", __debug__, i, tasks[i].length);
 
         part->start = tmp_offset;
-        tmp_offset += part_length;
+        tmp_offset += tasks[i].length;
         part->end = tmp_offset;
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: part start: 0x%" G_GINT64_MODIFIER "X", __debug__, part->start);
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: part end: 0x%" G_GINT64_MODIFIER "X", __debug__, part->end);
     }
 
+    g_free(tasks);
+
+    if (!succeeded) {
+        return FALSE;
+    }
+
+    /* Precompute the part in which each chunk starts; both chunks and
+     * parts are ordered by offset, so a single sweep suffices */
+    for (gint i = 0, p = 0; i < self->priv->num_chunks; i++) {
+        DAA_Chunk *chunk = &self->priv->chunk_table[i];
+
+        while (p < self->priv->num_parts - 1 && chunk->offset >= self->priv->part_table[p].end) {
+            p++;
+        }
+        chunk->part = p;
+    }
+
     return TRUE;
 }
 
@@ -1328,6 +1458,13 @@ static gboolean mirage_filter_stream_daa_parse_daa_file (MirageFilterStreamDaa *
         return FALSE;
     }
 
+    /* Set up read-ahead; it is an optimization, so do without it if
+     * thread cannot be created */
+    self->priv->readahead_buffer = g_try_malloc(self->priv->io_buffer_size);
+    if (self->priv->readahead_buffer) {
+        self->priv->readahead_pool = g_thread_pool_new((GFunc)mirage_filter_stream_daa_readahead_chunk, self, 1, FALSE, NULL);
+    }
+
     return TRUE;
 }
 
@@ -1408,7 +1545,7 @@ static gssize mirage_filter_stream_daa_partial_read (MirageFilterStream *_self,
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: chunk not cached, reading...", __debug__);
 
         /* Read chunk */
-        if (!mirage_filter_stream_daa_read_from_stream(self, chunk->offset, chunk->length, self->priv->io_buffer, NULL)) {
+        if (!mirage_filter_stream_daa_read_chunk_data(self, chunk_index, self->priv->io_buffer)) {
             MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read data for chunk #%i", __debug__, chunk_index);
             return -1;
         }
@@ -1491,12 +1628,28 @@ static void mirage_filter_stream_daa_init (MirageFilterStreamDaa *self)
     self->priv->inflate_buffer = NULL;
 
     self->priv->cached_chunk = -1;
+
+    self->priv->readahead_pool = NULL;
+    g_mutex_init(&self->priv->readahead_mutex);
+    g_cond_init(&self->priv->readahead_cond);
+    self->priv->readahead_buffer = NULL;
+    self->priv->readahead_chunk = -1;
+    self->priv->readahead_pending = FALSE;
+    self->priv->readahead_succeeded = FALSE;
+    self->priv->last_read_chunk = -1;
 }
 
 static void mirage_filter_stream_daa_finalize (GObject *gobject)
 {
     MirageFilterStreamDaa *self = MIRAGE_FILTER_STREAM_DAA(gobject);
 
+    /* Wait for read-ahead in progress, which uses part streams */
+    if (self->priv->readahead_pool) {
+        g_thread_pool_free(self->priv->readahead_pool, TRUE, TRUE);
+    }
+    g_mutex_clear(&self->priv->readahead_mutex);
+    g_cond_clear(&self->priv->readahead_cond);
+
     /* Free stream */
     inflateEnd(&self->priv->zlib_stream);
     LzmaDec_Free(&self->priv->lzma_decoder, &lzma_allocator);
@@ -1518,6 +1671,7 @@ static void mirage_filter_stream_daa_finalize (GObject *gobject)
     /* Free buffer */
     g_free(self->priv->io_buffer);
     g_free(self->priv->inflate_buffer);
+    g_free(self->priv->readahead_buffer);
 
     /* Chain up to the parent class */
     G_OBJECT_CLASS(mirage_filter_stream_daa_parent_class)->finalize(gobject);
@@ -23,6 +23,7 @@
 #include <mirage/mirage.h>
 
 #include <glib/gi18n-lib.h>
+#include <stdlib.h>
 #include <zlib.h>
 #include <bzlib.h>
 
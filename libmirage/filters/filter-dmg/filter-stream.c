@@ -37,6 +37,12 @@ typedef struct
     gsize in_length;
 } DMG_Part;
 
+typedef struct
+{
+    gint index;
+    GError *error;
+} DMG_StreamOpenTask;
+
 typedef gchar * (*DMG_create_filename_func) (const gchar *main_filename, gint index);
 
 
@@ -64,10 +70,23 @@ struct _MirageFilterStreamDmgPrivate
     guint inflate_buffer_size;
     gint cached_part;
 
+    /* Last part found by lookup */
+    gint last_found_part;
+
     /* I/O buffer */
     guint8 *io_buffer;
     guint io_buffer_size;
 
+    /* Read-ahead of next part's raw data */
+    GThreadPool *readahead_pool;
+    GMutex readahead_mutex;
+    GCond readahead_cond;
+    guint8 *readahead_buffer;
+    gint readahead_part; /* Part held in (or being read into) read-ahead buffer */
+    gboolean readahead_pending;
+    gssize readahead_length;
+    gint last_read_part;
+
     /* Compression streams */
     z_stream  zlib_stream;
     bz_stream bzip2_stream;
@@ -506,6 +525,16 @@ static gboolean mirage_filter_stream_dmg_read_descriptor (MirageFilterStreamDmg
     return TRUE;
 }
 
+static gint mirage_filter_stream_dmg_compare_parts (const DMG_Part *part1, const DMG_Part *part2)
+{
+    if (part1->first_sector < part2->first_sector) {
+        return -1;
+    } else if (part1->first_sector > part2->first_sector) {
+        return 1;
+    }
+    return 0;
+}
+
 static gboolean mirage_filter_stream_dmg_read_part_index (MirageFilterStreamDmg *self, GError **error)
 {
     z_stream *zlib_stream = &self->priv->zlib_stream;
@@ -605,6 +634,10 @@ static gboolean mirage_filter_stream_dmg_read_part_index (MirageFilterStreamDmg
         }
     }
 
+    /* Sort parts by their first sector, so that part lookup can use
+     * binary search, and so that next part is also next in the stream */
+    qsort(self->priv->parts, cur_part, sizeof(DMG_Part), (GCompareFunc)mirage_filter_stream_dmg_compare_parts);
+
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: required I/O buffer size: %u", __debug__, self->priv->io_buffer_size);
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: required inflate buffer size: %u", __debug__, self->priv->inflate_buffer_size);
 
@@ -663,111 +696,153 @@ static gboolean mirage_filter_stream_dmg_read_part_index (MirageFilterStreamDmg
 /**********************************************************************\
  *               MirageFilterStream methods implementation            *
 \**********************************************************************/
-static gboolean mirage_filter_stream_dmg_open_streams (MirageFilterStreamDmg *self, GError **error)
+static void mirage_filter_stream_dmg_readahead_part (gpointer data, MirageFilterStreamDmg *self);
+
+static void mirage_filter_stream_dmg_open_stream (DMG_StreamOpenTask *task, MirageFilterStreamDmg *self)
 {
-    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: opening stream(s) for %d segment(s)...", __debug__, self->priv->num_segments);
+    const gchar *original_filename = mirage_stream_get_filename(self->priv->streams[0]);
+    koly_block_t *koly_block = &self->priv->koly_blocks[task->index];
+    guint s = task->index;
+    MirageStream *stream;
+    GError *local_error = NULL;
+    gchar *filename = self->priv->create_filename_func(original_filename, s);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: trying to create stream #%d for file: %s", __debug__, s, filename);
+
+    /* Directly create an instance of MirageFileStream, instead of
+     * going through mirage_contextual_create_input_stream(). Using
+     * the latter would try to instantiate DMG filter again, and that
+     * would fail due to file not being the first one in the set. While
+     * we could demote the corresponding error in mirage_filter_stream_dmg_open()
+     * from MIRAGE_ERROR_STREAM_ERROR to MIRAGE_ERROR_CANNOT_HANDLE,
+     * that would effectively result in creation of a MirageFileStream. */
+    stream = g_object_new(MIRAGE_TYPE_FILE_STREAM, NULL);
+
+    /* Propagate context; for debugging */
+    mirage_contextual_inherit_context(MIRAGE_CONTEXTUAL(stream), MIRAGE_CONTEXTUAL(self));
+
+    if (!mirage_file_stream_open(MIRAGE_FILE_STREAM(stream), filename, FALSE, &local_error)) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to create stream #%d on file %s: %s", __debug__, s, filename, local_error->message);
+        g_error_free(local_error);
+        g_object_unref(stream);
+        g_free(filename);
+        g_set_error(&task->error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to create stream!"));
+        return;
+    }
 
-    /* Fill in existing stream */
-    self->priv->streams[0] = g_object_ref(mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self)));
+    g_free(filename);
 
-    const gchar *original_filename = mirage_stream_get_filename(self->priv->streams[0]);
-    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: reusing stream #0 on filename: %s", __debug__, original_filename);
+    /* If the first stream is an instance of EncrCDSA stream, the image
+     * is encrypted; in that case, we also need to create EncrCDSA stream
+     * for each segment. By now, the password (if it was obtained
+     * interactively) has been stored in context options by the first
+     * stream, so the segments do not prompt for it concurrently. */
+    if (MIRAGE_IS_FILTER_STREAM_ENCRCDSA(self->priv->streams[0])) {
+        MirageStream *orig_stream = stream;
 
-    /* Create the rest of the streams */
-    for (guint s = 1; s < self->priv->num_segments; s++) {
-        MirageStream *stream;
-        GError *local_error = NULL;
-        gchar *filename = self->priv->create_filename_func(original_filename, s);
-
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: trying to create stream #%d for file: %s", __debug__, s, filename);
-
-        /* Directly create an instance of MirageFileStream, instead of
-         * going through mirage_contextual_create_input_stream(). Using
-         * the latter would try to instantiate DMG filter again, and that
-         * would fail due to file not being the first one in the set. While
-         * we could demote the corresponding error in mirage_filter_stream_dmg_open()
-         * from MIRAGE_ERROR_STREAM_ERROR to MIRAGE_ERROR_CANNOT_HANDLE,
-         * that would effectively result in creation of a MirageFileStream. */
-        stream = g_object_new(MIRAGE_TYPE_FILE_STREAM, NULL);
-
-        /* Propagate context; for debugging */
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: trying to create EncrCDSA stream on top of stream #%d...", __debug__, s);
+
+        stream = g_object_new(MIRAGE_TYPE_FILTER_STREAM_ENCRCDSA, NULL);
+
+        /* Propagate context; for debugging and password settings */
         mirage_contextual_inherit_context(MIRAGE_CONTEXTUAL(stream), MIRAGE_CONTEXTUAL(self));
 
-        if (!mirage_file_stream_open(MIRAGE_FILE_STREAM(stream), filename, FALSE, &local_error)) {
-            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to create stream #%d on file %s: %s", __debug__, s, filename, local_error->message);
+        if (!mirage_filter_stream_open(MIRAGE_FILTER_STREAM(stream), orig_stream, FALSE, &local_error)) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to create EncrCDSA stream on top of stream #%d: %s", __debug__, s, local_error->message);
             g_error_free(local_error);
             g_object_unref(stream);
-            g_free(filename);
-            g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to create stream!"));
-            return FALSE;
+            g_object_unref(orig_stream);
+            g_set_error(&task->error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to create stream!"));
+            return;
         }
 
-        g_free(filename);
-
-        /* If the first stream is an instance of EncrCDSA stream, the image
-         * is encrypted; in that case, we also need to create EncrCDSA stream
-         * for each segment. */
-        if (MIRAGE_IS_FILTER_STREAM_ENCRCDSA(self->priv->streams[0])) {
-            MirageStream *orig_stream = stream;
+        g_object_unref(orig_stream); /* Now owned by EncrCDSA stream */
+    }
 
-            MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: trying to create EncrCDSA stream on top of stream #%d...", __debug__, s);
+    self->priv->streams[s] = stream;
 
-            stream = g_object_new(MIRAGE_TYPE_FILTER_STREAM_ENCRCDSA, NULL);
+    /* Read koly block */
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: reading koly block in stream #%d...!", __debug__, s);
+    for (guint try = 0; try < 2; try++) {
+        /* Find koly block either on end (most often) or beginning of file */
+        if (try == 0) {
+            mirage_stream_seek(stream, -sizeof(koly_block_t), G_SEEK_END, NULL);
+        } else {
+            mirage_stream_seek(stream, 0, G_SEEK_SET, NULL);
+        }
 
-            /* Propagate context; for debugging and password settings */
-            mirage_contextual_inherit_context(MIRAGE_CONTEXTUAL(stream), MIRAGE_CONTEXTUAL(self));
+        /* Read koly block */
+        if (mirage_stream_read(stream, koly_block, sizeof(koly_block_t), NULL) != sizeof(koly_block_t)) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read koly block!", __debug__);
+            g_set_error(&task->error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to read koly block!"));
+            return;
+        }
 
-            if (!mirage_filter_stream_open(MIRAGE_FILTER_STREAM(stream), orig_stream, FALSE, &local_error)) {
-                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to create EncrCDSA stream on top of stream #%d: %s", __debug__, s, local_error->message);
-                g_error_free(local_error);
-                g_object_unref(stream);
-                g_object_unref(orig_stream);
-                g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to create stream!"));
-                return FALSE;
+        /* Validate koly block */
+        if (memcmp(koly_block->signature, koly_signature, sizeof(koly_signature))) {
+            if (try == 1) {
+                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: invalid koly block!", __debug__);
+                g_set_error(&task->error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Invalid koly block!"));
+                return;
             }
-
-            g_object_unref(orig_stream); /* Now owned by EncrCDSA stream */
+        } else {
+            mirage_filter_stream_dmg_koly_block_fix_endian(koly_block);
+            break;
         }
-
-        self->priv->streams[s] = stream;
     }
+}
+
+static gboolean mirage_filter_stream_dmg_open_streams (MirageFilterStreamDmg *self, GError **error)
+{
+    DMG_StreamOpenTask *tasks;
+    GThreadPool *pool;
+    gboolean succeeded = TRUE;
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: opening stream(s) for %d segment(s)...", __debug__, self->priv->num_segments);
+
+    /* Fill in existing stream */
+    self->priv->streams[0] = g_object_ref(mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self)));
+
+    const gchar *original_filename = mirage_stream_get_filename(self->priv->streams[0]);
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: reusing stream #0 on filename: %s", __debug__, original_filename);
+
+    /* Create the rest of the streams and read their koly blocks; this is
+     * done in parallel, so that open latency on slow (e.g., network)
+     * storage and key derivation for encrypted segments do not add up */
+    tasks = g_new0(DMG_StreamOpenTask, self->priv->num_segments);
+    pool = g_thread_pool_new((GFunc)mirage_filter_stream_dmg_open_stream, self, MAX(g_get_num_processors(), 1), FALSE, NULL);
 
-    /* Read the rest of the koly blocks */
     for (guint s = 1; s < self->priv->num_segments; s++) {
-        MirageStream *stream = self->priv->streams[s];
-        koly_block_t *koly_block = &self->priv->koly_blocks[s];
-
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: reading koly block in stream #%d...!", __debug__, s);
-        for (guint try = 0; try < 2; try++) {
-            /* Find koly block either on end (most often) or beginning of file */
-            if (try == 0) {
-                mirage_stream_seek(stream, -sizeof(koly_block_t), G_SEEK_END, NULL);
-            } else {
-                mirage_stream_seek(stream, 0, G_SEEK_SET, NULL);
-            }
+        tasks[s].index = s;
+        if (pool) {
+            g_thread_pool_push(pool, &tasks[s], NULL);
+        } else {
+            mirage_filter_stream_dmg_open_stream(&tasks[s], self);
+        }
+    }
 
-            /* Read koly block */
-            if (mirage_stream_read(stream, koly_block, sizeof(koly_block_t), NULL) != sizeof(koly_block_t)) {
-                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read koly block!", __debug__);
-                g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to read koly block!"));
-                return FALSE;
-            }
+    if (pool) {
+        g_thread_pool_free(pool, FALSE, TRUE);
+    }
 
-            /* Validate koly block */
-            if (memcmp(koly_block->signature, koly_signature, sizeof(koly_signature))) {
-                if (try == 1) {
-                    MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: invalid koly block!", __debug__);
-                    g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Invalid koly block!"));
-                    return FALSE;
-                }
+    for (guint s = 1; s < self->priv->num_segments; s++) {
+        if (tasks[s].error) {
+            if (succeeded) {
+                g_propagate_error(error, tasks[s].error);
+                succeeded = FALSE;
             } else {
-                mirage_filter_stream_dmg_koly_block_fix_endian(koly_block);
-                break;
+                g_error_free(tasks[s].error);
             }
+            continue;
         }
 
         /* Output koly block info */
-        mirage_filter_stream_dmg_print_koly_block(self, koly_block);
+        mirage_filter_stream_dmg_print_koly_block(self, &self->priv->koly_blocks[s]);
+    }
+    g_free(tasks);
+
+    if (!succeeded) {
+        return FALSE;
     }
 
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: successfully opened %d streams", __debug__, self->priv->num_segments);
@@ -909,6 +984,14 @@ static gboolean mirage_filter_stream_dmg_open (MirageFilterStream *_self, Mirage
         return FALSE;
     }
 
+    /* Set up read-ahead; it is an optimization, so do without it if
+     * thread cannot be created. Raw parts are read into inflate buffer,
+     * so read-ahead buffer must accommodate either */
+    self->priv->readahead_buffer = g_try_malloc(MAX(self->priv->io_buffer_size, self->priv->inflate_buffer_size));
+    if (self->priv->readahead_buffer) {
+        self->priv->readahead_pool = g_thread_pool_new((GFunc)mirage_filter_stream_dmg_readahead_part, self, 1, FALSE, NULL);
+    }
+
     /* Set file size */
     mirage_filter_stream_simplified_set_stream_length(_self, koly_block->sector_count * DMG_SECTOR_SIZE);
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: original stream size: %" G_GINT64_MODIFIER "u", __debug__, koly_block->sector_count * DMG_SECTOR_SIZE);
@@ -983,21 +1066,99 @@ static gssize mirage_filter_stream_dmg_read_raw_chunk (MirageFilterStreamDmg *se
     return have_read;
 }
 
+static gint mirage_filter_stream_dmg_find_part (MirageFilterStreamDmg *self, guint64 sector)
+{
+    gint last = self->priv->last_found_part;
+    gint low = 0;
+    gint high = self->priv->num_parts - 1;
+
+    /* Sequential access stays within last found part, or moves to the
+     * next one */
+    for (gint p = MAX(last, 0); p <= MIN(last + 1, high); p++) {
+        const DMG_Part *part = &self->priv->parts[p];
+        if (part->first_sector <= sector && sector < part->first_sector + part->num_sectors) {
+            return self->priv->last_found_part = p;
+        }
+    }
+
+    /* Otherwise, binary search; parts are sorted by their first sector */
+    while (low <= high) {
+        gint mid = low + (high - low) / 2;
+        const DMG_Part *part = &self->priv->parts[mid];
+
+        if (sector < part->first_sector) {
+            high = mid - 1;
+        } else if (sector >= part->first_sector + part->num_sectors) {
+            low = mid + 1;
+        } else {
+            return self->priv->last_found_part = mid;
+        }
+    }
+
+    return -1;
+}
+
+static void mirage_filter_stream_dmg_readahead_part (gpointer data, MirageFilterStreamDmg *self)
+{
+    gssize read_length = mirage_filter_stream_dmg_read_raw_chunk(self, self->priv->readahead_buffer, GPOINTER_TO_INT(data) - 1);
+
+    g_mutex_lock(&self->priv->readahead_mutex);
+    self->priv->readahead_length = read_length;
+    self->priv->readahead_pending = FALSE;
+    g_cond_signal(&self->priv->readahead_cond);
+    g_mutex_unlock(&self->priv->readahead_mutex);
+}
+
+static void mirage_filter_stream_dmg_readahead_wait (MirageFilterStreamDmg *self)
+{
+    g_mutex_lock(&self->priv->readahead_mutex);
+    while (self->priv->readahead_pending) {
+        g_cond_wait(&self->priv->readahead_cond, &self->priv->readahead_mutex);
+    }
+    g_mutex_unlock(&self->priv->readahead_mutex);
+}
+
+static gssize mirage_filter_stream_dmg_read_part_data (MirageFilterStreamDmg *self, guint8 *buffer, gint part_idx)
+{
+    gboolean sequential = part_idx == self->priv->last_read_part + 1;
+    gssize read_length;
+
+    /* Segment streams are shared with read-ahead; wait for it to finish */
+    mirage_filter_stream_dmg_readahead_wait(self);
+
+    if (part_idx == self->priv->readahead_part && self->priv->readahead_length >= 0) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: using read-ahead data for part #%d", __debug__, part_idx);
+        read_length = self->priv->readahead_length;
+        memcpy(buffer, self->priv->readahead_buffer, read_length);
+    } else {
+        read_length = mirage_filter_stream_dmg_read_raw_chunk(self, buffer, part_idx);
+    }
+
+    self->priv->readahead_part = -1;
+    self->priv->last_read_part = part_idx;
+
+    /* On sequential access, read next part's data (which may reside in
+     * next segment file) while the current one is being processed */
+    if (sequential && self->priv->readahead_pool && (guint)part_idx + 1 < self->priv->num_parts) {
+        const DMG_Part *next_part = &self->priv->parts[part_idx + 1];
+        if (next_part->type != ZERO && next_part->type != IGNORE) {
+            self->priv->readahead_part = part_idx + 1;
+            self->priv->readahead_pending = TRUE;
+            g_thread_pool_push(self->priv->readahead_pool, GINT_TO_POINTER(part_idx + 2), NULL);
+        }
+    }
+
+    return read_length;
+}
+
 static gssize mirage_filter_stream_dmg_partial_read (MirageFilterStream *_self, void *buffer, gsize count)
 {
     MirageFilterStreamDmg *self = MIRAGE_FILTER_STREAM_DMG(_self);
     goffset position = mirage_filter_stream_simplified_get_position(MIRAGE_FILTER_STREAM(self));
-    gint part_idx = -1;
+    gint part_idx;
 
     /* Find part that corresponds to current position */
-    for (guint p = 0; p < self->priv->num_parts; p++) {
-        const DMG_Part *cur_part = &self->priv->parts[p];
-        guint req_sector = position / DMG_SECTOR_SIZE;
-
-        if ((cur_part->first_sector <= req_sector) && (cur_part->first_sector + cur_part->num_sectors >= req_sector)) {
-            part_idx = p;
-        }
-    }
+    part_idx = mirage_filter_stream_dmg_find_part(self, position / DMG_SECTOR_SIZE);
 
     if (part_idx == -1) {
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: failed to find part!", __debug__);
@@ -1017,7 +1178,7 @@ static gssize mirage_filter_stream_dmg_partial_read (MirageFilterStream *_self,
             /* We don't use internal buffers for zero data */
         } else if (part->type == RAW) {
             /* Read uncompressed part */
-            gssize ret = mirage_filter_stream_dmg_read_raw_chunk (self, self->priv->inflate_buffer, part_idx);
+            gssize ret = mirage_filter_stream_dmg_read_part_data(self, self->priv->inflate_buffer, part_idx);
             if ((gsize)ret != part->in_length) {
                 MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read raw chunk!", __debug__);
                 return -1;
@@ -1041,7 +1202,7 @@ static gssize mirage_filter_stream_dmg_partial_read (MirageFilterStream *_self,
             zlib_stream->next_out = self->priv->inflate_buffer;
 
             /* Read some compressed data */
-            read_bytes = mirage_filter_stream_dmg_read_raw_chunk (self, self->priv->io_buffer, part_idx);
+            read_bytes = mirage_filter_stream_dmg_read_part_data(self, self->priv->io_buffer, part_idx);
             if ((gsize)read_bytes != part->in_length) {
                 MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read raw chunk!", __debug__);
                 return -1;
@@ -1074,7 +1235,7 @@ static gssize mirage_filter_stream_dmg_partial_read (MirageFilterStream *_self,
             bzip2_stream->next_out = (gchar *)self->priv->inflate_buffer;
 
             /* Read some compressed data */
-            read_bytes = mirage_filter_stream_dmg_read_raw_chunk (self, self->priv->io_buffer, part_idx);
+            read_bytes = mirage_filter_stream_dmg_read_part_data(self, self->priv->io_buffer, part_idx);
             if ((gsize)read_bytes != part->in_length) {
                 MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read raw chunk!", __debug__);
                 return -1;
@@ -1101,7 +1262,7 @@ static gssize mirage_filter_stream_dmg_partial_read (MirageFilterStream *_self,
             gsize ret;
 
             /* Read some compressed data */
-            read_bytes = mirage_filter_stream_dmg_read_raw_chunk(self, self->priv->io_buffer, part_idx);
+            read_bytes = mirage_filter_stream_dmg_read_part_data(self, self->priv->io_buffer, part_idx);
             if ((gsize)read_bytes != part->in_length) {
                 MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read raw chunk!", __debug__);
                 return -1;
@@ -1175,6 +1336,17 @@ static void mirage_filter_stream_dmg_init (MirageFilterStreamDmg *self)
     self->priv->inflate_buffer = NULL;
     self->priv->io_buffer = NULL;
 
+    self->priv->last_found_part = -1;
+
+    self->priv->readahead_pool = NULL;
+    g_mutex_init(&self->priv->readahead_mutex);
+    g_cond_init(&self->priv->readahead_cond);
+    self->priv->readahead_buffer = NULL;
+    self->priv->readahead_part = -1;
+    self->priv->readahead_pending = FALSE;
+    self->priv->readahead_length = -1;
+    self->priv->last_read_part = -1;
+
     self->priv->create_filename_func = NULL;
 }
 
@@ -1182,6 +1354,13 @@ static void mirage_filter_stream_dmg_finalize (GObject *gobject)
 {
     MirageFilterStreamDmg *self = MIRAGE_FILTER_STREAM_DMG(gobject);
 
+    /* Wait for read-ahead in progress, which uses segment streams */
+    if (self->priv->readahead_pool) {
+        g_thread_pool_free(self->priv->readahead_pool, TRUE, TRUE);
+    }
+    g_mutex_clear(&self->priv->readahead_mutex);
+    g_cond_clear(&self->priv->readahead_cond);
+
     if (self->priv->streams) {
         for (guint s = 0; s < self->priv->num_segments; s++) {
             MirageStream *stream = self->priv->streams[s];
@@ -1195,6 +1374,7 @@ static void mirage_filter_stream_dmg_finalize (GObject *gobject)
     g_free(self->priv->parts);
     g_free(self->priv->inflate_buffer);
     g_free(self->priv->io_buffer);
+    g_free(self->priv->readahead_buffer);
 
     inflateEnd(&self->priv->zlib_stream);
     BZ2_bzDecompressEnd(&self->priv->bzip2_stream);
@@ -34,8 +34,27 @@ typedef struct
     gsize size;
 } ECM_Part;
 
+typedef struct
+{
+    /* Input */
+    guint8 *data;
+    gsize data_size;
+
+    /* Output */
+    GByteArray *records;
+} ECM_Job;
+
 static const guint8 ecm_signature[4] = {'E', 'C', 'M', 0x00};
 
+/* When writing, data is encoded in independent batches. The batch size
+ * is a multiple of both 2352 and 2448 bytes, so that batches of sector
+ * data written with or without subchannel are aligned to sectors, and
+ * no sector is split between two batches */
+#define BATCH_SIZE (8*119952)
+
+/* Length of data covered by a single unit of each part type */
+static const gsize ecm_unit_size[4] = {1, 2352, 2336, 2336};
+
 
 /**********************************************************************\
  *                  Object and its private structure                  *
@@ -51,6 +70,18 @@ struct _MirageFilterStreamEcmPrivate
     gint cached_part;
     gint cached_block;
     guint8 buffer[2352];
+
+    /* Encoding (write mode) */
+    gboolean write_mode;
+    gboolean write_failed;
+
+    guint8 *batch_buffer; /* Data of batch that is being filled */
+    goffset batch_offset; /* Its offset within decoded stream */
+    gsize batch_fill;
+
+    guint32 edc; /* EDC of all decoded data; stored at the end */
+
+    MirageJobQueue *job_queue;
 };
 
 
@@ -234,15 +265,298 @@ static gboolean mirage_filter_stream_ecm_build_index (MirageFilterStreamEcm *sel
 }
 
 
+/**********************************************************************\
+ *                              Encoding                              *
+\**********************************************************************/
+static ECM_PartType mirage_filter_stream_ecm_classify_sector (const guint8 *data, gsize available)
+{
+    static const guint8 zero[8] = {0};
+    guint8 sector[2352];
+    guint8 ecc_p[172];
+    guint8 ecc_q[104];
+    guint32 edc;
+
+    /* Cheap checks on sync pattern, mode and subheader come first; EDC
+     * is verified next, and ECC only for sectors that passed it */
+
+    /* Mode 1 sector, complete with sync pattern and header */
+    if (available >= 2352 && data[0x00F] == 1 && !memcmp(data, mirage_pattern_sync, sizeof(mirage_pattern_sync))) {
+        mirage_helper_sector_edc_ecc_compute_edc_block(data, 0x810, (guint8 *)&edc);
+        if (!memcmp(&edc, data+0x810, 4) && !memcmp(data+0x814, zero, 8)) {
+            mirage_helper_sector_edc_ecc_compute_ecc_block(data+0x00C, 86, 24, 2, 86, ecc_p); /* P */
+            mirage_helper_sector_edc_ecc_compute_ecc_block(data+0x00C, 52, 43, 86, 88, ecc_q); /* Q */
+            if (!memcmp(ecc_p, data+0x81C, sizeof(ecc_p)) && !memcmp(ecc_q, data+0x8C8, sizeof(ecc_q))) {
+                return ECM_MODE1_2352;
+            }
+        }
+    }
+
+    /* Mode 2 sector without sync pattern and header; subheader must be
+     * duplicated */
+    if (available >= 2336 && !memcmp(data, data+4, 4)) {
+        /* ECC of Mode 2 Form 1 sectors is computed with zeroed header */
+        memset(sector, 0, 0x010);
+        memcpy(sector+0x010, data, 2336);
+
+        mirage_helper_sector_edc_ecc_compute_edc_block(sector+0x010, 0x808, (guint8 *)&edc);
+        if (!memcmp(&edc, sector+0x818, 4)) {
+            mirage_helper_sector_edc_ecc_compute_ecc_block(sector+0x00C, 86, 24, 2, 86, ecc_p); /* P */
+            mirage_helper_sector_edc_ecc_compute_ecc_block(sector+0x00C, 52, 43, 86, 88, ecc_q); /* Q */
+            if (!memcmp(ecc_p, sector+0x81C, sizeof(ecc_p)) && !memcmp(ecc_q, sector+0x8C8, sizeof(ecc_q))) {
+                return ECM_MODE2_FORM1_2336;
+            }
+        }
+
+        mirage_helper_sector_edc_ecc_compute_edc_block(sector+0x010, 0x91C, (guint8 *)&edc);
+        if (!memcmp(&edc, sector+0x92C, 4)) {
+            return ECM_MODE2_FORM2_2336;
+        }
+    }
+
+    return ECM_RAW;
+}
+
+static void mirage_filter_stream_ecm_append_type_count (GByteArray *records, guint8 type, guint32 count)
+{
+    guint8 buf[5];
+    guint len = 0;
+
+    /* Count is stored decremented; zero results in end indicator */
+    count--;
+
+    buf[len++] = ((count >= 32) << 7) | ((count & 0x1F) << 2) | type;
+    count >>= 5;
+    while (count) {
+        buf[len++] = ((count >= 128) << 7) | (count & 0x7F);
+        count >>= 7;
+    }
+
+    g_byte_array_append(records, buf, len);
+}
+
+static void mirage_filter_stream_ecm_append_part_data (GByteArray *records, guint8 type, const guint8 *data, guint32 count)
+{
+    mirage_filter_stream_ecm_append_type_count(records, type, count);
+
+    /* Store only the data that cannot be regenerated */
+    switch (type) {
+        case ECM_RAW: {
+            g_byte_array_append(records, data, count);
+            break;
+        }
+        case ECM_MODE1_2352: {
+            for (guint32 i = 0; i < count; i++, data += 2352) {
+                g_byte_array_append(records, data+0x00C, 0x003);
+                g_byte_array_append(records, data+0x010, 0x800);
+            }
+            break;
+        }
+        case ECM_MODE2_FORM1_2336: {
+            for (guint32 i = 0; i < count; i++, data += 2336) {
+                g_byte_array_append(records, data+0x004, 0x804);
+            }
+            break;
+        }
+        case ECM_MODE2_FORM2_2336: {
+            for (guint32 i = 0; i < count; i++, data += 2336) {
+                g_byte_array_append(records, data+0x004, 0x918);
+            }
+            break;
+        }
+    }
+}
+
+static void mirage_filter_stream_ecm_free_job (ECM_Job *job)
+{
+    if (job->records) {
+        g_byte_array_unref(job->records);
+    }
+    g_free(job->data);
+    g_free(job);
+}
+
+static gboolean mirage_filter_stream_ecm_encode_job (ECM_Job *job, MirageFilterStreamEcm *self G_GNUC_UNUSED)
+{
+    GByteArray *records = g_byte_array_sized_new(job->data_size + 64);
+    gsize position = 0;
+
+    guint8 part_type = ECM_RAW;
+    gsize part_start = 0;
+    guint32 part_count = 0;
+
+    /* Group consecutive units of the same type into parts */
+    while (position < job->data_size) {
+        ECM_PartType type = mirage_filter_stream_ecm_classify_sector(job->data + position, job->data_size - position);
+
+        if (part_count && type != part_type) {
+            mirage_filter_stream_ecm_append_part_data(records, part_type, job->data + part_start, part_count);
+            part_count = 0;
+        }
+
+        if (!part_count) {
+            part_type = type;
+            part_start = position;
+        }
+
+        part_count++;
+        position += ecm_unit_size[type];
+    }
+
+    if (part_count) {
+        mirage_filter_stream_ecm_append_part_data(records, part_type, job->data + part_start, part_count);
+    }
+
+    job->records = records;
+
+    return TRUE;
+}
+
+static void mirage_filter_stream_ecm_update_edc (MirageFilterStreamEcm *self, const guint8 *data, gsize size)
+{
+    guint32 edc = self->priv->edc;
+
+    /* Running EDC over the decoded data, using the first slice of the
+     * shared EDC look-up table */
+    while (size--) {
+        edc = (edc >> 8) ^ crc32_d8018001_lut[(edc ^ *data++) & 0xFF];
+    }
+
+    self->priv->edc = edc;
+}
+
+static gboolean mirage_filter_stream_ecm_write_data (MirageFilterStreamEcm *self, const guint8 *data, gsize size)
+{
+    MirageStream *stream = mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self));
+
+    if (mirage_stream_write(stream, data, size, NULL) != (gssize)size) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to write %" G_GSIZE_MODIFIER "d bytes to underlying stream!", __debug__, size);
+        self->priv->write_failed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_ecm_complete_job (ECM_Job *job, MirageFilterStreamEcm *self)
+{
+    /* Encoded batches are completed in stream order */
+    mirage_filter_stream_ecm_update_edc(self, job->data, job->data_size);
+    return mirage_filter_stream_ecm_write_data(self, job->records->data, job->records->len);
+}
+
+static gboolean mirage_filter_stream_ecm_submit_batch (MirageFilterStreamEcm *self)
+{
+    ECM_Job *job = g_new0(ECM_Job, 1);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: submitting batch at offset %" G_GOFFSET_MODIFIER "d (%" G_GSIZE_MODIFIER "d bytes)", __debug__, self->priv->batch_offset, self->priv->batch_fill);
+
+    /* Job takes over the batch buffer */
+    job->data = self->priv->batch_buffer;
+    job->data_size = self->priv->batch_fill;
+
+    self->priv->batch_buffer = g_malloc(BATCH_SIZE);
+    self->priv->batch_offset += self->priv->batch_fill;
+    self->priv->batch_fill = 0;
+
+    if (!mirage_helper_job_queue_push(self->priv->job_queue, job)) {
+        self->priv->write_failed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_ecm_finish (MirageFilterStream *_self, GError **error)
+{
+    MirageFilterStreamEcm *self = MIRAGE_FILTER_STREAM_ECM(_self);
+    GByteArray *trailer;
+    guint32 edc;
+
+    if (!self->priv->write_mode) {
+        return TRUE;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: finishing encoded stream", __debug__);
+
+    /* Encode remaining data and wait for all batches */
+    if (self->priv->batch_fill) {
+        mirage_filter_stream_ecm_submit_batch(self);
+    }
+    if (!mirage_helper_job_queue_wait(self->priv->job_queue)) {
+        self->priv->write_failed = TRUE;
+    }
+
+    /* End indicator, followed by EDC of decoded data */
+    if (!self->priv->write_failed) {
+        trailer = g_byte_array_new();
+        mirage_filter_stream_ecm_append_type_count(trailer, ECM_RAW, 0);
+        edc = GUINT32_TO_LE(self->priv->edc);
+        g_byte_array_append(trailer, (const guint8 *)&edc, sizeof(edc));
+
+        mirage_filter_stream_ecm_write_data(self, trailer->data, trailer->len);
+        g_byte_array_unref(trailer);
+    }
+
+    mirage_helper_job_queue_free(self->priv->job_queue);
+    self->priv->job_queue = NULL;
+
+    self->priv->write_mode = FALSE;
+
+    if (self->priv->write_failed) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write encoded stream!"));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_ecm_open_for_writing (MirageFilterStreamEcm *self, MirageStream *stream, GError **error)
+{
+    gint num_threads = MAX(g_get_num_processors(), 1);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: creating ECM stream; %d encoder thread(s)", __debug__, num_threads);
+
+    if (!mirage_stream_seek(stream, 0, G_SEEK_SET, NULL)) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to seek to the beginning of stream!"));
+        return FALSE;
+    }
+
+    if (mirage_stream_write(stream, ecm_signature, sizeof(ecm_signature), error) != sizeof(ecm_signature)) {
+        return FALSE;
+    }
+
+    /* Bound the memory used by batches in flight */
+    self->priv->job_queue = mirage_helper_job_queue_new((MirageJobFunc)mirage_filter_stream_ecm_encode_job, (MirageJobFunc)mirage_filter_stream_ecm_complete_job, (GDestroyNotify)mirage_filter_stream_ecm_free_job, self, num_threads, 2*num_threads, error);
+    if (!self->priv->job_queue) {
+        return FALSE;
+    }
+
+    self->priv->batch_buffer = g_malloc(BATCH_SIZE);
+    self->priv->batch_offset = 0;
+    self->priv->batch_fill = 0;
+
+    self->priv->edc = 0;
+
+    self->priv->write_mode = TRUE;
+
+    return TRUE;
+}
+
+
 /**********************************************************************\
  *              MirageFilterStream methods implementations            *
 \**********************************************************************/
-static gboolean mirage_filter_stream_ecm_open (MirageFilterStream *_self, MirageStream *stream, gboolean writable G_GNUC_UNUSED, GError **error)
+static gboolean mirage_filter_stream_ecm_open (MirageFilterStream *_self, MirageStream *stream, gboolean writable, GError **error)
 {
     MirageFilterStreamEcm *self = MIRAGE_FILTER_STREAM_ECM(_self);
 
     guint8 sig[4];
 
+    /* In write mode, we create a new file */
+    if (writable) {
+        return mirage_filter_stream_ecm_open_for_writing(self, stream, error);
+    }
+
     /* Look for "ECM " signature at the beginning */
     mirage_stream_seek(stream, 0, G_SEEK_SET, NULL);
     if (mirage_stream_read(stream, sig, sizeof(sig), NULL) != sizeof(sig)) {
@@ -337,6 +651,10 @@ static gssize mirage_filter_stream_ecm_partial_read (MirageFilterStream *_self,
     gint block_idx;
     gint block_size, raw_block_size, skip_bytes;
 
+    if (self->priv->write_mode) {
+        return -1;
+    }
+
     /* Find part that corresponds to current position */
     part_idx = mirage_filter_stream_ecm_find_part(self, position);
     if (part_idx == -1) {
@@ -509,6 +827,49 @@ static gssize mirage_filter_stream_ecm_partial_read (MirageFilterStream *_self,
     return count;
 }
 
+static gssize mirage_filter_stream_ecm_partial_write (MirageFilterStream *_self, const void *buffer, gsize count)
+{
+    MirageFilterStreamEcm *self = MIRAGE_FILTER_STREAM_ECM(_self);
+    goffset position = mirage_filter_stream_simplified_get_position(_self);
+    gsize batch_position;
+
+    if (!self->priv->write_mode || self->priv->write_failed) {
+        return -1;
+    }
+
+    /* Data that has already been handed over for encoding cannot be
+     * changed anymore; only the batch being filled can be */
+    if (position < self->priv->batch_offset) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: cannot write at position %" G_GOFFSET_MODIFIER "d; data up to %" G_GOFFSET_MODIFIER "d has already been encoded!", __debug__, position, self->priv->batch_offset);
+        return -1;
+    }
+
+    /* Writing beyond the current batch; zero-fill and submit it */
+    if (position >= self->priv->batch_offset + BATCH_SIZE) {
+        memset(self->priv->batch_buffer + self->priv->batch_fill, 0, BATCH_SIZE - self->priv->batch_fill);
+        self->priv->batch_fill = BATCH_SIZE;
+        return mirage_filter_stream_ecm_submit_batch(self) ? 0 : -1;
+    }
+
+    /* Copy data into batch, zero-filling the gap, if any */
+    batch_position = position - self->priv->batch_offset;
+    count = MIN(count, BATCH_SIZE - batch_position);
+
+    if (batch_position > self->priv->batch_fill) {
+        memset(self->priv->batch_buffer + self->priv->batch_fill, 0, batch_position - self->priv->batch_fill);
+    }
+    memcpy(self->priv->batch_buffer + batch_position, buffer, count);
+    self->priv->batch_fill = MAX(self->priv->batch_fill, batch_position + count);
+
+    /* Submit full batch */
+    if (self->priv->batch_fill == BATCH_SIZE) {
+        if (!mirage_filter_stream_ecm_submit_batch(self)) {
+            return -1;
+        }
+    }
+
+    return count;
+}
 
 
 /**********************************************************************\
@@ -521,7 +882,7 @@ static void mirage_filter_stream_ecm_init (MirageFilterStreamEcm *self)
     mirage_filter_stream_generate_info(MIRAGE_FILTER_STREAM(self),
         "FILTER-ECM",
         Q_("ECM File Filter"),
-        FALSE,
+        TRUE,
         1,
         Q_("ECM'ified images (*.ecm)"), "application/x-ecm"
     );
@@ -532,6 +893,23 @@ static void mirage_filter_stream_ecm_init (MirageFilterStreamEcm *self)
 
     self->priv->cached_part = -1;
     self->priv->cached_block = -1;
+
+    self->priv->write_mode = FALSE;
+    self->priv->write_failed = FALSE;
+    self->priv->batch_buffer = NULL;
+    self->priv->job_queue = NULL;
+}
+
+static void mirage_filter_stream_ecm_dispose (GObject *gobject)
+{
+    MirageFilterStreamEcm *self = MIRAGE_FILTER_STREAM_ECM(gobject);
+
+    /* Complete the encoded stream while we still have the underlying
+     * stream; parent's dispose releases it */
+    mirage_filter_stream_ecm_finish(MIRAGE_FILTER_STREAM(self), NULL);
+
+    /* Chain up to the parent class */
+    G_OBJECT_CLASS(mirage_filter_stream_ecm_parent_class)->dispose(gobject);
 }
 
 static void mirage_filter_stream_ecm_finalize (GObject *gobject)
@@ -540,6 +918,8 @@ static void mirage_filter_stream_ecm_finalize (GObject *gobject)
 
     g_free(self->priv->parts);
 
+    g_free(self->priv->batch_buffer);
+
     /* Chain up to the parent class */
     G_OBJECT_CLASS(mirage_filter_stream_ecm_parent_class)->finalize(gobject);
 }
@@ -549,11 +929,14 @@ static void mirage_filter_stream_ecm_class_init (MirageFilterStreamEcmClass *kla
     GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
     MirageFilterStreamClass *filter_stream_class = MIRAGE_FILTER_STREAM_CLASS(klass);
 
+    gobject_class->dispose = mirage_filter_stream_ecm_dispose;
     gobject_class->finalize = mirage_filter_stream_ecm_finalize;
 
     filter_stream_class->open = mirage_filter_stream_ecm_open;
 
     filter_stream_class->simplified_partial_read = mirage_filter_stream_ecm_partial_read;
+    filter_stream_class->simplified_partial_write = mirage_filter_stream_ecm_partial_write;
+    filter_stream_class->finish = mirage_filter_stream_ecm_finish;
 }
 
 static void mirage_filter_stream_ecm_class_finalize (MirageFilterStreamEcmClass *klass G_GNUC_UNUSED)
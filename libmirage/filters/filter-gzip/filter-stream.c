@@ -27,6 +27,18 @@
 #define WINSIZE 32768 /* sliding window size - 32 kB */
 #define CHUNKSIZE 16384 /* file input buffer size - 16 kB */
 
+/* When writing, data is split into independently-compressed members of
+ * this size, which then also serve as access points when reading */
+#define MEMBER_SIZE SPAN
+
+/* Member header: 10-byte fixed header, 2-byte extra field length and
+ * a single 12-byte extra subfield, which holds the compressed size of
+ * the whole member and the size of uncompressed data (both 32-bit LE).
+ * Similarly to BGZF, this allows the index to be built by walking over
+ * member headers, without inflating the data */
+#define MEMBER_HEADER_SIZE 24
+#define MEMBER_TRAILER_SIZE 8
+
 typedef struct
 {
     goffset offset;
@@ -34,11 +46,49 @@ typedef struct
 
     goffset raw_offset;
     gint bits;
-    guint8 window[WINSIZE];
+    guint8 *window; /* NULL if part begins at start of a member */
 } GZIP_Part;
 
+typedef struct
+{
+    /* Input */
+    guint8 *data;
+    gsize data_size;
+
+    /* Output */
+    guint8 *member;
+    gsize member_size;
+} GZIP_Job;
+
 
 static const guint8 gzip_signature[2] = {0x1F, 0x8B};
+static const guint8 gzip_index_subfield[2] = {'M', 'L'};
+
+#define GZIP_FLAG_FEXTRA 0x04
+
+static inline guint16 gzip_get_le16 (const guint8 *ptr)
+{
+    return ptr[0] | (ptr[1] << 8);
+}
+
+static inline guint32 gzip_get_le32 (const guint8 *ptr)
+{
+    return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((guint32)ptr[3] << 24);
+}
+
+static inline void gzip_put_le16 (guint8 *ptr, guint16 value)
+{
+    ptr[0] = value & 0xFF;
+    ptr[1] = (value >> 8) & 0xFF;
+}
+
+static inline void gzip_put_le32 (guint8 *ptr, guint32 value)
+{
+    ptr[0] = value & 0xFF;
+    ptr[1] = (value >> 8) & 0xFF;
+    ptr[2] = (value >> 16) & 0xFF;
+    ptr[3] = (value >> 24) & 0xFF;
+}
 
 
 /**********************************************************************\
@@ -65,6 +115,16 @@ struct _MirageFilterStreamGzipPrivate
 
     /* Zlib stream */
     z_stream zlib_stream;
+
+    /* Compression (write mode) */
+    gboolean write_mode;
+    gboolean write_failed;
+
+    guint8 *member_buffer; /* Data of member that is being filled */
+    goffset member_offset; /* Its offset within uncompressed stream */
+    gsize member_fill;
+
+    MirageJobQueue *job_queue;
 };
 
 
@@ -153,16 +213,107 @@ static gboolean mirage_filter_stream_gzip_append_part (MirageFilterStreamGzip *s
     new_part->bits = bits;
     new_part->offset = offset;
     new_part->raw_offset = raw_offset;
-    if (left) {
-        memcpy(new_part->window, window + WINSIZE - left, left);
+    new_part->window = NULL;
+
+    /* Parts that start at the beginning of a member need no window */
+    if (window) {
+        new_part->window = g_try_malloc(WINSIZE);
+        if (!new_part->window) {
+            g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to allocate GZIP part window!"));
+            return FALSE;
+        }
+
+        if (left) {
+            memcpy(new_part->window, window + WINSIZE - left, left);
+        }
+        if (left < WINSIZE) {
+            memcpy(new_part->window + left, window, WINSIZE - left);
+        }
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_gzip_read_member_index (MirageFilterStreamGzip *self, GError **error)
+{
+    MirageStream *stream = mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self));
+    guint8 header[MEMBER_HEADER_SIZE];
+    goffset stream_size;
+    goffset raw_offset = 0;
+    goffset total_out = 0;
+
+    /* Determine size of underlying stream */
+    mirage_stream_seek(stream, 0, G_SEEK_END, NULL);
+    stream_size = mirage_stream_tell(stream);
+
+    /* Walk over member headers */
+    while (raw_offset < stream_size) {
+        guint32 member_size, data_size;
+
+        if (!mirage_stream_seek(stream, raw_offset, G_SEEK_SET, NULL) || mirage_stream_read(stream, header, sizeof(header), NULL) != sizeof(header)) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: failed to read member header at offset %" G_GOFFSET_MODIFIER "d!", __debug__, raw_offset);
+            return FALSE;
+        }
+
+        /* Only members written by us carry the index subfield, and all
+         * of them have it in the exact same place */
+        if (memcmp(header, gzip_signature, sizeof(gzip_signature)) || header[2] != Z_DEFLATED || header[3] != GZIP_FLAG_FEXTRA ||
+            gzip_get_le16(header + 10) != 12 || memcmp(header + 12, gzip_index_subfield, sizeof(gzip_index_subfield)) || gzip_get_le16(header + 14) != 8) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: member at offset %" G_GOFFSET_MODIFIER "d has no index subfield!", __debug__, raw_offset);
+            return FALSE;
+        }
+
+        member_size = gzip_get_le32(header + 16);
+        data_size = gzip_get_le32(header + 20);
+
+        if (member_size < MEMBER_HEADER_SIZE + MEMBER_TRAILER_SIZE || raw_offset + member_size > stream_size) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: member at offset %" G_GOFFSET_MODIFIER "d has invalid size %d!", __debug__, raw_offset, member_size);
+            return FALSE;
+        }
+
+        /* Empty members (e.g., the end-of-file marker) are skipped */
+        if (data_size) {
+            if (!mirage_filter_stream_gzip_append_part(self, 0, raw_offset + MEMBER_HEADER_SIZE, total_out, 0, NULL, error)) {
+                return FALSE;
+            }
+        }
+
+        raw_offset += member_size;
+        total_out += data_size;
     }
-    if (left < WINSIZE) {
-        memcpy(new_part->window + left, window, WINSIZE - left);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: number of parts: %d", __debug__, self->priv->num_parts);
+    if (!self->priv->num_parts) {
+        return FALSE;
     }
 
+    /* Release unused allocated parts */
+    self->priv->parts = g_renew(GZIP_Part, self->priv->parts, self->priv->num_parts);
+
+    /* Compute sizes of parts and allocate part buffer */
+    if (!mirage_filter_stream_gzip_compute_part_sizes(self, total_out, error)) {
+        return FALSE;
+    }
+
+    /* Store file size (= total_out) */
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: file size: %" G_GOFFSET_MODIFIER "d (0x%" G_GOFFSET_MODIFIER "X)", __debug__, total_out, total_out);
+    mirage_filter_stream_simplified_set_stream_length(MIRAGE_FILTER_STREAM(self), total_out);
+
     return TRUE;
 }
 
+static void mirage_filter_stream_gzip_clear_parts (MirageFilterStreamGzip *self)
+{
+    for (gint i = 0; i < self->priv->num_parts; i++) {
+        g_free(self->priv->parts[i].window);
+    }
+    g_free(self->priv->parts);
+
+    self->priv->parts = NULL;
+    self->priv->num_parts = 0;
+    self->priv->allocated_parts = 0;
+}
+
 static gboolean mirage_filter_stream_gzip_build_index (MirageFilterStreamGzip *self, GError **error)
 {
     MirageStream *stream = mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self));
@@ -171,6 +322,7 @@ static gboolean mirage_filter_stream_gzip_build_index (MirageFilterStreamGzip *s
     goffset total_in;
     goffset total_out;
     goffset last;
+    gboolean member_end;
     gint ret;
 
 
@@ -202,15 +354,25 @@ static gboolean mirage_filter_stream_gzip_build_index (MirageFilterStreamGzip *s
         return FALSE;
     }
 
+    /* Files that we wrote ourselves carry member sizes in their headers,
+     * so the index can be built without inflating the data */
+    if (mirage_filter_stream_gzip_read_member_index(self, NULL)) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: index built from member headers", __debug__);
+        return TRUE;
+    }
+    mirage_filter_stream_gzip_clear_parts(self);
+
     /* Position at the beginning of the stream */
     if (!mirage_stream_seek(stream, 0, G_SEEK_SET, NULL)) {
         g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to seek to the beginning of stream!"));
         return FALSE;
     }
 
-    /* Inflate the input and build an index */
+    /* Inflate the input and build an index; the file may consist of
+     * multiple members, which are decoded one after another */
     total_in = total_out = last = 0;
     zlib_stream->avail_out = 0;
+    member_end = FALSE;
     do {
         /* Read some compressed data */
         ret = mirage_stream_read(stream, self->priv->io_buffer, self->priv->io_buffer_size, NULL);
@@ -218,6 +380,9 @@ static gboolean mirage_filter_stream_gzip_build_index (MirageFilterStreamGzip *s
             g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to read %d bytes from underlying stream!"), CHUNKSIZE);
             return FALSE;
         } else if (ret == 0) {
+            if (member_end) {
+                break; /* EOF after the end of last member */
+            }
             g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Unexpectedly reached EOF!"));
             return FALSE;
         }
@@ -234,6 +399,8 @@ static gboolean mirage_filter_stream_gzip_build_index (MirageFilterStreamGzip *s
             }
 
             /* Inflate until end of input or output, or until end of block */
+            goffset previous_total_in = total_in;
+
             total_in += zlib_stream->avail_in;
             total_out += zlib_stream->avail_out;
 
@@ -242,12 +409,23 @@ static gboolean mirage_filter_stream_gzip_build_index (MirageFilterStreamGzip *s
             total_in -= zlib_stream->avail_in;
             total_out -= zlib_stream->avail_out;
 
+            if (ret == Z_DATA_ERROR && member_end) {
+                /* Trailing garbage after the last member */
+                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: ignoring trailing data after last member!", __debug__);
+                break;
+            }
             if (ret == Z_NEED_DICT || ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) {
                 g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to inflate!"));
                 return FALSE;
             }
             if (ret == Z_STREAM_END) {
-                break;
+                /* End of member; prepare for the next one, if any */
+                member_end = TRUE;
+                inflateReset(zlib_stream);
+                continue;
+            }
+            if (total_in != previous_total_in) {
+                member_end = FALSE; /* Decoding next member */
             }
 
             /* If at end of block, add part entry */
@@ -261,7 +439,7 @@ static gboolean mirage_filter_stream_gzip_build_index (MirageFilterStreamGzip *s
                 last = total_out;
             }
         } while (zlib_stream->avail_in);
-    } while (ret != Z_STREAM_END);
+    } while (ret != Z_DATA_ERROR);
 
     /* At least one part must be present */
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: number of parts: %d", __debug__, self->priv->num_parts);
@@ -289,15 +467,217 @@ static gboolean mirage_filter_stream_gzip_build_index (MirageFilterStreamGzip *s
 }
 
 
+/**********************************************************************\
+ *                            Compression                             *
+\**********************************************************************/
+static gboolean mirage_filter_stream_gzip_compress_member (const guint8 *data, gsize data_size, guint8 **member, gsize *member_size)
+{
+    z_stream zlib_stream;
+    guint8 *buffer;
+    gsize deflate_bound;
+    gsize deflate_size;
+    gint ret;
+
+    memset(&zlib_stream, 0, sizeof(zlib_stream));
+
+    /* Raw deflate; header and trailer are written by us */
+    ret = deflateInit2(&zlib_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) {
+        return FALSE;
+    }
+
+    deflate_bound = deflateBound(&zlib_stream, data_size);
+    buffer = g_try_malloc(MEMBER_HEADER_SIZE + deflate_bound + MEMBER_TRAILER_SIZE);
+    if (!buffer) {
+        deflateEnd(&zlib_stream);
+        return FALSE;
+    }
+
+    zlib_stream.next_in = (Bytef *)data;
+    zlib_stream.avail_in = data_size;
+    zlib_stream.next_out = buffer + MEMBER_HEADER_SIZE;
+    zlib_stream.avail_out = deflate_bound;
+
+    ret = deflate(&zlib_stream, Z_FINISH);
+    deflate_size = zlib_stream.total_out;
+    deflateEnd(&zlib_stream);
+
+    if (ret != Z_STREAM_END) {
+        g_free(buffer);
+        return FALSE;
+    }
+
+    *member_size = MEMBER_HEADER_SIZE + deflate_size + MEMBER_TRAILER_SIZE;
+
+    /* Header */
+    buffer[0] = gzip_signature[0];
+    buffer[1] = gzip_signature[1];
+    buffer[2] = Z_DEFLATED; /* CM */
+    buffer[3] = GZIP_FLAG_FEXTRA; /* FLG */
+    gzip_put_le32(buffer + 4, 0); /* MTIME */
+    buffer[8] = 0; /* XFL */
+    buffer[9] = 255; /* OS: unknown */
+    gzip_put_le16(buffer + 10, 12); /* XLEN */
+    buffer[12] = gzip_index_subfield[0];
+    buffer[13] = gzip_index_subfield[1];
+    gzip_put_le16(buffer + 14, 8);
+    gzip_put_le32(buffer + 16, *member_size);
+    gzip_put_le32(buffer + 20, data_size);
+
+    /* Trailer */
+    gzip_put_le32(buffer + MEMBER_HEADER_SIZE + deflate_size, crc32(0L, data, data_size));
+    gzip_put_le32(buffer + MEMBER_HEADER_SIZE + deflate_size + 4, data_size);
+
+    *member = buffer;
+    return TRUE;
+}
+
+static void mirage_filter_stream_gzip_free_job (GZIP_Job *job)
+{
+    g_free(job->data);
+    g_free(job->member);
+    g_free(job);
+}
+
+static gboolean mirage_filter_stream_gzip_compress_job (GZIP_Job *job, MirageFilterStreamGzip *self)
+{
+    gboolean succeeded = mirage_filter_stream_gzip_compress_member(job->data, job->data_size, &job->member, &job->member_size);
+
+    g_free(job->data);
+    job->data = NULL;
+
+    if (!succeeded) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to compress member!", __debug__);
+    }
+
+    return succeeded;
+}
+
+static gboolean mirage_filter_stream_gzip_write_data (MirageFilterStreamGzip *self, const guint8 *data, gsize size)
+{
+    MirageStream *stream = mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self));
+
+    if (mirage_stream_write(stream, data, size, NULL) != (gssize)size) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to write %" G_GSIZE_MODIFIER "d bytes to underlying stream!", __debug__, size);
+        self->priv->write_failed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_gzip_complete_job (GZIP_Job *job, MirageFilterStreamGzip *self)
+{
+    /* Compressed members are completed in stream order */
+    return mirage_filter_stream_gzip_write_data(self, job->member, job->member_size);
+}
+
+static gboolean mirage_filter_stream_gzip_submit_member (MirageFilterStreamGzip *self)
+{
+    GZIP_Job *job = g_new0(GZIP_Job, 1);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: submitting member at offset %" G_GOFFSET_MODIFIER "d (%" G_GSIZE_MODIFIER "d bytes)", __debug__, self->priv->member_offset, self->priv->member_fill);
+
+    /* Job takes over the member buffer */
+    job->data = self->priv->member_buffer;
+    job->data_size = self->priv->member_fill;
+
+    self->priv->member_buffer = g_malloc(MEMBER_SIZE);
+    self->priv->member_offset += self->priv->member_fill;
+    self->priv->member_fill = 0;
+
+    if (!mirage_helper_job_queue_push(self->priv->job_queue, job)) {
+        self->priv->write_failed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_gzip_finish (MirageFilterStream *_self, GError **error)
+{
+    MirageFilterStreamGzip *self = MIRAGE_FILTER_STREAM_GZIP(_self);
+    guint8 *member;
+    gsize member_size;
+
+    if (!self->priv->write_mode) {
+        return TRUE;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: finishing compressed stream", __debug__);
+
+    /* Compress remaining data and wait for all members */
+    if (self->priv->member_fill) {
+        mirage_filter_stream_gzip_submit_member(self);
+    }
+    if (!mirage_helper_job_queue_wait(self->priv->job_queue)) {
+        self->priv->write_failed = TRUE;
+    }
+
+    /* Append empty member as end-of-file marker */
+    if (!self->priv->write_failed) {
+        if (mirage_filter_stream_gzip_compress_member((const guint8 *)"", 0, &member, &member_size)) {
+            mirage_filter_stream_gzip_write_data(self, member, member_size);
+            g_free(member);
+        } else {
+            self->priv->write_failed = TRUE;
+        }
+    }
+
+    mirage_helper_job_queue_free(self->priv->job_queue);
+    self->priv->job_queue = NULL;
+
+    self->priv->write_mode = FALSE;
+
+    if (self->priv->write_failed) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write compressed stream!"));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_gzip_open_for_writing (MirageFilterStreamGzip *self, MirageStream *stream, GError **error)
+{
+    gint num_threads = MAX(g_get_num_processors(), 1);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: creating compressed stream; %d compression thread(s), %d kB members", __debug__, num_threads, MEMBER_SIZE/1024);
+
+    if (!mirage_stream_seek(stream, 0, G_SEEK_SET, NULL)) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to seek to the beginning of stream!"));
+        return FALSE;
+    }
+
+    /* Bound the memory used by members in flight */
+    self->priv->job_queue = mirage_helper_job_queue_new((MirageJobFunc)mirage_filter_stream_gzip_compress_job, (MirageJobFunc)mirage_filter_stream_gzip_complete_job, (GDestroyNotify)mirage_filter_stream_gzip_free_job, self, num_threads, 2*num_threads, error);
+    if (!self->priv->job_queue) {
+        return FALSE;
+    }
+
+    self->priv->member_buffer = g_malloc(MEMBER_SIZE);
+    self->priv->member_offset = 0;
+    self->priv->member_fill = 0;
+
+    self->priv->write_mode = TRUE;
+
+    return TRUE;
+}
+
+
 /**********************************************************************\
  *              MirageFilterStream methods implementations            *
 \**********************************************************************/
-static gboolean mirage_filter_stream_gzip_open (MirageFilterStream *_self, MirageStream *stream, gboolean writable G_GNUC_UNUSED, GError **error)
+static gboolean mirage_filter_stream_gzip_open (MirageFilterStream *_self, MirageStream *stream, gboolean writable, GError **error)
 {
     MirageFilterStreamGzip *self = MIRAGE_FILTER_STREAM_GZIP(_self);
 
     guint8 sig[2];
 
+    /* In write mode, we create a new file */
+    if (writable) {
+        return mirage_filter_stream_gzip_open_for_writing(self, stream, error);
+    }
+
     /* Look for gzip signature at the beginning */
     mirage_stream_seek(stream, 0, G_SEEK_SET, NULL);
     if (mirage_stream_read(stream, sig, sizeof(sig), NULL) != sizeof(sig)) {
@@ -387,6 +767,12 @@ static gssize mirage_filter_stream_gzip_partial_read (MirageFilterStream *_self,
     const GZIP_Part *part;
     gint part_idx;
 
+    /* Data that is being compressed cannot be read back */
+    if (self->priv->write_mode) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: reading from stream opened for writing is not supported!", __debug__);
+        return -1;
+    }
+
     /* Find part that corresponds to current position */
     part_idx = mirage_filter_stream_gzip_find_part(self, position);
     if (part_idx == -1) {
@@ -401,6 +787,8 @@ static gssize mirage_filter_stream_gzip_partial_read (MirageFilterStream *_self,
     if (part_idx != self->priv->cached_part) {
         z_stream *zlib_stream = &self->priv->zlib_stream;
         goffset underlying_stream_offset;
+        gboolean raw_inflate = TRUE;
+        guint skip_bytes = 0;
         gint ret;
 
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: part not cached, reading...", __debug__);
@@ -434,7 +822,9 @@ static gssize mirage_filter_stream_gzip_partial_read (MirageFilterStream *_self,
             }
             inflatePrime(zlib_stream, part->bits, value >> (8 - part->bits));
         }
-        inflateSetDictionary(zlib_stream, part->window, WINSIZE);
+        if (part->window) {
+            inflateSetDictionary(zlib_stream, part->window, WINSIZE);
+        }
 
         /* Uncompress whole part */
         zlib_stream->avail_in = 0;
@@ -457,12 +847,39 @@ static gssize mirage_filter_stream_gzip_partial_read (MirageFilterStream *_self,
                 zlib_stream->next_in = self->priv->io_buffer;
             }
 
+            /* Skip trailer of the member that was inflated in raw mode */
+            if (skip_bytes) {
+                guint skip = MIN(skip_bytes, zlib_stream->avail_in);
+
+                zlib_stream->next_in += skip;
+                zlib_stream->avail_in -= skip;
+                skip_bytes -= skip;
+                continue;
+            }
+
             /* Inflate */
             ret = inflate(zlib_stream, Z_NO_FLUSH);
             if (ret == Z_NEED_DICT || ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) {
                 MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to inflate part: %s!", __debug__, zlib_stream->msg);
                 return -1;
             }
+
+            /* Part continues in the next member; restart inflate on it,
+             * letting zlib parse its header (and the trailers from there
+             * on). The trailer of the member that we started in is
+             * skipped, because raw inflate does not consume it */
+            if (ret == Z_STREAM_END && zlib_stream->avail_out) {
+                if (raw_inflate) {
+                    skip_bytes = 8; /* CRC32 and ISIZE */
+                    raw_inflate = FALSE;
+                }
+
+                ret = inflateReset2(zlib_stream, 31); /* 31 = gzip decoding */
+                if (ret != Z_OK) {
+                    MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to reset inflate engine!", __debug__);
+                    return -1;
+                }
+            }
         } while (zlib_stream->avail_out);
 
 
@@ -484,6 +901,51 @@ static gssize mirage_filter_stream_gzip_partial_read (MirageFilterStream *_self,
 }
 
 
+static gssize mirage_filter_stream_gzip_partial_write (MirageFilterStream *_self, const void *buffer, gsize count)
+{
+    MirageFilterStreamGzip *self = MIRAGE_FILTER_STREAM_GZIP(_self);
+    goffset position = mirage_filter_stream_simplified_get_position(_self);
+    gsize member_position;
+
+    if (!self->priv->write_mode || self->priv->write_failed) {
+        return -1;
+    }
+
+    /* Data that has already been handed over for compression cannot
+     * be changed anymore; only the member being filled can be */
+    if (position < self->priv->member_offset) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: cannot write at position %" G_GOFFSET_MODIFIER "d; data up to %" G_GOFFSET_MODIFIER "d has already been compressed!", __debug__, position, self->priv->member_offset);
+        return -1;
+    }
+
+    /* Writing beyond the current member; zero-fill and submit it */
+    if (position >= self->priv->member_offset + MEMBER_SIZE) {
+        memset(self->priv->member_buffer + self->priv->member_fill, 0, MEMBER_SIZE - self->priv->member_fill);
+        self->priv->member_fill = MEMBER_SIZE;
+        return mirage_filter_stream_gzip_submit_member(self) ? 0 : -1;
+    }
+
+    /* Copy data into member, zero-filling the gap, if any */
+    member_position = position - self->priv->member_offset;
+    count = MIN(count, MEMBER_SIZE - member_position);
+
+    if (member_position > self->priv->member_fill) {
+        memset(self->priv->member_buffer + self->priv->member_fill, 0, member_position - self->priv->member_fill);
+    }
+    memcpy(self->priv->member_buffer + member_position, buffer, count);
+    self->priv->member_fill = MAX(self->priv->member_fill, member_position + count);
+
+    /* Submit full member */
+    if (self->priv->member_fill == MEMBER_SIZE) {
+        if (!mirage_filter_stream_gzip_submit_member(self)) {
+            return -1;
+        }
+    }
+
+    return count;
+}
+
+
 /**********************************************************************\
  *                             Object init                            *
 \**********************************************************************/
@@ -494,7 +956,7 @@ static void mirage_filter_stream_gzip_init (MirageFilterStreamGzip *self)
     mirage_filter_stream_generate_info(MIRAGE_FILTER_STREAM(self),
         "FILTER-GZIP",
         Q_("GZIP File Filter"),
-        FALSE,
+        TRUE,
         1,
         Q_("gzip-compressed images (*.gz)"), "application/x-gzip"
     );
@@ -508,15 +970,34 @@ static void mirage_filter_stream_gzip_init (MirageFilterStreamGzip *self)
     self->priv->io_buffer = NULL;
     self->priv->window_buffer = NULL;
     self->priv->part_buffer = NULL;
+
+    self->priv->write_mode = FALSE;
+    self->priv->write_failed = FALSE;
+    self->priv->member_buffer = NULL;
+    self->priv->job_queue = NULL;
+}
+
+static void mirage_filter_stream_gzip_dispose (GObject *gobject)
+{
+    MirageFilterStreamGzip *self = MIRAGE_FILTER_STREAM_GZIP(gobject);
+
+    /* Complete the compressed stream while we still have the underlying
+     * stream; parent's dispose releases it */
+    mirage_filter_stream_gzip_finish(MIRAGE_FILTER_STREAM(self), NULL);
+
+    /* Chain up to the parent class */
+    G_OBJECT_CLASS(mirage_filter_stream_gzip_parent_class)->dispose(gobject);
 }
 
 static void mirage_filter_stream_gzip_finalize (GObject *gobject)
 {
     MirageFilterStreamGzip *self = MIRAGE_FILTER_STREAM_GZIP(gobject);
 
-    g_free(self->priv->parts);
+    mirage_filter_stream_gzip_clear_parts(self);
     g_free(self->priv->part_buffer);
 
+    g_free(self->priv->member_buffer);
+
     g_free(self->priv->io_buffer);
     g_free(self->priv->window_buffer);
 
@@ -531,11 +1012,14 @@ static void mirage_filter_stream_gzip_class_init (MirageFilterStreamGzipClass *k
     GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
     MirageFilterStreamClass *filter_stream_class = MIRAGE_FILTER_STREAM_CLASS(klass);
 
+    gobject_class->dispose = mirage_filter_stream_gzip_dispose;
     gobject_class->finalize = mirage_filter_stream_gzip_finalize;
 
     filter_stream_class->open = mirage_filter_stream_gzip_open;
 
     filter_stream_class->simplified_partial_read = mirage_filter_stream_gzip_partial_read;
+    filter_stream_class->simplified_partial_write = mirage_filter_stream_gzip_partial_write;
+    filter_stream_class->finish = mirage_filter_stream_gzip_finish;
 }
 
 static void mirage_filter_stream_gzip_class_finalize (MirageFilterStreamGzipClass *klass G_GNUC_UNUSED)
@@ -32,6 +32,40 @@
 
 static const guint8 isz_signature[4] = {'I', 's', 'Z', '!'};
 
+/* Number of decoded parts that can be prefetched on sequential access */
+#define ISZ_PREFETCH_SLOTS 4
+
+
+/* Per-thread state needed to decode a part: I/O buffer for raw chunk
+ * data, decompression streams and cipher handle */
+typedef struct
+{
+    guint8 *io_buffer;
+
+    z_stream  zlib_stream;
+    bz_stream bzip2_stream;
+
+#if MIRAGE_HAVE_LIBGCRYPT
+    gcry_cipher_hd_t crypt_handle;
+#endif
+} ISZ_Decoder;
+
+typedef enum
+{
+    PREFETCH_EMPTY,
+    PREFETCH_PENDING,
+    PREFETCH_READY,
+    PREFETCH_FAILED
+} ISZ_PrefetchState;
+
+typedef struct
+{
+    gint part;
+    ISZ_PrefetchState state;
+    guint8 *buffer; /* Decoded part data */
+    ISZ_Decoder decoder;
+} ISZ_PrefetchSlot;
+
 
 /**********************************************************************\
  *                  Object and its private structure                  *
@@ -59,17 +93,28 @@ struct _MirageFilterStreamIszPrivate
     gint inflate_buffer_size;
     guint cached_part;
 
-    /* I/O buffer */
-    guint8 *io_buffer;
+    /* I/O buffer size */
     gint io_buffer_size;
 
-    /* Compression streams */
-    z_stream  zlib_stream;
-    bz_stream bzip2_stream;
+    /* Decoder used by reading thread */
+    ISZ_Decoder decoder;
 
-    /* Decryption */
+    /* Segment streams are shared between reading thread and prefetch */
+    GMutex io_mutex;
+
+    /* Prefetch of decoded parts */
+    GThreadPool *prefetch_pool;
+    GMutex prefetch_mutex;
+    GCond prefetch_cond;
+    ISZ_PrefetchSlot prefetch_slots[ISZ_PREFETCH_SLOTS];
+    gint num_prefetch_slots;
+    gint last_read_part;
+
+    /* Decryption key; each decoder has its own cipher handle */
 #if MIRAGE_HAVE_LIBGCRYPT
-    gcry_cipher_hd_t crypt_handle;
+    gint crypt_algo;
+    guint8 crypt_key[32];
+    guint crypt_key_size;
 #endif
 };
 
@@ -137,29 +182,44 @@ static inline void mirage_filter_stream_isz_deobfuscate (guint8 *data, gint leng
 \**********************************************************************/
 #if MIRAGE_HAVE_LIBGCRYPT
 
-static gboolean mirage_filter_stream_isz_initialize_decryption (MirageFilterStreamIsz *self, const gchar *password, int mode, GError **error)
+static gboolean mirage_filter_stream_isz_open_cipher (MirageFilterStreamIsz *self, gcry_cipher_hd_t *handle, GError **error)
 {
     gpg_error_t rc;
-    gint algo;
-    guint key_size;
 
+    rc = gcry_cipher_open(handle, self->priv->crypt_algo, GCRY_CIPHER_MODE_ECB, 0);
+    if (rc != 0) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, "Failed to initialize AES cipher! Error code: %d (%X)!", rc, rc);
+        return FALSE;
+    }
+
+    rc = gcry_cipher_setkey(*handle, self->priv->crypt_key, self->priv->crypt_key_size);
+    if (rc != 0) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, "Failed to set key! Error code: %d (%X)!", rc, rc);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_isz_initialize_decryption (MirageFilterStreamIsz *self, const gchar *password, int mode, GError **error)
+{
     /* Initialize AES-128/192/256 cipher. The ISZ spec incorrectly claims
      * that CBC mode is used; ECB is used, with user-supplied password used
      * directly as the key. */
     switch (mode) {
         case AES128: {
-            algo = GCRY_CIPHER_AES128;
-            key_size = 16;
+            self->priv->crypt_algo = GCRY_CIPHER_AES128;
+            self->priv->crypt_key_size = 16;
             break;
         }
         case AES192: {
-            algo = GCRY_CIPHER_AES192;
-            key_size = 24;
+            self->priv->crypt_algo = GCRY_CIPHER_AES192;
+            self->priv->crypt_key_size = 24;
             break;
         }
         case AES256: {
-            algo = GCRY_CIPHER_AES256;
-            key_size = 32;
+            self->priv->crypt_algo = GCRY_CIPHER_AES256;
+            self->priv->crypt_key_size = 32;
             break;
         }
         default: {
@@ -168,38 +228,27 @@ static gboolean mirage_filter_stream_isz_initialize_decryption (MirageFilterStre
         }
     }
 
-    rc = gcry_cipher_open(&self->priv->crypt_handle, algo, GCRY_CIPHER_MODE_ECB, 0);
-    if (rc != 0) {
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, "Failed to initialize AES cipher! Error code: %d (%X)!", rc, rc);
-        return FALSE;
-    }
-
-    guint8 master_key[key_size];
-    memset(master_key, 0, key_size);
+    memset(self->priv->crypt_key, 0, sizeof(self->priv->crypt_key));
 
     gsize len = strlen(password);
-    if (len > key_size) {
-        len = key_size;
+    if (len > self->priv->crypt_key_size) {
+        len = self->priv->crypt_key_size;
     }
-    memcpy(master_key, password, len);
+    memcpy(self->priv->crypt_key, password, len);
 
-    rc = gcry_cipher_setkey(self->priv->crypt_handle, master_key, key_size);
-    if (rc != 0) {
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, "Failed to set key! Error code: %d (%X)!", rc, rc);
-        return FALSE;
-    }
-
-    return TRUE;
+    /* Cipher handle for reading thread's decoder; prefetch decoders open
+     * their own */
+    return mirage_filter_stream_isz_open_cipher(self, &self->priv->decoder.crypt_handle, error);
 }
 
 #endif
 
-static gint mirage_filter_stream_isz_decrypt_data_block (MirageFilterStreamIsz *self, guint8 *data, gsize length)
+static gint mirage_filter_stream_isz_decrypt_data_block (MirageFilterStreamIsz *self, ISZ_Decoder *decoder, guint8 *data, gsize length)
 {
 #if MIRAGE_HAVE_LIBGCRYPT
-    if (self->priv->crypt_handle) {
+    if (decoder->crypt_handle) {
         /* NOTE: unaligned part of buffer is left un-encrypted */
-        gpg_error_t rc = gcry_cipher_decrypt(self->priv->crypt_handle, data, length & ~15, NULL, 0);
+        gpg_error_t rc = gcry_cipher_decrypt(decoder->crypt_handle, data, length & ~15, NULL, 0);
         if (rc != 0) {
             MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to decrypt raw chunk - gcry_cipher_decrypt() failed with error code: %d!", __debug__, rc);
             return -1;
@@ -207,6 +256,7 @@ static gint mirage_filter_stream_isz_decrypt_data_block (MirageFilterStreamIsz *
     }
 #else
     (void)self;
+    (void)decoder;
     (void)data;
     (void)length;
 #endif
@@ -215,6 +265,64 @@ static gint mirage_filter_stream_isz_decrypt_data_block (MirageFilterStreamIsz *
 }
 
 
+/**********************************************************************\
+ *                              Decoders                              *
+\**********************************************************************/
+static gboolean mirage_filter_stream_isz_decoder_init (MirageFilterStreamIsz *self, ISZ_Decoder *decoder, GError **error)
+{
+    z_stream  *zlib_stream = &decoder->zlib_stream;
+    bz_stream *bzip2_stream = &decoder->bzip2_stream;
+    gint ret;
+
+    /* Initialize zlib stream */
+    zlib_stream->zalloc = Z_NULL;
+    zlib_stream->zfree = Z_NULL;
+    zlib_stream->opaque = Z_NULL;
+    zlib_stream->avail_in = 0;
+    zlib_stream->next_in = Z_NULL;
+
+    ret = inflateInit2(zlib_stream, 15);
+
+    if (ret != Z_OK) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to initialize zlib's inflate (error: %d)!"), ret);
+        return FALSE;
+    }
+
+    /* Initialize bzip2 stream; decompress engine itself is initialized
+     * for each part */
+    bzip2_stream->bzalloc = NULL;
+    bzip2_stream->bzfree = NULL;
+    bzip2_stream->opaque = NULL;
+    bzip2_stream->avail_in = 0;
+    bzip2_stream->next_in = NULL;
+
+    /* Allocate I/O buffer */
+    decoder->io_buffer = g_try_malloc(self->priv->io_buffer_size);
+    if (!decoder->io_buffer) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to allocate memory for I/O buffer!"));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void mirage_filter_stream_isz_decoder_cleanup (ISZ_Decoder *decoder)
+{
+    g_free(decoder->io_buffer);
+    decoder->io_buffer = NULL;
+
+    inflateEnd(&decoder->zlib_stream);
+    BZ2_bzDecompressEnd(&decoder->bzip2_stream);
+
+#if MIRAGE_HAVE_LIBGCRYPT
+    if (decoder->crypt_handle) {
+        gcry_cipher_close(decoder->crypt_handle);
+        decoder->crypt_handle = NULL;
+    }
+#endif
+}
+
+
 /**********************************************************************\
  *                     Part filename generation                       *
 \**********************************************************************/
@@ -438,8 +546,47 @@ static gboolean mirage_filter_stream_isz_construct_segment_table (MirageFilterSt
     return TRUE;
 }
 
+typedef struct
+{
+    gint index;
+    GError *error;
+} ISZ_StreamOpenTask;
+
+static void mirage_filter_stream_isz_open_stream (ISZ_StreamOpenTask *task, MirageFilterStreamIsz *self)
+{
+    MirageFileStream *stream;
+    GError *local_error = NULL;
+    gchar *filename = mirage_filter_stream_isz_format_part_filename(self->priv->volname_prefix, self->priv->volname_format, task->index);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: trying to create stream #%d for file: %s", __debug__, task->index, filename);
+
+    /* Directly create an instance of MirageFileStream, instead of
+     * going through mirage_contextual_create_input_stream(). Using
+     * the latter would try to instantiate ISZ filter again, and that
+     * would fail due to file not being the first one in the set. While
+     * we could demote the corresponding error in mirage_filter_stream_isz_open()
+     * from MIRAGE_ERROR_STREAM_ERROR to MIRAGE_ERROR_CANNOT_HANDLE,
+     * that would effectively result in creation of a MirageFileStream. */
+    stream = g_object_new(MIRAGE_TYPE_FILE_STREAM, NULL);
+    if (!mirage_file_stream_open(stream, filename, FALSE, &local_error)) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to create stream #%d on file %s: %s", __debug__, task->index, filename, local_error->message);
+        g_error_free(local_error);
+        g_object_unref(stream);
+        g_free(filename);
+        g_set_error(&task->error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to create stream!"));
+        return;
+    }
+    self->priv->streams[task->index] = MIRAGE_STREAM(stream);
+
+    g_free(filename);
+}
+
 static gboolean mirage_filter_stream_isz_open_streams (MirageFilterStreamIsz *self, GError **error)
 {
+    ISZ_StreamOpenTask *tasks;
+    GThreadPool *pool;
+    gboolean succeeded = TRUE;
+
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: opening stream(s) for %d segment(s)...", __debug__, self->priv->num_segments);
 
     /* Allocate space for streams */
@@ -453,33 +600,38 @@ static gboolean mirage_filter_stream_isz_open_streams (MirageFilterStreamIsz *se
     self->priv->streams[0] = g_object_ref(mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self)));
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: reusing stream #0 on filename: %s", __debug__, mirage_stream_get_filename(self->priv->streams[0]));
 
-    /* Create the rest of the streams */
+    /* Create the rest of the streams; this is done in parallel, so that
+     * open latency on slow (e.g., network) storage does not add up */
+    tasks = g_new0(ISZ_StreamOpenTask, self->priv->num_segments);
+    pool = g_thread_pool_new((GFunc)mirage_filter_stream_isz_open_stream, self, MAX(g_get_num_processors(), 1), FALSE, NULL);
+
     for (gint s = 1; s < self->priv->num_segments; s++) {
-        MirageFileStream *stream;
-        GError *local_error = NULL;
-        gchar *filename = mirage_filter_stream_isz_format_part_filename(self->priv->volname_prefix, self->priv->volname_format, s);
-
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: trying to create stream #%d for file: %s", __debug__, s, filename);
-
-        /* Directly create an instance of MirageFileStream, instead of
-         * going through mirage_contextual_create_input_stream(). Using
-         * the latter would try to instantiate ISZ filter again, and that
-         * would fail due to file not being the first one in the set. While
-         * we could demote the corresponding error in mirage_filter_stream_isz_open()
-         * from MIRAGE_ERROR_STREAM_ERROR to MIRAGE_ERROR_CANNOT_HANDLE,
-         * that would effectively result in creation of a MirageFileStream. */
-        stream = g_object_new(MIRAGE_TYPE_FILE_STREAM, NULL);
-        if (!mirage_file_stream_open(stream, filename, FALSE, &local_error)) {
-            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to create stream #%d on file %s: %s", __debug__, s, filename, local_error->message);
-            g_error_free(local_error);
-            g_object_unref(stream);
-            g_free(filename);
-            g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to create stream!"));
-            return FALSE;
+        tasks[s].index = s;
+        if (pool) {
+            g_thread_pool_push(pool, &tasks[s], NULL);
+        } else {
+            mirage_filter_stream_isz_open_stream(&tasks[s], self);
         }
-        self->priv->streams[s] = MIRAGE_STREAM(stream);
+    }
 
-        g_free(filename);
+    if (pool) {
+        g_thread_pool_free(pool, FALSE, TRUE);
+    }
+
+    for (gint s = 1; s < self->priv->num_segments; s++) {
+        if (tasks[s].error) {
+            if (succeeded) {
+                g_propagate_error(error, tasks[s].error);
+                succeeded = FALSE;
+            } else {
+                g_error_free(tasks[s].error);
+            }
+        }
+    }
+    g_free(tasks);
+
+    if (!succeeded) {
+        return FALSE;
     }
 
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: successfully opened %d streams!", __debug__, self->priv->num_segments);
@@ -511,13 +663,12 @@ static inline void mirage_filter_stream_isz_decode_chunk_ptr(guint8 *chunk_ptr,
 static gboolean mirage_filter_stream_isz_read_index (MirageFilterStreamIsz *self, GError **error)
 {
     MirageStream *stream = mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self));
-    z_stream  *zlib_stream = &self->priv->zlib_stream;
-    bz_stream *bzip2_stream = &self->priv->bzip2_stream;
 
     ISZ_Header *header = &self->priv->header;
 
     gint ret, original_size;
     gint last_segment = 0;
+    gint cur_segment_idx = 0;
 
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: reading part index...", __debug__);
 
@@ -623,14 +774,12 @@ static gboolean mirage_filter_stream_isz_read_index (MirageFilterStreamIsz *self
             cur_part->adj_offset = prev_part->adj_offset + prev_part->length;
         }
 
-        /* Which segment holds this chunk? */
-        for (gint s = 0; s < self->priv->num_segments; s++) {
-            ISZ_Segment *segment = &self->priv->segments[s];
-
-            if ((i >= segment->first_chunk_num) && (i < segment->first_chunk_num + segment->num_chunks)) {
-                cur_part->segment = s;
-            }
+        /* Which segment holds this chunk? Segments are ordered by their
+         * first chunk, so a single sweep suffices */
+        while (cur_segment_idx < self->priv->num_segments - 1 && i >= self->priv->segments[cur_segment_idx].first_chunk_num + self->priv->segments[cur_segment_idx].num_chunks) {
+            cur_segment_idx++;
         }
+        cur_part->segment = cur_segment_idx;
 
         if (cur_part->segment > last_segment) {
             last_segment = cur_part->segment;
@@ -673,34 +822,6 @@ static gboolean mirage_filter_stream_isz_read_index (MirageFilterStreamIsz *self
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: number of parts: %d; zero=%d, raw=%d, zlib=%d, bzip2=%d", __debug__, self->priv->num_parts, num_zero, num_raw, num_zlib, num_bzip2);
     }
 
-    /* Initialize zlib stream */
-    zlib_stream->zalloc = Z_NULL;
-    zlib_stream->zfree = Z_NULL;
-    zlib_stream->opaque = Z_NULL;
-    zlib_stream->avail_in = 0;
-    zlib_stream->next_in = Z_NULL;
-
-    ret = inflateInit2(zlib_stream, 15);
-
-    if (ret != Z_OK) {
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to initialize zlib's inflate (error: %d)!"), ret);
-        return FALSE;
-    }
-
-    /* Initialize bzip2 stream */
-    bzip2_stream->bzalloc = NULL;
-    bzip2_stream->bzfree = NULL;
-    bzip2_stream->opaque = NULL;
-    bzip2_stream->avail_in = 0;
-    bzip2_stream->next_in = NULL;
-
-    ret = BZ2_bzDecompressInit(bzip2_stream, 0, 0);
-
-    if (ret != BZ_OK) {
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to initialize libbz2's decompress (error: %d)!"), ret);
-        return FALSE;
-    }
-
     /* Allocate inflate buffer */
     self->priv->inflate_buffer_size = header->block_size;
     self->priv->inflate_buffer = g_try_malloc(self->priv->inflate_buffer_size);
@@ -709,13 +830,8 @@ static gboolean mirage_filter_stream_isz_read_index (MirageFilterStreamIsz *self
         return FALSE;
     }
 
-    /* Allocate I/O buffer */
+    /* I/O buffers are allocated by decoders */
     self->priv->io_buffer_size = header->block_size;
-    self->priv->io_buffer = g_try_malloc(self->priv->io_buffer_size);
-    if (!self->priv->io_buffer) {
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to allocate memory for I/O buffer!"));
-        return FALSE;
-    }
 
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: successfully read part index", __debug__);
 
@@ -726,6 +842,8 @@ static gboolean mirage_filter_stream_isz_read_index (MirageFilterStreamIsz *self
 /**********************************************************************\
  *             MirageFilterStream methods implementations             *
 \**********************************************************************/
+static void mirage_filter_stream_isz_setup_prefetch (MirageFilterStreamIsz *self);
+
 static gboolean mirage_filter_stream_isz_open (MirageFilterStream *_self, MirageStream *stream, gboolean writable G_GNUC_UNUSED, GError **error)
 {
     MirageFilterStreamIsz *self = MIRAGE_FILTER_STREAM_ISZ(_self);
@@ -868,6 +986,14 @@ static gboolean mirage_filter_stream_isz_open (MirageFilterStream *_self, Mirage
         return FALSE;
     }
 
+    /* Set up decoder for reading thread */
+    if (!mirage_filter_stream_isz_decoder_init(self, &self->priv->decoder, error)) {
+        return FALSE;
+    }
+
+    /* Set up prefetch */
+    mirage_filter_stream_isz_setup_prefetch(self);
+
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: parsing completed successfully", __debug__);
 
     return TRUE;
@@ -939,129 +1065,304 @@ static gssize mirage_filter_stream_isz_read_raw_chunk (MirageFilterStreamIsz *se
     return have_read;
 }
 
-static gssize mirage_filter_stream_isz_partial_read (MirageFilterStream *_self, void *buffer, gsize count)
+static gssize mirage_filter_stream_isz_read_part_data (MirageFilterStreamIsz *self, guint8 *buffer, guint part_idx)
 {
-    MirageFilterStreamIsz *self = MIRAGE_FILTER_STREAM_ISZ(_self);
-    goffset position = mirage_filter_stream_simplified_get_position(MIRAGE_FILTER_STREAM(self));
-    guint part_idx;
+    gssize read_length;
 
-    /* Find part that corresponds to current position */
-    part_idx = position / self->priv->header.block_size;
+    g_mutex_lock(&self->priv->io_mutex);
+    read_length = mirage_filter_stream_isz_read_raw_chunk(self, buffer, part_idx);
+    g_mutex_unlock(&self->priv->io_mutex);
 
-    if (part_idx >= self->priv->num_parts) {
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: stream position %" G_GOFFSET_MODIFIER "d (0x%" G_GOFFSET_MODIFIER "X) beyond end of stream, doing nothing!", __debug__, position, position);
-        return 0;
-    }
+    return read_length;
+}
 
-    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: stream position: %" G_GOFFSET_MODIFIER "d (0x%" G_GOFFSET_MODIFIER "X) -> part #%d (cached: #%d)", __debug__, position, position, part_idx, self->priv->cached_part);
+static gboolean mirage_filter_stream_isz_decode_part (MirageFilterStreamIsz *self, ISZ_Decoder *decoder, guint part_idx, guint8 *buffer)
+{
+    const ISZ_Chunk *part = &self->priv->parts[part_idx];
+
+    /* Read a part, either zero, raw or compressed */
+    if (part->type == ZERO) {
+        /* Return a zero-filled buffer */
+        memset(buffer, 0, self->priv->inflate_buffer_size);
+    } else if (part->type == DATA) {
+        /* Read uncompressed data chunk */
+        gssize read_bytes = mirage_filter_stream_isz_read_part_data(self, buffer, part_idx);
+        if ((gsize)read_bytes != part->length) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read raw chunk!", __debug__);
+            return FALSE;
+        }
 
-    /* If we do not have part in cache, uncompress it */
-    if (part_idx != self->priv->cached_part) {
-        const ISZ_Chunk *part = &self->priv->parts[part_idx];
+        /* Decrypt if necessary */
+        if (mirage_filter_stream_isz_decrypt_data_block(self, decoder, buffer, read_bytes) < 0) {
+            return FALSE;
+        }
+    } else if (part->type == ZLIB) {
+        z_stream *zlib_stream = &decoder->zlib_stream;
+        gint zlib_ret;
+        gssize read_bytes;
+
+        /* Read compressed data chunk */
+        read_bytes = mirage_filter_stream_isz_read_part_data(self, decoder->io_buffer, part_idx);
+        if ((gsize)read_bytes != part->length) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read compressed chunk!", __debug__);
+            return FALSE;
+        }
 
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: part not cached, reading...", __debug__);
+        /* If data is encrypted, decrypt it before attempting to decompress */
+        if (mirage_filter_stream_isz_decrypt_data_block(self, decoder, decoder->io_buffer, read_bytes) < 0) {
+            return FALSE;
+        }
 
-        /* Read a part, either zero, raw or compressed */
-        if (part->type == ZERO) {
-            /* Return a zero-filled buffer */
-            memset(self->priv->inflate_buffer, 0, self->priv->inflate_buffer_size);
-        } else if (part->type == DATA) {
-            /* Read uncompressed data chunk */
-            gssize read_bytes = mirage_filter_stream_isz_read_raw_chunk(self, self->priv->inflate_buffer, part_idx);
-            if ((gsize)read_bytes != part->length) {
-                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read raw chunk!", __debug__);
-                return -1;
-            }
+        /* Reset inflate engine, and inflate whole part */
+        zlib_ret = inflateReset2(zlib_stream, 15);
+        if (zlib_ret != Z_OK) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to reset inflate engine!", __debug__);
+            return FALSE;
+        }
+
+        zlib_stream->avail_in = part->length;
+        zlib_stream->next_in = decoder->io_buffer;
+        zlib_stream->avail_out = self->priv->inflate_buffer_size;
+        zlib_stream->next_out = buffer;
 
-            /* Decrypt if necessary */
-            if (mirage_filter_stream_isz_decrypt_data_block(self, self->priv->inflate_buffer, read_bytes) < 0) {
-                return -1;
+        do {
+            zlib_ret = inflate(zlib_stream, Z_NO_FLUSH);
+            if (zlib_ret == Z_NEED_DICT || zlib_ret == Z_MEM_ERROR || zlib_ret == Z_DATA_ERROR) {
+                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to inflate data: %s!", __debug__, zlib_stream->msg);
+                return FALSE;
             }
-        } else if (part->type == ZLIB) {
-            z_stream *zlib_stream = &self->priv->zlib_stream;
-            gint zlib_ret;
-            gssize read_bytes;
-
-            /* Read compressed data chunk */
-            read_bytes = mirage_filter_stream_isz_read_raw_chunk(self, self->priv->io_buffer, part_idx);
-            if ((gsize)read_bytes != part->length) {
-                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read compressed chunk!", __debug__);
-                return -1;
+        } while (zlib_stream->avail_in);
+    } else if (part->type == BZ2) {
+        bz_stream *bzip2_stream = &decoder->bzip2_stream;
+        int bz_ret;
+        gssize read_bytes;
+
+        /* Read compressed data chunk */
+        read_bytes = mirage_filter_stream_isz_read_part_data(self, decoder->io_buffer, part_idx);
+        if ((gsize)read_bytes != part->length) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read compressed chunk!", __debug__);
+            return FALSE;
+        }
+
+        /* If data is encrypted, decrypt it before attempting to decompress */
+        if (mirage_filter_stream_isz_decrypt_data_block(self, decoder, decoder->io_buffer, read_bytes) < 0) {
+            return FALSE;
+        }
+
+        /* Restore a correct header */
+        memcpy(decoder->io_buffer, "BZh", 3);
+
+        /* Reset decompression engine, and decompress whole part */
+        bz_ret = BZ2_bzDecompressInit(bzip2_stream, 0, 0);
+        if (bz_ret != BZ_OK) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to initialize decompress engine!", __debug__);
+            return FALSE;
+        }
+
+        bzip2_stream->avail_in = part->length;
+        bzip2_stream->next_in = (gchar *)decoder->io_buffer;
+        bzip2_stream->avail_out = self->priv->inflate_buffer_size;
+        bzip2_stream->next_out = (gchar *)buffer;
+
+        do {
+            bz_ret = BZ2_bzDecompress(bzip2_stream);
+            if (bz_ret < 0) {
+                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to decompress data: %d!", __debug__, bz_ret);
+                return FALSE;
             }
+        } while (bzip2_stream->avail_in);
+
+        /* Uninitialize decompression engine */
+        bz_ret = BZ2_bzDecompressEnd(bzip2_stream);
+        if (bz_ret != BZ_OK) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to uninitialize decompress engine!", __debug__);
+            return FALSE;
+        }
+    } else {
+        /* We should never get here... */
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: encountered unknown chunk type %u!", __debug__, part->type);
+        return FALSE;
+    }
+
+
+    return TRUE;
+}
+
+
+/**********************************************************************\
+ *                        Prefetch of decoded parts                   *
+\**********************************************************************/
+static void mirage_filter_stream_isz_prefetch_part (gpointer data, MirageFilterStreamIsz *self)
+{
+    ISZ_PrefetchSlot *slot = &self->priv->prefetch_slots[GPOINTER_TO_INT(data) - 1];
+
+    /* Slot's part and buffer are not touched by reading thread while the
+     * slot is pending */
+    gboolean succeeded = mirage_filter_stream_isz_decode_part(self, &slot->decoder, slot->part, slot->buffer);
+
+    g_mutex_lock(&self->priv->prefetch_mutex);
+    slot->state = succeeded ? PREFETCH_READY : PREFETCH_FAILED;
+    g_cond_broadcast(&self->priv->prefetch_cond);
+    g_mutex_unlock(&self->priv->prefetch_mutex);
+}
+
+static void mirage_filter_stream_isz_setup_prefetch (MirageFilterStreamIsz *self)
+{
+    /* Prefetch is an optimization, so do with fewer slots (or without
+     * it) if buffers or threads cannot be created */
+    for (gint i = 0; i < ISZ_PREFETCH_SLOTS; i++) {
+        ISZ_PrefetchSlot *slot = &self->priv->prefetch_slots[i];
+
+        slot->part = -1;
+        slot->state = PREFETCH_EMPTY;
+
+        slot->buffer = g_try_malloc(self->priv->inflate_buffer_size);
+        if (!slot->buffer) {
+            break;
+        }
+        if (!mirage_filter_stream_isz_decoder_init(self, &slot->decoder, NULL)) {
+            break;
+        }
+#if MIRAGE_HAVE_LIBGCRYPT
+        if (self->priv->decoder.crypt_handle && !mirage_filter_stream_isz_open_cipher(self, &slot->decoder.crypt_handle, NULL)) {
+            break;
+        }
+#endif
+
+        self->priv->num_prefetch_slots++;
+    }
+
+    if (self->priv->num_prefetch_slots) {
+        gint num_threads = MIN(MAX(g_get_num_processors(), 1), (guint)self->priv->num_prefetch_slots);
+        self->priv->prefetch_pool = g_thread_pool_new((GFunc)mirage_filter_stream_isz_prefetch_part, self, num_threads, FALSE, NULL);
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: prefetch slots: %d", __debug__, self->priv->prefetch_pool ? self->priv->num_prefetch_slots : 0);
+}
 
-            /* If data is encrypted, decrypt it before attempting to decompress */
-            if (mirage_filter_stream_isz_decrypt_data_block(self, self->priv->io_buffer, read_bytes) < 0) {
-                return -1;
+static void mirage_filter_stream_isz_schedule_prefetch (MirageFilterStreamIsz *self, guint first_part)
+{
+    const guint last_part = MIN(first_part + self->priv->num_prefetch_slots, self->priv->num_parts);
+
+    g_mutex_lock(&self->priv->prefetch_mutex);
+
+    for (guint part_idx = first_part; part_idx < last_part; part_idx++) {
+        ISZ_PrefetchSlot *free_slot = NULL;
+        gint free_slot_idx = -1;
+        gboolean scheduled = FALSE;
+
+        /* Zero parts are not worth prefetching */
+        if (self->priv->parts[part_idx].type == ZERO) {
+            continue;
+        }
+
+        /* Find out whether part is already prefetched; meanwhile, look
+         * for a free slot. Slots holding parts outside the prefetch window
+         * are reused. */
+        for (gint i = 0; i < self->priv->num_prefetch_slots; i++) {
+            ISZ_PrefetchSlot *slot = &self->priv->prefetch_slots[i];
+
+            if (slot->state != PREFETCH_EMPTY && slot->part == (gint)part_idx) {
+                scheduled = TRUE;
+                break;
             }
 
-            /* Reset inflate engine, and inflate whole part */
-            zlib_ret = inflateReset2(zlib_stream, 15);
-            if (zlib_ret != Z_OK) {
-                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to reset inflate engine!", __debug__);
-                return -1;
+            if (!free_slot && slot->state != PREFETCH_PENDING && (slot->state == PREFETCH_EMPTY || slot->part < (gint)first_part || slot->part >= (gint)last_part)) {
+                free_slot = slot;
+                free_slot_idx = i;
             }
+        }
 
-            zlib_stream->avail_in = part->length;
-            zlib_stream->next_in = self->priv->io_buffer;
-            zlib_stream->avail_out = self->priv->inflate_buffer_size;
-            zlib_stream->next_out = self->priv->inflate_buffer;
+        if (scheduled) {
+            continue;
+        }
+        if (!free_slot) {
+            break;
+        }
 
-            do {
-                zlib_ret = inflate(zlib_stream, Z_NO_FLUSH);
-                if (zlib_ret == Z_NEED_DICT || zlib_ret == Z_MEM_ERROR || zlib_ret == Z_DATA_ERROR) {
-                    MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to inflate data: %s!", __debug__, zlib_stream->msg);
-                    return -1;
-                }
-            } while (zlib_stream->avail_in);
-        } else if (part->type == BZ2) {
-            bz_stream *bzip2_stream = &self->priv->bzip2_stream;
-            int bz_ret;
-            gssize read_bytes;
-
-            /* Read compressed data chunk */
-            read_bytes = mirage_filter_stream_isz_read_raw_chunk(self, self->priv->io_buffer, part_idx);
-            if ((gsize)read_bytes != part->length) {
-                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read compressed chunk!", __debug__);
-                return -1;
-            }
+        free_slot->part = part_idx;
+        free_slot->state = PREFETCH_PENDING;
+        g_thread_pool_push(self->priv->prefetch_pool, GINT_TO_POINTER(free_slot_idx + 1), NULL);
+    }
 
-            /* If data is encrypted, decrypt it before attempting to decompress */
-            if (mirage_filter_stream_isz_decrypt_data_block(self, self->priv->io_buffer, read_bytes) < 0) {
-                return -1;
+    g_mutex_unlock(&self->priv->prefetch_mutex);
+}
+
+static gboolean mirage_filter_stream_isz_read_part (MirageFilterStreamIsz *self, guint part_idx)
+{
+    gboolean sequential = (gint)part_idx == self->priv->last_read_part + 1;
+    gboolean prefetched = FALSE;
+
+    /* Take decoded data from prefetch slot, if available */
+    if (self->priv->prefetch_pool) {
+        g_mutex_lock(&self->priv->prefetch_mutex);
+        for (gint i = 0; i < self->priv->num_prefetch_slots; i++) {
+            ISZ_PrefetchSlot *slot = &self->priv->prefetch_slots[i];
+
+            if (slot->state == PREFETCH_EMPTY || slot->part != (gint)part_idx) {
+                continue;
             }
 
-            /* Restore a correct header */
-            memcpy(self->priv->io_buffer, "BZh", 3);
+            while (slot->state == PREFETCH_PENDING) {
+                g_cond_wait(&self->priv->prefetch_cond, &self->priv->prefetch_mutex);
+            }
 
-            /* Reset decompression engine, and decompress whole part */
-            bz_ret = BZ2_bzDecompressInit(bzip2_stream, 0, 0);
-            if (bz_ret != BZ_OK) {
-                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to initialize decompress engine!", __debug__);
-                return -1;
+            if (slot->state == PREFETCH_READY) {
+                /* Both buffers are of the same size; swap them */
+                guint8 *tmp = self->priv->inflate_buffer;
+                self->priv->inflate_buffer = slot->buffer;
+                slot->buffer = tmp;
+                prefetched = TRUE;
             }
 
-            bzip2_stream->avail_in = part->length;
-            bzip2_stream->next_in = (gchar *)self->priv->io_buffer;
-            bzip2_stream->avail_out = self->priv->inflate_buffer_size;
-            bzip2_stream->next_out = (gchar *)self->priv->inflate_buffer;
+            slot->part = -1;
+            slot->state = PREFETCH_EMPTY;
+            break;
+        }
+        g_mutex_unlock(&self->priv->prefetch_mutex);
+    }
 
-            do {
-                bz_ret = BZ2_bzDecompress(bzip2_stream);
-                if (bz_ret < 0) {
-                    MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to decompress data: %d!", __debug__, bz_ret);
-                    return -1;
-                }
-            } while (bzip2_stream->avail_in);
+    if (prefetched) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: using prefetched data for part #%d", __debug__, part_idx);
+    } else if (!mirage_filter_stream_isz_decode_part(self, &self->priv->decoder, part_idx, self->priv->inflate_buffer)) {
+        return FALSE;
+    }
 
-            /* Uninitialize decompression engine */
-            bz_ret = BZ2_bzDecompressEnd(bzip2_stream);
-            if (bz_ret != BZ_OK) {
-                MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to uninitialize decompress engine!", __debug__);
-                return -1;
-            }
-        } else {
-            /* We should never get here... */
-            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: encountered unknown chunk type %u!", __debug__, part->type);
+    self->priv->last_read_part = part_idx;
+
+    /* On sequential access, decrypt and decompress following parts on
+     * worker threads while the current one is being consumed */
+    if (sequential && self->priv->prefetch_pool) {
+        mirage_filter_stream_isz_schedule_prefetch(self, part_idx + 1);
+    }
+
+    return TRUE;
+}
+
+static gssize mirage_filter_stream_isz_partial_read (MirageFilterStream *_self, void *buffer, gsize count)
+{
+    MirageFilterStreamIsz *self = MIRAGE_FILTER_STREAM_ISZ(_self);
+    goffset position = mirage_filter_stream_simplified_get_position(MIRAGE_FILTER_STREAM(self));
+    guint part_idx;
+
+    /* Find part that corresponds to current position */
+    part_idx = position / self->priv->header.block_size;
+
+    if (part_idx >= self->priv->num_parts) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: stream position %" G_GOFFSET_MODIFIER "d (0x%" G_GOFFSET_MODIFIER "X) beyond end of stream, doing nothing!", __debug__, position, position);
+        return 0;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: stream position: %" G_GOFFSET_MODIFIER "d (0x%" G_GOFFSET_MODIFIER "X) -> part #%d (cached: #%d)", __debug__, position, position, part_idx, self->priv->cached_part);
+
+    /* If we do not have part in cache, uncompress it */
+    if (part_idx != self->priv->cached_part) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: part not cached, reading...", __debug__);
+
+        /* Buffer contents are undefined if reading fails */
+        self->priv->cached_part = -1;
+
+        if (!mirage_filter_stream_isz_read_part(self, part_idx)) {
             return -1;
         }
 
@@ -1111,10 +1412,17 @@ static void mirage_filter_stream_isz_init (MirageFilterStreamIsz *self)
 
     self->priv->cached_part = -1;
     self->priv->inflate_buffer = NULL;
-    self->priv->io_buffer = NULL;
+
+    g_mutex_init(&self->priv->io_mutex);
+
+    self->priv->prefetch_pool = NULL;
+    g_mutex_init(&self->priv->prefetch_mutex);
+    g_cond_init(&self->priv->prefetch_cond);
+    self->priv->num_prefetch_slots = 0;
+    self->priv->last_read_part = -1;
 
 #if MIRAGE_HAVE_LIBGCRYPT
-    self->priv->crypt_handle = NULL;
+    self->priv->crypt_key_size = 0;
 #endif
 }
 
@@ -1122,6 +1430,20 @@ static void mirage_filter_stream_isz_finalize (GObject *gobject)
 {
     MirageFilterStreamIsz *self = MIRAGE_FILTER_STREAM_ISZ(gobject);
 
+    /* Wait for prefetch in progress, which uses segment streams */
+    if (self->priv->prefetch_pool) {
+        g_thread_pool_free(self->priv->prefetch_pool, TRUE, TRUE);
+    }
+    g_mutex_clear(&self->priv->prefetch_mutex);
+    g_cond_clear(&self->priv->prefetch_cond);
+    g_mutex_clear(&self->priv->io_mutex);
+
+    for (gint i = 0; i < ISZ_PREFETCH_SLOTS; i++) {
+        g_free(self->priv->prefetch_slots[i].buffer);
+        mirage_filter_stream_isz_decoder_cleanup(&self->priv->prefetch_slots[i].decoder);
+    }
+    mirage_filter_stream_isz_decoder_cleanup(&self->priv->decoder);
+
     g_free(self->priv->volname_prefix);
 
     for (gint s = 0; s < self->priv->num_segments; s++) {
@@ -1135,17 +1457,6 @@ static void mirage_filter_stream_isz_finalize (GObject *gobject)
     g_free(self->priv->segments);
     g_free(self->priv->parts);
     g_free(self->priv->inflate_buffer);
-    g_free(self->priv->io_buffer);
-
-    inflateEnd(&self->priv->zlib_stream);
-    BZ2_bzDecompressEnd(&self->priv->bzip2_stream);
-
-#if MIRAGE_HAVE_LIBGCRYPT
-    if (self->priv->crypt_handle) {
-        gcry_cipher_close(self->priv->crypt_handle);
-        self->priv->crypt_handle = NULL;
-    }
-#endif
 
     /* Chain up to the parent class */
     G_OBJECT_CLASS(mirage_filter_stream_isz_parent_class)->finalize(gobject);
@@ -23,6 +23,9 @@
 #include <mirage/mirage.h>
 
 #include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <sndfile.h>
 #include <samplerate.h>
 
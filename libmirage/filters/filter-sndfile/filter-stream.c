@@ -44,6 +44,21 @@ struct _MirageFilterStreamSndfilePrivate
     float *resample_buffer_out;
     SRC_STATE *resampler;
     SRC_DATA resampler_data;
+
+    /* Serializes sndfile access between reader and background decoder */
+    GMutex sndfile_mutex;
+    sf_count_t sndfile_position; /* Position expected by decoder; -1 if moved */
+
+    /* Decoded PCM cache */
+    gboolean cache_enabled;
+    GThread *cache_thread;
+    gint cache_fd;
+    guint8 *cache_data;
+    gsize cache_length;
+
+    GMutex cache_mutex;
+    gsize cache_filled; /* Number of decoded bytes available in cache */
+    gboolean cache_cancel;
 };
 
 
@@ -136,6 +151,212 @@ static SF_VIRTUAL_IO sndfile_io_bridge = {
 };
 
 
+/**********************************************************************\
+ *                         Decoded PCM cache                          *
+\**********************************************************************/
+static gboolean mirage_filter_stream_sndfile_cache_decode_chunk (MirageFilterStreamSndfile *self, SRC_STATE *resampler, float *buffer_in, float *buffer_out, sf_count_t *input_position, gsize *output_frames, gboolean *eof)
+{
+    gint channels = self->priv->format.channels;
+    gsize frame_size = channels * sizeof(guint16);
+    gsize total_frames = self->priv->cache_length / frame_size;
+    sf_count_t requested, read_length;
+    SRC_DATA data;
+
+    /* Read next chunk; re-seek first if reader moved the position */
+    g_mutex_lock(&self->priv->sndfile_mutex);
+    if (self->priv->sndfile_position != *input_position) {
+        if (sf_seek(self->priv->sndfile, *input_position, SEEK_SET) < 0) {
+            g_mutex_unlock(&self->priv->sndfile_mutex);
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to seek to offset %" G_GINT64_MODIFIER "d in underlying stream!", __debug__, (gint64)*input_position);
+            return FALSE;
+        }
+    }
+    if (!resampler) {
+        /* Decode straight into the cache */
+        requested = MIN(NUM_FRAMES, total_frames - *output_frames);
+        read_length = sf_readf_short(self->priv->sndfile, (short *)(void *)(self->priv->cache_data + *output_frames * frame_size), requested);
+    } else {
+        requested = NUM_FRAMES*self->priv->io_ratio;
+        read_length = sf_readf_float(self->priv->sndfile, buffer_in, requested);
+    }
+    *input_position += read_length;
+    self->priv->sndfile_position = *input_position;
+    g_mutex_unlock(&self->priv->sndfile_mutex);
+
+    *eof = read_length < requested;
+
+    if (!resampler) {
+        *output_frames += read_length;
+        return TRUE;
+    }
+
+    /* Feed the chunk to the resampler, which carries its state across
+     * chunks; signal end of input on the last (short) chunk, so that
+     * the remaining frames are flushed out */
+    data.data_in = buffer_in;
+    data.input_frames = read_length;
+    data.end_of_input = *eof;
+    data.src_ratio = 1/self->priv->io_ratio;
+
+    do {
+        gint resampler_error;
+        gsize generated;
+
+        data.data_out = buffer_out;
+        data.output_frames = NUM_FRAMES;
+
+        resampler_error = src_process(resampler, &data);
+        if (resampler_error) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to resample frames: %s!", __debug__, src_strerror(resampler_error));
+            return FALSE;
+        }
+
+        generated = MIN((gsize)data.output_frames_gen, total_frames - *output_frames);
+        src_float_to_short_array(buffer_out, (short *)(void *)(self->priv->cache_data + *output_frames * frame_size), generated * channels);
+        *output_frames += generated;
+
+        data.data_in += data.input_frames_used * channels;
+        data.input_frames -= data.input_frames_used;
+    } while ((data.input_frames > 0 || (data.end_of_input && data.output_frames_gen > 0)) && *output_frames < total_frames);
+
+    return TRUE;
+}
+
+static gpointer mirage_filter_stream_sndfile_cache_decode_thread (MirageFilterStreamSndfile *self)
+{
+    gsize frame_size = self->priv->format.channels * sizeof(guint16);
+    gsize total_frames = self->priv->cache_length / frame_size;
+    sf_count_t input_position = 0;
+    gsize output_frames = 0;
+    gboolean eof = FALSE;
+    gboolean succeeded = TRUE;
+
+    SRC_STATE *resampler = NULL;
+    float *buffer_in = NULL;
+    float *buffer_out = NULL;
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: decoding track into PCM cache...", __debug__);
+
+    /* Decoder uses its own resampler instance, so that it can carry
+     * the state across chunks */
+    if (self->priv->io_ratio != 1.0) {
+        gint resampler_error;
+
+        resampler = src_new(SRC_LINEAR, self->priv->format.channels, &resampler_error);
+        if (!resampler) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to initialize resampler; error code %d!", __debug__, resampler_error);
+            return NULL;
+        }
+
+        buffer_in = g_new(float, self->priv->format.channels * (gsize)(NUM_FRAMES*self->priv->io_ratio));
+        buffer_out = g_new(float, self->priv->format.channels * NUM_FRAMES);
+    }
+
+    while (!eof && output_frames < total_frames) {
+        gboolean cancel;
+
+        g_mutex_lock(&self->priv->cache_mutex);
+        cancel = self->priv->cache_cancel;
+        g_mutex_unlock(&self->priv->cache_mutex);
+        if (cancel) {
+            succeeded = FALSE;
+            break;
+        }
+
+        if (!mirage_filter_stream_sndfile_cache_decode_chunk(self, resampler, buffer_in, buffer_out, &input_position, &output_frames, &eof)) {
+            succeeded = FALSE;
+            break;
+        }
+
+        /* Publish decoded data */
+        g_mutex_lock(&self->priv->cache_mutex);
+        self->priv->cache_filled = output_frames * frame_size;
+        g_mutex_unlock(&self->priv->cache_mutex);
+    }
+
+    /* Whatever the decoder came short of (due to rounding of resampled
+     * length) is left zeroed, same as the freshly-truncated cache file */
+    if (succeeded) {
+        g_mutex_lock(&self->priv->cache_mutex);
+        self->priv->cache_filled = self->priv->cache_length;
+        g_mutex_unlock(&self->priv->cache_mutex);
+
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: track decoded into PCM cache (%" G_GSIZE_MODIFIER "d frames)", __debug__, output_frames);
+    }
+
+    if (resampler) {
+        src_delete(resampler);
+    }
+    g_free(buffer_in);
+    g_free(buffer_out);
+
+    return NULL;
+}
+
+static void mirage_filter_stream_sndfile_cache_start (MirageFilterStreamSndfile *self)
+{
+    GError *local_error = NULL;
+    gchar *filename;
+
+    /* Cache is backed by an unlinked temporary file that is mapped
+     * into memory; this way, the decoded data of large tracks can be
+     * paged out by the kernel instead of pinning anonymous memory */
+    self->priv->cache_fd = g_file_open_tmp("libmirage-sndfile-XXXXXX.pcm", &filename, &local_error);
+    if (self->priv->cache_fd == -1) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to create PCM cache file: %s; disabling cache!", __debug__, local_error->message);
+        g_error_free(local_error);
+        self->priv->cache_enabled = FALSE;
+        return;
+    }
+    g_unlink(filename);
+    g_free(filename);
+
+    if (ftruncate(self->priv->cache_fd, self->priv->cache_length) < 0) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to resize PCM cache file to %" G_GSIZE_MODIFIER "d bytes; disabling cache!", __debug__, self->priv->cache_length);
+        close(self->priv->cache_fd);
+        self->priv->cache_fd = -1;
+        self->priv->cache_enabled = FALSE;
+        return;
+    }
+
+    self->priv->cache_data = mmap(NULL, self->priv->cache_length, PROT_READ | PROT_WRITE, MAP_SHARED, self->priv->cache_fd, 0);
+    if (self->priv->cache_data == MAP_FAILED) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to map PCM cache file; disabling cache!", __debug__);
+        self->priv->cache_data = NULL;
+        close(self->priv->cache_fd);
+        self->priv->cache_fd = -1;
+        self->priv->cache_enabled = FALSE;
+        return;
+    }
+
+    /* Start the decoder */
+    self->priv->cache_thread = g_thread_new("mirage-sndfile-decoder", (GThreadFunc)mirage_filter_stream_sndfile_cache_decode_thread, self);
+}
+
+static void mirage_filter_stream_sndfile_cache_stop (MirageFilterStreamSndfile *self)
+{
+    if (self->priv->cache_thread) {
+        g_mutex_lock(&self->priv->cache_mutex);
+        self->priv->cache_cancel = TRUE;
+        g_mutex_unlock(&self->priv->cache_mutex);
+
+        g_thread_join(self->priv->cache_thread);
+        self->priv->cache_thread = NULL;
+    }
+
+    if (self->priv->cache_data) {
+        munmap(self->priv->cache_data, self->priv->cache_length);
+        self->priv->cache_data = NULL;
+    }
+    if (self->priv->cache_fd != -1) {
+        close(self->priv->cache_fd);
+        self->priv->cache_fd = -1;
+    }
+
+    self->priv->cache_enabled = FALSE;
+}
+
+
 /**********************************************************************\
  *              MirageFilterStream methods implementations            *
 \**********************************************************************/
@@ -286,13 +507,30 @@ static gboolean mirage_filter_stream_sndfile_open (MirageFilterStream *_self, Mi
         mirage_filter_stream_simplified_set_stream_length(MIRAGE_FILTER_STREAM(self), length);
     }
 
+    /* Check whether decoded PCM cache is requested; the track is then
+     * decoded in its entirety on first access */
+    if (!writable) {
+        GVariant *cache_value = mirage_contextual_get_option(MIRAGE_CONTEXTUAL(self), "audio-cache");
+        if (cache_value) {
+            if (g_variant_is_of_type(cache_value, G_VARIANT_TYPE_BOOLEAN)) {
+                self->priv->cache_enabled = g_variant_get_boolean(cache_value);
+            }
+            g_variant_unref(cache_value);
+        }
+        self->priv->cache_length = length;
+
+        if (self->priv->cache_enabled && length) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: decoded PCM cache enabled", __debug__);
+        } else {
+            self->priv->cache_enabled = FALSE;
+        }
+    }
+
     return TRUE;
 }
 
-static gssize mirage_filter_stream_sndfile_partial_read (MirageFilterStream *_self, void *buffer, gsize count)
+static gssize mirage_filter_stream_sndfile_read_block (MirageFilterStreamSndfile *self, goffset position, void *buffer, gsize count)
 {
-    MirageFilterStreamSndfile *self = MIRAGE_FILTER_STREAM_SNDFILE(_self);
-    goffset position = mirage_filter_stream_simplified_get_position(_self);
     gint block;
 
     /* Find the block of frames corresponding to current position; this
@@ -359,8 +597,10 @@ static gssize mirage_filter_stream_sndfile_partial_read (MirageFilterStream *_se
             src_float_to_short_array(self->priv->resample_buffer_out, (short *)(void *)self->priv->buffer, NUM_FRAMES * self->priv->format.channels);
         }
 
-        /* Store the number of currently stored block */
+        /* Store the number of currently stored block; the background
+         * decoder needs to re-seek before its next read */
         self->priv->cached_block = block;
+        self->priv->sndfile_position = -1;
     } else {
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: block already cached", __debug__);
     }
@@ -376,6 +616,41 @@ static gssize mirage_filter_stream_sndfile_partial_read (MirageFilterStream *_se
     return count;
 }
 
+static gssize mirage_filter_stream_sndfile_partial_read (MirageFilterStream *_self, void *buffer, gsize count)
+{
+    MirageFilterStreamSndfile *self = MIRAGE_FILTER_STREAM_SNDFILE(_self);
+    goffset position = mirage_filter_stream_simplified_get_position(_self);
+    gssize read_length;
+
+    /* If decoded PCM cache is enabled, start the decoder on first
+     * access, and serve the data from cache once it is available */
+    if (self->priv->cache_enabled) {
+        gsize cache_filled;
+
+        if (!self->priv->cache_thread) {
+            mirage_filter_stream_sndfile_cache_start(self);
+        }
+
+        g_mutex_lock(&self->priv->cache_mutex);
+        cache_filled = self->priv->cache_filled;
+        g_mutex_unlock(&self->priv->cache_mutex);
+
+        if ((gsize)position < cache_filled) {
+            count = MIN(count, cache_filled - position);
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: stream position: %" G_GOFFSET_MODIFIER "d (0x%" G_GOFFSET_MODIFIER "X) -> copying %" G_GSIZE_MODIFIER "d bytes from decoded cache", __debug__, position, position, count);
+            memcpy(buffer, self->priv->cache_data + position, count);
+            return count;
+        }
+    }
+
+    /* Decode the block ourselves */
+    g_mutex_lock(&self->priv->sndfile_mutex);
+    read_length = mirage_filter_stream_sndfile_read_block(self, position, buffer, count);
+    g_mutex_unlock(&self->priv->sndfile_mutex);
+
+    return read_length;
+}
+
 static gssize mirage_filter_stream_sndfile_partial_write (MirageFilterStream *_self, const void *buffer, gsize count)
 {
     MirageFilterStreamSndfile *self = MIRAGE_FILTER_STREAM_SNDFILE(_self);
@@ -429,12 +704,29 @@ static void mirage_filter_stream_sndfile_init (MirageFilterStreamSndfile *self)
     self->priv->resample_buffer_in = NULL;
     self->priv->resample_buffer_out = NULL;
     self->priv->resampler = NULL;
+
+    g_mutex_init(&self->priv->sndfile_mutex);
+    self->priv->sndfile_position = -1;
+
+    self->priv->cache_enabled = FALSE;
+    self->priv->cache_thread = NULL;
+    self->priv->cache_fd = -1;
+    self->priv->cache_data = NULL;
+    self->priv->cache_length = 0;
+
+    g_mutex_init(&self->priv->cache_mutex);
+    self->priv->cache_filled = 0;
+    self->priv->cache_cancel = FALSE;
 }
 
 static void mirage_filter_stream_sndfile_dispose (GObject *gobject)
 {
     MirageFilterStreamSndfile *self = MIRAGE_FILTER_STREAM_SNDFILE(gobject);
 
+    /* Stop the decoder and release the cache; must be done before
+     * sndfile is closed */
+    mirage_filter_stream_sndfile_cache_stop(self);
+
     /* Close sndfile */
     if (self->priv->sndfile) {
         sf_close(self->priv->sndfile);
@@ -462,6 +754,9 @@ static void mirage_filter_stream_sndfile_finalize (GObject *gobject)
     g_free(self->priv->resample_buffer_in);
     g_free(self->priv->resample_buffer_out);
 
+    g_mutex_clear(&self->priv->sndfile_mutex);
+    g_mutex_clear(&self->priv->cache_mutex);
+
     /* Chain up to the parent class */
     G_OBJECT_CLASS(mirage_filter_stream_sndfile_parent_class)->finalize(gobject);
 }
@@ -24,6 +24,21 @@
 
 #define MAX_BLOCK_SIZE 10485760 /* For performance reasons, we support only 10 MB blocks and smaller */
 
+#define WRITE_BLOCK_SIZE 1048576 /* Size of blocks that we create when writing - 1 MB */
+#define WRITE_CHECK LZMA_CHECK_CRC64 /* Integrity check used when writing */
+
+typedef struct
+{
+    /* Input */
+    guint8 *data;
+    gsize data_size;
+
+    /* Output */
+    guint8 *block;
+    gsize block_size;
+    lzma_vli unpadded_size;
+} XZ_Job;
+
 
 static const guint8 xz_signature[6] = {0xFD, '7', 'z', 'X', 'Z', 0x00};
 
@@ -47,6 +62,16 @@ struct _MirageFilterStreamXzPrivate
     lzma_stream_flags footer;
 
     lzma_index *index;
+
+    /* Compression (write mode) */
+    gboolean write_mode;
+    gboolean write_failed;
+
+    guint8 *write_block_buffer; /* Data of block that is being filled */
+    goffset write_block_offset; /* Its offset within uncompressed stream */
+    gsize write_block_fill;
+
+    MirageJobQueue *job_queue;
 };
 
 
@@ -262,15 +287,242 @@ static gboolean mirage_filter_stream_xz_parse_stream (MirageFilterStreamXz *self
 }
 
 
+/**********************************************************************\
+ *                            Compression                             *
+\**********************************************************************/
+static gboolean mirage_filter_stream_xz_compress_block (const guint8 *data, gsize data_size, guint8 **output, gsize *output_size, lzma_vli *unpadded_size)
+{
+    lzma_options_lzma options;
+    lzma_filter filters[2];
+    lzma_block block;
+    guint8 *buffer;
+    gsize buffer_size;
+    gsize out_pos = 0;
+
+    /* Default preset, but with dictionary no larger than the block;
+     * anything more only costs memory, of which each thread needs its own */
+    if (lzma_lzma_preset(&options, LZMA_PRESET_DEFAULT)) {
+        return FALSE;
+    }
+    options.dict_size = MAX(LZMA_DICT_SIZE_MIN, MIN(options.dict_size, data_size));
+
+    filters[0].id = LZMA_FILTER_LZMA2;
+    filters[0].options = &options;
+    filters[1].id = LZMA_VLI_UNKNOWN;
+    filters[1].options = NULL;
+
+    memset(&block, 0, sizeof(block));
+    block.version = 0;
+    block.check = WRITE_CHECK;
+    block.filters = filters;
+
+    buffer_size = lzma_block_buffer_bound(data_size);
+    buffer = g_try_malloc(buffer_size);
+    if (!buffer) {
+        return FALSE;
+    }
+
+    if (lzma_block_buffer_encode(&block, NULL, data, data_size, buffer, &out_pos, buffer_size) != LZMA_OK) {
+        g_free(buffer);
+        return FALSE;
+    }
+
+    *output = buffer;
+    *output_size = out_pos;
+    *unpadded_size = lzma_block_unpadded_size(&block);
+
+    return TRUE;
+}
+
+static void mirage_filter_stream_xz_free_job (XZ_Job *job)
+{
+    g_free(job->data);
+    g_free(job->block);
+    g_free(job);
+}
+
+static gboolean mirage_filter_stream_xz_compress_job (XZ_Job *job, MirageFilterStreamXz *self)
+{
+    gboolean succeeded = mirage_filter_stream_xz_compress_block(job->data, job->data_size, &job->block, &job->block_size, &job->unpadded_size);
+
+    g_free(job->data);
+    job->data = NULL;
+
+    if (!succeeded) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to compress block!", __debug__);
+    }
+
+    return succeeded;
+}
+
+static gboolean mirage_filter_stream_xz_write_data (MirageFilterStreamXz *self, const guint8 *data, gsize size)
+{
+    MirageStream *stream = mirage_filter_stream_get_underlying_stream(MIRAGE_FILTER_STREAM(self));
+
+    if (mirage_stream_write(stream, data, size, NULL) != (gssize)size) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to write %" G_GSIZE_MODIFIER "d bytes to underlying stream!", __debug__, size);
+        self->priv->write_failed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_xz_complete_job (XZ_Job *job, MirageFilterStreamXz *self)
+{
+    /* Compressed blocks are completed in stream order; write them out
+     * and record them in the index */
+    if (!mirage_filter_stream_xz_write_data(self, job->block, job->block_size)) {
+        return FALSE;
+    }
+
+    if (lzma_index_append(self->priv->index, NULL, job->unpadded_size, job->data_size) != LZMA_OK) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to append block to index!", __debug__);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_xz_submit_block (MirageFilterStreamXz *self)
+{
+    XZ_Job *job = g_new0(XZ_Job, 1);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: submitting block at offset %" G_GOFFSET_MODIFIER "d (%" G_GSIZE_MODIFIER "d bytes)", __debug__, self->priv->write_block_offset, self->priv->write_block_fill);
+
+    /* Job takes over the block buffer */
+    job->data = self->priv->write_block_buffer;
+    job->data_size = self->priv->write_block_fill;
+
+    self->priv->write_block_buffer = g_malloc(WRITE_BLOCK_SIZE);
+    self->priv->write_block_offset += self->priv->write_block_fill;
+    self->priv->write_block_fill = 0;
+
+    if (!mirage_helper_job_queue_push(self->priv->job_queue, job)) {
+        self->priv->write_failed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_xz_finish (MirageFilterStream *_self, GError **error)
+{
+    MirageFilterStreamXz *self = MIRAGE_FILTER_STREAM_XZ(_self);
+    lzma_stream_flags flags;
+    guint8 footer[LZMA_STREAM_HEADER_SIZE];
+
+    if (!self->priv->write_mode) {
+        return TRUE;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: finishing compressed stream", __debug__);
+
+    /* Compress remaining data and wait for all blocks */
+    if (self->priv->write_block_fill) {
+        mirage_filter_stream_xz_submit_block(self);
+    }
+    if (!mirage_helper_job_queue_wait(self->priv->job_queue)) {
+        self->priv->write_failed = TRUE;
+    }
+
+    mirage_helper_job_queue_free(self->priv->job_queue);
+    self->priv->job_queue = NULL;
+
+    self->priv->write_mode = FALSE;
+
+    /* Index and footer */
+    if (!self->priv->write_failed) {
+        gsize index_size = lzma_index_size(self->priv->index);
+        guint8 *index_buffer = g_malloc(index_size);
+        gsize out_pos = 0;
+
+        memset(&flags, 0, sizeof(flags));
+        flags.version = 0;
+        flags.check = WRITE_CHECK;
+        flags.backward_size = index_size;
+
+        if (lzma_index_buffer_encode(self->priv->index, index_buffer, &out_pos, index_size) != LZMA_OK) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to encode index!", __debug__);
+            self->priv->write_failed = TRUE;
+        } else if (lzma_stream_footer_encode(&flags, footer) != LZMA_OK) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to encode stream footer!", __debug__);
+            self->priv->write_failed = TRUE;
+        } else if (mirage_filter_stream_xz_write_data(self, index_buffer, out_pos)) {
+            mirage_filter_stream_xz_write_data(self, footer, sizeof(footer));
+        }
+
+        g_free(index_buffer);
+    }
+
+    if (self->priv->write_failed) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write compressed stream!"));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_filter_stream_xz_open_for_writing (MirageFilterStreamXz *self, MirageStream *stream, GError **error)
+{
+    gint num_threads = MAX(g_get_num_processors(), 1);
+    lzma_stream_flags flags;
+    guint8 header[LZMA_STREAM_HEADER_SIZE];
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: creating compressed stream; %d compression thread(s), %d kB blocks", __debug__, num_threads, WRITE_BLOCK_SIZE/1024);
+
+    /* Stream header */
+    memset(&flags, 0, sizeof(flags));
+    flags.version = 0;
+    flags.check = WRITE_CHECK;
+
+    if (lzma_stream_header_encode(&flags, header) != LZMA_OK) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to encode stream's header!"));
+        return FALSE;
+    }
+
+    if (!mirage_stream_seek(stream, 0, G_SEEK_SET, NULL) || mirage_stream_write(stream, header, sizeof(header), NULL) != (gssize)sizeof(header)) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write stream's header!"));
+        return FALSE;
+    }
+
+    /* Index is filled in as blocks are written */
+    self->priv->index = lzma_index_init(NULL);
+    if (!self->priv->index) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to initialize stream's index!"));
+        return FALSE;
+    }
+
+    /* Bound the memory used by blocks in flight */
+    self->priv->job_queue = mirage_helper_job_queue_new((MirageJobFunc)mirage_filter_stream_xz_compress_job, (MirageJobFunc)mirage_filter_stream_xz_complete_job, (GDestroyNotify)mirage_filter_stream_xz_free_job, self, num_threads, 2*num_threads, error);
+    if (!self->priv->job_queue) {
+        return FALSE;
+    }
+
+    self->priv->write_block_buffer = g_malloc(WRITE_BLOCK_SIZE);
+    self->priv->write_block_offset = 0;
+    self->priv->write_block_fill = 0;
+
+    self->priv->write_mode = TRUE;
+
+    return TRUE;
+}
+
+
 /**********************************************************************\
  *              MirageFilterStream methods implementations            *
 \**********************************************************************/
-static gboolean mirage_filter_stream_xz_open (MirageFilterStream *_self, MirageStream *stream, gboolean writable G_GNUC_UNUSED, GError **error)
+static gboolean mirage_filter_stream_xz_open (MirageFilterStream *_self, MirageStream *stream, gboolean writable, GError **error)
 {
     MirageFilterStreamXz *self = MIRAGE_FILTER_STREAM_XZ(_self);
 
     guint8 sig[6];
 
+    /* In write mode, we create a new file */
+    if (writable) {
+        return mirage_filter_stream_xz_open_for_writing(self, stream, error);
+    }
+
     /* Look for signature at the beginning */
     mirage_stream_seek(stream, 0, G_SEEK_SET, NULL);
     if (mirage_stream_read(stream, sig, sizeof(sig), NULL) != sizeof(sig)) {
@@ -304,6 +556,12 @@ static gssize mirage_filter_stream_xz_partial_read (MirageFilterStream *_self, v
     goffset position = mirage_filter_stream_simplified_get_position(_self);
     lzma_index_iter index_iter;
 
+    /* Data that is being compressed cannot be read back */
+    if (self->priv->write_mode) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: reading from stream opened for writing is not supported!", __debug__);
+        return -1;
+    }
+
     /* Find block that corresponds to current position */
     lzma_index_iter_init(&index_iter, self->priv->index);
     if (lzma_index_iter_locate(&index_iter, position)) {
@@ -410,6 +668,51 @@ static gssize mirage_filter_stream_xz_partial_read (MirageFilterStream *_self, v
 }
 
 
+static gssize mirage_filter_stream_xz_partial_write (MirageFilterStream *_self, const void *buffer, gsize count)
+{
+    MirageFilterStreamXz *self = MIRAGE_FILTER_STREAM_XZ(_self);
+    goffset position = mirage_filter_stream_simplified_get_position(_self);
+    gsize block_position;
+
+    if (!self->priv->write_mode || self->priv->write_failed) {
+        return -1;
+    }
+
+    /* Data that has already been handed over for compression cannot
+     * be changed anymore; only the block being filled can be */
+    if (position < self->priv->write_block_offset) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: cannot write at position %" G_GOFFSET_MODIFIER "d; data up to %" G_GOFFSET_MODIFIER "d has already been compressed!", __debug__, position, self->priv->write_block_offset);
+        return -1;
+    }
+
+    /* Writing beyond the current block; zero-fill and submit it */
+    if (position >= self->priv->write_block_offset + WRITE_BLOCK_SIZE) {
+        memset(self->priv->write_block_buffer + self->priv->write_block_fill, 0, WRITE_BLOCK_SIZE - self->priv->write_block_fill);
+        self->priv->write_block_fill = WRITE_BLOCK_SIZE;
+        return mirage_filter_stream_xz_submit_block(self) ? 0 : -1;
+    }
+
+    /* Copy data into block, zero-filling the gap, if any */
+    block_position = position - self->priv->write_block_offset;
+    count = MIN(count, WRITE_BLOCK_SIZE - block_position);
+
+    if (block_position > self->priv->write_block_fill) {
+        memset(self->priv->write_block_buffer + self->priv->write_block_fill, 0, block_position - self->priv->write_block_fill);
+    }
+    memcpy(self->priv->write_block_buffer + block_position, buffer, count);
+    self->priv->write_block_fill = MAX(self->priv->write_block_fill, block_position + count);
+
+    /* Submit full block */
+    if (self->priv->write_block_fill == WRITE_BLOCK_SIZE) {
+        if (!mirage_filter_stream_xz_submit_block(self)) {
+            return -1;
+        }
+    }
+
+    return count;
+}
+
+
 /**********************************************************************\
  *                             Object init                            *
 \**********************************************************************/
@@ -420,7 +723,7 @@ static void mirage_filter_stream_xz_init (MirageFilterStreamXz *self)
     mirage_filter_stream_generate_info(MIRAGE_FILTER_STREAM(self),
         "FILTER-XZ",
         Q_("XZ File Filter"),
-        FALSE,
+        TRUE,
         1,
         Q_("xz-compressed images (*.xz)"), "application/x-xz"
     );
@@ -431,6 +734,23 @@ static void mirage_filter_stream_xz_init (MirageFilterStreamXz *self)
 
     self->priv->io_buffer = NULL;
     self->priv->block_buffer = NULL;
+
+    self->priv->write_mode = FALSE;
+    self->priv->write_failed = FALSE;
+    self->priv->write_block_buffer = NULL;
+    self->priv->job_queue = NULL;
+}
+
+static void mirage_filter_stream_xz_dispose (GObject *gobject)
+{
+    MirageFilterStreamXz *self = MIRAGE_FILTER_STREAM_XZ(gobject);
+
+    /* Complete the compressed stream while we still have the underlying
+     * stream; parent's dispose releases it */
+    mirage_filter_stream_xz_finish(MIRAGE_FILTER_STREAM(self), NULL);
+
+    /* Chain up to the parent class */
+    G_OBJECT_CLASS(mirage_filter_stream_xz_parent_class)->dispose(gobject);
 }
 
 static void mirage_filter_stream_xz_finalize (GObject *gobject)
@@ -442,6 +762,8 @@ static void mirage_filter_stream_xz_finalize (GObject *gobject)
     g_free(self->priv->io_buffer);
     g_free(self->priv->block_buffer);
 
+    g_free(self->priv->write_block_buffer);
+
     /* Chain up to the parent class */
     G_OBJECT_CLASS(mirage_filter_stream_xz_parent_class)->finalize(gobject);
 }
@@ -451,11 +773,14 @@ static void mirage_filter_stream_xz_class_init (MirageFilterStreamXzClass *klass
     GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
     MirageFilterStreamClass *filter_stream_class = MIRAGE_FILTER_STREAM_CLASS(klass);
 
+    gobject_class->dispose = mirage_filter_stream_xz_dispose;
     gobject_class->finalize = mirage_filter_stream_xz_finalize;
 
     filter_stream_class->open = mirage_filter_stream_xz_open;
 
     filter_stream_class->simplified_partial_read = mirage_filter_stream_xz_partial_read;
+    filter_stream_class->simplified_partial_write = mirage_filter_stream_xz_partial_write;
+    filter_stream_class->finish = mirage_filter_stream_xz_finish;
 }
 
 static void mirage_filter_stream_xz_class_finalize (MirageFilterStreamXzClass *klass G_GNUC_UNUSED)
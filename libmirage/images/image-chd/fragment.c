@@ -37,9 +37,6 @@ struct _MirageFragmentChdPrivate
     guint32 sector_size;
     guint32 sectors_in_hunk;
 
-    guint8 *buffer;
-    guint32 cached_hunk_idx;
-
     /* The following elements are stored in private structure of
      * MirageFragment, which is (by design) inaccessible from here.
      * So keep our own copies. */
@@ -90,7 +87,7 @@ gboolean mirage_fragment_chd_setup (
     self->priv->start_sector = start_sector;
     self->priv->num_sectors = num_sectors;
 
-    /* Allocate hunk buffer */
+    /* Hunks are decompressed into cache shared by all fragments */
     self->priv->hunk_size = hunk_size;
     self->priv->sector_size = sector_size;
     self->priv->sectors_in_hunk = hunk_size / sector_size;
@@ -101,13 +98,6 @@ gboolean mirage_fragment_chd_setup (
         return FALSE;
     }
 
-    self->priv->buffer = g_try_malloc0(self->priv->hunk_size);
-    if (!self->priv->buffer) {
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to allocate data buffer (%u bytes)!", __debug__, self->priv->hunk_size);
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, "Failed to allocate data buffer (%u bytes)!", self->priv->hunk_size);
-        return FALSE;
-    }
-
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: sectors per hunk: %u", __debug__, self->priv->sectors_in_hunk);
 
     /* Set fragment length */
@@ -146,31 +136,29 @@ gboolean mirage_fragment_chd_setup (
     return TRUE;
 }
 
-static gboolean mirage_fragment_chd_read_sector_data (MirageFragmentChd *self, gint address, GError **error)
+static gboolean mirage_fragment_chd_read_sector_data (MirageFragmentChd *self, gint address, guint offset, guint8 *buffer, guint length, GError **error)
 {
     guint64 chd_address;
     guint hunk_idx;
+    guint sector_index;
     chd_error status;
 
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: read sector data request for relative address %d", __debug__, address);
 
     /* Map the fragment-relative address into CHD address space, and
-     * compute target hunk index. */
+     * compute target hunk index and sector index inside hunk. */
     chd_address = self->priv->start_sector + address;
     hunk_idx = chd_address / self->priv->sectors_in_hunk;
+    sector_index = chd_address % self->priv->sectors_in_hunk;
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: fragment start offset inside CHD: %" G_GINT64_MODIFIER "u, target sector address inside CHD: %" G_GINT64_MODIFIER "u, hunk index: %u", __debug__, self->priv->start_sector, chd_address, hunk_idx);
 
-    /* Check if data is already in the buffer */
-    if (hunk_idx == self->priv->cached_hunk_idx) {
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: data for hunk %u is already loaded in buffer!", __debug__, hunk_idx);
-        return TRUE;
-    }
-
-    /* Read hunk */
-    status = chd_read(
-        self->priv->chd_file_ptr->chd_file,
+    /* Copy data out of (cached) hunk */
+    status = shared_chd_file_read_hunk_data(
+        self->priv->chd_file_ptr,
         hunk_idx,
-        self->priv->buffer
+        sector_index * self->priv->sector_size + offset,
+        buffer,
+        length
     );
     if (status != CHDERR_NONE) {
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to read data for hunk %u - chd_read() failed with error code %s (%d)", __debug__, hunk_idx, _chd_error_str(status), status);
@@ -178,9 +166,6 @@ static gboolean mirage_fragment_chd_read_sector_data (MirageFragmentChd *self, g
         return FALSE;
     }
 
-    /* Mark hunk as cached */
-    self->priv->cached_hunk_idx = hunk_idx;
-
     return TRUE;
 }
 
@@ -197,21 +182,11 @@ static gint mirage_fragment_chd_read_main_data_impl (MirageFragment *_self, gint
         return self->priv->main_size;
     }
 
-    /* Ensure sector data is available in cache */
-    if (!mirage_fragment_chd_read_sector_data(MIRAGE_FRAGMENT_CHD(_self), address, error)) {
-        return -1;
-    }
-
     /* Data */
-    guint offset = 0;
-    if (self->priv->sectors_in_hunk > 1) {
-        guint64 chd_address = self->priv->start_sector + address; /* Fragment-relative address to CHD-global address */
-        guint sector_index = chd_address % self->priv->sectors_in_hunk; /* Sector index inside hunk */
-        offset = sector_index * self->priv->sector_size; /* Sector address inside hunk */
+    if (!mirage_fragment_chd_read_sector_data(self, address, 0, buffer, self->priv->main_size, error)) {
+        return -1;
     }
 
-    memcpy(buffer, self->priv->buffer + offset, self->priv->main_size);
-
     /* Audio data may need to be swapped from BE to LE */
     if (self->priv->main_format == MIRAGE_MAIN_DATA_FORMAT_AUDIO_SWAP) {
         for (gint i = 0; i < self->priv->main_size; i += 2) {
@@ -238,26 +213,19 @@ static gint mirage_fragment_chd_read_subchannel_data_impl (MirageFragment *_self
         return 96;
     }
 
-    /* Ensure sector data is available in cache */
-    if (!mirage_fragment_chd_read_sector_data(MIRAGE_FRAGMENT_CHD(_self), address, error)) {
-        return -1;
-    }
-
     /* Data */
-    guint offset = 0;
-    if (self->priv->sectors_in_hunk > 1) {
-        guint64 chd_address = self->priv->start_sector + address; /* Fragment-relative address to CHD-global address */
-        guint sector_index = chd_address % self->priv->sectors_in_hunk; /* Sector index inside hunk */
-        offset = sector_index * self->priv->sector_size; /* Sector address inside hunk */
-    }
-    offset += self->priv->main_size;
-
     if (self->priv->subchannel_format & MIRAGE_SUBCHANNEL_DATA_FORMAT_Q16) {
         /* 16-byte Q; interleave it and pretend everything else's 0 */
-        mirage_helper_subchannel_interleave(SUBCHANNEL_Q, self->priv->buffer + offset, buffer);
+        guint8 q[16];
+        if (!mirage_fragment_chd_read_sector_data(self, address, self->priv->main_size, q, sizeof(q), error)) {
+            return -1;
+        }
+        mirage_helper_subchannel_interleave(SUBCHANNEL_Q, q, buffer);
     } else if (self->priv->subchannel_format & MIRAGE_SUBCHANNEL_DATA_FORMAT_PW96_INTERLEAVED) {
         /* 96-byte interleaved PW; just copy it */
-        memcpy(buffer, self->priv->buffer + offset, 96);
+        if (!mirage_fragment_chd_read_sector_data(self, address, self->priv->main_size, buffer, 96, error)) {
+            return -1;
+        }
     }
 
     return 96;
@@ -274,8 +242,6 @@ static void mirage_fragment_chd_init (MirageFragmentChd *self)
     self->priv->chd_file_ptr = NULL;
 
     self->priv->hunk_size = 0;
-    self->priv->buffer = NULL;
-    self->priv->cached_hunk_idx = -1;
 }
 
 static void mirage_fragment_chd_dispose (GObject *gobject)
@@ -291,23 +257,12 @@ static void mirage_fragment_chd_dispose (GObject *gobject)
     G_OBJECT_CLASS(mirage_fragment_chd_parent_class)->dispose(gobject);
 }
 
-static void mirage_fragment_chd_finalize (GObject *gobject)
-{
-    MirageFragmentChd *self = MIRAGE_FRAGMENT_CHD(gobject);
-
-    g_free(self->priv->buffer);
-
-    /* Chain up to the parent class */
-    G_OBJECT_CLASS(mirage_fragment_chd_parent_class)->finalize(gobject);
-}
-
 static void mirage_fragment_chd_class_init (MirageFragmentChdClass *klass)
 {
     GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
     MirageFragmentClass *fragment_class = MIRAGE_FRAGMENT_CLASS(klass);
 
     gobject_class->dispose = mirage_fragment_chd_dispose;
-    gobject_class->finalize = mirage_fragment_chd_finalize;
 
     fragment_class->read_main_data_impl = mirage_fragment_chd_read_main_data_impl;
     fragment_class->read_subchannel_data_impl = mirage_fragment_chd_read_subchannel_data_impl;
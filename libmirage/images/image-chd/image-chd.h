@@ -25,8 +25,14 @@
 #include <glib/gi18n-lib.h>
 
 #include <chd.h>
+#include <zlib.h>
+#ifdef HAVE_LIBLZMA
+#include <lzma.h>
+#endif
 
 #include "parser.h"
+#include "stream.h"
+#include "writer.h"
 
 
 G_BEGIN_DECLS
@@ -50,6 +56,24 @@ G_BEGIN_DECLS
 #endif
 
 
+/* Number of decompressed hunks kept in cache */
+#define CHD_HUNK_CACHE_SIZE 16
+
+typedef enum
+{
+    CHD_HUNK_EMPTY,
+    CHD_HUNK_LOADING,
+    CHD_HUNK_READY,
+} chd_hunk_state_t;
+
+typedef struct _chd_hunk_cache_entry_t
+{
+    guint32 hunk_idx;
+    chd_hunk_state_t state;
+    guint64 last_use;
+    guint8 *data;
+} chd_hunk_cache_entry_t;
+
 typedef struct _shared_chd_file_t
 {
     chd_file *chd_file;
@@ -59,10 +83,31 @@ typedef struct _shared_chd_file_t
 #if !defined(HAVE_NEW_IO_API)
     struct chd_core_file legacy_io_adapter;
 #endif
+
+    /* Cache of decompressed hunks, shared by all fragments of the
+     * image; least-recently used hunk is evicted first */
+    guint32 hunk_size;
+    guint32 hunk_count;
+    chd_hunk_cache_entry_t hunk_cache[CHD_HUNK_CACHE_SIZE];
+    guint64 hunk_cache_clock;
+    guint32 last_hunk_idx;
+
+    GMutex hunk_cache_mutex;
+    GCond hunk_cache_cond;
+
+    /* libchdr reader is not thread-safe */
+    GMutex read_mutex;
+
+    /* Decodes next hunk during sequential reads */
+    GThreadPool *prefetch_pool;
 } shared_chd_file_t;
 
+void shared_chd_file_init (shared_chd_file_t *p);
 void shared_chd_file_cleanup (shared_chd_file_t *p);
 
+void shared_chd_file_setup_hunk_cache (shared_chd_file_t *p, guint32 hunk_size, guint32 hunk_count);
+chd_error shared_chd_file_read_hunk_data (shared_chd_file_t *p, guint32 hunk_idx, guint32 offset, guint8 *buffer, guint32 length);
+
 const char *_chd_error_str (chd_error error_code);
 const char *_chd_tag_str (uint32_t tag);
 
@@ -274,13 +274,169 @@ static const struct chd_core_file_callbacks _chd_io_adapter = {
 #endif
 
 
+void shared_chd_file_init (shared_chd_file_t *p)
+{
+    g_mutex_init(&p->hunk_cache_mutex);
+    g_cond_init(&p->hunk_cache_cond);
+    g_mutex_init(&p->read_mutex);
+}
+
 /* Cleanup helper for shared_chd_file_t, to be used with g_rc_box_release_full() */
 void shared_chd_file_cleanup (shared_chd_file_t *p)
 {
+    /* Wait for prefetch in progress, which uses the reader */
+    if (p->prefetch_pool) {
+        g_thread_pool_free(p->prefetch_pool, TRUE, TRUE);
+        p->prefetch_pool = NULL;
+    }
+
     if (p->chd_file) {
         chd_close(p->chd_file);
         p->chd_file = NULL;
     }
+
+    for (gint i = 0; i < CHD_HUNK_CACHE_SIZE; i++) {
+        g_free(p->hunk_cache[i].data);
+        p->hunk_cache[i].data = NULL;
+    }
+
+    g_mutex_clear(&p->hunk_cache_mutex);
+    g_cond_clear(&p->hunk_cache_cond);
+    g_mutex_clear(&p->read_mutex);
+}
+
+
+/**********************************************************************\
+ *                          Shared hunk cache                         *
+\**********************************************************************/
+/* The following functions must be called with hunk cache mutex held */
+static chd_hunk_cache_entry_t *shared_chd_file_find_hunk (shared_chd_file_t *p, guint32 hunk_idx)
+{
+    for (gint i = 0; i < CHD_HUNK_CACHE_SIZE; i++) {
+        chd_hunk_cache_entry_t *entry = &p->hunk_cache[i];
+        if (entry->state != CHD_HUNK_EMPTY && entry->hunk_idx == hunk_idx) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static chd_hunk_cache_entry_t *shared_chd_file_claim_hunk (shared_chd_file_t *p, guint32 hunk_idx)
+{
+    chd_hunk_cache_entry_t *victim = NULL;
+
+    /* Least-recently used entry that is not being decoded; empty
+     * entries have zero last-use stamp, so they are taken first */
+    for (gint i = 0; i < CHD_HUNK_CACHE_SIZE; i++) {
+        chd_hunk_cache_entry_t *entry = &p->hunk_cache[i];
+        if (entry->state != CHD_HUNK_LOADING && (!victim || entry->last_use < victim->last_use)) {
+            victim = entry;
+        }
+    }
+
+    if (victim) {
+        victim->hunk_idx = hunk_idx;
+        victim->state = CHD_HUNK_LOADING;
+        victim->last_use = ++p->hunk_cache_clock;
+    }
+
+    return victim;
+}
+
+/* Called without hunk cache mutex held; entry must have been claimed */
+static chd_error shared_chd_file_decode_hunk (shared_chd_file_t *p, chd_hunk_cache_entry_t *entry)
+{
+    chd_error status;
+
+    g_mutex_lock(&p->read_mutex);
+    status = chd_read(p->chd_file, entry->hunk_idx, entry->data);
+    g_mutex_unlock(&p->read_mutex);
+
+    g_mutex_lock(&p->hunk_cache_mutex);
+    if (status == CHDERR_NONE) {
+        entry->state = CHD_HUNK_READY;
+    } else {
+        entry->state = CHD_HUNK_EMPTY;
+        entry->last_use = 0;
+    }
+    g_cond_broadcast(&p->hunk_cache_cond);
+    g_mutex_unlock(&p->hunk_cache_mutex);
+
+    return status;
+}
+
+static void shared_chd_file_prefetch_hunk (chd_hunk_cache_entry_t *entry, shared_chd_file_t *p)
+{
+    /* Errors are reported when the hunk is actually requested */
+    shared_chd_file_decode_hunk(p, entry);
+}
+
+void shared_chd_file_setup_hunk_cache (shared_chd_file_t *p, guint32 hunk_size, guint32 hunk_count)
+{
+    p->hunk_size = hunk_size;
+    p->hunk_count = hunk_count;
+
+    for (gint i = 0; i < CHD_HUNK_CACHE_SIZE; i++) {
+        p->hunk_cache[i].state = CHD_HUNK_EMPTY;
+        p->hunk_cache[i].last_use = 0;
+        p->hunk_cache[i].data = g_malloc(hunk_size);
+    }
+    p->hunk_cache_clock = 0;
+    p->last_hunk_idx = G_MAXUINT32;
+
+    /* Prefetch is an optimization; do without it if thread cannot be
+     * created */
+    p->prefetch_pool = g_thread_pool_new((GFunc)shared_chd_file_prefetch_hunk, p, 1, FALSE, NULL);
+}
+
+chd_error shared_chd_file_read_hunk_data (shared_chd_file_t *p, guint32 hunk_idx, guint32 offset, guint8 *buffer, guint32 length)
+{
+    chd_hunk_cache_entry_t *entry;
+    chd_error status;
+
+    g_mutex_lock(&p->hunk_cache_mutex);
+
+    for (;;) {
+        entry = shared_chd_file_find_hunk(p, hunk_idx);
+        if (entry && entry->state == CHD_HUNK_READY) {
+            break;
+        }
+
+        /* Hunk is being decoded (possibly by prefetch), or all entries
+         * are; wait for decoding to complete */
+        if (!entry) {
+            entry = shared_chd_file_claim_hunk(p, hunk_idx);
+            if (entry) {
+                g_mutex_unlock(&p->hunk_cache_mutex);
+                status = shared_chd_file_decode_hunk(p, entry);
+                if (status != CHDERR_NONE) {
+                    return status;
+                }
+                g_mutex_lock(&p->hunk_cache_mutex);
+                continue;
+            }
+        }
+
+        g_cond_wait(&p->hunk_cache_cond, &p->hunk_cache_mutex);
+    }
+
+    entry->last_use = ++p->hunk_cache_clock;
+    memcpy(buffer, entry->data + offset, length);
+
+    /* On sequential access, decode the next hunk in background while
+     * data from this one is being consumed */
+    if (p->prefetch_pool && hunk_idx == p->last_hunk_idx + 1 && hunk_idx + 1 < p->hunk_count && !shared_chd_file_find_hunk(p, hunk_idx + 1)) {
+        chd_hunk_cache_entry_t *next_entry = shared_chd_file_claim_hunk(p, hunk_idx + 1);
+        if (next_entry) {
+            g_thread_pool_push(p->prefetch_pool, next_entry, NULL);
+        }
+    }
+    p->last_hunk_idx = hunk_idx;
+
+    g_mutex_unlock(&p->hunk_cache_mutex);
+
+    return CHDERR_NONE;
 }
 
 
@@ -845,6 +1001,9 @@ static MirageDisc *mirage_parser_chd_load_image (MirageParser *_self, MirageStre
     /* Grab header */
     header = chd_get_header(self->priv->chd_file_ptr->chd_file);
 
+    /* Hunk cache, shared by fragments */
+    shared_chd_file_setup_hunk_cache(self->priv->chd_file_ptr, header->hunkbytes, header->hunkcount);
+
     /* Dump header */
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: CHD header:", __debug__);
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s:  length: %u", __debug__, header->length);
@@ -985,6 +1144,7 @@ static void mirage_parser_chd_init (MirageParserChd *self)
 
     /* Allocate box structure for libchdr file reader object */
     self->priv->chd_file_ptr = g_rc_box_new0(shared_chd_file_t);
+    shared_chd_file_init(self->priv->chd_file_ptr);
 
     /* If using legacy I/O API, also initialize methods of the I/O
      * adapter */
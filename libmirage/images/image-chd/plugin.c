@@ -28,6 +28,7 @@ G_MODULE_EXPORT guint mirage_plugin_soversion_minor = MIRAGE_SOVERSION_MINOR;
 G_MODULE_EXPORT void mirage_plugin_load_plugin (MiragePlugin *plugin)
 {
     mirage_parser_chd_type_register(G_TYPE_MODULE(plugin));
+    mirage_writer_chd_type_register(G_TYPE_MODULE(plugin));
 }
 
 G_MODULE_EXPORT void mirage_plugin_unload_plugin (MiragePlugin *plugin G_GNUC_UNUSED)
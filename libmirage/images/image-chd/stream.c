@@ -0,0 +1,981 @@
+/*
+ *  libMirage: CHD image: compressed output stream
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "image-chd.h"
+
+#define __debug__ "CHD-Stream"
+
+
+/* Compression types of hunks in the V5 map */
+#define CHD_MAP_TYPE_NONE       4
+#define CHD_MAP_TYPE_RLE_SMALL  7
+#define CHD_MAP_TYPE_RLE_LARGE  8
+
+#define CHD_MAP_HEADER_SIZE     16
+#define CHD_MAP_ENTRY_SIZE      12
+#define CHD_METADATA_ENTRY_SIZE 24
+
+/* libchdr sets up its LZMA decoder with level 9 properties for the
+ * sector data of a hunk; for 8*2352 bytes, this gives 24 kB dictionary */
+#define CHD_LZMA_DICT_SIZE      24576
+
+static const guint8 chd_signature[8] = { 'M', 'C', 'o', 'm', 'p', 'r', 'H', 'D' };
+
+
+typedef struct
+{
+    guint8 *data; /* Uncompressed hunk */
+
+    guint8 *output; /* Compressed (or raw) hunk */
+    gsize output_size;
+    guint8 type;
+    guint16 crc;
+} CHD_Job;
+
+typedef struct
+{
+    guint8 type;
+    guint32 length;
+    guint16 crc;
+} CHD_MapEntry;
+
+typedef struct
+{
+    guint32 tag;
+    guint8 flags;
+    GBytes *data;
+} CHD_Metadata;
+
+typedef struct
+{
+    GByteArray *bytes;
+    guint8 current;
+    gint num_bits;
+} CHD_BitWriter;
+
+
+/**********************************************************************\
+ *                  Object and its private structure                  *
+\**********************************************************************/
+struct _MirageStreamChdPrivate
+{
+    /* Underlying file stream */
+    MirageStream *stream;
+
+    guint32 codecs[4];
+    gint num_codecs;
+    gboolean write_subchannel;
+
+    gboolean write_mode;
+    gboolean write_failed;
+
+    goffset position;
+    goffset end_position;
+
+    /* Hunk being filled */
+    guint8 *hunk_buffer;
+    goffset hunk_offset;
+    gsize hunk_fill;
+
+    /* Hunks written so far; they are stored back-to-back after the
+     * header, in hunk order */
+    GArray *map;
+    guint64 data_offset;
+
+    GChecksum *raw_sha1;
+    GList *metadata;
+
+    /* Parallel compression */
+    MirageJobQueue *job_queue;
+};
+
+
+static void mirage_stream_chd_stream_init (MirageStreamInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(
+    MirageStreamChd,
+    mirage_stream_chd,
+    MIRAGE_TYPE_OBJECT,
+    G_IMPLEMENT_INTERFACE(MIRAGE_TYPE_STREAM, mirage_stream_chd_stream_init)
+    G_ADD_PRIVATE(MirageStreamChd)
+)
+
+
+/**********************************************************************\
+ *                          Helper functions                          *
+\**********************************************************************/
+static inline void chd_put_be16 (guint8 *buffer, guint16 value)
+{
+    buffer[0] = value >> 8;
+    buffer[1] = value;
+}
+
+static inline void chd_put_be24 (guint8 *buffer, guint32 value)
+{
+    buffer[0] = value >> 16;
+    buffer[1] = value >> 8;
+    buffer[2] = value;
+}
+
+static inline void chd_put_be32 (guint8 *buffer, guint32 value)
+{
+    buffer[0] = value >> 24;
+    buffer[1] = value >> 16;
+    buffer[2] = value >> 8;
+    buffer[3] = value;
+}
+
+static inline void chd_put_be48 (guint8 *buffer, guint64 value)
+{
+    chd_put_be16(buffer, value >> 32);
+    chd_put_be32(buffer + 2, value);
+}
+
+static inline void chd_put_be64 (guint8 *buffer, guint64 value)
+{
+    chd_put_be32(buffer, value >> 32);
+    chd_put_be32(buffer + 4, value);
+}
+
+static guint16 chd_crc16 (const guint8 *data, gsize length)
+{
+    /* CRC-16/CCITT with initial value of 0xFFFF, as used by CHD */
+    guint16 crc = 0xFFFF;
+
+    while (length--) {
+        crc = (crc << 8) ^ crc16_1021_lut[(crc >> 8) ^ *data++];
+    }
+
+    return crc;
+}
+
+static void chd_bit_writer_put (CHD_BitWriter *writer, guint32 value, gint num_bits)
+{
+    /* Most significant bit first */
+    while (num_bits--) {
+        writer->current = (writer->current << 1) | ((value >> num_bits) & 1);
+        if (++writer->num_bits == 8) {
+            g_byte_array_append(writer->bytes, &writer->current, 1);
+            writer->current = 0;
+            writer->num_bits = 0;
+        }
+    }
+}
+
+static void chd_bit_writer_flush (CHD_BitWriter *writer)
+{
+    if (writer->num_bits) {
+        chd_bit_writer_put(writer, 0, 8 - writer->num_bits);
+    }
+}
+
+static void chd_metadata_free (CHD_Metadata *metadata)
+{
+    g_bytes_unref(metadata->data);
+    g_free(metadata);
+}
+
+
+/**********************************************************************\
+ *                          Hunk compression                          *
+\**********************************************************************/
+static gboolean mirage_stream_chd_deflate (const guint8 *data, gsize data_size, guint8 *dest, gsize dest_capacity, gsize *dest_size)
+{
+    z_stream zlib_stream;
+    gint ret;
+
+    memset(&zlib_stream, 0, sizeof(zlib_stream));
+
+    ret = deflateInit2(&zlib_stream, Z_BEST_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) {
+        return FALSE;
+    }
+
+    zlib_stream.next_in = (Bytef *)data;
+    zlib_stream.avail_in = data_size;
+    zlib_stream.next_out = dest;
+    zlib_stream.avail_out = dest_capacity;
+
+    ret = deflate(&zlib_stream, Z_FINISH);
+    *dest_size = zlib_stream.total_out;
+    deflateEnd(&zlib_stream);
+
+    /* Anything but end of stream means that output did not fit */
+    return ret == Z_STREAM_END;
+}
+
+#ifdef HAVE_LIBLZMA
+static gboolean mirage_stream_chd_lzma (const guint8 *data, gsize data_size, guint8 *dest, gsize dest_capacity, gsize *dest_size)
+{
+    lzma_stream lzma = LZMA_STREAM_INIT;
+    lzma_options_lzma options;
+    lzma_filter filters[2];
+    lzma_ret ret;
+
+    if (lzma_lzma_preset(&options, 9)) {
+        return FALSE;
+    }
+    options.dict_size = CHD_LZMA_DICT_SIZE;
+
+    /* libchdr expects raw LZMA data without end marker; the encoder
+     * omits it when it is given the uncompressed size */
+    options.ext_flags = 0;
+    options.ext_size_low = data_size;
+    options.ext_size_high = 0;
+
+    filters[0].id = LZMA_FILTER_LZMA1EXT;
+    filters[0].options = &options;
+    filters[1].id = LZMA_VLI_UNKNOWN;
+    filters[1].options = NULL;
+
+    if (lzma_raw_encoder(&lzma, filters) != LZMA_OK) {
+        return FALSE;
+    }
+
+    lzma.next_in = data;
+    lzma.avail_in = data_size;
+    lzma.next_out = dest;
+    lzma.avail_out = dest_capacity;
+
+    ret = lzma_code(&lzma, LZMA_FINISH);
+    *dest_size = lzma.total_out;
+    lzma_end(&lzma);
+
+    return ret == LZMA_STREAM_END;
+}
+#endif
+
+static gboolean mirage_stream_chd_sector_has_ecc (const guint8 *sector)
+{
+    guint8 ecc_p[172];
+    guint8 ecc_q[104];
+
+    if (memcmp(sector, mirage_pattern_sync, sizeof(mirage_pattern_sync))) {
+        return FALSE;
+    }
+
+    /* The decoder regenerates ECC over header and data, the way it is
+     * done for Mode 1 sectors */
+    mirage_helper_sector_edc_ecc_compute_ecc_block(sector+0x00C, 86, 24, 2, 86, ecc_p); /* P */
+    mirage_helper_sector_edc_ecc_compute_ecc_block(sector+0x00C, 52, 43, 86, 88, ecc_q); /* Q */
+
+    return !memcmp(ecc_p, sector+0x81C, sizeof(ecc_p)) && !memcmp(ecc_q, sector+0x8C8, sizeof(ecc_q));
+}
+
+static gboolean mirage_stream_chd_compress_cd (const guint8 *hunk, guint32 codec, guint8 *dest, gsize *dest_size)
+{
+    /* Hunk header: bitmap of sectors with stripped sync pattern and ECC,
+     * followed by the length of compressed sector data; the length is
+     * 16-bit, as hunks are smaller than 64 kB */
+    const gsize ecc_bytes = (CHD_CD_FRAMES_PER_HUNK + 7) / 8;
+    const gsize header_bytes = ecc_bytes + 2;
+
+    guint8 sectors[CHD_CD_FRAMES_PER_HUNK*CHD_CD_SECTOR_SIZE];
+    guint8 subcode[CHD_CD_FRAMES_PER_HUNK*CHD_CD_SUBCODE_SIZE];
+    gsize base_size;
+    gsize subcode_size;
+    gboolean succeeded;
+
+    memset(dest, 0, header_bytes);
+
+    /* Split sector data and subcode */
+    for (gint i = 0; i < CHD_CD_FRAMES_PER_HUNK; i++) {
+        const guint8 *frame = hunk + i*CHD_CD_FRAME_SIZE;
+        guint8 *sector = sectors + i*CHD_CD_SECTOR_SIZE;
+
+        memcpy(sector, frame, CHD_CD_SECTOR_SIZE);
+        memcpy(subcode + i*CHD_CD_SUBCODE_SIZE, frame + CHD_CD_SECTOR_SIZE, CHD_CD_SUBCODE_SIZE);
+
+        if (mirage_stream_chd_sector_has_ecc(sector)) {
+            dest[i/8] |= 1 << (i%8);
+            memset(sector, 0, sizeof(mirage_pattern_sync));
+            memset(sector+0x81C, 0, 172 + 104);
+        }
+    }
+
+    /* Sector data with the selected codec */
+    switch (codec) {
+        case CHD_CODEC_CD_ZLIB: {
+            succeeded = mirage_stream_chd_deflate(sectors, sizeof(sectors), dest + header_bytes, CHD_CD_HUNK_SIZE - header_bytes, &base_size);
+            break;
+        }
+#ifdef HAVE_LIBLZMA
+        case CHD_CODEC_CD_LZMA: {
+            succeeded = mirage_stream_chd_lzma(sectors, sizeof(sectors), dest + header_bytes, CHD_CD_HUNK_SIZE - header_bytes, &base_size);
+            break;
+        }
+#endif
+        default: {
+            succeeded = FALSE;
+            break;
+        }
+    }
+
+    if (!succeeded) {
+        return FALSE;
+    }
+
+    chd_put_be16(dest + ecc_bytes, base_size);
+
+    /* Subcode is always deflated */
+    if (!mirage_stream_chd_deflate(subcode, sizeof(subcode), dest + header_bytes + base_size, CHD_CD_HUNK_SIZE - header_bytes - base_size, &subcode_size)) {
+        return FALSE;
+    }
+
+    *dest_size = header_bytes + base_size + subcode_size;
+    return TRUE;
+}
+
+static void mirage_stream_chd_free_job (CHD_Job *job)
+{
+    g_free(job->data);
+    g_free(job->output);
+    g_free(job);
+}
+
+static gboolean mirage_stream_chd_compress_job (CHD_Job *job, MirageStreamChd *self)
+{
+    guint8 *candidate = g_malloc(CHD_CD_HUNK_SIZE);
+    gsize candidate_size;
+
+    job->crc = chd_crc16(job->data, CHD_CD_HUNK_SIZE);
+    job->type = CHD_MAP_TYPE_NONE;
+    job->output_size = CHD_CD_HUNK_SIZE;
+
+    /* Try all codecs and keep the smallest result */
+    for (gint i = 0; i < self->priv->num_codecs; i++) {
+        if (mirage_stream_chd_compress_cd(job->data, self->priv->codecs[i], candidate, &candidate_size) && candidate_size < job->output_size) {
+            guint8 *tmp = job->output;
+
+            job->output = candidate;
+            job->output_size = candidate_size;
+            job->type = i;
+
+            candidate = tmp ? tmp : g_malloc(CHD_CD_HUNK_SIZE);
+        }
+    }
+    g_free(candidate);
+
+    /* Hunks that cannot be compressed are stored as they are */
+    if (job->type == CHD_MAP_TYPE_NONE) {
+        job->output = job->data;
+    } else {
+        g_free(job->data);
+    }
+    job->data = NULL;
+
+    return TRUE;
+}
+
+static gboolean mirage_stream_chd_write_data (MirageStreamChd *self, const guint8 *data, gsize size)
+{
+    if (mirage_stream_write(self->priv->stream, data, size, NULL) != (gssize)size) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to write %" G_GSIZE_MODIFIER "d bytes to underlying stream!", __debug__, size);
+        self->priv->write_failed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean mirage_stream_chd_complete_job (CHD_Job *job, MirageStreamChd *self)
+{
+    CHD_MapEntry entry = { job->type, job->output_size, job->crc };
+
+    /* Compressed hunks are completed in stream order */
+    if (!mirage_stream_chd_write_data(self, job->output, job->output_size)) {
+        return FALSE;
+    }
+
+    g_array_append_val(self->priv->map, entry);
+    self->priv->data_offset += job->output_size;
+
+    return TRUE;
+}
+
+static gboolean mirage_stream_chd_submit_hunk (MirageStreamChd *self, gsize logical_size)
+{
+    CHD_Job *job = g_new0(CHD_Job, 1);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: submitting hunk %d at offset %" G_GOFFSET_MODIFIER "d", __debug__, (gint)(self->priv->hunk_offset / CHD_CD_HUNK_SIZE), self->priv->hunk_offset);
+
+    /* Clear subcode if we are not supposed to store it */
+    if (!self->priv->write_subchannel) {
+        for (gint i = 0; i < CHD_CD_FRAMES_PER_HUNK; i++) {
+            memset(self->priv->hunk_buffer + i*CHD_CD_FRAME_SIZE + CHD_CD_SECTOR_SIZE, 0, CHD_CD_SUBCODE_SIZE);
+        }
+    }
+
+    /* Raw SHA-1 covers the logical data only, without padding of the
+     * last hunk */
+    g_checksum_update(self->priv->raw_sha1, self->priv->hunk_buffer, logical_size);
+
+    /* Job takes over the hunk buffer */
+    job->data = self->priv->hunk_buffer;
+
+    self->priv->hunk_buffer = g_malloc0(CHD_CD_HUNK_SIZE);
+    self->priv->hunk_offset += CHD_CD_HUNK_SIZE;
+    self->priv->hunk_fill = 0;
+
+    if (!mirage_helper_job_queue_push(self->priv->job_queue, job)) {
+        self->priv->write_failed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void mirage_stream_chd_stop (MirageStreamChd *self)
+{
+    if (!self->priv->write_mode) {
+        return;
+    }
+
+    mirage_helper_job_queue_free(self->priv->job_queue);
+    self->priv->job_queue = NULL;
+
+    self->priv->write_mode = FALSE;
+}
+
+
+/**********************************************************************\
+ *                        Map, metadata, header                       *
+\**********************************************************************/
+static gboolean mirage_stream_chd_write_map (MirageStreamChd *self)
+{
+    const CHD_MapEntry *entries = (const CHD_MapEntry *)self->priv->map->data;
+    guint num_hunks = self->priv->map->len;
+
+    guint8 *raw_map = g_malloc(num_hunks * CHD_MAP_ENTRY_SIZE);
+    guint8 header[CHD_MAP_HEADER_SIZE] = { 0 };
+    guint64 offset = CHD_V5_HEADER_SIZE;
+    guint32 max_length = 0;
+    gint length_bits = 0;
+    gboolean succeeded;
+
+    CHD_BitWriter writer = { g_byte_array_new(), 0, 0 };
+
+    /* Raw map, which the map CRC is computed over */
+    for (guint i = 0; i < num_hunks; i++) {
+        guint8 *raw_entry = raw_map + i*CHD_MAP_ENTRY_SIZE;
+
+        raw_entry[0] = entries[i].type;
+        chd_put_be24(raw_entry + 1, entries[i].length);
+        chd_put_be48(raw_entry + 4, offset);
+        chd_put_be16(raw_entry + 10, entries[i].crc);
+
+        offset += entries[i].length;
+
+        if (entries[i].type < CHD_MAP_TYPE_NONE) {
+            max_length = MAX(max_length, entries[i].length);
+        }
+    }
+
+    while (max_length >> length_bits) {
+        length_bits++;
+    }
+
+    /* Huffman tree for compression types; all 16 codes are 4 bits long,
+     * which makes each code equal to its symbol */
+    for (gint i = 0; i < 16; i++) {
+        chd_bit_writer_put(&writer, 4, 4);
+    }
+
+    /* Compression types, run-length encoded */
+    guint8 last_type = 0;
+    for (guint i = 0; i < num_hunks; ) {
+        guint8 type = entries[i].type;
+        guint run = 1;
+
+        while (i + run < num_hunks && entries[i + run].type == type) {
+            run++;
+        }
+        i += run;
+
+        if (type != last_type) {
+            chd_bit_writer_put(&writer, type, 4);
+            last_type = type;
+            run--;
+        }
+
+        while (run) {
+            if (run >= 19) {
+                guint repeat = MIN(run, 19 + 255);
+                chd_bit_writer_put(&writer, CHD_MAP_TYPE_RLE_LARGE, 4);
+                chd_bit_writer_put(&writer, (repeat - 19) >> 4, 4);
+                chd_bit_writer_put(&writer, (repeat - 19) & 0xF, 4);
+                run -= repeat;
+            } else if (run >= 3) {
+                chd_bit_writer_put(&writer, CHD_MAP_TYPE_RLE_SMALL, 4);
+                chd_bit_writer_put(&writer, run - 3, 4);
+                run = 0;
+            } else {
+                chd_bit_writer_put(&writer, type, 4);
+                run--;
+            }
+        }
+    }
+
+    /* Lengths and CRCs; offsets follow from the lengths */
+    for (guint i = 0; i < num_hunks; i++) {
+        if (entries[i].type < CHD_MAP_TYPE_NONE) {
+            chd_bit_writer_put(&writer, entries[i].length, length_bits);
+        }
+        chd_bit_writer_put(&writer, entries[i].crc, 16);
+    }
+    chd_bit_writer_flush(&writer);
+
+    /* Map header */
+    chd_put_be32(header + 0, writer.bytes->len);
+    chd_put_be48(header + 4, CHD_V5_HEADER_SIZE);
+    chd_put_be16(header + 10, chd_crc16(raw_map, num_hunks * CHD_MAP_ENTRY_SIZE));
+    header[12] = length_bits;
+    header[13] = 0; /* Self-reference bits */
+    header[14] = 0; /* Parent-reference bits */
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: writing map for %d hunks at offset %" G_GINT64_MODIFIER "d (%d bytes)", __debug__, num_hunks, self->priv->data_offset, writer.bytes->len);
+
+    succeeded = mirage_stream_chd_write_data(self, header, sizeof(header)) && mirage_stream_chd_write_data(self, writer.bytes->data, writer.bytes->len);
+
+    g_byte_array_unref(writer.bytes);
+    g_free(raw_map);
+
+    return succeeded;
+}
+
+static gboolean mirage_stream_chd_write_metadata (MirageStreamChd *self, guint64 offset)
+{
+    for (GList *iter = self->priv->metadata; iter; iter = iter->next) {
+        const CHD_Metadata *metadata = iter->data;
+        gsize size;
+        const guint8 *data = g_bytes_get_data(metadata->data, &size);
+        guint8 header[16];
+
+        offset += sizeof(header) + size;
+
+        chd_put_be32(header + 0, metadata->tag);
+        header[4] = metadata->flags;
+        chd_put_be24(header + 5, size);
+        chd_put_be64(header + 8, iter->next ? offset : 0); /* Next entry */
+
+        if (!mirage_stream_chd_write_data(self, header, sizeof(header)) || !mirage_stream_chd_write_data(self, data, size)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static gint chd_compare_metadata_hash (gconstpointer a, gconstpointer b)
+{
+    return memcmp(a, b, CHD_METADATA_ENTRY_SIZE);
+}
+
+static void mirage_stream_chd_compute_sha1 (MirageStreamChd *self, guint8 *raw_sha1, guint8 *sha1)
+{
+    GChecksum *checksum;
+    guint num_entries = 0;
+    guint8 *entries;
+    gsize digest_size;
+
+    digest_size = 20;
+    g_checksum_get_digest(self->priv->raw_sha1, raw_sha1, &digest_size);
+
+    /* Overall SHA-1 additionally covers checksummed metadata; entries
+     * of tag and SHA-1 of data are sorted before hashing */
+    entries = g_malloc0(g_list_length(self->priv->metadata) * CHD_METADATA_ENTRY_SIZE);
+
+    for (GList *iter = self->priv->metadata; iter; iter = iter->next) {
+        const CHD_Metadata *metadata = iter->data;
+        guint8 *entry = entries + num_entries*CHD_METADATA_ENTRY_SIZE;
+        gsize size;
+        const guint8 *data = g_bytes_get_data(metadata->data, &size);
+
+        if (!(metadata->flags & CHD_MDFLAGS_CHECKSUM)) {
+            continue;
+        }
+
+        chd_put_be32(entry, metadata->tag);
+
+        checksum = g_checksum_new(G_CHECKSUM_SHA1);
+        g_checksum_update(checksum, data, size);
+        digest_size = 20;
+        g_checksum_get_digest(checksum, entry + 4, &digest_size);
+        g_checksum_free(checksum);
+
+        num_entries++;
+    }
+
+    qsort(entries, num_entries, CHD_METADATA_ENTRY_SIZE, chd_compare_metadata_hash);
+
+    checksum = g_checksum_new(G_CHECKSUM_SHA1);
+    g_checksum_update(checksum, raw_sha1, 20);
+    g_checksum_update(checksum, entries, num_entries * CHD_METADATA_ENTRY_SIZE);
+    digest_size = 20;
+    g_checksum_get_digest(checksum, sha1, &digest_size);
+    g_checksum_free(checksum);
+
+    g_free(entries);
+}
+
+
+/**********************************************************************\
+ *                             Public API                             *
+\**********************************************************************/
+gboolean mirage_stream_chd_open (MirageStreamChd *self, MirageStream *stream, const guint32 *codecs, gint num_codecs, gboolean write_subchannel, GError **error)
+{
+    gint num_threads = MAX(g_get_num_processors(), 1);
+    guint8 header[CHD_V5_HEADER_SIZE] = { 0 };
+
+    if (num_codecs < 1 || num_codecs > 4) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Invalid number of compression codecs!"));
+        return FALSE;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: creating CHD stream; %d codec(s), %d compression thread(s)", __debug__, num_codecs, num_threads);
+
+    self->priv->stream = g_object_ref(stream);
+
+    memcpy(self->priv->codecs, codecs, num_codecs * sizeof(guint32));
+    self->priv->num_codecs = num_codecs;
+    self->priv->write_subchannel = write_subchannel;
+
+    /* Header is written when image is finished; reserve space for it,
+     * so that hunks can be written out as they are compressed */
+    if (!mirage_stream_seek(stream, 0, G_SEEK_SET, NULL) || mirage_stream_write(stream, header, sizeof(header), NULL) != (gssize)sizeof(header)) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write CHD header!"));
+        return FALSE;
+    }
+    self->priv->data_offset = sizeof(header);
+
+    /* Hunks are small, so we can afford more of them in flight */
+    self->priv->job_queue = mirage_helper_job_queue_new((MirageJobFunc)mirage_stream_chd_compress_job, (MirageJobFunc)mirage_stream_chd_complete_job, (GDestroyNotify)mirage_stream_chd_free_job, self, num_threads, 4*num_threads, error);
+    if (!self->priv->job_queue) {
+        return FALSE;
+    }
+
+    self->priv->map = g_array_new(FALSE, FALSE, sizeof(CHD_MapEntry));
+    self->priv->raw_sha1 = g_checksum_new(G_CHECKSUM_SHA1);
+
+    self->priv->hunk_buffer = g_malloc0(CHD_CD_HUNK_SIZE);
+    self->priv->hunk_offset = 0;
+    self->priv->hunk_fill = 0;
+
+    self->priv->position = 0;
+    self->priv->end_position = 0;
+
+    self->priv->write_mode = TRUE;
+
+    return TRUE;
+}
+
+void mirage_stream_chd_add_metadata (MirageStreamChd *self, guint32 tag, guint8 flags, const guint8 *data, gsize size)
+{
+    CHD_Metadata *metadata = g_new0(CHD_Metadata, 1);
+
+    metadata->tag = tag;
+    metadata->flags = flags;
+    metadata->data = g_bytes_new(data, size);
+
+    self->priv->metadata = g_list_append(self->priv->metadata, metadata);
+}
+
+gboolean mirage_stream_chd_finish (MirageStreamChd *self, guint64 logical_bytes, GError **error)
+{
+    guint8 header[CHD_V5_HEADER_SIZE] = { 0 };
+    guint64 map_offset;
+    guint64 metadata_offset;
+
+    if (!self->priv->write_mode) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Stream is not open for writing!"));
+        return FALSE;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: finishing CHD stream; %" G_GINT64_MODIFIER "d logical bytes", __debug__, logical_bytes);
+
+    if (self->priv->end_position > (goffset)logical_bytes) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: %" G_GOFFSET_MODIFIER "d bytes written past the end of logical data are discarded!", __debug__, self->priv->end_position - logical_bytes);
+    }
+
+    /* Submit remaining hunks, zero-padding the last one */
+    while (!self->priv->write_failed && self->priv->hunk_offset < (goffset)logical_bytes) {
+        mirage_stream_chd_submit_hunk(self, MIN(CHD_CD_HUNK_SIZE, logical_bytes - self->priv->hunk_offset));
+    }
+    if (!mirage_helper_job_queue_wait(self->priv->job_queue)) {
+        self->priv->write_failed = TRUE;
+    }
+    mirage_stream_chd_stop(self);
+
+    if (self->priv->write_failed) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write compressed hunks!"));
+        return FALSE;
+    }
+
+    /* Map and metadata follow the hunks */
+    map_offset = self->priv->data_offset;
+    if (!mirage_stream_chd_write_map(self)) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write CHD map!"));
+        return FALSE;
+    }
+
+    metadata_offset = self->priv->metadata ? (guint64)mirage_stream_tell(self->priv->stream) : 0;
+    if (!mirage_stream_chd_write_metadata(self, metadata_offset)) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write CHD metadata!"));
+        return FALSE;
+    }
+
+    /* Header */
+    memcpy(header, chd_signature, sizeof(chd_signature));
+    chd_put_be32(header + 8, CHD_V5_HEADER_SIZE);
+    chd_put_be32(header + 12, 5); /* Version */
+    for (gint i = 0; i < self->priv->num_codecs; i++) {
+        chd_put_be32(header + 16 + i*4, self->priv->codecs[i]);
+    }
+    chd_put_be64(header + 32, logical_bytes);
+    chd_put_be64(header + 40, map_offset);
+    chd_put_be64(header + 48, metadata_offset);
+    chd_put_be32(header + 56, CHD_CD_HUNK_SIZE);
+    chd_put_be32(header + 60, CHD_CD_FRAME_SIZE);
+    mirage_stream_chd_compute_sha1(self, header + 64, header + 84);
+    /* Parent SHA-1 remains zero */
+
+    if (!mirage_stream_seek(self->priv->stream, 0, G_SEEK_SET, NULL) || !mirage_stream_chd_write_data(self, header, sizeof(header))) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write CHD header!"));
+        return FALSE;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_STREAM, "%s: CHD stream finished; %d hunks, map at %" G_GINT64_MODIFIER "d, metadata at %" G_GINT64_MODIFIER "d", __debug__, self->priv->map->len, map_offset, metadata_offset);
+
+    return TRUE;
+}
+
+
+/**********************************************************************\
+ *                MirageStream methods implementations                *
+\**********************************************************************/
+static const gchar *mirage_stream_chd_get_filename (MirageStream *_self)
+{
+    MirageStreamChd *self = MIRAGE_STREAM_CHD(_self);
+    return self->priv->stream ? mirage_stream_get_filename(self->priv->stream) : NULL;
+}
+
+static gboolean mirage_stream_chd_is_writable (MirageStream *_self)
+{
+    MirageStreamChd *self = MIRAGE_STREAM_CHD(_self);
+    return self->priv->write_mode;
+}
+
+static gboolean mirage_stream_chd_move_file (MirageStream *_self, const gchar *new_filename, GError **error)
+{
+    MirageStreamChd *self = MIRAGE_STREAM_CHD(_self);
+
+    if (!self->priv->stream) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Cannot move file for non-writable stream!"));
+        return FALSE;
+    }
+
+    return mirage_stream_move_file(self->priv->stream, new_filename, error);
+}
+
+static gssize mirage_stream_chd_read (MirageStream *_self, void *buffer G_GNUC_UNUSED, gsize count G_GNUC_UNUSED, GError **error)
+{
+    MirageStreamChd *self = MIRAGE_STREAM_CHD(_self);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: reading is not supported!", __debug__);
+    g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Reading from CHD output stream is not supported!"));
+
+    return -1;
+}
+
+static gssize mirage_stream_chd_write (MirageStream *_self, const void *buffer, gsize count, GError **error)
+{
+    MirageStreamChd *self = MIRAGE_STREAM_CHD(_self);
+    const guint8 *data = buffer;
+    gsize written = 0;
+
+    if (!self->priv->write_mode || self->priv->write_failed) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Stream is not open for writing!"));
+        return -1;
+    }
+
+    while (written < count) {
+        goffset position = self->priv->position;
+        gsize hunk_position;
+        gsize chunk_size;
+
+        /* Data that has already been handed over for compression cannot
+         * be changed anymore; only the hunk being filled can be */
+        if (position < self->priv->hunk_offset) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: cannot write at position %" G_GOFFSET_MODIFIER "d; data up to %" G_GOFFSET_MODIFIER "d has already been compressed!", __debug__, position, self->priv->hunk_offset);
+            g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Cannot write to already compressed part of stream!"));
+            return -1;
+        }
+
+        /* Writing beyond the current hunk; zero-fill and submit it */
+        if (position >= self->priv->hunk_offset + CHD_CD_HUNK_SIZE) {
+            memset(self->priv->hunk_buffer + self->priv->hunk_fill, 0, CHD_CD_HUNK_SIZE - self->priv->hunk_fill);
+            self->priv->hunk_fill = CHD_CD_HUNK_SIZE;
+            if (!mirage_stream_chd_submit_hunk(self, CHD_CD_HUNK_SIZE)) {
+                g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write compressed hunks!"));
+                return -1;
+            }
+            continue;
+        }
+
+        /* Copy data into hunk; hunk buffer starts zeroed, so gaps are
+         * zero-filled */
+        hunk_position = position - self->priv->hunk_offset;
+        chunk_size = MIN(count - written, CHD_CD_HUNK_SIZE - hunk_position);
+
+        memcpy(self->priv->hunk_buffer + hunk_position, data + written, chunk_size);
+        self->priv->hunk_fill = MAX(self->priv->hunk_fill, hunk_position + chunk_size);
+
+        written += chunk_size;
+        self->priv->position += chunk_size;
+        self->priv->end_position = MAX(self->priv->end_position, self->priv->position);
+
+        /* Submit full hunk */
+        if (self->priv->hunk_fill == CHD_CD_HUNK_SIZE) {
+            if (!mirage_stream_chd_submit_hunk(self, CHD_CD_HUNK_SIZE)) {
+                g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Failed to write compressed hunks!"));
+                return -1;
+            }
+        }
+    }
+
+    return written;
+}
+
+static gboolean mirage_stream_chd_seek (MirageStream *_self, goffset offset, GSeekType type, GError **error)
+{
+    MirageStreamChd *self = MIRAGE_STREAM_CHD(_self);
+    goffset new_position;
+
+    switch (type) {
+        case G_SEEK_SET: {
+            new_position = offset;
+            break;
+        }
+        case G_SEEK_CUR: {
+            new_position = self->priv->position + offset;
+            break;
+        }
+        case G_SEEK_END: {
+            new_position = self->priv->end_position + offset;
+            break;
+        }
+        default: {
+            g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Invalid seek type!"));
+            return FALSE;
+        }
+    }
+
+    if (new_position < 0) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_STREAM_ERROR, Q_("Seek before beginning of stream!"));
+        return FALSE;
+    }
+
+    self->priv->position = new_position;
+
+    return TRUE;
+}
+
+static goffset mirage_stream_chd_tell (MirageStream *_self)
+{
+    MirageStreamChd *self = MIRAGE_STREAM_CHD(_self);
+    return self->priv->position;
+}
+
+
+/**********************************************************************\
+ *                             Object init                            *
+\**********************************************************************/
+static void mirage_stream_chd_init (MirageStreamChd *self)
+{
+    self->priv = mirage_stream_chd_get_instance_private(self);
+
+    self->priv->stream = NULL;
+
+    self->priv->num_codecs = 0;
+    self->priv->write_subchannel = FALSE;
+
+    self->priv->write_mode = FALSE;
+    self->priv->write_failed = FALSE;
+
+    self->priv->hunk_buffer = NULL;
+    self->priv->map = NULL;
+    self->priv->raw_sha1 = NULL;
+    self->priv->metadata = NULL;
+
+    self->priv->job_queue = NULL;
+}
+
+static void mirage_stream_chd_dispose (GObject *gobject)
+{
+    MirageStreamChd *self = MIRAGE_STREAM_CHD(gobject);
+
+    /* Unfinished stream; wait for jobs in flight, then drop them */
+    mirage_stream_chd_stop(self);
+
+    if (self->priv->stream) {
+        g_object_unref(self->priv->stream);
+        self->priv->stream = NULL;
+    }
+
+    /* Chain up to the parent class */
+    G_OBJECT_CLASS(mirage_stream_chd_parent_class)->dispose(gobject);
+}
+
+static void mirage_stream_chd_finalize (GObject *gobject)
+{
+    MirageStreamChd *self = MIRAGE_STREAM_CHD(gobject);
+
+    g_free(self->priv->hunk_buffer);
+    if (self->priv->map) {
+        g_array_free(self->priv->map, TRUE);
+    }
+    if (self->priv->raw_sha1) {
+        g_checksum_free(self->priv->raw_sha1);
+    }
+    g_list_free_full(self->priv->metadata, (GDestroyNotify)chd_metadata_free);
+
+    /* Chain up to the parent class */
+    G_OBJECT_CLASS(mirage_stream_chd_parent_class)->finalize(gobject);
+}
+
+static void mirage_stream_chd_class_init (MirageStreamChdClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->dispose = mirage_stream_chd_dispose;
+    gobject_class->finalize = mirage_stream_chd_finalize;
+}
+
+static void mirage_stream_chd_stream_init (MirageStreamInterface *iface)
+{
+    iface->get_filename = mirage_stream_chd_get_filename;
+    iface->is_writable = mirage_stream_chd_is_writable;
+
+    iface->read = mirage_stream_chd_read;
+    iface->write = mirage_stream_chd_write;
+    iface->seek = mirage_stream_chd_seek;
+    iface->tell = mirage_stream_chd_tell;
+
+    iface->move_file = mirage_stream_chd_move_file;
+}
@@ -0,0 +1,70 @@
+/*
+ *  libMirage: CHD image: compressed output stream
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "mirage/config.h"
+#include <mirage/mirage.h>
+
+#include <glib/gi18n-lib.h>
+
+G_BEGIN_DECLS
+
+
+/* Layout of CD-ROM CHD images we write */
+#define CHD_CD_FRAME_SIZE       2448
+#define CHD_CD_SECTOR_SIZE      2352
+#define CHD_CD_SUBCODE_SIZE     96
+#define CHD_CD_FRAMES_PER_HUNK  8
+#define CHD_CD_HUNK_SIZE        (CHD_CD_FRAMES_PER_HUNK*CHD_CD_FRAME_SIZE)
+
+
+#define MIRAGE_TYPE_STREAM_CHD            (mirage_stream_chd_get_type())
+#define MIRAGE_STREAM_CHD(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MIRAGE_TYPE_STREAM_CHD, MirageStreamChd))
+#define MIRAGE_STREAM_CHD_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MIRAGE_TYPE_STREAM_CHD, MirageStreamChdClass))
+#define MIRAGE_IS_STREAM_CHD(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), MIRAGE_TYPE_STREAM_CHD))
+#define MIRAGE_IS_STREAM_CHD_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MIRAGE_TYPE_STREAM_CHD))
+#define MIRAGE_STREAM_CHD_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MIRAGE_TYPE_STREAM_CHD, MirageStreamChdClass))
+
+typedef struct _MirageStreamChd           MirageStreamChd;
+typedef struct _MirageStreamChdClass      MirageStreamChdClass;
+typedef struct _MirageStreamChdPrivate    MirageStreamChdPrivate;
+
+struct _MirageStreamChd
+{
+    MirageObject parent_instance;
+
+    /*< private >*/
+    MirageStreamChdPrivate *priv;
+};
+
+struct _MirageStreamChdClass
+{
+    MirageObjectClass parent_class;
+};
+
+/* Used by MIRAGE_TYPE_STREAM_CHD */
+GType mirage_stream_chd_get_type (void);
+
+gboolean mirage_stream_chd_open (MirageStreamChd *self, MirageStream *stream, const guint32 *codecs, gint num_codecs, gboolean write_subchannel, GError **error);
+void mirage_stream_chd_add_metadata (MirageStreamChd *self, guint32 tag, guint8 flags, const guint8 *data, gsize size);
+gboolean mirage_stream_chd_finish (MirageStreamChd *self, guint64 logical_bytes, GError **error);
+
+
+G_END_DECLS
@@ -0,0 +1,365 @@
+/*
+ *  libMirage: CHD image: writer
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "image-chd.h"
+
+#define __debug__ "CHD-Writer"
+
+#define PARAM_WRITE_SUBCHANNEL "writer.write_subchannel"
+#define PARAM_COMPRESSION "writer.compression"
+
+/* In CHD image, the CD tracks are padded to multiples of 4 frames */
+#define CHD_CD_TRACK_PADDING 4
+
+
+/**********************************************************************\
+ *                  Object and its private structure                  *
+\**********************************************************************/
+struct _MirageWriterChdPrivate
+{
+    MirageStreamChd *stream;
+
+    /* Layout of frames in image */
+    MirageTrack *current_track; /* Only compared against, not referenced */
+    MirageFragment *last_fragment;
+    guint64 num_frames;
+    gint num_tracks;
+};
+
+
+G_DEFINE_DYNAMIC_TYPE_EXTENDED(
+    MirageWriterChd,
+    mirage_writer_chd,
+    MIRAGE_TYPE_WRITER,
+    0,
+    G_ADD_PRIVATE_DYNAMIC(MirageWriterChd)
+)
+
+void mirage_writer_chd_type_register (GTypeModule *type_module)
+{
+    mirage_writer_chd_register_type(type_module);
+}
+
+
+/**********************************************************************\
+ *                          Helper functions                          *
+\**********************************************************************/
+static void mirage_writer_chd_account_last_fragment (MirageWriterChd *self)
+{
+    /* Fragment length is set by the caller only after we return it,
+     * so we account for it when the next one is requested */
+    if (self->priv->last_fragment) {
+        self->priv->num_frames += mirage_fragment_get_length(self->priv->last_fragment);
+        g_object_unref(self->priv->last_fragment);
+        self->priv->last_fragment = NULL;
+    }
+}
+
+static void mirage_writer_chd_pad_track (MirageWriterChd *self)
+{
+    self->priv->num_frames = (self->priv->num_frames + CHD_CD_TRACK_PADDING - 1) / CHD_CD_TRACK_PADDING * CHD_CD_TRACK_PADDING;
+}
+
+static const gchar *mirage_writer_chd_get_track_type (MirageTrack *track)
+{
+    /* Data is always stored raw */
+    switch (mirage_track_get_sector_type(track)) {
+        case MIRAGE_SECTOR_AUDIO: {
+            return "AUDIO";
+        }
+        case MIRAGE_SECTOR_MODE1: {
+            return "MODE1_RAW";
+        }
+        default: {
+            return "MODE2_RAW";
+        }
+    }
+}
+
+static void mirage_writer_chd_add_track_metadata (MirageWriterChd *self, MirageTrack *track, gboolean first_track)
+{
+    const gchar *type = mirage_writer_chd_get_track_type(track);
+    const gchar *subtype = mirage_writer_get_parameter_boolean(MIRAGE_WRITER(self), PARAM_WRITE_SUBCHANNEL) ? "RW_RAW" : "NONE";
+    gint num_fragments = mirage_track_get_number_of_fragments(track);
+    gint stored_length = 0;
+    gint external_length = 0;
+    gint stored_pregap;
+    gchar *pregap_type;
+    gchar *metadata;
+
+    /* Fragments without data are the ones we did not store */
+    for (gint i = 0; i < num_fragments; i++) {
+        MirageFragment *fragment = mirage_track_get_fragment_by_index(track, i, NULL);
+
+        if (mirage_fragment_main_data_get_size(fragment)) {
+            stored_length += mirage_fragment_get_length(fragment);
+        } else {
+            external_length += mirage_fragment_get_length(fragment);
+        }
+
+        g_object_unref(fragment);
+    }
+
+    /* Pregap that is stored in the image is marked with 'V' prefix */
+    stored_pregap = MAX(mirage_track_get_track_start(track) - external_length, 0);
+
+    /* Red Book pregap of the first track is added by the parser */
+    if (first_track) {
+        external_length = MAX(external_length - 150, 0);
+    }
+
+    if (stored_pregap) {
+        if (external_length) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: track %d has both stored and non-stored pregap; latter is ignored!", __debug__, mirage_track_layout_get_track_number(track));
+        }
+
+        pregap_type = g_strconcat("V", type, NULL);
+        metadata = g_strdup_printf(CDROM_TRACK_METADATA2_FORMAT,
+            mirage_track_layout_get_track_number(track),
+            type, subtype, stored_length,
+            stored_pregap, pregap_type, subtype,
+            0);
+        g_free(pregap_type);
+    } else {
+        metadata = g_strdup_printf(CDROM_TRACK_METADATA2_FORMAT,
+            mirage_track_layout_get_track_number(track),
+            type, subtype, stored_length,
+            external_length, "MODE1", "NONE",
+            0);
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: track metadata: %s", __debug__, metadata);
+
+    /* Metadata string is stored with its terminating NUL */
+    mirage_stream_chd_add_metadata(self->priv->stream, CDROM_TRACK_METADATA2_TAG, CHD_MDFLAGS_CHECKSUM, (const guint8 *)metadata, strlen(metadata) + 1);
+
+    g_free(metadata);
+}
+
+
+/**********************************************************************\
+ *                MirageWriter methods implementation                 *
+\**********************************************************************/
+static gboolean mirage_writer_chd_open_image_impl (MirageWriter *_self, MirageDisc *disc, GError **error)
+{
+    MirageWriterChd *self = MIRAGE_WRITER_CHD(_self);
+    guint32 codecs[2];
+    gint num_codecs = 0;
+    MirageStream *stream;
+
+    /* This writer supports only CD-ROM medium */
+    if (mirage_disc_get_medium_type(disc) != MIRAGE_MEDIUM_CD) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: CHD image writer supports only CD-ROM medium format!", __debug__);
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_WRITER_ERROR, Q_("Unsupported medium format!"));
+        return FALSE;
+    }
+
+    /* Print parameters */
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: write subchannel: %d", __debug__, mirage_writer_get_parameter_boolean(_self, PARAM_WRITE_SUBCHANNEL));
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: compression: '%s'", __debug__, mirage_writer_get_parameter_string(_self, PARAM_COMPRESSION));
+
+    /* Codecs; each hunk is compressed with all of them, and the
+     * smallest result is kept */
+    const gchar *compression = mirage_writer_get_parameter_string(_self, PARAM_COMPRESSION);
+    if (strstr(compression, "zlib")) {
+        codecs[num_codecs++] = CHD_CODEC_CD_ZLIB;
+    }
+#ifdef HAVE_LIBLZMA
+    if (strstr(compression, "lzma")) {
+        codecs[num_codecs++] = CHD_CODEC_CD_LZMA;
+    }
+#endif
+    if (!num_codecs) {
+        codecs[num_codecs++] = CHD_CODEC_CD_ZLIB;
+    }
+
+    /* Output stream */
+    stream = mirage_contextual_create_output_stream(MIRAGE_CONTEXTUAL(self), mirage_disc_get_filenames(disc)[0], NULL, error);
+    if (!stream) {
+        return FALSE;
+    }
+
+    self->priv->stream = g_object_new(MIRAGE_TYPE_STREAM_CHD, NULL);
+    mirage_contextual_set_context(MIRAGE_CONTEXTUAL(self->priv->stream), mirage_contextual_get_context(MIRAGE_CONTEXTUAL(self)));
+
+    if (!mirage_stream_chd_open(self->priv->stream, stream, codecs, num_codecs, mirage_writer_get_parameter_boolean(_self, PARAM_WRITE_SUBCHANNEL), error)) {
+        g_object_unref(stream);
+        return FALSE;
+    }
+    g_object_unref(stream);
+
+    self->priv->current_track = NULL;
+    self->priv->num_frames = 0;
+    self->priv->num_tracks = 0;
+
+    return TRUE;
+}
+
+static MirageFragment *mirage_writer_chd_create_fragment (MirageWriter *_self, MirageTrack *track, MirageFragmentRole role, GError **error)
+{
+    MirageWriterChd *self = MIRAGE_WRITER_CHD(_self);
+    MirageFragment *fragment;
+
+    /* Single session only; there is no way to describe more of them
+     * in CHD metadata */
+    if (mirage_track_layout_get_session_number(track) > 1) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: CHD image writer supports only single-session discs!", __debug__);
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_WRITER_ERROR, Q_("Multi-session discs are not supported!"));
+        return NULL;
+    }
+
+    mirage_writer_chd_account_last_fragment(self);
+
+    /* Tracks start at multiples of 4 frames */
+    if (track != self->priv->current_track) {
+        mirage_writer_chd_pad_track(self);
+        self->priv->current_track = track;
+        self->priv->num_tracks++;
+    }
+
+    fragment = g_object_new(MIRAGE_TYPE_FRAGMENT, NULL);
+
+    /* Pregap of the first track is not stored; the parser adds the Red
+     * Book pregap, and the remainder is described in metadata. Pregaps
+     * of other tracks are stored as part of track data */
+    if (role == MIRAGE_FRAGMENT_PREGAP && self->priv->num_tracks == 1) {
+        return fragment;
+    }
+
+    mirage_fragment_main_data_set_stream(fragment, MIRAGE_STREAM(self->priv->stream));
+    mirage_fragment_main_data_set_offset(fragment, self->priv->num_frames * CHD_CD_FRAME_SIZE);
+    mirage_fragment_main_data_set_size(fragment, CHD_CD_SECTOR_SIZE);
+
+    if (mirage_track_get_sector_type(track) == MIRAGE_SECTOR_AUDIO) {
+        mirage_fragment_main_data_set_format(fragment, MIRAGE_MAIN_DATA_FORMAT_AUDIO_SWAP);
+    } else {
+        mirage_fragment_main_data_set_format(fragment, MIRAGE_MAIN_DATA_FORMAT_DATA);
+    }
+
+    /* Frames always include subcode; if it is not to be written, the
+     * stream clears it */
+    mirage_fragment_subchannel_data_set_format(fragment, MIRAGE_SUBCHANNEL_DATA_FORMAT_PW96_INTERLEAVED | MIRAGE_SUBCHANNEL_DATA_FORMAT_INTERNAL);
+    mirage_fragment_subchannel_data_set_size(fragment, CHD_CD_SUBCODE_SIZE);
+
+    self->priv->last_fragment = g_object_ref(fragment);
+
+    return fragment;
+}
+
+static gboolean mirage_writer_chd_finalize_image (MirageWriter *_self, MirageDisc *disc, GError **error)
+{
+    MirageWriterChd *self = MIRAGE_WRITER_CHD(_self);
+    gint num_tracks = mirage_disc_get_number_of_tracks(disc);
+    gboolean succeeded;
+
+    mirage_writer_chd_account_last_fragment(self);
+    mirage_writer_chd_pad_track(self);
+
+    /* Track metadata */
+    for (gint i = 0; i < num_tracks; i++) {
+        MirageTrack *track = mirage_disc_get_track_by_index(disc, i, NULL);
+        mirage_writer_chd_add_track_metadata(self, track, i == 0);
+        g_object_unref(track);
+    }
+
+    /* Complete the image */
+    succeeded = mirage_stream_chd_finish(self->priv->stream, self->priv->num_frames * CHD_CD_FRAME_SIZE, error);
+
+    g_object_unref(self->priv->stream);
+    self->priv->stream = NULL;
+
+    return succeeded;
+}
+
+
+/**********************************************************************\
+ *                             Object init                            *
+\**********************************************************************/
+static void mirage_writer_chd_init (MirageWriterChd *self)
+{
+    self->priv = mirage_writer_chd_get_instance_private(self);
+
+    mirage_writer_generate_info(MIRAGE_WRITER(self),
+        "WRITER-CHD",
+        Q_("CHD Image Writer")
+    );
+
+    self->priv->stream = NULL;
+    self->priv->current_track = NULL;
+    self->priv->last_fragment = NULL;
+    self->priv->num_frames = 0;
+    self->priv->num_tracks = 0;
+
+    /* Create parameter sheet */
+    mirage_writer_add_parameter_boolean(MIRAGE_WRITER(self),
+        PARAM_WRITE_SUBCHANNEL,
+        Q_("Write subchannel"),
+        Q_("A flag indicating whether to write subchannel data or not."),
+        FALSE);
+
+#ifdef HAVE_LIBLZMA
+    mirage_writer_add_parameter_enum(MIRAGE_WRITER(self),
+        PARAM_COMPRESSION,
+        Q_("Compression"),
+        Q_("Compression codecs for hunks. Hunks are compressed in parallel; if more than one codec is given, each hunk is stored with the one that compresses it best."),
+        "zlib+lzma",
+        "zlib", "lzma", "zlib+lzma", NULL);
+#else
+    mirage_writer_add_parameter_enum(MIRAGE_WRITER(self),
+        PARAM_COMPRESSION,
+        Q_("Compression"),
+        Q_("Compression codecs for hunks. Hunks are compressed in parallel; if more than one codec is given, each hunk is stored with the one that compresses it best."),
+        "zlib",
+        "zlib", NULL);
+#endif
+}
+
+static void mirage_writer_chd_dispose (GObject *gobject)
+{
+    MirageWriterChd *self = MIRAGE_WRITER_CHD(gobject);
+
+    if (self->priv->last_fragment) {
+        g_object_unref(self->priv->last_fragment);
+        self->priv->last_fragment = NULL;
+    }
+
+    if (self->priv->stream) {
+        g_object_unref(self->priv->stream);
+        self->priv->stream = NULL;
+    }
+
+    /* Chain up to the parent class */
+    G_OBJECT_CLASS(mirage_writer_chd_parent_class)->dispose(gobject);
+}
+
+static void mirage_writer_chd_class_init (MirageWriterChdClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    MirageWriterClass *writer_class = MIRAGE_WRITER_CLASS(klass);
+
+    gobject_class->dispose = mirage_writer_chd_dispose;
+
+    writer_class->open_image_impl = mirage_writer_chd_open_image_impl;
+    writer_class->create_fragment = mirage_writer_chd_create_fragment;
+    writer_class->finalize_image = mirage_writer_chd_finalize_image;
+}
+
+static void mirage_writer_chd_class_finalize (MirageWriterChdClass *klass G_GNUC_UNUSED)
+{
+}
@@ -25,6 +25,7 @@
 #define PARAM_WRITE_RAW "writer.write_raw"
 #define PARAM_WRITE_SUBCHANNEL "writer.write_subchannel"
 #define PARAM_SWAP_RAW_AUDIO_DATA "writer.swap_raw_audio"
+#define PARAM_COMPRESSION "writer.compression"
 
 
 /**********************************************************************\
@@ -36,6 +37,9 @@ struct _MirageWriterIsoPrivate
 
     GList *image_file_streams;
 
+    const gchar **compression_filter_chain;
+    const gchar *compression_suffix;
+
     gboolean is_cd_rom;
 };
 
@@ -59,12 +63,45 @@ static const gchar *audio_filter_chain[] = {
     NULL
 };
 
+static const gchar *gzip_filter_chain[] = {
+    "MirageFilterStreamGzip",
+    NULL
+};
+
+static const gchar *xz_filter_chain[] = {
+    "MirageFilterStreamXz",
+    NULL
+};
+
+static const gchar *ecm_filter_chain[] = {
+    "MirageFilterStreamEcm",
+    NULL
+};
+
+static const gchar *cso_filter_chain[] = {
+    "MirageFilterStreamCso",
+    NULL
+};
+
 static const gchar image_file_format[] = "%b-%02s-%02t.%e";
 
 
 /**********************************************************************\
  *                          Helper functions                          *
 \**********************************************************************/
+static gchar *mirage_writer_iso_get_extension (MirageWriterIso *self, const gchar *filename)
+{
+    /* Compressed files have double extension (e.g., .bin.gz) */
+    if (self->priv->compression_suffix && g_str_has_suffix(filename, self->priv->compression_suffix)) {
+        gchar *uncompressed_filename = g_strndup(filename, strlen(filename) - strlen(self->priv->compression_suffix));
+        gchar *extension = g_strconcat(mirage_helper_get_suffix(uncompressed_filename) + 1, self->priv->compression_suffix, NULL); /* +1 to skip the '.' */
+        g_free(uncompressed_filename);
+        return extension;
+    }
+
+    return g_strdup(mirage_helper_get_suffix(filename) + 1); /* +1 to skip the '.' */
+}
+
 static void mirage_writer_iso_rename_track_image_files (MirageWriterIso *self, MirageDisc *disc)
 {
     gint num_sessions = mirage_disc_get_number_of_sessions(disc);
@@ -73,7 +110,8 @@ static void mirage_writer_iso_rename_track_image_files (MirageWriterIso *self, M
     if (num_tracks > 1) {
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: renaming track files...", __debug__);
 
-        const gchar *original_filename, *extension;
+        const gchar *original_filename;
+        gchar *extension;
         gchar *new_filename;
 
         gint track = 1;
@@ -82,7 +120,7 @@ static void mirage_writer_iso_rename_track_image_files (MirageWriterIso *self, M
         while (iter) {
             /* Construct new filename */
             original_filename = mirage_stream_get_filename(iter->data);
-            extension = mirage_helper_get_suffix(original_filename) + 1; /* +1 to skip the '.' */
+            extension = mirage_writer_iso_get_extension(self, original_filename);
 
             if (num_sessions == 1) {
                 new_filename = mirage_helper_format_string(
@@ -109,6 +147,7 @@ static void mirage_writer_iso_rename_track_image_files (MirageWriterIso *self, M
                 MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to rename file for track #%d to '%s'!", __debug__, track, new_filename);
             }
             g_free(new_filename);
+            g_free(extension);
 
             /* If we have only one session, nreak after first iteration */
             if (num_sessions == 1) {
@@ -184,6 +223,30 @@ static gboolean mirage_writer_iso_open_image_impl (MirageWriter *_self, MirageDi
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: write raw: %d", __debug__, mirage_writer_get_parameter_boolean(_self, PARAM_WRITE_RAW));
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: write subchannel: %d", __debug__, mirage_writer_get_parameter_boolean(_self, PARAM_WRITE_SUBCHANNEL));
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: swap raw audio data: %d", __debug__, mirage_writer_get_parameter_boolean(_self, PARAM_SWAP_RAW_AUDIO_DATA));
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: compression: '%s'", __debug__, mirage_writer_get_parameter_string(_self, PARAM_COMPRESSION));
+
+    /* Compression of data files */
+    const gchar *compression = mirage_writer_get_parameter_string(_self, PARAM_COMPRESSION);
+    if (!g_strcmp0(compression, "gzip")) {
+        self->priv->compression_filter_chain = gzip_filter_chain;
+        self->priv->compression_suffix = ".gz";
+    } else if (!g_strcmp0(compression, "xz")) {
+        self->priv->compression_filter_chain = xz_filter_chain;
+        self->priv->compression_suffix = ".xz";
+    } else if (!g_strcmp0(compression, "ecm")) {
+        self->priv->compression_filter_chain = ecm_filter_chain;
+        self->priv->compression_suffix = ".ecm";
+    } else if (!g_strcmp0(compression, "cso")) {
+        self->priv->compression_filter_chain = cso_filter_chain;
+        self->priv->compression_suffix = ".cso";
+    } else if (!g_strcmp0(compression, "zso")) {
+        /* Same filter; LZ4 compression is chosen based on suffix */
+        self->priv->compression_filter_chain = cso_filter_chain;
+        self->priv->compression_suffix = ".zso";
+    } else {
+        self->priv->compression_filter_chain = NULL;
+        self->priv->compression_suffix = NULL;
+    }
 
     /* Disable raw mode and subchannel for non-CD media */
     self->priv->is_cd_rom = mirage_disc_get_medium_type(disc) == MIRAGE_MEDIUM_CD;
@@ -277,6 +340,15 @@ static MirageFragment *mirage_writer_iso_create_fragment (MirageWriter *_self, M
         mirage_fragment_subchannel_data_set_size(fragment, 96);
     }
 
+    /* Data files can be compressed; audio files written via sndfile
+     * cannot, as sndfile needs to go back and update their headers */
+    gchar *compressed_extension = NULL;
+    if (!filter_chain && self->priv->compression_filter_chain) {
+        filter_chain = self->priv->compression_filter_chain;
+        compressed_extension = g_strconcat(extension, self->priv->compression_suffix, NULL);
+        extension = compressed_extension;
+    }
+
     /* Format filename */
     gint session_number = mirage_track_layout_get_session_number(track);
     gint track_number = mirage_track_layout_get_track_number(track);
@@ -310,6 +382,7 @@ static MirageFragment *mirage_writer_iso_create_fragment (MirageWriter *_self, M
             NULL
         );
     }
+    g_free(compressed_extension);
 
     /* I/O stream */
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: fragment filename = %s", __debug__, filename);
@@ -362,6 +435,9 @@ static void mirage_writer_iso_init (MirageWriterIso *self)
     self->priv->image_file_basename = NULL;
     self->priv->image_file_streams = NULL;
 
+    self->priv->compression_filter_chain = NULL;
+    self->priv->compression_suffix = NULL;
+
     /* Create parameter sheet */
     mirage_writer_add_parameter_enum(MIRAGE_WRITER(self),
         PARAM_AUDIO_FILE_SUFFIX,
@@ -387,6 +463,13 @@ static void mirage_writer_iso_init (MirageWriterIso *self)
         Q_("Swap raw audio data"),
         Q_("A flag indicating whether to swap audio data. Applicable only to raw writing."),
         FALSE);
+
+    mirage_writer_add_parameter_enum(MIRAGE_WRITER(self),
+        PARAM_COMPRESSION,
+        Q_("Compression"),
+        Q_("Compression to apply to image files of data tracks. Compressed files are split into independently compressed blocks, which keeps them seekable."),
+        "none",
+        "none", "gzip", "xz", "cso", "zso", "ecm", NULL);
 }
 
 static void mirage_writer_iso_dispose (GObject *gobject)
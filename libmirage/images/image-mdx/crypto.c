@@ -31,6 +31,10 @@
 /**********************************************************************\
  *                         AES-256 with LRW                           *
 \**********************************************************************/
+/* Number of 16-byte blocks passed to gcrypt in a single call; this lets
+ * gcrypt use its bulk (AES-NI / ARMv8-CE pipelined) ECB implementation */
+#define LRW_BATCH_BLOCKS 128
+
 gboolean
 mdx_crypto_decipher_buffer_lrw (
     gcry_cipher_hd_t crypt_handle,
@@ -42,6 +46,11 @@ mdx_crypto_decipher_buffer_lrw (
 )
 {
     const gint block_size = 16;
+    const gf128mul_lrw_table *table = gfmul_table;
+    guint128_bbe tweaks[LRW_BATCH_BLOCKS];
+    guint128_bbe tweak;
+    guint64 index = sector_number;
+    gsize num_blocks;
     gpg_error_t rc;
 
     if (len % block_size) {
@@ -49,37 +58,63 @@ mdx_crypto_decipher_buffer_lrw (
         return FALSE;
     }
 
-    /* Decipher each 16-byte block */
-    for (gsize i = 0; i < len / block_size; i++) {
+    num_blocks = len / block_size;
+    if (!num_blocks) {
+        return TRUE;
+    }
+
+    /* Tweak: product of tweak key (F) and tweak index (I) in GF(2^128).
+     * Use the table-based multiplication (where table was initialized
+     * using the tweak key) only for the first block; the tweaks for
+     * subsequent indices are obtained incrementally, since
+     * F*(I+1) = F*I + F*(I XOR (I+1)), and I XOR (I+1) = 2^(t+1) - 1,
+     * where t is the number of trailing one bits in I. */
+    tweak.a = 0;
+    tweak.b = GUINT64_TO_BE(index);
+    gf128mul_64k_bbe(&tweak, &table->mul);
+
+    /* Decipher in batches of 16-byte blocks */
+    while (num_blocks) {
+        gsize batch = MIN(num_blocks, LRW_BATCH_BLOCKS);
+
         /* Cast the pointer to current 16-byte / 128-bit data block to
          * our guint128_bbe struct, so we can perform operations on two
          * 64-bit integers. */
         guint128_bbe *data_ptr = (guint128_bbe *)(void *)data;
 
-        /* Tweak: product of tweak key (F) and tweak index (I) in GF(2^128).
-         * Use the table-based multiplication (where table was initialized
-         * using the tweak key). */
-        guint128_bbe tweak;
-        tweak.a = 0;
-        tweak.b = GUINT64_TO_BE(sector_number + i);
-        gf128mul_64k_bbe(&tweak, (gf128mul_64k_table *)gfmul_table);
-
-        /* XOR with tweak */
-        data_ptr->a ^= tweak.a;
-        data_ptr->b ^= tweak.b;
+        /* XOR with tweaks, and advance the tweak */
+        for (gsize i = 0; i < batch; i++) {
+            guint t = 0;
+            guint64 tmp = index;
+
+            tweaks[i] = tweak;
+            data_ptr[i].a ^= tweak.a;
+            data_ptr[i].b ^= tweak.b;
+
+            while ((tmp & 1) && t < 63) {
+                tmp >>= 1;
+                t++;
+            }
+            tweak.a ^= table->inc[t].a;
+            tweak.b ^= table->inc[t].b;
+            index++;
+        }
 
-        /* Decipher */
-        rc = gcry_cipher_decrypt(crypt_handle, data, block_size, NULL, 0);
+        /* Decipher whole batch */
+        rc = gcry_cipher_decrypt(crypt_handle, data, batch * block_size, NULL, 0);
         if (rc != 0) {
             g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_PARSER_ERROR, "gcry_cipher_decrypt() failed with error code: %d", rc);
             return FALSE;
         }
 
-        /* XOR with tweak */
-        data_ptr->a ^= tweak.a;
-        data_ptr->b ^= tweak.b;
+        /* XOR with tweaks */
+        for (gsize i = 0; i < batch; i++) {
+            data_ptr[i].a ^= tweaks[i].a;
+            data_ptr[i].b ^= tweaks[i].b;
+        }
 
-        data += block_size / sizeof(*data);
+        data += batch * block_size;
+        num_blocks -= batch;
     }
 
     return TRUE;
@@ -219,13 +254,13 @@ static gboolean _mdx_crypto_decipher_encryption_header (
         );
     } else {
         /* Initialize table for GF(2^128) multiplication using the master key */
-        gpointer gfmul_table = g_new0(gf128mul_64k_table, 1);
+        gpointer gfmul_table = g_new0(gf128mul_lrw_table, 1);
         if (!gfmul_table) {
             g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_PARSER_ERROR, "Failed to initialize table for GF(2^128) multiplication!");
             gcry_cipher_close(crypt_handle);
             return FALSE;
         }
-        gf128mul_init_64k_table_bbe((guint128_bbe *)master_key, gfmul_table);
+        gf128mul_init_lrw_table_bbe((guint128_bbe *)master_key, gfmul_table);
 
         succeeded = mdx_crypto_decipher_buffer_lrw(
             crypt_handle,
@@ -231,3 +231,15 @@ void gf128mul_64k_bbe (guint128_bbe *a, const gf128mul_64k_table *table)
     }
     *a = r;
 }
+
+void gf128mul_init_lrw_table_bbe (const guint128_bbe *g, gf128mul_lrw_table *table)
+{
+    gf128mul_init_64k_table_bbe(g, &table->mul);
+
+    /* inc[i] contains g*(2^(i+1) - 1) */
+    for (guint i = 0; i < 64; i++) {
+        table->inc[i].a = 0;
+        table->inc[i].b = GUINT64_TO_BE(G_MAXUINT64 >> (63 - i));
+        gf128mul_64k_bbe(&table->inc[i], &table->mul);
+    }
+}
@@ -58,3 +58,16 @@ void gf128mul_init_64k_table_bbe (const guint128_bbe *g, gf128mul_64k_table *tab
 /* Fast table-based multiplication; multiplies the given value with the
  * operand that was used to initialize the given table. */
 void gf128mul_64k_bbe (guint128_bbe *a, const gf128mul_64k_table *table);
+
+/* Tables for LRW tweak computation: the 64k multiplication table, and
+ * products of the operand with (2^(i+1) - 1) for i in [0, 64). Since
+ * i XOR (i+1) always has this form, the tweak for the next index can be
+ * obtained from the tweak for the current one with a single XOR. */
+typedef struct
+{
+    gf128mul_64k_table mul;
+    guint128_bbe inc[64];
+} gf128mul_lrw_table;
+
+/* Initialize the LRW tables; the structure must be allocated by caller. */
+void gf128mul_init_lrw_table_bbe (const guint128_bbe *g, gf128mul_lrw_table *table);
@@ -1315,12 +1315,12 @@ static MirageDisc *mirage_parser_mdx_load_image (MirageParser *_self, MirageStre
      * in GLib 2.58. */
     if (self->priv->data_encryption_header) {
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_PARSER, "%s: initializing GF(2^128) multiplication table for data decryption...", __debug__);
-        self->priv->gfmul_table = g_rc_box_new0(gf128mul_64k_table);
+        self->priv->gfmul_table = g_rc_box_new0(gf128mul_lrw_table);
         if (!self->priv->gfmul_table) {
             g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_PARSER_ERROR, "Failed to initialize table for GF(2^128) multiplication!");
             return FALSE;
         }
-        gf128mul_init_64k_table_bbe(
+        gf128mul_init_lrw_table_bbe(
             (guint128_bbe *)(void *)self->priv->data_encryption_header->key_data,
             self->priv->gfmul_table
         );
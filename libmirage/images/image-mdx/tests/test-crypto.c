@@ -0,0 +1,176 @@
+/*
+ *  libMirage: MDX image: data decryption tests
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "image-mdx.h"
+
+#include <string.h>
+
+#include "gf128mul.h"
+
+
+#define BLOCK_SIZE 16
+#define SECTOR_BLOCKS (2048 / BLOCK_SIZE)
+
+static const guint8 data_key[32] = {
+    0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+    0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4,
+};
+
+static const guint8 tweak_key[16] = {
+    0x4d, 0x9e, 0x3b, 0x71, 0x02, 0xc8, 0x5f, 0xa6, 0x19, 0xe4, 0x80, 0x37, 0xbb, 0x6c, 0xd5, 0x2a,
+};
+
+
+/**********************************************************************\
+ *                          Reference tweaks                          *
+\**********************************************************************/
+/* Tweak for given block index, computed with the full table-based
+ * multiplication, independently of the incremental update */
+static guint128_bbe reference_tweak (const gf128mul_lrw_table *table, guint64 index)
+{
+    guint128_bbe tweak = { 0, GUINT64_TO_BE(index) };
+    gf128mul_64k_bbe(&tweak, &table->mul);
+    return tweak;
+}
+
+/* Enciphers given buffer with AES-256 in LRW mode, one block at a time */
+static void reference_encipher (gcry_cipher_hd_t crypt_handle, const gf128mul_lrw_table *table, guint8 *data, gsize num_blocks, guint64 index)
+{
+    for (gsize i = 0; i < num_blocks; i++) {
+        guint128_bbe *block = (guint128_bbe *)(void *)(data + i * BLOCK_SIZE);
+        guint128_bbe tweak = reference_tweak(table, index + i);
+
+        block->a ^= tweak.a;
+        block->b ^= tweak.b;
+        g_assert_cmpint(gcry_cipher_encrypt(crypt_handle, block, BLOCK_SIZE, NULL, 0), ==, 0);
+        block->a ^= tweak.a;
+        block->b ^= tweak.b;
+    }
+}
+
+
+/**********************************************************************\
+ *                                Tests                               *
+\**********************************************************************/
+typedef struct
+{
+    gcry_cipher_hd_t crypt_handle;
+    gf128mul_lrw_table *table;
+} LrwFixture;
+
+static void lrw_fixture_setup (LrwFixture *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    g_assert_cmpint(gcry_cipher_open(&fixture->crypt_handle, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_ECB, 0), ==, 0);
+    g_assert_cmpint(gcry_cipher_setkey(fixture->crypt_handle, data_key, sizeof(data_key)), ==, 0);
+
+    fixture->table = g_new0(gf128mul_lrw_table, 1);
+    gf128mul_init_lrw_table_bbe((const guint128_bbe *)(const void *)tweak_key, fixture->table);
+}
+
+static void lrw_fixture_teardown (LrwFixture *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    gcry_cipher_close(fixture->crypt_handle);
+    g_free(fixture->table);
+}
+
+/* Tweak of block index 1 is the tweak key itself */
+static void test_lrw_tweak_identity (LrwFixture *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    guint128_bbe tweak = reference_tweak(fixture->table, 1);
+    g_assert_cmpmem(&tweak, sizeof(tweak), tweak_key, sizeof(tweak_key));
+}
+
+/* Incremental table entries against per-index multiplication */
+static void test_lrw_increment_table (LrwFixture *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    for (guint t = 0; t < 64; t++) {
+        guint128_bbe expected = reference_tweak(fixture->table, G_MAXUINT64 >> (63 - t));
+        g_assert_cmpmem(&fixture->table->inc[t], sizeof(guint128_bbe), &expected, sizeof(expected));
+    }
+}
+
+/* Deciphers a multi-sector buffer starting at given block index, and
+ * compares it to the plaintext that was enciphered with per-block tweaks */
+static void test_lrw_decipher (LrwFixture *fixture, gconstpointer user_data)
+{
+    const guint64 start_index = *(const guint64 *)user_data;
+    const gsize num_blocks = 3 * SECTOR_BLOCKS + 5;
+    const gsize len = num_blocks * BLOCK_SIZE;
+    guint8 *plaintext = g_malloc(len);
+    guint8 *data = g_malloc(len);
+    GError *error = NULL;
+
+    for (gsize i = 0; i < len; i++) {
+        plaintext[i] = (guint8)(i * 131 + 7);
+    }
+    memcpy(data, plaintext, len);
+
+    reference_encipher(fixture->crypt_handle, fixture->table, data, num_blocks, start_index);
+    g_assert_true(memcmp(data, plaintext, len));
+
+    g_assert_true(mdx_crypto_decipher_buffer_lrw(fixture->crypt_handle, fixture->table, data, len, start_index, &error));
+    g_assert_no_error(error);
+
+    g_assert_cmpmem(data, len, plaintext, len);
+
+    g_free(data);
+    g_free(plaintext);
+}
+
+static void test_lrw_unaligned (LrwFixture *fixture, gconstpointer user_data G_GNUC_UNUSED)
+{
+    guint8 data[BLOCK_SIZE + 1] = { 0 };
+    GError *error = NULL;
+
+    g_assert_false(mdx_crypto_decipher_buffer_lrw(fixture->crypt_handle, fixture->table, data, sizeof(data), 1, &error));
+    g_assert_error(error, MIRAGE_ERROR, MIRAGE_ERROR_PARSER_ERROR);
+    g_error_free(error);
+}
+
+
+/**********************************************************************\
+ *                                Main                                *
+\**********************************************************************/
+/* Start indices; each decipher test spans several sectors and crosses
+ * LRW_BATCH_BLOCKS boundaries */
+static const guint64 index_header = 1;
+static const guint64 index_carry_byte = 0xFF - 2; /* 0xFF -> 0x100 */
+static const guint64 index_carry_sector = 2 * SECTOR_BLOCKS - 1;
+static const guint64 index_carry_word = G_GUINT64_CONSTANT(0xFFFFFFFF) - 40; /* 0xFFFFFFFF -> 0x100000000 */
+
+int main (int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    if (!gcry_check_version(GCRYPT_VERSION)) {
+        g_error("libgcrypt version mismatch!");
+    }
+    gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
+    gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+
+    g_test_add("/image-mdx/lrw/tweak-identity", LrwFixture, NULL, lrw_fixture_setup, test_lrw_tweak_identity, lrw_fixture_teardown);
+    g_test_add("/image-mdx/lrw/increment-table", LrwFixture, NULL, lrw_fixture_setup, test_lrw_increment_table, lrw_fixture_teardown);
+    g_test_add("/image-mdx/lrw/decipher-header", LrwFixture, &index_header, lrw_fixture_setup, test_lrw_decipher, lrw_fixture_teardown);
+    g_test_add("/image-mdx/lrw/decipher-carry-byte", LrwFixture, &index_carry_byte, lrw_fixture_setup, test_lrw_decipher, lrw_fixture_teardown);
+    g_test_add("/image-mdx/lrw/decipher-carry-sector", LrwFixture, &index_carry_sector, lrw_fixture_setup, test_lrw_decipher, lrw_fixture_teardown);
+    g_test_add("/image-mdx/lrw/decipher-carry-word", LrwFixture, &index_carry_word, lrw_fixture_setup, test_lrw_decipher, lrw_fixture_teardown);
+    g_test_add("/image-mdx/lrw/unaligned", LrwFixture, NULL, lrw_fixture_setup, test_lrw_unaligned, lrw_fixture_teardown);
+
+    return g_test_run();
+}
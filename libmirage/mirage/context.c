@@ -42,6 +42,7 @@
 
 #include "mirage/config.h"
 #include "mirage/mirage.h"
+#include "mirage/utils-private.h"
 
 #include <glib/gi18n-lib.h>
 
@@ -345,6 +346,11 @@ gchar *mirage_context_obtain_password (MirageContext *self, GError **error)
  * If multiple filenames are provided and parser supports only single-file images,
  * only the first filename is used.
  *
+ * If the boolean "layout-cache" option is set to %TRUE on the context, the
+ * disc layout produced by the parser is stored in the user's cache directory,
+ * and subsequent loads of the same, unmodified files with the same options
+ * rebuild the layout from there instead of parsing the image again.
+ *
  * Returns: (transfer full): a #MirageDisc object on success, %NULL on failure. The reference to
  * the object should be released using g_object_unref() when no longer needed.
  */
@@ -356,6 +362,9 @@ MirageDisc *mirage_context_load_image (MirageContext *self, gchar **filenames, G
     gint num_parsers;
     const GType *parser_types;
 
+    GVariant *layout_cache_value;
+    gchar *layout_cache_key = NULL;
+
     gint num_filenames = g_strv_length(filenames);
 
     if (!num_filenames) {
@@ -363,8 +372,21 @@ MirageDisc *mirage_context_load_image (MirageContext *self, gchar **filenames, G
         return NULL;
     }
 
+    /* If layout cache is enabled, try restoring the layout from it first */
+    layout_cache_value = g_hash_table_lookup(self->priv->options, "layout-cache");
+    if (layout_cache_value && g_variant_is_of_type(layout_cache_value, G_VARIANT_TYPE_BOOLEAN) && g_variant_get_boolean(layout_cache_value)) {
+        layout_cache_key = mirage_layout_cache_compute_key(filenames, self->priv->options);
+
+        disc = mirage_layout_cache_load(self, layout_cache_key);
+        if (disc) {
+            g_free(layout_cache_key);
+            return disc;
+        }
+    }
+
     /* Get the list of supported parsers */
     if (!mirage_get_parsers_type(&parser_types, &num_parsers, error)) {
+        g_free(layout_cache_key);
         return NULL;
     }
 
@@ -420,6 +442,12 @@ end:
     }
     g_free(streams);
 
+    /* Store the parsed layout for subsequent loads */
+    if (disc && layout_cache_key) {
+        mirage_layout_cache_store(layout_cache_key, filenames, disc);
+    }
+    g_free(layout_cache_key);
+
     return disc;
 }
 
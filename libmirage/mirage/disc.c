@@ -176,6 +176,65 @@ static gint sort_sessions_by_number (MirageSession *session1, MirageSession *ses
 }
 
 
+/* Returns the track containing @address; @track, if given, is reused if
+ * it contains the address, and released otherwise */
+static MirageTrack *mirage_disc_get_track_for_range (MirageDisc *self, MirageTrack *track, gint address, GError **error)
+{
+    if (track) {
+        if (mirage_track_layout_contains_address(track, address)) {
+            return track;
+        }
+        g_object_unref(track);
+    }
+
+    return mirage_disc_get_track_by_address(self, address, error);
+}
+
+/* Reads a run of raw sectors starting at @address straight from the
+ * fragment that contains it, provided that its data needs no conversion.
+ * Returns number of read sectors; 0 if direct read is not possible */
+static gint mirage_disc_read_raw_sector_run (MirageTrack *track, gint address, gint num_sectors, gboolean subchannel, guint8 *buffer)
+{
+    MirageFragment *fragment;
+    gint relative_address = address - mirage_track_layout_get_start_sector(track);
+    gint num_read = 0;
+
+    fragment = mirage_track_get_fragment_by_address(track, relative_address, NULL);
+    if (!fragment) {
+        return 0;
+    }
+
+    if (mirage_fragment_can_read_raw_sectors(fragment, subchannel)) {
+        num_read = mirage_fragment_read_raw_sectors(fragment, relative_address - mirage_fragment_get_address(fragment), num_sectors, subchannel, buffer, NULL);
+    }
+
+    g_object_unref(fragment);
+
+    return MAX(num_read, 0);
+}
+
+/* Validates a sector range; it must lie within the disc layout, and its
+ * data, at most @max_sector_size bytes per sector, must fit into a single
+ * buffer */
+static gboolean mirage_disc_check_sector_range (MirageDisc *self, gint start, gint num_sectors, gint max_sector_size, GError **error)
+{
+    gint64 disc_start = self->priv->start_sector;
+    gint64 disc_end = disc_start + self->priv->length;
+
+    if (num_sectors < 0 || start > G_MAXINT - num_sectors || (guint)num_sectors > G_MAXUINT / max_sector_size) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_DISC_ERROR, Q_("Invalid sector range arguments!"));
+        return FALSE;
+    }
+
+    if (start < disc_start || (gint64)start + num_sectors > disc_end) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_DISC_ERROR, Q_("Sector range (start %d, length %d) lies outside disc layout!"), start, num_sectors);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
 /**********************************************************************\
  *                             Public API                             *
 \**********************************************************************/
@@ -1340,6 +1399,21 @@ gboolean mirage_disc_get_disc_structure (MirageDisc *self, gint layer, gint type
     return TRUE;
 }
 
+/*
+ * mirage_disc_foreach_disc_structure:
+ * @self: a #MirageDisc
+ * @func: (in) (scope call): function to call for each disc structure
+ * @user_data: (in) (closure): user data to pass to @func
+ *
+ * Internal iterator over disc structures, used by layout cache. @func is
+ * called with key that packs layer into upper and type into lower 16 bits,
+ * and a #GByteArray holding the structure data.
+ */
+void mirage_disc_foreach_disc_structure (MirageDisc *self, GHFunc func, gpointer user_data)
+{
+    g_hash_table_foreach(self->priv->disc_structures, func, user_data);
+}
+
 
 /**
  * mirage_disc_get_sector:
@@ -1452,6 +1526,206 @@ gboolean mirage_disc_put_sector (MirageDisc *self, MirageSector *sector, GError
 }
 
 
+/**
+ * mirage_disc_get_sector_range:
+ * @self: a #MirageDisc
+ * @start: (in): address of first sector
+ * @num_sectors: (in): number of sectors
+ * @format: (in): per-sector data layout
+ * @error: (out) (optional): location to store error, or %NULL
+ *
+ * Reads @num_sectors sectors, starting at sector address @start, and
+ * returns their data, laid out according to @format, in a single buffer.
+ * The range must lie within the disc layout.
+ *
+ * With %MIRAGE_SECTOR_RANGE_USER_DATA, user data of consecutive sectors
+ * is concatenated without padding; the size of each sector's data follows
+ * from its type, which can be obtained using mirage_disc_get_sector_range_status().
+ * Other formats have a fixed size per sector.
+ *
+ * This function is meant for bulk access (e.g., dumps and analysis) from
+ * language bindings, where calling mirage_disc_get_sector() and sector's
+ * getters for each sector would be prohibitively slow. Raw sectors that
+ * are stored in the image as-is are read directly from the image's stream.
+ *
+ * Returns: (transfer full): a #GBytes with sector data, or %NULL on failure
+ *
+ * Since: 3.4.0
+ */
+GBytes *mirage_disc_get_sector_range (MirageDisc *self, gint start, gint num_sectors, MirageSectorRangeFormat format, GError **error)
+{
+    static const gint sector_sizes[] = {
+        [MIRAGE_SECTOR_RANGE_USER_DATA] = 2048, /* Typical; used only for preallocation */
+        [MIRAGE_SECTOR_RANGE_RAW] = 2352,
+        [MIRAGE_SECTOR_RANGE_RAW_PW] = 2352 + 96,
+        [MIRAGE_SECTOR_RANGE_Q] = 16,
+    };
+
+    MirageTrack *track = NULL;
+    MirageSector *sector;
+    GByteArray *data;
+    gint address = start;
+
+    if (format < MIRAGE_SECTOR_RANGE_USER_DATA || format > MIRAGE_SECTOR_RANGE_Q) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_DISC_ERROR, Q_("Invalid sector range arguments!"));
+        return NULL;
+    }
+
+    /* User data never exceeds the size of a raw sector */
+    if (!mirage_disc_check_sector_range(self, start, num_sectors, format == MIRAGE_SECTOR_RANGE_USER_DATA ? 2352 : sector_sizes[format], error)) {
+        return NULL;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_DISC, "%s: reading %d sectors at address 0x%X (format: %d)", __debug__, num_sectors, start, format);
+
+    data = g_byte_array_sized_new((guint)num_sectors * sector_sizes[format]);
+    sector = g_object_new(MIRAGE_TYPE_SECTOR, NULL);
+
+    while (address < start + num_sectors) {
+        const guint8 *main_buf, *subchannel_buf;
+        gint main_len = 0, subchannel_len = 0;
+        gboolean succeeded;
+
+        track = mirage_disc_get_track_for_range(self, track, address, error);
+        if (!track) {
+            goto failure;
+        }
+
+        /* Try reading a run of raw sectors without going through sector
+         * objects */
+        if (format == MIRAGE_SECTOR_RANGE_RAW || format == MIRAGE_SECTOR_RANGE_RAW_PW) {
+            guint offset = data->len;
+            gint num_read;
+
+            g_byte_array_set_size(data, offset + (guint)(start + num_sectors - address) * sector_sizes[format]);
+            num_read = mirage_disc_read_raw_sector_run(track, address, start + num_sectors - address, format == MIRAGE_SECTOR_RANGE_RAW_PW, data->data + offset);
+            g_byte_array_set_size(data, offset + (guint)num_read * sector_sizes[format]);
+
+            if (num_read) {
+                address += num_read;
+                continue;
+            }
+        }
+
+        /* Read the sector */
+        if (!mirage_track_read_sector(track, address, TRUE, sector, error)) {
+            goto failure;
+        }
+
+        switch (format) {
+            case MIRAGE_SECTOR_RANGE_USER_DATA: {
+                succeeded = mirage_sector_get_data(sector, &main_buf, &main_len, error);
+                break;
+            }
+            case MIRAGE_SECTOR_RANGE_RAW: {
+                succeeded = mirage_sector_extract_data(sector, &main_buf, 2352, MIRAGE_SUBCHANNEL_NONE, &subchannel_buf, 0, error);
+                main_len = 2352;
+                break;
+            }
+            case MIRAGE_SECTOR_RANGE_RAW_PW: {
+                succeeded = mirage_sector_extract_data(sector, &main_buf, 2352, MIRAGE_SUBCHANNEL_PW, &subchannel_buf, 96, error);
+                main_len = 2352;
+                subchannel_len = 96;
+                break;
+            }
+            default: {
+                succeeded = mirage_sector_get_subchannel(sector, MIRAGE_SUBCHANNEL_Q, &main_buf, &main_len, error);
+                break;
+            }
+        }
+
+        if (!succeeded) {
+            goto failure;
+        }
+
+        g_byte_array_append(data, main_buf, main_len);
+        if (subchannel_len) {
+            g_byte_array_append(data, subchannel_buf, subchannel_len);
+        }
+
+        address++;
+    }
+
+    if (track) {
+        g_object_unref(track);
+    }
+    g_object_unref(sector);
+
+    return g_byte_array_free_to_bytes(data);
+
+failure:
+    if (track) {
+        g_object_unref(track);
+    }
+    g_object_unref(sector);
+    g_byte_array_unref(data);
+
+    return NULL;
+}
+
+/**
+ * mirage_disc_get_sector_range_status:
+ * @self: a #MirageDisc
+ * @start: (in): address of first sector
+ * @num_sectors: (in): number of sectors
+ * @error: (out) (optional): location to store error, or %NULL
+ *
+ * Reads @num_sectors sectors, starting at sector address @start, and
+ * returns their status as an array of bytes, one per sector. The range
+ * must lie within the disc layout. Each byte
+ * is a combination of #MirageSectorStatus flags; its lower bits hold the
+ * sector type (see %MIRAGE_SECTOR_STATUS_TYPE_MASK), while the validity
+ * flags are determined using mirage_sector_verify_lec() and
+ * mirage_sector_verify_subchannel_crc(). Sectors that cannot be read
+ * are marked with %MIRAGE_SECTOR_STATUS_READ_ERROR instead of causing
+ * the function to fail.
+ *
+ * Returns: (transfer full): a #GBytes with sector status bytes, or %NULL on failure
+ *
+ * Since: 3.4.0
+ */
+GBytes *mirage_disc_get_sector_range_status (MirageDisc *self, gint start, gint num_sectors, GError **error)
+{
+    MirageTrack *track = NULL;
+    MirageSector *sector;
+    guint8 *status;
+
+    if (!mirage_disc_check_sector_range(self, start, num_sectors, 1, error)) {
+        return NULL;
+    }
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_DISC, "%s: checking status of %d sectors at address 0x%X", __debug__, num_sectors, start);
+
+    status = g_new0(guint8, num_sectors);
+    sector = g_object_new(MIRAGE_TYPE_SECTOR, NULL);
+
+    for (gint i = 0; i < num_sectors; i++) {
+        gint address = start + i;
+
+        track = mirage_disc_get_track_for_range(self, track, address, NULL);
+        if (!track || !mirage_track_read_sector(track, address, TRUE, sector, NULL)) {
+            status[i] = MIRAGE_SECTOR_STATUS_READ_ERROR;
+            continue;
+        }
+
+        status[i] = mirage_sector_get_sector_type(sector) & MIRAGE_SECTOR_STATUS_TYPE_MASK;
+        if (mirage_sector_verify_lec(sector)) {
+            status[i] |= MIRAGE_SECTOR_STATUS_EDC_VALID;
+        }
+        if (mirage_sector_verify_subchannel_crc(sector)) {
+            status[i] |= MIRAGE_SECTOR_STATUS_SUBCHANNEL_CRC_VALID;
+        }
+    }
+
+    if (track) {
+        g_object_unref(track);
+    }
+    g_object_unref(sector);
+
+    return g_bytes_new_take(status, num_sectors);
+}
+
+
 /**
  * mirage_disc_set_dpm_data:
  * @self: a #MirageDisc
@@ -155,6 +155,10 @@ MirageSector *mirage_disc_get_sector (MirageDisc *self, gint address, GError **e
 gboolean mirage_disc_read_sector (MirageDisc *self, gint address, MirageSector *sector, GError **error);
 gboolean mirage_disc_put_sector (MirageDisc *self, MirageSector *sector, GError **error);
 
+/* Sector range access */
+GBytes *mirage_disc_get_sector_range (MirageDisc *self, gint start, gint num_sectors, MirageSectorRangeFormat format, GError **error);
+GBytes *mirage_disc_get_sector_range_status (MirageDisc *self, gint start, gint num_sectors, GError **error);
+
 /* DPM */
 void mirage_disc_set_dpm_data (MirageDisc *self, gint start, gint resolution, gint num_entries, const guint32 *data);
 void mirage_disc_get_dpm_data (MirageDisc *self, gint *start, gint *resolution, gint *num_entries, const guint32 **data);
@@ -31,11 +31,20 @@
  * by libMirage's image parsers and writers.
  */
 
+#define _GNU_SOURCE /* copy_file_range() */
+
 #include "mirage/config.h"
 #include "mirage/mirage.h"
+#include "mirage/utils-private.h"
 
 #include <glib/gi18n-lib.h>
 
+#if MIRAGE_HAVE_COPY_FILE_RANGE
+#include <gio/gfiledescriptorbased.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
 
 #define __debug__ "FileStream"
 
@@ -281,6 +290,79 @@ static gboolean mirage_file_stream_move_file (MirageStream *_self, const gchar *
 }
 
 
+/**********************************************************************\
+ *                            Private API                             *
+\**********************************************************************/
+/*
+ * mirage_file_stream_copy_range:
+ * @dest: (in): destination stream
+ * @dest_offset: (in): offset in destination stream
+ * @source: (in): source stream
+ * @source_offset: (in): offset in source stream
+ * @count: (in): number of bytes to copy
+ *
+ * Copies up to @count bytes between two file streams using in-kernel
+ * copy_file_range(), which avoids bouncing data through user space and
+ * allows the filesystem to share (reflink) the extents, if supported.
+ * Both @source and @dest need to be #MirageFileStream objects, i.e.,
+ * there must be no filter streams involved. Stream positions are not
+ * modified.
+ *
+ * Returns: number of bytes copied. This might be less than @count (or
+ * even 0), if the end of @source was reached, or if in-kernel copy is
+ * not supported; in that case, the caller should copy the remaining
+ * data using regular I/O.
+ */
+gsize mirage_file_stream_copy_range (MirageStream *dest, goffset dest_offset, MirageStream *source, goffset source_offset, gsize count)
+{
+#if MIRAGE_HAVE_COPY_FILE_RANGE
+    if (!MIRAGE_IS_FILE_STREAM(dest) || !MIRAGE_IS_FILE_STREAM(source)) {
+        return 0;
+    }
+
+    GOutputStream *output_stream = MIRAGE_FILE_STREAM(dest)->priv->output_stream;
+    GInputStream *input_stream = MIRAGE_FILE_STREAM(source)->priv->input_stream;
+
+    if (!G_IS_FILE_DESCRIPTOR_BASED(output_stream) || !G_IS_FILE_DESCRIPTOR_BASED(input_stream)) {
+        return 0;
+    }
+
+    gint fd_out = g_file_descriptor_based_get_fd(G_FILE_DESCRIPTOR_BASED(output_stream));
+    gint fd_in = g_file_descriptor_based_get_fd(G_FILE_DESCRIPTOR_BASED(input_stream));
+
+    loff_t off_in = source_offset;
+    loff_t off_out = dest_offset;
+    gsize copied = 0;
+
+    while (copied < count) {
+        ssize_t ret = copy_file_range(fd_in, &off_in, fd_out, &off_out, count - copied, 0);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            /* EXDEV, ENOSYS, EOPNOTSUPP, ...; let the caller fall back
+             * to regular I/O */
+            MIRAGE_DEBUG(source, MIRAGE_DEBUG_STREAM, "%s: copy_file_range() failed: %s", __debug__, g_strerror(errno));
+            break;
+        } else if (ret == 0) {
+            /* End of source file */
+            break;
+        }
+        copied += ret;
+    }
+
+    return copied;
+#else
+    (void)dest;
+    (void)dest_offset;
+    (void)source;
+    (void)source_offset;
+    (void)count;
+    return 0;
+#endif
+}
+
+
 /**********************************************************************\
  *                             Object init                            *
 \**********************************************************************/
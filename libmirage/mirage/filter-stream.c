@@ -225,6 +225,40 @@ gboolean mirage_filter_stream_open (MirageFilterStream *self, MirageStream *stre
     return succeeded;
 }
 
+/**
+ * mirage_filter_stream_finish:
+ * @self: a #MirageFilterStream
+ * @error: (out) (optional): location to store error, or %NULL
+ *
+ * Completes the data written to the stream; for example, compresses and
+ * writes out buffered data, followed by any trailing structures of the
+ * file format. If the underlying stream is a filter stream as well, it
+ * is finished, too. No more data can be written to the stream afterwards.
+ *
+ * Filter streams that need this are finished when they are disposed at
+ * the latest, but errors that occur at that point cannot be reported.
+ *
+ * Returns: %TRUE on success, %FALSE on failure
+ *
+ * Since: 3.4.0
+ */
+gboolean mirage_filter_stream_finish (MirageFilterStream *self, GError **error)
+{
+    /* Provided by implementation */
+    if (MIRAGE_FILTER_STREAM_GET_CLASS(self)->finish) {
+        if (!MIRAGE_FILTER_STREAM_GET_CLASS(self)->finish(self, error)) {
+            return FALSE;
+        }
+    }
+
+    /* Stacked filter streams */
+    if (self->priv->underlying_stream && MIRAGE_IS_FILTER_STREAM(self->priv->underlying_stream)) {
+        return mirage_filter_stream_finish(MIRAGE_FILTER_STREAM(self->priv->underlying_stream), error);
+    }
+
+    return TRUE;
+}
+
 
 /**
  * mirage_filter_stream_simplified_set_stream_length:
@@ -535,6 +569,8 @@ static void mirage_filter_stream_class_init (MirageFilterStreamClass *klass)
     klass->write = mirage_filter_stream_write_impl;
     klass->tell = mirage_filter_stream_tell_impl;
     klass->seek = mirage_filter_stream_seek_impl;
+
+    klass->finish = NULL;
 }
 
 static void mirage_filter_stream_stream_init (MirageStreamInterface *iface)
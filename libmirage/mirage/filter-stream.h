@@ -88,6 +88,7 @@ struct _MirageFilterStream
  * @seek: seeks to a location within stream
  * @simplified_partial_read: reads a chunk of requested data from stream (part of simplified interface)
  * @simplified_partial_write: writes a chunk of requested data to stream (part of simplified interface)
+ * @finish: completes data written to stream (optional; since 3.4.0)
  *
  * The class structure for the <structname>MirageFilterStream</structname> type.
  */
@@ -107,6 +108,8 @@ struct _MirageFilterStreamClass
     /* Simplified read/write interface */
     gssize (*simplified_partial_read) (MirageFilterStream *self, void *buffer, gsize count);
     gssize (*simplified_partial_write) (MirageFilterStream *self, const void *buffer, gsize count);
+
+    gboolean (*finish) (MirageFilterStream *self, GError **error);
 };
 
 /* Used by MIRAGE_TYPE_FILTER_STREAM */
@@ -118,6 +121,7 @@ const MirageFilterStreamInfo *mirage_filter_stream_get_info (MirageFilterStream
 MirageStream *mirage_filter_stream_get_underlying_stream (MirageFilterStream *self);
 
 gboolean mirage_filter_stream_open (MirageFilterStream *self, MirageStream *stream, gboolean writable, GError **error);
+gboolean mirage_filter_stream_finish (MirageFilterStream *self, GError **error);
 
 void mirage_filter_stream_simplified_set_stream_length (MirageFilterStream *self, gsize length);
 goffset mirage_filter_stream_simplified_get_position (MirageFilterStream *self);
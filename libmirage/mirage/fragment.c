@@ -41,15 +41,36 @@
 
 #include "mirage/config.h"
 #include "mirage/mirage.h"
+#include "mirage/utils-private.h"
 
 #include <glib/gi18n-lib.h>
 
 #define __debug__ "Fragment"
 
+/* Buffer size used by verbatim data copy between fragments */
+#define COPY_BUFFER_SIZE (4*1024*1024)
+
+/* Size of write-back buffer; consecutive sector writes are coalesced
+ * until this much data is accumulated */
+#define WRITE_BUFFER_SIZE (1024*1024)
+
 
 /**********************************************************************\
  *                  Object and its private structure                  *
 \**********************************************************************/
+/* Write-back buffer is attached to the stream rather than to fragment,
+ * so that fragments sharing a stream also share its buffer, and their
+ * data reaches the stream in the order it was written */
+typedef struct
+{
+    MirageStream *stream; /* Stream that buffered data belongs to (not referenced) */
+    GMutex mutex;
+    guint8 *data; /* Buffered data; allocated on first use */
+    guint64 position; /* Position of buffered data within stream */
+    gsize length; /* Length of buffered data */
+    GError *deferred_error; /* Error from a write-out that could not report it */
+} MirageFragmentWriteBuffer;
+
 struct _MirageFragmentPrivate
 {
     gint address; /* Address (relative to track start) */
@@ -64,6 +85,8 @@ struct _MirageFragmentPrivate
     gint subchannel_size; /* Subchannel data sector size*/
     gint subchannel_format; /* Subchannel data format */
     guint64 subchannel_offset; /* Offset in subchannel data file */
+
+    gboolean write_pending; /* Data was written through fragment since last flush */
 };
 
 
@@ -85,6 +108,235 @@ static void mirage_fragment_commit_bottomup_change (MirageFragment *self)
 }
 
 
+/**********************************************************************\
+ *                          Write-back buffer                         *
+\**********************************************************************/
+G_LOCK_DEFINE_STATIC(write_buffer_lock);
+G_DEFINE_QUARK(mirage-fragment-write-buffer, mirage_fragment_write_buffer)
+
+static void mirage_fragment_write_buffer_free (MirageFragmentWriteBuffer *write_buffer)
+{
+    /* By the time stream is finalized, all fragments that wrote to it
+     * have been disposed of, and have flushed the buffer */
+    g_mutex_clear(&write_buffer->mutex);
+    g_clear_error(&write_buffer->deferred_error);
+    g_free(write_buffer->data);
+    g_free(write_buffer);
+}
+
+/* Returns write-back buffer of @stream; if @create is %FALSE and stream
+ * has no buffer yet, %NULL is returned */
+static MirageFragmentWriteBuffer *mirage_fragment_write_buffer_get (MirageStream *stream, gboolean create)
+{
+    MirageFragmentWriteBuffer *write_buffer = g_object_get_qdata(G_OBJECT(stream), mirage_fragment_write_buffer_quark());
+
+    if (write_buffer || !create) {
+        return write_buffer;
+    }
+
+    /* Buffer may be created concurrently by another fragment */
+    G_LOCK(write_buffer_lock);
+
+    write_buffer = g_object_get_qdata(G_OBJECT(stream), mirage_fragment_write_buffer_quark());
+    if (!write_buffer) {
+        write_buffer = g_new0(MirageFragmentWriteBuffer, 1);
+        write_buffer->stream = stream;
+        g_mutex_init(&write_buffer->mutex);
+        g_object_set_qdata_full(G_OBJECT(stream), mirage_fragment_write_buffer_quark(), write_buffer, (GDestroyNotify)mirage_fragment_write_buffer_free);
+    }
+
+    G_UNLOCK(write_buffer_lock);
+
+    return write_buffer;
+}
+
+/* Must be called with buffer's mutex held */
+static gboolean mirage_fragment_write_buffer_flush_unlocked (MirageFragment *self, MirageFragmentWriteBuffer *write_buffer, GError **error)
+{
+    GError *local_error = NULL;
+    gsize length = write_buffer->length;
+
+    if (!length) {
+        return TRUE;
+    }
+
+    /* Buffer is considered empty regardless of the outcome; data that
+     * failed to be written is dropped, same as with unbuffered writes */
+    write_buffer->length = 0;
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: flushing %" G_GSIZE_FORMAT " bytes at position 0x%" G_GINT64_MODIFIER "X", __debug__, length, write_buffer->position);
+
+    mirage_stream_seek(write_buffer->stream, write_buffer->position, G_SEEK_SET, NULL);
+    if ((guint64)mirage_stream_tell(write_buffer->stream) != write_buffer->position) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: failed to seek to position 0x%" G_GINT64_MODIFIER "X", __debug__, write_buffer->position);
+
+        gchar tmp[100] = ""; /* Work-around for lack of direct G_GINT64_MODIFIER support in xgettext() */
+        g_snprintf(tmp, sizeof(tmp)/sizeof(tmp[0]), "0x%" G_GINT64_MODIFIER "X", write_buffer->position);
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, Q_("Failed to seek to position %s"), tmp);
+
+        return FALSE;
+    }
+
+    if (mirage_stream_write(write_buffer->stream, write_buffer->data, length, &local_error) != (gssize)length) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: failed to write data: %s", __debug__, local_error ? local_error->message : "short write");
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, Q_("Failed to write data: %s"), local_error ? local_error->message : Q_("short write"));
+        g_clear_error(&local_error);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Writes out buffered data of @stream, if any. If @deferred is %TRUE, an
+ * error is kept with the buffer instead of being returned, and is reported
+ * by the next non-deferred flush. Buffer memory is kept for subsequent
+ * writes, unless @release is %TRUE */
+static gboolean mirage_fragment_write_buffer_flush (MirageFragment *self, MirageStream *stream, gboolean deferred, gboolean release, GError **error)
+{
+    MirageFragmentWriteBuffer *write_buffer;
+    GError *local_error = NULL;
+    gboolean succeeded;
+
+    if (!stream) {
+        return TRUE;
+    }
+
+    write_buffer = mirage_fragment_write_buffer_get(stream, FALSE);
+    if (!write_buffer) {
+        return TRUE;
+    }
+
+    g_mutex_lock(&write_buffer->mutex);
+
+    succeeded = mirage_fragment_write_buffer_flush_unlocked(self, write_buffer, &local_error);
+    if (release) {
+        g_free(write_buffer->data);
+        write_buffer->data = NULL;
+    }
+
+    if (deferred) {
+        /* Keep only the first error */
+        if (local_error && !write_buffer->deferred_error) {
+            write_buffer->deferred_error = local_error;
+            local_error = NULL;
+        }
+    } else if (write_buffer->deferred_error) {
+        /* Earlier error takes precedence */
+        g_clear_error(&local_error);
+        local_error = write_buffer->deferred_error;
+        write_buffer->deferred_error = NULL;
+        succeeded = FALSE;
+    }
+
+    g_mutex_unlock(&write_buffer->mutex);
+
+    if (local_error) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to flush buffered data: %s", __debug__, local_error->message);
+        g_propagate_error(error, local_error);
+    }
+
+    return succeeded;
+}
+
+static gboolean mirage_fragment_write_buffer_put (MirageFragment *self, MirageStream *stream, guint64 position, const guint8 *data, gsize length, GError **error)
+{
+    MirageFragmentWriteBuffer *write_buffer = mirage_fragment_write_buffer_get(stream, TRUE);
+
+    self->priv->write_pending = TRUE;
+
+    g_mutex_lock(&write_buffer->mutex);
+
+    /* Flush if new data does not directly follow the buffered data, or
+     * if it would not fit into the buffer */
+    if (write_buffer->length) {
+        if (write_buffer->position + write_buffer->length != position || write_buffer->length + length > WRITE_BUFFER_SIZE) {
+            if (!mirage_fragment_write_buffer_flush_unlocked(self, write_buffer, error)) {
+                g_mutex_unlock(&write_buffer->mutex);
+                return FALSE;
+            }
+        }
+    }
+
+    if (!write_buffer->data) {
+        write_buffer->data = g_malloc(WRITE_BUFFER_SIZE);
+    }
+
+    if (!write_buffer->length) {
+        write_buffer->position = position;
+    }
+
+    memcpy(write_buffer->data + write_buffer->length, data, length);
+    write_buffer->length += length;
+
+    g_mutex_unlock(&write_buffer->mutex);
+
+    return TRUE;
+}
+
+/* Flushes data written through this fragment before streams are read
+ * from or replaced; errors are deferred until the next call to
+ * mirage_fragment_flush(). Fragments that were not written to since the
+ * last flush have nothing pending, so the buffers are not looked up. */
+static void mirage_fragment_flush_pending (MirageFragment *self, gboolean release)
+{
+    if (!self->priv->write_pending) {
+        return;
+    }
+    self->priv->write_pending = FALSE;
+
+    mirage_fragment_write_buffer_flush(self, self->priv->main_stream, TRUE, release, NULL);
+    if (self->priv->subchannel_stream != self->priv->main_stream) {
+        mirage_fragment_write_buffer_flush(self, self->priv->subchannel_stream, TRUE, release, NULL);
+    }
+}
+
+
+/**
+ * mirage_fragment_flush:
+ * @self: a #MirageFragment
+ * @error: (out) (optional): location to store error, or %NULL
+ *
+ * Writes out main channel and subchannel data that is held in write-back
+ * buffers of fragment's streams.
+ *
+ * To reduce the number of I/O operations, data passed to
+ * mirage_fragment_write_main_data() and mirage_fragment_write_subchannel_data()
+ * for consecutive sectors is accumulated in a bounded buffer and written
+ * with a single operation once the buffer is full, a non-consecutive sector
+ * is written, or data is read back from the fragment. The buffer belongs
+ * to the stream, so fragments that share a stream also share the buffer,
+ * and flushing one of them writes out data of all. Errors encountered
+ * while writing out the buffered data are reported either by the write
+ * function that triggered the write-out, or by this function; this
+ * includes errors from write-outs triggered by reads. The buffers
+ * are also flushed when fragment is disposed of, but any error at that
+ * point is lost. Buffer memory is kept between write-outs, and released
+ * by this function or when fragment is disposed of.
+ *
+ * Returns: %TRUE on success, %FALSE on failure
+ *
+ * Since: 3.4.0
+ */
+gboolean mirage_fragment_flush (MirageFragment *self, GError **error)
+{
+    gboolean succeeded = TRUE;
+
+    self->priv->write_pending = FALSE;
+
+    if (!mirage_fragment_write_buffer_flush(self, self->priv->main_stream, FALSE, TRUE, error)) {
+        succeeded = FALSE;
+        error = NULL; /* Report only the first error */
+    }
+    if (self->priv->subchannel_stream != self->priv->main_stream) {
+        if (!mirage_fragment_write_buffer_flush(self, self->priv->subchannel_stream, FALSE, TRUE, error)) {
+            succeeded = FALSE;
+        }
+    }
+
+    return succeeded;
+}
+
+
 /**********************************************************************\
  *                      Address/length functions                      *
 \**********************************************************************/
@@ -195,7 +447,9 @@ gboolean mirage_fragment_use_the_rest_of_file (MirageFragment *self, GError **er
         return FALSE;
     }
 
-    /* Get file length */
+    /* Get file length; make sure buffered data is accounted for */
+    mirage_fragment_flush_pending(self, FALSE);
+
     if (!mirage_stream_seek(self->priv->main_stream, 0, G_SEEK_END, &local_error)) {
         MIRAGE_DEBUG(self, MIRAGE_DEBUG_WARNING, "%s: failed to seek to the end of main channel data input stream: %s", __debug__, local_error->message);
         g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, Q_("Failed to seek to the end of main channel data input stream: %s"), local_error->message);
@@ -246,6 +500,9 @@ gboolean mirage_fragment_contains_address (MirageFragment *self, gint address)
  */
 void mirage_fragment_main_data_set_stream (MirageFragment *self, MirageStream *stream)
 {
+    /* Write out data buffered for old stream */
+    mirage_fragment_flush_pending(self, FALSE);
+
     /* Release old stream */
     if (self->priv->main_stream) {
         g_object_unref(self->priv->main_stream);
@@ -274,6 +531,20 @@ const gchar *mirage_fragment_main_data_get_filename (MirageFragment *self)
     return mirage_stream_get_filename(self->priv->main_stream);
 }
 
+/*
+ * mirage_fragment_main_data_peek_stream:
+ * @self: a #MirageFragment
+ *
+ * Internal accessor for main channel data stream, used by layout cache
+ * to record the type of stream the data is read through.
+ *
+ * Returns: (transfer none): main channel data stream, or %NULL.
+ */
+MirageStream *mirage_fragment_main_data_peek_stream (MirageFragment *self)
+{
+    return self->priv->main_stream;
+}
+
 /**
  * mirage_fragment_main_data_set_offset:
  * @self: a #MirageFragment
@@ -407,6 +678,8 @@ gint mirage_fragment_read_main_data_fast (MirageFragment *self, gint address, gu
 {
     g_return_val_if_fail (length >= self->priv->main_size, FALSE);
 
+    mirage_fragment_flush_pending(self, FALSE);
+
     return MIRAGE_FRAGMENT_GET_CLASS(self)->read_main_data_impl(self, address, buffer, error);
 }
 
@@ -439,6 +712,8 @@ gboolean mirage_fragment_read_main_data (MirageFragment *self, gint address, gui
 
     data_buffer = g_malloc0(self->priv->main_size);
 
+    mirage_fragment_flush_pending(self, FALSE);
+
     len = MIRAGE_FRAGMENT_GET_CLASS(self)->read_main_data_impl(self, address, data_buffer, error);
 
     if (len >= 0) {
@@ -512,7 +787,7 @@ static gint mirage_fragment_read_main_data_impl (MirageFragment *self, gint addr
 gboolean mirage_fragment_write_main_data (MirageFragment *self, gint address, const guint8 *buffer, gint length, GError **error)
 {
     guint64 position;
-    GError *local_error = NULL;
+    gboolean succeeded;
 
     /* If there is no data to be written, do nothing */
     if (!length || !buffer) {
@@ -554,31 +829,14 @@ gboolean mirage_fragment_write_main_data (MirageFragment *self, gint address, co
     /* Determine position within file */
     position = mirage_fragment_main_data_get_position(self, address);
 
-    /* Write */
+    /* Write; data is put into write-back buffer, and written out
+     * together with data of consecutive sectors */
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: writing %d bytes at position 0x%" G_GINT64_MODIFIER "X", __debug__, self->priv->main_size, position);
 
-    mirage_stream_seek(self->priv->main_stream, position, G_SEEK_SET, NULL);
-    if ((gsize)mirage_stream_tell(self->priv->main_stream) != position) {
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: failed to seek to position 0x%" G_GINT64_MODIFIER "X", __debug__, position);
-
-        gchar tmp[100] = ""; /* Work-around for lack of direct G_GINT64_MODIFIER support in xgettext() */
-        g_snprintf(tmp, sizeof(tmp)/sizeof(tmp[0]), "0x%" G_GINT64_MODIFIER "X", position);
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, Q_("Failed to seek to position %s"), tmp);
-
-        g_free(swapped_buffer);
-        return FALSE;
-    }
-
-    if (mirage_stream_write(self->priv->main_stream, swapped_buffer ? swapped_buffer : buffer, self->priv->main_size, &local_error) != self->priv->main_size) {
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: failed to write data: %s", __debug__, local_error->message);
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, Q_("Failed to write data: %s"), local_error->message);
-        g_error_free(local_error);
-        g_free(swapped_buffer);
-        return FALSE;
-    }
+    succeeded = mirage_fragment_write_buffer_put(self, self->priv->main_stream, position, swapped_buffer ? swapped_buffer : buffer, self->priv->main_size, error);
 
     g_free(swapped_buffer);
-    return TRUE;
+    return succeeded;
 }
 
 
@@ -594,6 +852,9 @@ gboolean mirage_fragment_write_main_data (MirageFragment *self, gint address, co
  */
 void mirage_fragment_subchannel_data_set_stream (MirageFragment *self, MirageStream *stream)
 {
+    /* Write out data buffered for old stream */
+    mirage_fragment_flush_pending(self, FALSE);
+
     /* Release old stream */
     if (self->priv->subchannel_stream) {
         g_object_unref(self->priv->subchannel_stream);
@@ -622,6 +883,20 @@ const gchar *mirage_fragment_subchannel_data_get_filename (MirageFragment *self)
     return mirage_stream_get_filename(self->priv->subchannel_stream);
 }
 
+/*
+ * mirage_fragment_subchannel_data_peek_stream:
+ * @self: a #MirageFragment
+ *
+ * Internal accessor for subchannel data stream; see
+ * mirage_fragment_main_data_peek_stream().
+ *
+ * Returns: (transfer none): subchannel data stream, or %NULL.
+ */
+MirageStream *mirage_fragment_subchannel_data_peek_stream (MirageFragment *self)
+{
+    return self->priv->subchannel_stream;
+}
+
 /**
  * mirage_fragment_subchannel_data_set_offset:
  * @self: a #MirageFragment
@@ -765,6 +1040,8 @@ gboolean mirage_fragment_read_subchannel_data (MirageFragment *self, gint addres
 
     data_buffer = g_malloc0(96);
 
+    mirage_fragment_flush_pending(self, FALSE);
+
     len = MIRAGE_FRAGMENT_GET_CLASS(self)->read_subchannel_data_impl(self, address, data_buffer, error);
 
     if (len >= 0) {
@@ -799,6 +1076,8 @@ gint mirage_fragment_read_subchannel_data_fast (MirageFragment *self, gint addre
 {
     g_return_val_if_fail (length >= 96, FALSE);
 
+    mirage_fragment_flush_pending(self, FALSE);
+
     return MIRAGE_FRAGMENT_GET_CLASS(self)->read_subchannel_data_impl(self, address, buffer, error);
 }
 
@@ -896,7 +1175,6 @@ gboolean mirage_fragment_write_subchannel_data (MirageFragment *self, gint addre
 {
     MirageStream *stream;
     guint64 position;
-    GError *local_error = NULL;
 
     /* If there is no data to be written, do nothing */
     if (!length || !buffer) {
@@ -935,43 +1213,316 @@ gboolean mirage_fragment_write_subchannel_data (MirageFragment *self, gint addre
     /* Determine position within file */
     position = mirage_fragment_subchannel_data_get_position(self, address);
 
-    /* Write */
+    /* Write; internal subchannel shares the buffer with main channel
+     * data, so that both get coalesced into the same write */
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: writing %d bytes at position 0x%" G_GINT64_MODIFIER "X", __debug__, self->priv->subchannel_size, position);
 
-    mirage_stream_seek(stream, position, G_SEEK_SET, NULL);
-    if ((gsize)mirage_stream_tell(stream) != position) {
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: failed to seek to position 0x%" G_GINT64_MODIFIER "X", __debug__, position);
+    return mirage_fragment_write_buffer_put(self, stream, position, buffer, self->priv->subchannel_size, error);
+}
+
+
+/**
+ * mirage_fragment_is_writable:
+ * @self: a #MirageFragment
+ *
+ * Checks if fragment is writable, i.e., whether it has main channel data
+ * stream set and this stream is writable.
+ *
+ * Returns: %TRUE if fragment is writable, %FALSE if it is not.
+ */
+gboolean mirage_fragment_is_writable (MirageFragment *self)
+{
+    return (self->priv->main_stream != NULL && mirage_stream_is_writable(self->priv->main_stream));
+}
 
-        gchar tmp[100] = ""; /* Work-around for lack of direct G_GINT64_MODIFIER support in xgettext() */
-        g_snprintf(tmp, sizeof(tmp)/sizeof(tmp[0]), "0x%" G_GINT64_MODIFIER "X", position);
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, Q_("Failed to seek to position %s!"), tmp);
 
+/**********************************************************************\
+ *                         Verbatim data copy                         *
+\**********************************************************************/
+/**
+ * mirage_fragment_can_copy_data_from:
+ * @self: a #MirageFragment
+ * @source: (in): a #MirageFragment to copy data from
+ *
+ * Checks whether sectors' data from @source can be copied into @self
+ * verbatim, i.e., without being passed through #MirageSector objects.
+ * This is possible only if both fragments are plain #MirageFragment
+ * objects (i.e., their read functions are not overridden by an image
+ * format implementation) with main channel data of the same size and
+ * format, and if no subchannel data conversion is required.
+ *
+ * Returns: %TRUE if data can be copied using mirage_fragment_copy_data_from(),
+ * %FALSE if it cannot
+ *
+ * Since: 3.4.0
+ */
+gboolean mirage_fragment_can_copy_data_from (MirageFragment *self, MirageFragment *source)
+{
+    /* Sub-classed fragments (e.g., compressed or encrypted image formats)
+     * do not store sector data as-is */
+    if (G_OBJECT_TYPE(self) != MIRAGE_TYPE_FRAGMENT || G_OBJECT_TYPE(source) != MIRAGE_TYPE_FRAGMENT) {
         return FALSE;
     }
 
-    if (mirage_stream_write(stream, buffer, self->priv->subchannel_size, &local_error) != self->priv->subchannel_size) {
-        MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: failed to write data: %s", __debug__, local_error->message);
-        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, Q_("Failed to write data: %s"), local_error->message);
-        g_error_free(local_error);
+    /* Both fragments need streams; "NULL" fragments have their data
+     * generated by sector objects */
+    if (!self->priv->main_stream || !source->priv->main_stream) {
+        return FALSE;
+    }
+
+    /* Main channel data size and format must match */
+    if (!self->priv->main_size || self->priv->main_size != source->priv->main_size || self->priv->main_format != source->priv->main_format) {
+        return FALSE;
+    }
+
+    /* Subchannel: if we are supposed to write it, it must be internal and
+     * of the same format as source's, so that it can be copied along with
+     * main channel data. If we are not supposed to write it, source must
+     * not have it interleaved with main channel data */
+    if (self->priv->subchannel_size) {
+        if (!(self->priv->subchannel_format & MIRAGE_SUBCHANNEL_DATA_FORMAT_INTERNAL) ||
+            self->priv->subchannel_format != source->priv->subchannel_format ||
+            self->priv->subchannel_size != source->priv->subchannel_size) {
+            return FALSE;
+        }
+    } else if (source->priv->subchannel_format & MIRAGE_SUBCHANNEL_DATA_FORMAT_INTERNAL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * mirage_fragment_copy_data_from:
+ * @self: a #MirageFragment
+ * @source: (in): a #MirageFragment to copy data from
+ * @address: (in): fragment-relative start address
+ * @num_sectors: (in): number of sectors to copy
+ * @error: (out) (optional): location to store error, or %NULL
+ *
+ * Copies data for @num_sectors sectors, starting at fragment-relative
+ * @address (given in sectors), from @source into the same fragment-relative
+ * location in @self. The data is copied verbatim, using large reads and
+ * writes; if both fragments' streams are plain files, in-kernel copy
+ * (which might share the data extents on filesystems with reflink support)
+ * is attempted first.
+ *
+ * The fragments must be compatible, as determined by mirage_fragment_can_copy_data_from().
+ * Data missing from (truncated) @source is written as zeros.
+ *
+ * Returns: %TRUE on success, %FALSE on failure
+ *
+ * Since: 3.4.0
+ */
+gboolean mirage_fragment_copy_data_from (MirageFragment *self, MirageFragment *source, gint address, gint num_sectors, GError **error)
+{
+    GError *local_error = NULL;
+
+    g_return_val_if_fail(mirage_fragment_can_copy_data_from(self, source), FALSE);
+
+    /* Data is copied directly between streams, so any buffered data
+     * needs to be written out first */
+    mirage_fragment_flush_pending(source, FALSE);
+    if (!mirage_fragment_flush(self, error)) {
+        return FALSE;
+    }
+
+    gint full_size = self->priv->main_size;
+    if (self->priv->subchannel_format & MIRAGE_SUBCHANNEL_DATA_FORMAT_INTERNAL) {
+        full_size += self->priv->subchannel_size;
+    }
+
+    guint64 source_position = mirage_fragment_main_data_get_position(source, address);
+    guint64 dest_position = mirage_fragment_main_data_get_position(self, address);
+    gsize remaining = (gsize)num_sectors * (gsize)full_size;
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: copying %d sectors (%" G_GSIZE_FORMAT " bytes) from position 0x%" G_GINT64_MODIFIER "X to position 0x%" G_GINT64_MODIFIER "X", __debug__, num_sectors, remaining, source_position, dest_position);
+
+    /* Try in-kernel copy first */
+    gsize copied = mirage_file_stream_copy_range(self->priv->main_stream, dest_position, source->priv->main_stream, source_position, remaining);
+    if (copied) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: copied %" G_GSIZE_FORMAT " bytes in-kernel", __debug__, copied);
+        source_position += copied;
+        dest_position += copied;
+        remaining -= copied;
+    }
+
+    if (!remaining) {
+        return TRUE;
+    }
+
+    /* Copy the rest via regular I/O; as with sector reads, we ignore
+     * read errors in order to be able to cope with truncated images */
+    mirage_stream_seek(source->priv->main_stream, source_position, G_SEEK_SET, NULL);
+
+    mirage_stream_seek(self->priv->main_stream, dest_position, G_SEEK_SET, NULL);
+    if ((gsize)mirage_stream_tell(self->priv->main_stream) != dest_position) {
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: failed to seek to position 0x%" G_GINT64_MODIFIER "X", __debug__, dest_position);
+
+        gchar tmp[100] = ""; /* Work-around for lack of direct G_GINT64_MODIFIER support in xgettext() */
+        g_snprintf(tmp, sizeof(tmp)/sizeof(tmp[0]), "0x%" G_GINT64_MODIFIER "X", dest_position);
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, Q_("Failed to seek to position %s"), tmp);
+
         return FALSE;
     }
 
+    guint8 *buffer = g_malloc(MIN(remaining, COPY_BUFFER_SIZE));
+
+    while (remaining) {
+        gsize chunk = MIN(remaining, COPY_BUFFER_SIZE);
+        gssize read_len = mirage_stream_read(source->priv->main_stream, buffer, chunk, NULL);
+
+        if (read_len < 0) {
+            read_len = 0;
+        }
+        if ((gsize)read_len < chunk) {
+            memset(buffer + read_len, 0, chunk - read_len);
+        }
+
+        if (mirage_stream_write(self->priv->main_stream, buffer, chunk, &local_error) != (gssize)chunk) {
+            MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: failed to write data: %s", __debug__, local_error ? local_error->message : "short write");
+            g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, Q_("Failed to write data: %s"), local_error ? local_error->message : Q_("short write"));
+            g_clear_error(&local_error);
+            g_free(buffer);
+            return FALSE;
+        }
+
+        remaining -= chunk;
+    }
+
+    g_free(buffer);
     return TRUE;
 }
 
 
+/**********************************************************************\
+ *                          Raw sector reads                          *
+\**********************************************************************/
 /**
- * mirage_fragment_is_writable:
+ * mirage_fragment_can_read_raw_sectors:
  * @self: a #MirageFragment
+ * @subchannel: (in): whether P-W subchannel data is requested as well
  *
- * Checks if fragment is writable, i.e., whether it has main channel data
- * stream set and this stream is writable.
+ * Checks whether full raw sectors can be read from @self directly, using
+ * mirage_fragment_read_raw_sectors(). This is possible only if @self is
+ * a plain #MirageFragment (i.e., its read functions are not overridden by
+ * an image format implementation) whose main channel data consists of
+ * 2352-byte sectors that require no conversion. If @subchannel is %TRUE,
+ * the fragment must also have internal, 96-byte interleaved P-W subchannel.
  *
- * Returns: %TRUE if fragment is writable, %FALSE if it is not.
+ * Returns: %TRUE if raw sectors can be read directly, %FALSE if they
+ * cannot
+ *
+ * Since: 3.4.0
  */
-gboolean mirage_fragment_is_writable (MirageFragment *self)
+gboolean mirage_fragment_can_read_raw_sectors (MirageFragment *self, gboolean subchannel)
 {
-    return (self->priv->main_stream != NULL && mirage_stream_is_writable(self->priv->main_stream));
+    /* Sub-classed fragments (e.g., compressed or encrypted image formats)
+     * do not store sector data as-is */
+    if (G_OBJECT_TYPE(self) != MIRAGE_TYPE_FRAGMENT) {
+        return FALSE;
+    }
+
+    /* "NULL" fragments have their data generated by sector objects */
+    if (!self->priv->main_stream) {
+        return FALSE;
+    }
+
+    /* Full raw sectors only; byte-swapped audio needs conversion */
+    if (self->priv->main_size != 2352 || self->priv->main_format == MIRAGE_MAIN_DATA_FORMAT_AUDIO_SWAP) {
+        return FALSE;
+    }
+
+    /* Subchannel must be stored in the same layout as it is returned */
+    if (subchannel) {
+        if (!(self->priv->subchannel_format & MIRAGE_SUBCHANNEL_DATA_FORMAT_INTERNAL) ||
+            !(self->priv->subchannel_format & MIRAGE_SUBCHANNEL_DATA_FORMAT_PW96_INTERLEAVED) ||
+            self->priv->subchannel_size != 96) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * mirage_fragment_read_raw_sectors:
+ * @self: a #MirageFragment
+ * @address: (in): fragment-relative start address
+ * @num_sectors: (in): number of sectors to read
+ * @subchannel: (in): whether to read P-W subchannel data as well
+ * @buffer: (out caller-allocates) (array): buffer to read data into
+ * @error: (out) (optional): location to store error, or %NULL
+ *
+ * Reads up to @num_sectors full raw sectors, starting at fragment-relative
+ * @address (given in sectors), straight from the fragment's stream into
+ * @buffer. Each sector is stored as 2352 bytes of main channel data,
+ * followed by 96 bytes of interleaved P-W subchannel data if @subchannel
+ * is %TRUE. If the subchannel layout in the stream matches the requested
+ * one, the whole run is read at once.
+ *
+ * The fragment must support such reads, as determined by
+ * mirage_fragment_can_read_raw_sectors(). The run is clipped to the end
+ * of fragment, and @buffer must be large enough to hold @num_sectors
+ * sectors. Data missing from (truncated) stream is returned as zeros.
+ *
+ * Returns: number of read sectors, or -1 on failure
+ *
+ * Since: 3.4.0
+ */
+gint mirage_fragment_read_raw_sectors (MirageFragment *self, gint address, gint num_sectors, gboolean subchannel, guint8 *buffer, GError **error)
+{
+    gboolean internal_subchannel = (self->priv->subchannel_format & MIRAGE_SUBCHANNEL_DATA_FORMAT_INTERNAL) && self->priv->subchannel_size;
+    gint sector_size = subchannel ? 2352 + 96 : 2352;
+    gssize read_len;
+
+    g_return_val_if_fail(mirage_fragment_can_read_raw_sectors(self, subchannel), -1);
+
+    /* Clip to fragment */
+    num_sectors = MIN(num_sectors, self->priv->length - address);
+    if (address < 0 || num_sectors <= 0) {
+        g_set_error(error, MIRAGE_ERROR, MIRAGE_ERROR_FRAGMENT_ERROR, Q_("Sector address out of range!"));
+        return -1;
+    }
+
+    /* Data is read directly from stream, so any buffered data needs
+     * to be written out first */
+    mirage_fragment_flush_pending(self, FALSE);
+
+    MIRAGE_DEBUG(self, MIRAGE_DEBUG_FRAGMENT, "%s: reading %d raw sectors at address 0x%X (subchannel: %d)", __debug__, num_sectors, address, subchannel);
+
+    /* As with sector reads, we ignore read errors in order to be able to
+     * cope with truncated images */
+    if (subchannel || !internal_subchannel) {
+        /* Stream layout matches the requested one (requested subchannel is
+         * guaranteed to be internal); read the whole run */
+        gsize length = (gsize)num_sectors * (gsize)sector_size;
+
+        mirage_stream_seek(self->priv->main_stream, mirage_fragment_main_data_get_position(self, address), G_SEEK_SET, NULL);
+        read_len = mirage_stream_read(self->priv->main_stream, buffer, length, NULL);
+        if (read_len < 0) {
+            read_len = 0;
+        }
+        if ((gsize)read_len < length) {
+            memset(buffer + read_len, 0, length - read_len);
+        }
+    } else {
+        /* Internal subchannel is not requested; skip it */
+        for (gint i = 0; i < num_sectors; i++) {
+            guint8 *ptr = buffer + (gsize)i * 2352;
+
+            mirage_stream_seek(self->priv->main_stream, mirage_fragment_main_data_get_position(self, address + i), G_SEEK_SET, NULL);
+            read_len = mirage_stream_read(self->priv->main_stream, ptr, 2352, NULL);
+            if (read_len < 0) {
+                read_len = 0;
+            }
+            if (read_len < 2352) {
+                memset(ptr + read_len, 0, 2352 - read_len);
+            }
+        }
+    }
+
+    return num_sectors;
 }
 
 
@@ -991,12 +1542,16 @@ static void mirage_fragment_init (MirageFragment *self)
     self->priv->subchannel_size = 0;
     self->priv->subchannel_format = 0;
     self->priv->subchannel_offset = 0;
+
 }
 
 static void mirage_fragment_dispose (GObject *gobject)
 {
     MirageFragment*self = MIRAGE_FRAGMENT(gobject);
 
+    /* Write out buffered data while we still hold the streams */
+    mirage_fragment_flush_pending(self, TRUE);
+
     if (self->priv->main_stream) {
         g_object_unref(self->priv->main_stream);
         self->priv->main_stream = NULL;
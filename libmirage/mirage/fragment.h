@@ -151,6 +151,15 @@ gboolean mirage_fragment_write_subchannel_data (MirageFragment *self, gint addre
 gint mirage_fragment_read_subchannel_data_fast (MirageFragment *self, gint address, guint8 *buffer, gint length, GError **error);
 
 gboolean mirage_fragment_is_writable (MirageFragment *self);
+gboolean mirage_fragment_flush (MirageFragment *self, GError **error);
+
+/* Verbatim data copy */
+gboolean mirage_fragment_can_copy_data_from (MirageFragment *self, MirageFragment *source);
+gboolean mirage_fragment_copy_data_from (MirageFragment *self, MirageFragment *source, gint address, gint num_sectors, GError **error);
+
+/* Raw sector reads */
+gboolean mirage_fragment_can_read_raw_sectors (MirageFragment *self, gboolean subchannel);
+gint mirage_fragment_read_raw_sectors (MirageFragment *self, gint address, gint num_sectors, gboolean subchannel, guint8 *buffer, GError **error);
 
 
 G_END_DECLS
@@ -0,0 +1,783 @@
+/*
+ *  libMirage: parsed layout cache
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The layout cache stores the disc layout produced by an image parser
+ * (sessions, tracks, fragments with their data file references, CD-TEXT,
+ * disc structures and DPM data) as a serialized GVariant in the user's
+ * cache directory. When the same image is loaded again, the layout is
+ * rebuilt from the cache instead of running the parser, which avoids
+ * re-reading and re-parsing large descriptor files.
+ *
+ * The cache entry is looked up by the absolute paths of the image files
+ * and the context options, and is only used if all files it references
+ * still have the recorded modification time and size. Layouts that use
+ * parser-specific objects (e.g., custom fragment implementations) or
+ * streams that cannot be re-created from a filename are never cached.
+ */
+
+#include "mirage/config.h"
+#include "mirage/mirage.h"
+#include "mirage/utils-private.h"
+
+#include <glib/gi18n-lib.h>
+
+#define __debug__ "LayoutCache"
+
+
+/* Version of the serialized layout; bump whenever the format changes */
+#define LAYOUT_CACHE_VERSION 1
+
+/* GVariant types of the serialized layout */
+#define LAYOUT_CACHE_STREAM_TYPE "(sstii)" /* Filename, stream type, offset, size, format */
+#define LAYOUT_CACHE_FRAGMENT_TYPE "(i" LAYOUT_CACHE_STREAM_TYPE LAYOUT_CACHE_STREAM_TYPE ")" /* Length, main data, subchannel data */
+#define LAYOUT_CACHE_LANGUAGE_TYPE "(ia(iay))" /* Code, packs */
+#define LAYOUT_CACHE_TRACK_TYPE "(iiisaia" LAYOUT_CACHE_FRAGMENT_TYPE "a" LAYOUT_CACHE_LANGUAGE_TYPE ")" /* Flags, sector type, track start, ISRC, indices, fragments, languages */
+#define LAYOUT_CACHE_SESSION_TYPE "(is" LAYOUT_CACHE_TRACK_TYPE LAYOUT_CACHE_TRACK_TYPE "a" LAYOUT_CACHE_TRACK_TYPE "a" LAYOUT_CACHE_LANGUAGE_TYPE ")" /* Session type, MCN, lead-in, lead-out, tracks, languages */
+#define LAYOUT_CACHE_DISC_TYPE "(iiiias(iiau)a(iay)a" LAYOUT_CACHE_SESSION_TYPE ")" /* Medium type, first session, first track, start sector, filenames, DPM, disc structures, sessions */
+#define LAYOUT_CACHE_FILE_TYPE "(usa(sxt)" LAYOUT_CACHE_DISC_TYPE ")" /* Version, key, file stamps, disc */
+
+
+/**********************************************************************\
+ *                          Helper functions                          *
+\**********************************************************************/
+static gchar *mirage_layout_cache_get_absolute_path (const gchar *filename)
+{
+    GFile *file = g_file_new_for_path(filename);
+    gchar *path = g_file_get_path(file);
+    g_object_unref(file);
+
+    return path ? path : g_strdup(filename);
+}
+
+static gboolean mirage_layout_cache_query_file (const gchar *path, gint64 *mtime, guint64 *size)
+{
+    GFile *file = g_file_new_for_path(path);
+    GFileInfo *info = g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    g_object_unref(file);
+
+    if (!info) {
+        return FALSE;
+    }
+
+    *mtime = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED)*G_USEC_PER_SEC + g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+    *size = g_file_info_get_size(info);
+
+    g_object_unref(info);
+
+    return TRUE;
+}
+
+static gchar *mirage_layout_cache_get_filename (const gchar *key)
+{
+    gchar *checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA256, key, -1);
+    gchar *basename = g_strconcat(checksum, ".layout", NULL);
+    gchar *filename = g_build_filename(g_get_user_cache_dir(), "libmirage", "layout", basename, NULL);
+
+    g_free(basename);
+    g_free(checksum);
+
+    return filename;
+}
+
+static gboolean mirage_layout_cache_track_has_subchannel (MirageTrack *track)
+{
+    MirageFragment *fragment = mirage_track_find_fragment_with_subchannel(track, NULL);
+    if (fragment) {
+        g_object_unref(fragment);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
+/**********************************************************************\
+ *                           Serialization                            *
+\**********************************************************************/
+typedef struct
+{
+    MirageDisc *disc; /* Disc being serialized; used for debug messages */
+    GHashTable *files; /* Absolute path -> (sxt) stamp of every file the layout depends on */
+    gboolean cacheable; /* Cleared when part of the layout cannot be cached */
+} MirageLayoutCacheWriter;
+
+static const gchar *mirage_layout_cache_writer_add_file (MirageLayoutCacheWriter *writer, const gchar *filename)
+{
+    gpointer stored_path;
+    gchar *path;
+    gint64 mtime;
+    guint64 size;
+
+    if (!filename) {
+        MIRAGE_DEBUG(writer->disc, MIRAGE_DEBUG_PARSER, "%s: layout references a stream without filename!", __debug__);
+        writer->cacheable = FALSE;
+        return "";
+    }
+
+    path = mirage_layout_cache_get_absolute_path(filename);
+    if (g_hash_table_lookup_extended(writer->files, path, &stored_path, NULL)) {
+        g_free(path);
+        return stored_path;
+    }
+
+    if (!mirage_layout_cache_query_file(path, &mtime, &size)) {
+        MIRAGE_DEBUG(writer->disc, MIRAGE_DEBUG_PARSER, "%s: failed to query file %s!", __debug__, path);
+        writer->cacheable = FALSE;
+        g_free(path);
+        return "";
+    }
+
+    g_hash_table_insert(writer->files, path, g_variant_ref_sink(g_variant_new("(sxt)", path, mtime, size)));
+
+    return path;
+}
+
+static GVariant *mirage_layout_cache_serialize_stream (MirageLayoutCacheWriter *writer, MirageStream *stream, guint64 offset, gint size, gint format)
+{
+    const gchar *filename = "";
+    const gchar *type_name = "";
+
+    if (stream) {
+        filename = mirage_layout_cache_writer_add_file(writer, mirage_stream_get_filename(stream));
+        type_name = G_OBJECT_TYPE_NAME(stream);
+    }
+
+    return g_variant_new(LAYOUT_CACHE_STREAM_TYPE, filename, type_name, offset, size, format);
+}
+
+static GVariant *mirage_layout_cache_serialize_fragment (MirageLayoutCacheWriter *writer, MirageFragment *fragment)
+{
+    GVariant *main_data, *subchannel_data;
+
+    /* Parser-specific fragments keep state we cannot restore */
+    if (G_OBJECT_TYPE(fragment) != MIRAGE_TYPE_FRAGMENT) {
+        MIRAGE_DEBUG(writer->disc, MIRAGE_DEBUG_PARSER, "%s: layout contains fragment of type %s!", __debug__, G_OBJECT_TYPE_NAME(fragment));
+        writer->cacheable = FALSE;
+    }
+
+    main_data = mirage_layout_cache_serialize_stream(writer,
+        mirage_fragment_main_data_peek_stream(fragment),
+        mirage_fragment_main_data_get_offset(fragment),
+        mirage_fragment_main_data_get_size(fragment),
+        mirage_fragment_main_data_get_format(fragment));
+
+    subchannel_data = mirage_layout_cache_serialize_stream(writer,
+        mirage_fragment_subchannel_data_peek_stream(fragment),
+        mirage_fragment_subchannel_data_get_offset(fragment),
+        mirage_fragment_subchannel_data_get_size(fragment),
+        mirage_fragment_subchannel_data_get_format(fragment));
+
+    return g_variant_new("(i@" LAYOUT_CACHE_STREAM_TYPE "@" LAYOUT_CACHE_STREAM_TYPE ")", mirage_fragment_get_length(fragment), main_data, subchannel_data);
+}
+
+static gboolean mirage_layout_cache_serialize_language (MirageLanguage *language, gpointer user_data)
+{
+    GVariantBuilder *languages = user_data;
+    GVariantBuilder packs;
+
+    g_variant_builder_init(&packs, G_VARIANT_TYPE("a(iay)"));
+    for (gint type = MIRAGE_LANGUAGE_PACK_TITLE; type <= MIRAGE_LANGUAGE_PACK_SIZE; type++) {
+        const guint8 *data;
+        gint length;
+
+        if (mirage_language_get_pack_data(language, type, &data, &length, NULL)) {
+            g_variant_builder_add(&packs, "(i@ay)", type, g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, data, length, sizeof(guint8)));
+        }
+    }
+
+    g_variant_builder_add(languages, "(i@a(iay))", mirage_language_get_code(language), g_variant_builder_end(&packs));
+
+    return TRUE;
+}
+
+static gboolean mirage_layout_cache_serialize_index (MirageIndex *index, gpointer user_data)
+{
+    g_variant_builder_add(user_data, "i", mirage_index_get_address(index));
+    return TRUE;
+}
+
+static GVariant *mirage_layout_cache_serialize_track (MirageLayoutCacheWriter *writer, MirageTrack *track)
+{
+    GVariantBuilder indices, fragments, languages;
+    const gchar *isrc = NULL;
+    gint num_fragments = mirage_track_get_number_of_fragments(track);
+
+    if (G_OBJECT_TYPE(track) != MIRAGE_TYPE_TRACK) {
+        MIRAGE_DEBUG(writer->disc, MIRAGE_DEBUG_PARSER, "%s: layout contains track of type %s!", __debug__, G_OBJECT_TYPE_NAME(track));
+        writer->cacheable = FALSE;
+    }
+
+    /* ISRC from subchannel is scanned for on demand, and the restored
+     * track does the same; do not trigger the scan here */
+    if (!mirage_layout_cache_track_has_subchannel(track)) {
+        isrc = mirage_track_get_isrc(track);
+    }
+
+    g_variant_builder_init(&indices, G_VARIANT_TYPE("ai"));
+    mirage_track_enumerate_indices(track, mirage_layout_cache_serialize_index, &indices);
+
+    g_variant_builder_init(&fragments, G_VARIANT_TYPE("a" LAYOUT_CACHE_FRAGMENT_TYPE));
+    for (gint i = 0; i < num_fragments; i++) {
+        MirageFragment *fragment = mirage_track_get_fragment_by_index(track, i, NULL);
+        g_variant_builder_add_value(&fragments, mirage_layout_cache_serialize_fragment(writer, fragment));
+        g_object_unref(fragment);
+    }
+
+    g_variant_builder_init(&languages, G_VARIANT_TYPE("a" LAYOUT_CACHE_LANGUAGE_TYPE));
+    mirage_track_enumerate_languages(track, mirage_layout_cache_serialize_language, &languages);
+
+    return g_variant_new("(iiis@ai@a" LAYOUT_CACHE_FRAGMENT_TYPE "@a" LAYOUT_CACHE_LANGUAGE_TYPE ")",
+        mirage_track_get_flags(track),
+        mirage_track_get_sector_type(track),
+        mirage_track_get_track_start(track),
+        isrc ? isrc : "",
+        g_variant_builder_end(&indices),
+        g_variant_builder_end(&fragments),
+        g_variant_builder_end(&languages));
+}
+
+static GVariant *mirage_layout_cache_serialize_session (MirageLayoutCacheWriter *writer, MirageSession *session)
+{
+    GVariantBuilder tracks, languages;
+    GVariant *leadin_data, *leadout_data;
+    MirageTrack *track;
+    gboolean has_subchannel = FALSE;
+    const gchar *mcn = NULL;
+    gint num_tracks = mirage_session_get_number_of_tracks(session);
+
+    if (G_OBJECT_TYPE(session) != MIRAGE_TYPE_SESSION) {
+        MIRAGE_DEBUG(writer->disc, MIRAGE_DEBUG_PARSER, "%s: layout contains session of type %s!", __debug__, G_OBJECT_TYPE_NAME(session));
+        writer->cacheable = FALSE;
+    }
+
+    /* Lead-in and lead-out are part of the session from its creation;
+     * parsers may have added fragments to them */
+    track = mirage_session_get_track_by_number(session, MIRAGE_TRACK_LEADIN, NULL);
+    leadin_data = mirage_layout_cache_serialize_track(writer, track);
+    g_object_unref(track);
+
+    track = mirage_session_get_track_by_number(session, MIRAGE_TRACK_LEADOUT, NULL);
+    leadout_data = mirage_layout_cache_serialize_track(writer, track);
+    g_object_unref(track);
+
+    g_variant_builder_init(&tracks, G_VARIANT_TYPE("a" LAYOUT_CACHE_TRACK_TYPE));
+    for (gint i = 0; i < num_tracks; i++) {
+        track = mirage_session_get_track_by_index(session, i, NULL);
+        has_subchannel |= mirage_layout_cache_track_has_subchannel(track);
+        g_variant_builder_add_value(&tracks, mirage_layout_cache_serialize_track(writer, track));
+        g_object_unref(track);
+    }
+
+    /* Same as with ISRC; MCN from subchannel is scanned for on demand */
+    if (!has_subchannel) {
+        mcn = mirage_session_get_mcn(session);
+    }
+
+    g_variant_builder_init(&languages, G_VARIANT_TYPE("a" LAYOUT_CACHE_LANGUAGE_TYPE));
+    mirage_session_enumerate_languages(session, mirage_layout_cache_serialize_language, &languages);
+
+    return g_variant_new("(is@" LAYOUT_CACHE_TRACK_TYPE "@" LAYOUT_CACHE_TRACK_TYPE "@a" LAYOUT_CACHE_TRACK_TYPE "@a" LAYOUT_CACHE_LANGUAGE_TYPE ")",
+        mirage_session_get_session_type(session),
+        mcn ? mcn : "",
+        leadin_data,
+        leadout_data,
+        g_variant_builder_end(&tracks),
+        g_variant_builder_end(&languages));
+}
+
+static void mirage_layout_cache_serialize_disc_structure (gpointer key, gpointer value, gpointer user_data)
+{
+    GByteArray *array = value;
+    g_variant_builder_add(user_data, "(i@ay)", GPOINTER_TO_INT(key), g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, array->data, array->len, sizeof(guint8)));
+}
+
+static GVariant *mirage_layout_cache_serialize_disc (MirageLayoutCacheWriter *writer, MirageDisc *disc)
+{
+    GVariantBuilder filenames, structures, sessions;
+    gchar **disc_filenames = mirage_disc_get_filenames(disc);
+    gint num_sessions = mirage_disc_get_number_of_sessions(disc);
+
+    gint dpm_start, dpm_resolution, dpm_num_entries;
+    const guint32 *dpm_data;
+
+    g_variant_builder_init(&filenames, G_VARIANT_TYPE_STRING_ARRAY);
+    for (gint i = 0; disc_filenames && disc_filenames[i]; i++) {
+        g_variant_builder_add(&filenames, "s", disc_filenames[i]);
+    }
+
+    mirage_disc_get_dpm_data(disc, &dpm_start, &dpm_resolution, &dpm_num_entries, &dpm_data);
+
+    g_variant_builder_init(&structures, G_VARIANT_TYPE("a(iay)"));
+    mirage_disc_foreach_disc_structure(disc, mirage_layout_cache_serialize_disc_structure, &structures);
+
+    g_variant_builder_init(&sessions, G_VARIANT_TYPE("a" LAYOUT_CACHE_SESSION_TYPE));
+    for (gint i = 0; i < num_sessions; i++) {
+        MirageSession *session = mirage_disc_get_session_by_index(disc, i, NULL);
+        g_variant_builder_add_value(&sessions, mirage_layout_cache_serialize_session(writer, session));
+        g_object_unref(session);
+    }
+
+    return g_variant_new("(iiii@as(ii@au)@a(iay)@a" LAYOUT_CACHE_SESSION_TYPE ")",
+        mirage_disc_get_medium_type(disc),
+        mirage_disc_layout_get_first_session(disc),
+        mirage_disc_layout_get_first_track(disc),
+        mirage_disc_layout_get_start_sector(disc),
+        g_variant_builder_end(&filenames),
+        dpm_start,
+        dpm_resolution,
+        g_variant_new_fixed_array(G_VARIANT_TYPE_UINT32, dpm_data, dpm_num_entries, sizeof(guint32)),
+        g_variant_builder_end(&structures),
+        g_variant_builder_end(&sessions));
+}
+
+
+/**********************************************************************\
+ *                          Deserialization                           *
+\**********************************************************************/
+static gboolean mirage_layout_cache_restore_stream (MirageDisc *disc, GVariant *data, MirageStream **stream, guint64 *offset, gint *size, gint *format)
+{
+    const gchar *filename, *type_name;
+
+    g_variant_get(data, "(&s&stii)", &filename, &type_name, offset, size, format);
+
+    *stream = NULL;
+    if (!*filename) {
+        return TRUE;
+    }
+
+    /* Streams are opened through the context, so they get the same
+     * filter chain as when the parser opened them */
+    *stream = mirage_contextual_create_input_stream(MIRAGE_CONTEXTUAL(disc), filename, NULL);
+    if (!*stream) {
+        MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: failed to open stream on %s!", __debug__, filename);
+        return FALSE;
+    }
+
+    if (g_strcmp0(G_OBJECT_TYPE_NAME(*stream), type_name)) {
+        MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: stream on %s is of type %s instead of %s!", __debug__, filename, G_OBJECT_TYPE_NAME(*stream), type_name);
+        g_object_unref(*stream);
+        *stream = NULL;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static MirageFragment *mirage_layout_cache_restore_fragment (MirageDisc *disc, GVariant *data)
+{
+    MirageFragment *fragment;
+    GVariant *main_data, *subchannel_data;
+    MirageStream *stream;
+    guint64 offset;
+    gint length, size, format;
+
+    g_variant_get(data, "(i@" LAYOUT_CACHE_STREAM_TYPE "@" LAYOUT_CACHE_STREAM_TYPE ")", &length, &main_data, &subchannel_data);
+
+    fragment = g_object_new(MIRAGE_TYPE_FRAGMENT, NULL);
+    mirage_fragment_set_length(fragment, length);
+
+    /* Main channel data */
+    if (!mirage_layout_cache_restore_stream(disc, main_data, &stream, &offset, &size, &format)) {
+        goto fail;
+    }
+    if (stream) {
+        mirage_fragment_main_data_set_stream(fragment, stream);
+        g_object_unref(stream);
+    }
+    mirage_fragment_main_data_set_offset(fragment, offset);
+    mirage_fragment_main_data_set_size(fragment, size);
+    mirage_fragment_main_data_set_format(fragment, format);
+
+    /* Subchannel data */
+    if (!mirage_layout_cache_restore_stream(disc, subchannel_data, &stream, &offset, &size, &format)) {
+        goto fail;
+    }
+    if (stream) {
+        mirage_fragment_subchannel_data_set_stream(fragment, stream);
+        g_object_unref(stream);
+    }
+    mirage_fragment_subchannel_data_set_offset(fragment, offset);
+    mirage_fragment_subchannel_data_set_size(fragment, size);
+    mirage_fragment_subchannel_data_set_format(fragment, format);
+
+    g_variant_unref(subchannel_data);
+    g_variant_unref(main_data);
+
+    return fragment;
+
+fail:
+    g_object_unref(fragment);
+    g_variant_unref(subchannel_data);
+    g_variant_unref(main_data);
+
+    return NULL;
+}
+
+static MirageLanguage *mirage_layout_cache_restore_language (GVariant *data, gint *code)
+{
+    MirageLanguage *language = g_object_new(MIRAGE_TYPE_LANGUAGE, NULL);
+    GVariant *packs, *pack_data;
+    GVariantIter iter;
+    gint type;
+
+    g_variant_get(data, "(i@a(iay))", code, &packs);
+
+    g_variant_iter_init(&iter, packs);
+    while (g_variant_iter_next(&iter, "(i@ay)", &type, &pack_data)) {
+        gsize length;
+        const guint8 *pack = g_variant_get_fixed_array(pack_data, &length, sizeof(guint8));
+
+        mirage_language_set_pack_data(language, type, pack, length, NULL);
+        g_variant_unref(pack_data);
+    }
+
+    g_variant_unref(packs);
+
+    return language;
+}
+
+static gboolean mirage_layout_cache_restore_track (MirageDisc *disc, MirageTrack *track, GVariant *data)
+{
+    GVariant *indices, *fragments, *languages, *child;
+    GVariantIter iter;
+    const gchar *isrc;
+    gint flags, sector_type, track_start;
+    gboolean succeeded = TRUE;
+
+    g_variant_get(data, "(iii&s@ai@a" LAYOUT_CACHE_FRAGMENT_TYPE "@a" LAYOUT_CACHE_LANGUAGE_TYPE ")", &flags, &sector_type, &track_start, &isrc, &indices, &fragments, &languages);
+
+    mirage_track_set_flags(track, flags);
+    mirage_track_set_sector_type(track, sector_type);
+
+    /* Fragments */
+    g_variant_iter_init(&iter, fragments);
+    while (succeeded && (child = g_variant_iter_next_value(&iter))) {
+        MirageFragment *fragment = mirage_layout_cache_restore_fragment(disc, child);
+        if (fragment) {
+            mirage_track_add_fragment(track, -1, fragment);
+            g_object_unref(fragment);
+        } else {
+            succeeded = FALSE;
+        }
+        g_variant_unref(child);
+    }
+
+    /* Track start and indices */
+    mirage_track_set_track_start(track, track_start);
+
+    g_variant_iter_init(&iter, indices);
+    while (succeeded && (child = g_variant_iter_next_value(&iter))) {
+        succeeded = mirage_track_add_index(track, g_variant_get_int32(child), NULL);
+        g_variant_unref(child);
+    }
+
+    if (*isrc) {
+        mirage_track_set_isrc(track, isrc);
+    }
+
+    /* Languages */
+    g_variant_iter_init(&iter, languages);
+    while (succeeded && (child = g_variant_iter_next_value(&iter))) {
+        gint code;
+        MirageLanguage *language = mirage_layout_cache_restore_language(child, &code);
+        succeeded = mirage_track_add_language(track, code, language, NULL);
+        g_object_unref(language);
+        g_variant_unref(child);
+    }
+
+    g_variant_unref(languages);
+    g_variant_unref(fragments);
+    g_variant_unref(indices);
+
+    return succeeded;
+}
+
+static gboolean mirage_layout_cache_restore_session (MirageDisc *disc, MirageSession *session, GVariant *data)
+{
+    GVariant *leadin_data, *leadout_data, *tracks, *languages, *child;
+    GVariantIter iter;
+    MirageTrack *track;
+    const gchar *mcn;
+    gint session_type;
+    gboolean succeeded;
+
+    g_variant_get(data, "(i&s@" LAYOUT_CACHE_TRACK_TYPE "@" LAYOUT_CACHE_TRACK_TYPE "@a" LAYOUT_CACHE_TRACK_TYPE "@a" LAYOUT_CACHE_LANGUAGE_TYPE ")", &session_type, &mcn, &leadin_data, &leadout_data, &tracks, &languages);
+
+    mirage_session_set_session_type(session, session_type);
+
+    /* Tracks */
+    track = mirage_session_get_track_by_number(session, MIRAGE_TRACK_LEADIN, NULL);
+    succeeded = mirage_layout_cache_restore_track(disc, track, leadin_data);
+    g_object_unref(track);
+
+    g_variant_iter_init(&iter, tracks);
+    while (succeeded && (child = g_variant_iter_next_value(&iter))) {
+        track = g_object_new(MIRAGE_TYPE_TRACK, NULL);
+        mirage_session_add_track_by_index(session, -1, track);
+        succeeded = mirage_layout_cache_restore_track(disc, track, child);
+        g_object_unref(track);
+        g_variant_unref(child);
+    }
+
+    if (succeeded) {
+        track = mirage_session_get_track_by_number(session, MIRAGE_TRACK_LEADOUT, NULL);
+        succeeded = mirage_layout_cache_restore_track(disc, track, leadout_data);
+        g_object_unref(track);
+    }
+
+    if (*mcn) {
+        mirage_session_set_mcn(session, mcn);
+    }
+
+    /* Languages */
+    g_variant_iter_init(&iter, languages);
+    while (succeeded && (child = g_variant_iter_next_value(&iter))) {
+        gint code;
+        MirageLanguage *language = mirage_layout_cache_restore_language(child, &code);
+        succeeded = mirage_session_add_language(session, code, language, NULL);
+        g_object_unref(language);
+        g_variant_unref(child);
+    }
+
+    g_variant_unref(languages);
+    g_variant_unref(tracks);
+    g_variant_unref(leadout_data);
+    g_variant_unref(leadin_data);
+
+    return succeeded;
+}
+
+static gboolean mirage_layout_cache_restore_disc (MirageDisc *disc, GVariant *data)
+{
+    GVariant *dpm_data, *structures, *sessions, *child;
+    GVariantIter iter;
+    gchar **filenames;
+    gint medium_type, first_session, first_track, start_sector;
+    gint dpm_start, dpm_resolution;
+    gboolean succeeded = TRUE;
+
+    g_variant_get(data, "(iiii^as(ii@au)@a(iay)@a" LAYOUT_CACHE_SESSION_TYPE ")", &medium_type, &first_session, &first_track, &start_sector, &filenames, &dpm_start, &dpm_resolution, &dpm_data, &structures, &sessions);
+
+    mirage_disc_set_medium_type(disc, medium_type);
+    mirage_disc_set_filenames(disc, filenames);
+    g_strfreev(filenames);
+
+    mirage_disc_layout_set_first_session(disc, first_session);
+    mirage_disc_layout_set_first_track(disc, first_track);
+    mirage_disc_layout_set_start_sector(disc, start_sector);
+
+    /* Sessions */
+    g_variant_iter_init(&iter, sessions);
+    while (succeeded && (child = g_variant_iter_next_value(&iter))) {
+        MirageSession *session = g_object_new(MIRAGE_TYPE_SESSION, NULL);
+        mirage_disc_add_session_by_index(disc, -1, session);
+        succeeded = mirage_layout_cache_restore_session(disc, session, child);
+        g_object_unref(session);
+        g_variant_unref(child);
+    }
+
+    /* Disc structures; key packs layer and type */
+    g_variant_iter_init(&iter, structures);
+    while ((child = g_variant_iter_next_value(&iter))) {
+        GVariant *structure_data;
+        const guint8 *structure;
+        gsize length;
+        gint key;
+
+        g_variant_get(child, "(i@ay)", &key, &structure_data);
+        structure = g_variant_get_fixed_array(structure_data, &length, sizeof(guint8));
+        mirage_disc_set_disc_structure(disc, (key >> 16) & 0xFFFF, key & 0xFFFF, structure, length);
+
+        g_variant_unref(structure_data);
+        g_variant_unref(child);
+    }
+
+    /* DPM */
+    if (g_variant_n_children(dpm_data)) {
+        gsize num_entries;
+        const guint32 *entries = g_variant_get_fixed_array(dpm_data, &num_entries, sizeof(guint32));
+        mirage_disc_set_dpm_data(disc, dpm_start, dpm_resolution, num_entries, entries);
+    }
+
+    g_variant_unref(sessions);
+    g_variant_unref(structures);
+    g_variant_unref(dpm_data);
+
+    return succeeded;
+}
+
+static gboolean mirage_layout_cache_validate_files (MirageDisc *disc, GVariant *files)
+{
+    GVariantIter iter;
+    const gchar *path;
+    gint64 cached_mtime, mtime;
+    guint64 cached_size, size;
+
+    g_variant_iter_init(&iter, files);
+    while (g_variant_iter_next(&iter, "(&sxt)", &path, &cached_mtime, &cached_size)) {
+        if (!mirage_layout_cache_query_file(path, &mtime, &size) || mtime != cached_mtime || size != cached_size) {
+            MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: file %s changed since the layout was cached!", __debug__, path);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+/**********************************************************************\
+ *                            Cache access                            *
+\**********************************************************************/
+gchar *mirage_layout_cache_compute_key (gchar **filenames, GHashTable *options)
+{
+    GString *key = g_string_new(mirage_version_long);
+    GList *names;
+
+    /* Image files */
+    for (gint i = 0; filenames[i]; i++) {
+        gchar *path = mirage_layout_cache_get_absolute_path(filenames[i]);
+        g_string_append_printf(key, "\n%s", path);
+        g_free(path);
+    }
+
+    /* Options may influence the parsers (e.g., encoding); password is
+     * left out, as it is requested again when streams are re-created */
+    names = g_list_sort(g_hash_table_get_keys(options), (GCompareFunc)g_strcmp0);
+    for (GList *entry = names; entry; entry = entry->next) {
+        const gchar *name = entry->data;
+        gchar *value;
+
+        if (!g_strcmp0(name, "password") || !g_strcmp0(name, "layout-cache")) {
+            continue;
+        }
+
+        value = g_variant_print(g_hash_table_lookup(options, name), TRUE);
+        g_string_append_printf(key, "\n%s=%s", name, value);
+        g_free(value);
+    }
+    g_list_free(names);
+
+    return g_string_free(key, FALSE);
+}
+
+MirageDisc *mirage_layout_cache_load (MirageContext *context, const gchar *key)
+{
+    MirageDisc *disc;
+    GVariant *layout, *files, *disc_data;
+    const gchar *stored_key;
+    guint32 version;
+    gchar *filename;
+    gchar *data;
+    gsize length;
+    gboolean succeeded = FALSE;
+
+    disc = g_object_new(MIRAGE_TYPE_DISC, NULL);
+    mirage_contextual_set_context(MIRAGE_CONTEXTUAL(disc), context);
+
+    filename = mirage_layout_cache_get_filename(key);
+    if (!g_file_get_contents(filename, &data, &length, NULL)) {
+        MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: no cached layout in %s", __debug__, filename);
+        g_free(filename);
+        g_object_unref(disc);
+        return NULL;
+    }
+
+    /* Cache file is not trusted; GVariant accessors handle malformed data */
+    layout = g_variant_ref_sink(g_variant_new_from_data(G_VARIANT_TYPE(LAYOUT_CACHE_FILE_TYPE), data, length, FALSE, g_free, data));
+    g_variant_get(layout, "(u&s@a(sxt)@" LAYOUT_CACHE_DISC_TYPE ")", &version, &stored_key, &files, &disc_data);
+
+    if (version != LAYOUT_CACHE_VERSION || g_strcmp0(stored_key, key)) {
+        MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: cached layout in %s does not match!", __debug__, filename);
+    } else if (mirage_layout_cache_validate_files(disc, files)) {
+        succeeded = mirage_layout_cache_restore_disc(disc, disc_data);
+        if (succeeded) {
+            MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: restored layout from %s", __debug__, filename);
+        } else {
+            MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: failed to restore layout from %s!", __debug__, filename);
+        }
+    }
+
+    g_variant_unref(disc_data);
+    g_variant_unref(files);
+    g_variant_unref(layout);
+    g_free(filename);
+
+    if (!succeeded) {
+        g_object_unref(disc);
+        return NULL;
+    }
+
+    return disc;
+}
+
+void mirage_layout_cache_store (const gchar *key, gchar **filenames, MirageDisc *disc)
+{
+    MirageLayoutCacheWriter writer;
+    GVariantBuilder files;
+    GHashTableIter iter;
+    gpointer stamp;
+    GVariant *disc_data, *layout;
+    GError *local_error = NULL;
+    gchar *filename, *dirname;
+
+    writer.disc = disc;
+    writer.files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_variant_unref);
+    writer.cacheable = TRUE;
+
+    /* Image files themselves are dependencies as well */
+    for (gint i = 0; filenames[i]; i++) {
+        mirage_layout_cache_writer_add_file(&writer, filenames[i]);
+    }
+
+    disc_data = g_variant_ref_sink(mirage_layout_cache_serialize_disc(&writer, disc));
+
+    if (!writer.cacheable) {
+        MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: layout cannot be cached", __debug__);
+        g_variant_unref(disc_data);
+        g_hash_table_unref(writer.files);
+        return;
+    }
+
+    g_variant_builder_init(&files, G_VARIANT_TYPE("a(sxt)"));
+    g_hash_table_iter_init(&iter, writer.files);
+    while (g_hash_table_iter_next(&iter, NULL, &stamp)) {
+        g_variant_builder_add_value(&files, stamp);
+    }
+
+    layout = g_variant_ref_sink(g_variant_new("(us@a(sxt)@" LAYOUT_CACHE_DISC_TYPE ")", LAYOUT_CACHE_VERSION, key, g_variant_builder_end(&files), disc_data));
+
+    /* Write the cache file; g_file_set_contents() replaces it atomically */
+    filename = mirage_layout_cache_get_filename(key);
+    dirname = g_path_get_dirname(filename);
+
+    if (g_mkdir_with_parents(dirname, 0700) < 0) {
+        MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: failed to create cache directory %s!", __debug__, dirname);
+    } else if (!g_file_set_contents(filename, g_variant_get_data(layout), g_variant_get_size(layout), &local_error)) {
+        MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: failed to write cached layout: %s!", __debug__, local_error->message);
+        g_error_free(local_error);
+    } else {
+        MIRAGE_DEBUG(disc, MIRAGE_DEBUG_PARSER, "%s: stored layout in %s", __debug__, filename);
+    }
+
+    g_free(dirname);
+    g_free(filename);
+    g_variant_unref(layout);
+    g_variant_unref(disc_data);
+    g_hash_table_unref(writer.files);
+}
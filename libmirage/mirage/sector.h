@@ -62,6 +62,44 @@ typedef enum _MirageSectorValidData
     MIRAGE_VALID_SUBCHAN = 0x20,
 } MirageSectorValidData;
 
+/**
+ * MirageSectorRangeFormat:
+ * @MIRAGE_SECTOR_RANGE_USER_DATA: user data only; size depends on sector type
+ * @MIRAGE_SECTOR_RANGE_RAW: 2352 bytes of raw main channel data
+ * @MIRAGE_SECTOR_RANGE_RAW_PW: 2352 bytes of raw main channel data, followed by 96 bytes of interleaved P-W subchannel
+ * @MIRAGE_SECTOR_RANGE_Q: 16 bytes of Q subchannel
+ *
+ * Per-sector data layout used by mirage_disc_get_sector_range().
+ *
+ * Since: 3.4.0
+ */
+typedef enum _MirageSectorRangeFormat
+{
+    MIRAGE_SECTOR_RANGE_USER_DATA,
+    MIRAGE_SECTOR_RANGE_RAW,
+    MIRAGE_SECTOR_RANGE_RAW_PW,
+    MIRAGE_SECTOR_RANGE_Q,
+} MirageSectorRangeFormat;
+
+/**
+ * MirageSectorStatus:
+ * @MIRAGE_SECTOR_STATUS_TYPE_MASK: mask for sector type (#MirageSectorType)
+ * @MIRAGE_SECTOR_STATUS_EDC_VALID: sector passes L-EC verification
+ * @MIRAGE_SECTOR_STATUS_SUBCHANNEL_CRC_VALID: sector's Q subchannel CRC is valid
+ * @MIRAGE_SECTOR_STATUS_READ_ERROR: sector could not be read; other bits are not set
+ *
+ * Per-sector status byte returned by mirage_disc_get_sector_range_status().
+ *
+ * Since: 3.4.0
+ */
+typedef enum _MirageSectorStatus
+{
+    MIRAGE_SECTOR_STATUS_TYPE_MASK = 0x0F,
+    MIRAGE_SECTOR_STATUS_EDC_VALID = 0x10,
+    MIRAGE_SECTOR_STATUS_SUBCHANNEL_CRC_VALID = 0x20,
+    MIRAGE_SECTOR_STATUS_READ_ERROR = 0x80,
+} MirageSectorStatus;
+
 
 /**********************************************************************\
  *                         MirageSector object                        *
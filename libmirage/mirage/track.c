@@ -685,6 +685,32 @@ gboolean mirage_track_put_sector (MirageTrack *self, MirageSector *sector, GErro
     return TRUE;
 }
 
+/**
+ * mirage_track_flush:
+ * @self: a #MirageTrack
+ * @error: (out) (optional): location to store error, or %NULL
+ *
+ * Writes out sector data that was written to track using mirage_track_put_sector()
+ * and is still held in write-back buffers of track's fragments. See
+ * mirage_fragment_flush() for details.
+ *
+ * Returns: %TRUE on success, %FALSE on failure.
+ *
+ * Since: 3.4.0
+ */
+gboolean mirage_track_flush (MirageTrack *self, GError **error)
+{
+    gboolean succeeded = TRUE;
+
+    for (GList *entry = self->priv->fragments_list; entry; entry = entry->next) {
+        if (!mirage_fragment_flush(entry->data, succeeded ? error : NULL)) {
+            succeeded = FALSE;
+        }
+    }
+
+    return succeeded;
+}
+
 /**
  * mirage_track_layout_get_session_number:
  * @self: a #MirageTrack
@@ -151,6 +151,7 @@ const gchar *mirage_track_get_isrc (MirageTrack *self);
 MirageSector *mirage_track_get_sector (MirageTrack *self, gint address, gboolean abs, GError **error);
 gboolean mirage_track_read_sector (MirageTrack *self, gint address, gboolean abs, MirageSector *sector, GError **error);
 gboolean mirage_track_put_sector (MirageTrack *self, MirageSector *sector, GError **error);
+gboolean mirage_track_flush (MirageTrack *self, GError **error);
 
 /* Layout */
 gint mirage_track_layout_get_session_number (MirageTrack *self);
@@ -21,6 +21,10 @@
 
 #include <glib.h>
 #include <glib-object.h> /* GCallback */
+#include <gio/gio.h>
+
+#include "mirage/stream.h"
+#include "mirage/context.h"
 
 
 G_BEGIN_DECLS
@@ -30,5 +34,24 @@ G_BEGIN_DECLS
 G_GNUC_INTERNAL
 guint mirage_signal_handlers_disconnect_by_func (gpointer instance, GCallback func, gpointer user_data);
 
+/* File streams */
+G_GNUC_INTERNAL
+gsize mirage_file_stream_copy_range (MirageStream *dest, goffset dest_offset, MirageStream *source, goffset source_offset, gsize count);
+
+/* Layout cache */
+G_GNUC_INTERNAL
+MirageStream *mirage_fragment_main_data_peek_stream (MirageFragment *self);
+G_GNUC_INTERNAL
+MirageStream *mirage_fragment_subchannel_data_peek_stream (MirageFragment *self);
+G_GNUC_INTERNAL
+void mirage_disc_foreach_disc_structure (MirageDisc *self, GHFunc func, gpointer user_data);
+
+G_GNUC_INTERNAL
+gchar *mirage_layout_cache_compute_key (gchar **filenames, GHashTable *options);
+G_GNUC_INTERNAL
+MirageDisc *mirage_layout_cache_load (MirageContext *context, const gchar *key);
+G_GNUC_INTERNAL
+void mirage_layout_cache_store (const gchar *key, gchar **filenames, MirageDisc *disc);
+
 
 G_END_DECLS
@@ -1518,3 +1518,215 @@ gchar *mirage_helper_dump_buffer_to_hex (const guint8 *data, gsize data_size, gb
     return g_string_free(data_dump, FALSE); /* Take ownership of the segment data */
 #endif
 }
+
+
+/**********************************************************************\
+ *                         Ordered job queue                          *
+\**********************************************************************/
+typedef struct
+{
+    gpointer job;
+
+    gboolean done;
+    gboolean succeeded;
+} MirageJobQueueEntry;
+
+struct _MirageJobQueue
+{
+    MirageJobFunc process_func;
+    MirageJobFunc complete_func;
+    GDestroyNotify free_func;
+    gpointer user_data;
+
+    GThreadPool *thread_pool;
+
+    GQueue *entries; /* In submission order */
+    guint max_pending_jobs;
+
+    gboolean failed;
+
+    GMutex mutex;
+    GCond cond;
+};
+
+static void mirage_helper_job_queue_process_entry (MirageJobQueueEntry *entry, MirageJobQueue *queue)
+{
+    gboolean succeeded = queue->process_func(entry->job, queue->user_data);
+
+    g_mutex_lock(&queue->mutex);
+    entry->succeeded = succeeded;
+    entry->done = TRUE;
+    g_cond_broadcast(&queue->cond);
+    g_mutex_unlock(&queue->mutex);
+}
+
+static void mirage_helper_job_queue_free_entry (MirageJobQueue *queue, MirageJobQueueEntry *entry)
+{
+    if (queue->free_func) {
+        queue->free_func(entry->job);
+    }
+    g_free(entry);
+}
+
+static gboolean mirage_helper_job_queue_complete (MirageJobQueue *queue, gboolean wait_all)
+{
+    MirageJobQueueEntry *entry;
+
+    /* Complete processed jobs in submission order; wait for the oldest
+     * one if we have too many in flight (or if we are told to wait for
+     * all of them) */
+    while ((entry = g_queue_peek_head(queue->entries))) {
+        gboolean done;
+
+        g_mutex_lock(&queue->mutex);
+        while (!entry->done && (wait_all || g_queue_get_length(queue->entries) > queue->max_pending_jobs)) {
+            g_cond_wait(&queue->cond, &queue->mutex);
+        }
+        done = entry->done;
+        g_mutex_unlock(&queue->mutex);
+
+        if (!done) {
+            break;
+        }
+
+        g_queue_pop_head(queue->entries);
+
+        /* Once a job has failed, results of the remaining ones are
+         * discarded */
+        if (!queue->failed) {
+            if (!entry->succeeded || (queue->complete_func && !queue->complete_func(entry->job, queue->user_data))) {
+                queue->failed = TRUE;
+            }
+        }
+
+        mirage_helper_job_queue_free_entry(queue, entry);
+    }
+
+    return !queue->failed;
+}
+
+/**
+ * mirage_helper_job_queue_new:
+ * @process_func: (in) (scope notified): function that processes a job in a worker thread
+ * @complete_func: (in) (scope notified) (nullable): function that completes a processed job in the submitting thread
+ * @free_func: (in) (nullable): function that frees a job
+ * @user_data: (in) (closure): user data passed to @process_func and @complete_func
+ * @num_threads: (in): number of worker threads
+ * @max_pending_jobs: (in): maximum number of jobs in flight
+ * @error: (out) (allow-none): location to store error, or %NULL
+ *
+ * Creates a job queue for encoders that process their data in
+ * independent chunks, but need to write out the results in the order in
+ * which the chunks were submitted.
+ *
+ * Jobs pushed with mirage_helper_job_queue_push() are processed by
+ * @process_func in one of @num_threads worker threads. Processed jobs
+ * are passed to @complete_func in submission order, from within
+ * mirage_helper_job_queue_push() and mirage_helper_job_queue_wait().
+ * If either function fails, the queue enters failed state, and the
+ * remaining jobs are freed without being completed.
+ *
+ * Returns: (transfer full): a new job queue, or %NULL on failure. The
+ * queue should be freed using mirage_helper_job_queue_free() when no
+ * longer needed.
+ *
+ * Since: 3.4.0
+ */
+MirageJobQueue *mirage_helper_job_queue_new (MirageJobFunc process_func, MirageJobFunc complete_func, GDestroyNotify free_func, gpointer user_data, gint num_threads, guint max_pending_jobs, GError **error)
+{
+    MirageJobQueue *queue = g_new0(MirageJobQueue, 1);
+
+    queue->process_func = process_func;
+    queue->complete_func = complete_func;
+    queue->free_func = free_func;
+    queue->user_data = user_data;
+
+    queue->entries = g_queue_new();
+    queue->max_pending_jobs = MAX(max_pending_jobs, 1);
+
+    g_mutex_init(&queue->mutex);
+    g_cond_init(&queue->cond);
+
+    queue->thread_pool = g_thread_pool_new((GFunc)mirage_helper_job_queue_process_entry, queue, MAX(num_threads, 1), FALSE, error);
+    if (!queue->thread_pool) {
+        mirage_helper_job_queue_free(queue);
+        return NULL;
+    }
+
+    return queue;
+}
+
+/**
+ * mirage_helper_job_queue_push:
+ * @queue: (in): a #MirageJobQueue
+ * @job: (in) (transfer full): job to push
+ *
+ * Pushes @job to @queue, and completes the jobs that have been processed
+ * in the meantime. If there are too many jobs in flight, waits for the
+ * oldest one to be processed.
+ *
+ * If the queue is in failed state, @job is freed right away.
+ *
+ * Returns: %FALSE if the queue is in failed state, %TRUE otherwise
+ *
+ * Since: 3.4.0
+ */
+gboolean mirage_helper_job_queue_push (MirageJobQueue *queue, gpointer job)
+{
+    MirageJobQueueEntry *entry = g_new0(MirageJobQueueEntry, 1);
+
+    entry->job = job;
+
+    if (queue->failed) {
+        mirage_helper_job_queue_free_entry(queue, entry);
+        return FALSE;
+    }
+
+    g_queue_push_tail(queue->entries, entry);
+    g_thread_pool_push(queue->thread_pool, entry, NULL);
+
+    return mirage_helper_job_queue_complete(queue, FALSE);
+}
+
+/**
+ * mirage_helper_job_queue_wait:
+ * @queue: (in): a #MirageJobQueue
+ *
+ * Waits for all jobs in @queue to be processed, and completes them.
+ *
+ * Returns: %FALSE if the queue is in failed state, %TRUE otherwise
+ *
+ * Since: 3.4.0
+ */
+gboolean mirage_helper_job_queue_wait (MirageJobQueue *queue)
+{
+    return mirage_helper_job_queue_complete(queue, TRUE);
+}
+
+/**
+ * mirage_helper_job_queue_free:
+ * @queue: (in): a #MirageJobQueue
+ *
+ * Frees @queue. Jobs that are still being processed are waited for,
+ * and freed together with the pending ones, without being completed.
+ *
+ * Since: 3.4.0
+ */
+void mirage_helper_job_queue_free (MirageJobQueue *queue)
+{
+    MirageJobQueueEntry *entry;
+
+    if (queue->thread_pool) {
+        g_thread_pool_free(queue->thread_pool, FALSE, TRUE);
+    }
+
+    while ((entry = g_queue_pop_head(queue->entries))) {
+        mirage_helper_job_queue_free_entry(queue, entry);
+    }
+    g_queue_free(queue->entries);
+
+    g_mutex_clear(&queue->mutex);
+    g_cond_clear(&queue->cond);
+
+    g_free(queue);
+}
@@ -160,4 +160,33 @@ gchar *mirage_helper_format_stringd (const gchar *format, GHashTable *dictionary
 gchar *mirage_helper_dump_buffer_to_hex (const guint8 *data, gsize data_size, gboolean add_spaces, gint wrap);
 
 
+/* Ordered job queue for multi-threaded encoders */
+/**
+ * MirageJobQueue:
+ *
+ * An opaque structure representing an ordered job queue.
+ *
+ * Since: 3.4.0
+ */
+typedef struct _MirageJobQueue MirageJobQueue;
+
+/**
+ * MirageJobFunc:
+ * @job: (in): job to process
+ * @user_data: (in) (closure): user data passed to mirage_helper_job_queue_new()
+ *
+ * Processes a job; called from one of the queue's worker threads.
+ *
+ * Returns: %TRUE on success, %FALSE on failure
+ *
+ * Since: 3.4.0
+ */
+typedef gboolean (*MirageJobFunc) (gpointer job, gpointer user_data);
+
+MirageJobQueue *mirage_helper_job_queue_new (MirageJobFunc process_func, MirageJobFunc complete_func, GDestroyNotify free_func, gpointer user_data, gint num_threads, guint max_pending_jobs, GError **error);
+gboolean mirage_helper_job_queue_push (MirageJobQueue *queue, gpointer job);
+gboolean mirage_helper_job_queue_wait (MirageJobQueue *queue);
+void mirage_helper_job_queue_free (MirageJobQueue *queue);
+
+
 G_END_DECLS
@@ -58,11 +58,15 @@
 
 #include "mirage/config.h"
 #include "mirage/mirage.h"
+#include "mirage/utils-private.h"
 
 #include <glib/gi18n-lib.h>
 
 #define __debug__ "Writer"
 
+/* Number of sectors copied per call when copying fragment data verbatim */
+#define CONVERSION_COPY_CHUNK 4096
+
 
 /**********************************************************************\
  *                  Object and its private structure                  *
@@ -80,6 +84,11 @@ struct _MirageWriterPrivate
 
     /* Progress signalling */
     guint progress_step;
+
+    /* Conversion progress tracking; valid only during conversion */
+    gint conversion_start;
+    guint conversion_step_size;
+    guint conversion_progress;
 };
 
 
@@ -500,6 +509,53 @@ MirageFragment *mirage_writer_create_fragment (MirageWriter *self, MirageTrack *
 }
 
 
+static gboolean mirage_writer_finish_streams (MirageDisc *disc, GError **error)
+{
+    GHashTable *finished_streams = g_hash_table_new(NULL, NULL);
+    gint num_tracks = mirage_disc_get_number_of_tracks(disc);
+    gboolean succeeded = TRUE;
+
+    /* Filter streams that fragments write through (e.g., compressing
+     * ones) are finished here, so that their errors are reported. A
+     * stream may be shared by several fragments; finish it only once */
+    for (gint i = 0; i < num_tracks && succeeded; i++) {
+        MirageTrack *track = mirage_disc_get_track_by_index(disc, i, NULL);
+        if (!track) {
+            continue;
+        }
+
+        gint num_fragments = mirage_track_get_number_of_fragments(track);
+        for (gint j = 0; j < num_fragments && succeeded; j++) {
+            MirageFragment *fragment = mirage_track_get_fragment_by_index(track, j, NULL);
+            if (!fragment) {
+                continue;
+            }
+
+            MirageStream *streams[2] = {
+                mirage_fragment_main_data_peek_stream(fragment),
+                mirage_fragment_subchannel_data_peek_stream(fragment),
+            };
+
+            for (gint k = 0; k < 2 && succeeded; k++) {
+                if (!streams[k] || !MIRAGE_IS_FILTER_STREAM(streams[k]) || g_hash_table_contains(finished_streams, streams[k])) {
+                    continue;
+                }
+                g_hash_table_add(finished_streams, streams[k]);
+
+                succeeded = mirage_filter_stream_finish(MIRAGE_FILTER_STREAM(streams[k]), error);
+            }
+
+            g_object_unref(fragment);
+        }
+
+        g_object_unref(track);
+    }
+
+    g_hash_table_unref(finished_streams);
+
+    return succeeded;
+}
+
 /**
  * mirage_writer_finalize_image:
  * @self: a #MirageWriter
@@ -507,14 +563,35 @@ MirageFragment *mirage_writer_create_fragment (MirageWriter *self, MirageTrack *
  * @error: (out) (optional): location to store error, or %NULL
  *
  * Finalizes the image, possibly creating the image descriptor file if
- * necessary.
+ * necessary. Data files that are written through filter streams are
+ * finished as well (see mirage_filter_stream_finish()).
  *
  * Returns: %TRUE on success, %FALSE on failure
  */
 gboolean mirage_writer_finalize_image (MirageWriter *self, MirageDisc *disc, GError **error)
 {
+    gboolean succeeded = TRUE;
+
+    /* Write out data still held in fragments' write-back buffers, so
+     * that data files are complete before implementation finalizes them */
+    gint num_tracks = mirage_disc_get_number_of_tracks(disc);
+    for (gint i = 0; i < num_tracks && succeeded; i++) {
+        MirageTrack *track = mirage_disc_get_track_by_index(disc, i, NULL);
+        if (track) {
+            succeeded = mirage_track_flush(track, error);
+            g_object_unref(track);
+        }
+    }
+
     /* Provided by implementation */
-    gboolean succeeded = MIRAGE_WRITER_GET_CLASS(self)->finalize_image(self, disc, error);
+    if (succeeded) {
+        succeeded = MIRAGE_WRITER_GET_CLASS(self)->finalize_image(self, disc, error);
+    }
+
+    /* Complete data files that are written through filter streams */
+    if (succeeded) {
+        succeeded = mirage_writer_finish_streams(disc, error);
+    }
 
     /* Free parameters */
     if (self->priv->parameters) {
@@ -553,6 +630,87 @@ void mirage_writer_set_conversion_progress_step (MirageWriter *self, guint step)
 }
 
 
+static void mirage_writer_report_conversion_progress (MirageWriter *self, gint sector_address)
+{
+    if (!self->priv->conversion_step_size) {
+        return;
+    }
+
+    guint sector_count = sector_address - self->priv->conversion_start;
+
+    /* Verbatim copy advances by more than one sector at a time, so
+     * several progress marks might have been reached */
+    while (sector_count >= self->priv->conversion_progress*self->priv->conversion_step_size) {
+        g_signal_emit_by_name(self, "conversion-progress", self->priv->conversion_progress*self->priv->progress_step, NULL);
+        self->priv->conversion_progress++;
+    }
+}
+
+static gboolean mirage_writer_convert_fragment (MirageWriter *self, MirageTrack *original_track, MirageTrack *new_track, gint index, MirageSector *sector, GCancellable *cancellable, GError **error)
+{
+    MirageFragment *original_fragment = mirage_track_get_fragment_by_index(original_track, index, error);
+    if (!original_fragment) {
+        return FALSE;
+    }
+
+    MirageFragment *new_fragment = mirage_track_get_fragment_by_index(new_track, index, error);
+    if (!new_fragment) {
+        g_object_unref(original_fragment);
+        return FALSE;
+    }
+
+    gint layout_start = mirage_track_layout_get_start_sector(original_track);
+    gint fragment_address = mirage_fragment_get_address(original_fragment);
+    gint fragment_length = mirage_fragment_get_length(original_fragment);
+    gboolean succeeded = TRUE;
+
+    if (mirage_fragment_can_copy_data_from(new_fragment, original_fragment)) {
+        /* Data layout is the same; copy whole extents verbatim */
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: copying fragment %d data verbatim (%d sectors)", __debug__, index, fragment_length);
+
+        for (gint address = 0; address < fragment_length && succeeded; address += CONVERSION_COPY_CHUNK) {
+            gint num_sectors = MIN(CONVERSION_COPY_CHUNK, fragment_length - address);
+
+            mirage_writer_report_conversion_progress(self, layout_start + fragment_address + address);
+
+            succeeded = mirage_fragment_copy_data_from(new_fragment, original_fragment, address, num_sectors, error);
+
+            /* Check if conversion is to be cancelled at user's request */
+            succeeded = succeeded && !g_cancellable_set_error_if_cancelled(cancellable, error);
+        }
+    } else {
+        /* Copy sectors, one by one */
+        MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: copying fragment %d sectors (%d)", __debug__, index, fragment_length);
+
+        for (gint sector_address = fragment_address; sector_address < fragment_address + fragment_length && succeeded; sector_address++) {
+            /* Get sector from original track using track-relative address... */
+            if (mirage_track_read_sector(original_track, sector_address, FALSE, sector, error)) {
+                mirage_writer_report_conversion_progress(self, mirage_sector_get_address(sector));
+
+                /* ... and put it into new track */
+                succeeded = mirage_track_put_sector(new_track, sector, error);
+            } else {
+                succeeded = FALSE;
+            }
+
+            /* Check if conversion is to be cancelled at user's request */
+            succeeded = succeeded && !g_cancellable_set_error_if_cancelled(cancellable, error);
+        }
+    }
+
+    /* Write out buffered data before moving on to the next fragment, so
+     * that write errors are reported here instead of being lost when the
+     * fragment is disposed of */
+    if (succeeded) {
+        succeeded = mirage_fragment_flush(new_fragment, error);
+    }
+
+    g_object_unref(new_fragment);
+    g_object_unref(original_fragment);
+
+    return succeeded;
+}
+
 /**
  * mirage_writer_convert_image:
  * @self: a #MirageWriter
@@ -568,15 +726,20 @@ void mirage_writer_set_conversion_progress_step (MirageWriter *self, guint step)
  * the #MirageWriter::conversion-progress signal is emitted at specified
  * time intervals during conversion.
  *
+ * Whenever the original and the new fragment store main channel data
+ * in the same format and no subchannel conversion is required, the
+ * fragment's data is copied verbatim in large blocks (see mirage_fragment_copy_data_from())
+ * instead of sector by sector.
+ *
  * Returns: %TRUE on success, %FALSE on failure
  */
 gboolean mirage_writer_convert_image (MirageWriter *self, const gchar *filename, MirageDisc *original_disc, GHashTable *parameters, GCancellable *cancellable, GError **error)
 {
     /* Conversion progress tracking */
     gint num_all_sectors = mirage_disc_layout_get_length(original_disc);
-    gint disc_layout_start = mirage_disc_layout_get_start_sector(original_disc);
-    guint progress_step_size = num_all_sectors*self->priv->progress_step/100;
-    guint conversion_progress = 0;
+    self->priv->conversion_start = mirage_disc_layout_get_start_sector(original_disc);
+    self->priv->conversion_step_size = num_all_sectors*self->priv->progress_step/100;
+    self->priv->conversion_progress = 0;
 
     MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: image conversion; filename '%s', original disc: %p", __debug__, filename, (void *)original_disc);
 
@@ -651,7 +814,6 @@ gboolean mirage_writer_convert_image (MirageWriter *self, const gchar *filename,
             gint num_fragments;
 
             gint track_start;
-            gint num_sectors;
 
             MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: processing track %d...", __debug__, j);
 
@@ -736,33 +898,9 @@ gboolean mirage_writer_convert_image (MirageWriter *self, const gchar *filename,
                 g_object_unref(fragment);
             }
 
-            /* Now, copy sectors, one by one */
-            num_sectors = mirage_track_layout_get_length(original_track);
-            MIRAGE_DEBUG(self, MIRAGE_DEBUG_WRITER, "%s: copying sectors (%d)", __debug__, num_sectors);
-            for (gint sector_address = 0; sector_address < num_sectors; sector_address++) {
-                gboolean succeeded = TRUE;
-
-                /* Get sector from original track using track-relative address... */
-                if (mirage_track_read_sector(original_track, sector_address, FALSE, sector, error)) {
-                    if (progress_step_size) {
-                        guint sector_count = mirage_sector_get_address(sector) - disc_layout_start;
-
-                        if (sector_count >= conversion_progress*progress_step_size) {
-                            g_signal_emit_by_name(self, "conversion-progress", conversion_progress*self->priv->progress_step, NULL);
-                            conversion_progress++;
-                        }
-                    }
-
-                    /* ... and put it into new track */
-                    succeeded = mirage_track_put_sector(new_track, sector, error);
-                } else {
-                    succeeded = FALSE;
-                }
-
-                /* Check if conversion is to be cancelled at user's request */
-                succeeded &= !g_cancellable_set_error_if_cancelled(cancellable, error);
-
-                if (!succeeded) {
+            /* Now, copy the data, fragment by fragment */
+            for (gint k = 0; k < num_fragments; k++) {
+                if (!mirage_writer_convert_fragment(self, original_track, new_track, k, sector, cancellable, error)) {
                     g_object_unref(sector);
                     g_object_unref(new_track);
                     g_object_unref(original_track);
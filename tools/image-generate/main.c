@@ -0,0 +1,876 @@
+/*
+ *  Synthetic optical disc image generator
+ *  Copyright (C) 2026 Rok Mandeljc
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <mirage/mirage.h>
+
+
+/**********************************************************************\
+ *                           Layout description                       *
+\**********************************************************************/
+typedef struct
+{
+    const gchar *name;
+    MirageSectorType sector_type;
+    gint main_size; /* Size of data we feed to the sector */
+} TrackTypeInfo;
+
+static const TrackTypeInfo track_types[] = {
+    {"audio", MIRAGE_SECTOR_AUDIO, 2352},
+    {"mode1", MIRAGE_SECTOR_MODE1, 2048},
+    {"mode2", MIRAGE_SECTOR_MODE2, 2336},
+    {"mode2-form1", MIRAGE_SECTOR_MODE2_FORM1, 2048},
+    {"mode2-form2", MIRAGE_SECTOR_MODE2_FORM2, 2324},
+    {"mode2-mixed", MIRAGE_SECTOR_MODE2_MIXED, 2332}, /* Subheader + data */
+};
+
+typedef struct
+{
+    const TrackTypeInfo *type;
+    gint length;
+} TrackSpec;
+
+typedef struct
+{
+    gint medium_type;
+    GPtrArray *sessions; /* GArray of TrackSpec per session */
+} LayoutSpec;
+
+
+static const TrackTypeInfo *_lookup_track_type (const gchar *name)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(track_types); i++) {
+        if (!g_ascii_strcasecmp(track_types[i].name, name)) {
+            return &track_types[i];
+        }
+    }
+    return NULL;
+}
+
+static void _layout_spec_free (LayoutSpec *layout)
+{
+    if (layout) {
+        g_ptr_array_unref(layout->sessions);
+        g_free(layout);
+    }
+}
+
+static gboolean _parse_track_string (const gchar *track_str, gint medium_type, TrackSpec *track)
+{
+    gchar **fields = g_strsplit(track_str, ":", 2);
+    gchar *endptr = NULL;
+    gboolean succeeded = FALSE;
+
+    if (g_strv_length(fields) != 2) {
+        g_printerr("Invalid track specification '%s' (expected type:length)!\n", track_str);
+    } else if (!(track->type = _lookup_track_type(g_strstrip(fields[0])))) {
+        g_printerr("Invalid track type '%s'!\n", fields[0]);
+    } else if ((track->length = strtol(fields[1], &endptr, 10)) <= 0 || *endptr) {
+        g_printerr("Invalid track length '%s'!\n", fields[1]);
+    } else if (medium_type != MIRAGE_MEDIUM_CD && track->type->sector_type != MIRAGE_SECTOR_MODE1) {
+        g_printerr("Only mode1 tracks are supported on non-CD media!\n");
+    } else {
+        succeeded = TRUE;
+    }
+
+    g_strfreev(fields);
+    return succeeded;
+}
+
+/* Layout string: sessions are separated by ';', tracks within session
+ * by ',', and each track is given as type:length, with length in sectors.
+ * For example: "mode1:4500,audio:3000;mode2-form1:1500" */
+static LayoutSpec *_parse_layout_string (const gchar *layout_str, gint medium_type)
+{
+    LayoutSpec *layout = g_new0(LayoutSpec, 1);
+    gchar **sessions_str = g_strsplit(layout_str, ";", -1);
+    gboolean succeeded = TRUE;
+
+    layout->medium_type = medium_type;
+    layout->sessions = g_ptr_array_new_with_free_func((GDestroyNotify)g_array_unref);
+
+    for (gint s = 0; sessions_str[s] && succeeded; s++) {
+        GArray *tracks = g_array_new(FALSE, FALSE, sizeof(TrackSpec));
+        gchar **tracks_str = g_strsplit(sessions_str[s], ",", -1);
+
+        g_ptr_array_add(layout->sessions, tracks);
+
+        for (gint t = 0; tracks_str[t] && succeeded; t++) {
+            TrackSpec track;
+            succeeded = _parse_track_string(g_strstrip(tracks_str[t]), medium_type, &track);
+            if (succeeded) {
+                g_array_append_val(tracks, track);
+            }
+        }
+        g_strfreev(tracks_str);
+
+        if (succeeded && !tracks->len) {
+            g_printerr("Session #%d has no tracks!\n", s + 1);
+            succeeded = FALSE;
+        }
+    }
+    g_strfreev(sessions_str);
+
+    if (succeeded && medium_type != MIRAGE_MEDIUM_CD && layout->sessions->len > 1) {
+        g_printerr("Multi-session layouts are supported only on CD media!\n");
+        succeeded = FALSE;
+    }
+
+    if (!succeeded) {
+        _layout_spec_free(layout);
+        return NULL;
+    }
+
+    return layout;
+}
+
+
+/**********************************************************************\
+ *                      Deterministic data pattern                    *
+\**********************************************************************/
+typedef struct
+{
+    guint64 seed;
+    gint compressibility; /* Percentage of compressible 64-byte blocks */
+    gboolean rw_subchannel;
+} PatternOptions;
+
+/* SplitMix64; we use our own generator instead of GRand so that the
+ * generated corpus is reproducible and can be keyed per sector */
+static guint64 _splitmix64 (guint64 *state)
+{
+    guint64 z = (*state += G_GUINT64_CONSTANT(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * G_GUINT64_CONSTANT(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * G_GUINT64_CONSTANT(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+static guint64 _sector_state (const PatternOptions *options, gint address, guint64 stream)
+{
+    return options->seed ^ ((guint64)(guint32)address * G_GUINT64_CONSTANT(0xD1B54A32D192ED03)) ^ (stream << 56);
+}
+
+static void _generate_data (const PatternOptions *options, gint address, guint8 *buffer, gint length)
+{
+    guint64 state = _sector_state(options, address, 0);
+
+    /* Data is generated in 64-byte blocks; each block is either random
+     * or a run of a single byte, which gives us control over how well
+     * the image compresses */
+    for (gint offset = 0; offset < length; offset += 64) {
+        gint block_length = MIN(64, length - offset);
+        guint64 value = _splitmix64(&state);
+
+        if ((gint)(value % 100) < options->compressibility) {
+            memset(buffer + offset, address & 0xFF, block_length);
+        } else {
+            for (gint i = 0; i < block_length; i++) {
+                if (i % 8 == 0) {
+                    value = _splitmix64(&state);
+                }
+                buffer[offset + i] = value >> (8 * (i % 8));
+            }
+        }
+    }
+}
+
+static void _generate_audio (const PatternOptions *options, gint address, guint8 *buffer)
+{
+    guint64 state = _sector_state(options, address, 1);
+    gint noise_amplitude = (100 - options->compressibility) * 2048 / 100;
+
+    /* 588 stereo 16-bit little-endian samples; ~441 Hz triangle wave
+     * with a bit of deterministic noise on top */
+    for (gint i = 0; i < 588; i++) {
+        gint64 position = ((gint64)address * 588 + i) % 100;
+        if (position < 0) {
+            position += 100;
+        }
+        gint triangle = (position < 50 ? position : 100 - position) * 640 - 16000;
+
+        for (gint channel = 0; channel < 2; channel++) {
+            gint sample = triangle;
+            if (noise_amplitude) {
+                sample += (gint)(_splitmix64(&state) % (2 * noise_amplitude + 1)) - noise_amplitude;
+            }
+            sample = CLAMP(sample, G_MININT16, G_MAXINT16);
+
+            buffer[i*4 + channel*2 + 0] = sample & 0xFF;
+            buffer[i*4 + channel*2 + 1] = (sample >> 8) & 0xFF;
+        }
+    }
+}
+
+static void _generate_sector_data (const PatternOptions *options, const TrackTypeInfo *type, gint address, guint8 *buffer)
+{
+    memset(buffer, 0, 2352);
+
+    switch (type->sector_type) {
+        case MIRAGE_SECTOR_AUDIO: {
+            _generate_audio(options, address, buffer);
+            break;
+        }
+        case MIRAGE_SECTOR_MODE2_MIXED: {
+            /* Alternate between Form 1 and Form 2 in runs of 16 sectors,
+             * similar to interleaved video/audio streams */
+            gboolean form2 = (address / 16) & 1;
+            guint8 subheader[4] = { 0x01, 0x00, form2 ? 0x64 : 0x08, 0x00 };
+
+            memcpy(buffer + 0, subheader, 4);
+            memcpy(buffer + 4, subheader, 4);
+            _generate_data(options, address, buffer + 8, form2 ? 2324 : 2048);
+            break;
+        }
+        default: {
+            _generate_data(options, address, buffer, type->main_size);
+            break;
+        }
+    }
+}
+
+static gboolean _set_rw_subchannel (const PatternOptions *options, MirageSector *sector, gint address, GError **error)
+{
+    const guint8 *pw_data;
+    guint8 pw_buffer[96];
+    guint64 state = _sector_state(options, address, 2);
+    guint64 value = 0;
+
+    /* Obtain P-Q, as generated by libMirage, and fill in R-W */
+    if (!mirage_sector_get_subchannel(sector, MIRAGE_SUBCHANNEL_PW, &pw_data, NULL, error)) {
+        return FALSE;
+    }
+    memcpy(pw_buffer, pw_data, sizeof(pw_buffer));
+
+    for (gint i = 0; i < 96; i++) {
+        if (i % 8 == 0) {
+            value = _splitmix64(&state);
+        }
+        pw_buffer[i] = (pw_buffer[i] & 0xC0) | ((value >> (8 * (i % 8))) & 0x3F);
+    }
+
+    return mirage_sector_set_subchannel(sector, MIRAGE_SUBCHANNEL_PW, pw_buffer, sizeof(pw_buffer), error);
+}
+
+
+/**********************************************************************\
+ *                            Disc creation                           *
+\**********************************************************************/
+static MirageTrack *_create_track (MirageWriter *writer, MirageDisc *disc, MirageSession *session, const TrackSpec *spec, GError **error)
+{
+    MirageTrack *track = g_object_new(MIRAGE_TYPE_TRACK, NULL);
+    MirageFragment *fragment;
+
+    mirage_track_set_sector_type(track, spec->type->sector_type);
+
+    mirage_session_add_track_by_index(session, -1, track);
+
+    /* On CD media, each track gets a 150-sector pregap, same as in
+     * track-at-once recording */
+    if (mirage_disc_get_medium_type(disc) == MIRAGE_MEDIUM_CD) {
+        fragment = mirage_writer_create_fragment(writer, track, MIRAGE_FRAGMENT_PREGAP, error);
+        if (!fragment) {
+            g_object_unref(track);
+            return NULL;
+        }
+
+        mirage_fragment_set_length(fragment, 150);
+        mirage_track_add_fragment(track, -1, fragment);
+        g_object_unref(fragment);
+
+        mirage_track_set_track_start(track, 150);
+    }
+
+    /* Data fragment; grows as sectors are appended */
+    fragment = mirage_writer_create_fragment(writer, track, MIRAGE_FRAGMENT_DATA, error);
+    if (!fragment) {
+        g_object_unref(track);
+        return NULL;
+    }
+
+    mirage_track_add_fragment(track, -1, fragment);
+    g_object_unref(fragment);
+
+    return track;
+}
+
+static gboolean _write_track (MirageTrack *track, const TrackSpec *spec, const PatternOptions *options, MirageSector *sector, guint8 *buffer, GError **error)
+{
+    gint start_address = mirage_track_layout_get_start_sector(track) + mirage_track_get_track_start(track);
+
+    for (gint address = start_address; address < start_address + spec->length; address++) {
+        _generate_sector_data(options, spec->type, address, buffer);
+
+        if (!mirage_sector_feed_data(sector, address, spec->type->sector_type, buffer, spec->type->main_size, MIRAGE_SUBCHANNEL_NONE, NULL, 0, 0, error)) {
+            return FALSE;
+        }
+
+        /* Sector needs its parent for generation of missing data
+         * (headers, EDC/ECC, Q subchannel) */
+        mirage_object_set_parent(MIRAGE_OBJECT(sector), track);
+
+        if (options->rw_subchannel && !_set_rw_subchannel(options, sector, address, error)) {
+            return FALSE;
+        }
+
+        if (!mirage_track_put_sector(track, sector, error)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static gboolean _generate_disc (MirageWriter *writer, MirageDisc *disc, const LayoutSpec *layout, const PatternOptions *options, GError **error)
+{
+    MirageSector *sector = g_object_new(MIRAGE_TYPE_SECTOR, NULL);
+    guint8 *buffer = g_malloc(2352);
+    gboolean succeeded = TRUE;
+
+    for (guint s = 0; s < layout->sessions->len && succeeded; s++) {
+        GArray *tracks = g_ptr_array_index(layout->sessions, s);
+        MirageSession *session = g_object_new(MIRAGE_TYPE_SESSION, NULL);
+        gboolean has_data = FALSE, has_mode2 = FALSE;
+
+        for (guint t = 0; t < tracks->len; t++) {
+            const TrackSpec *spec = &g_array_index(tracks, TrackSpec, t);
+            has_data |= spec->type->sector_type != MIRAGE_SECTOR_AUDIO;
+            has_mode2 |= spec->type->sector_type >= MIRAGE_SECTOR_MODE2 && spec->type->sector_type <= MIRAGE_SECTOR_MODE2_MIXED;
+        }
+        mirage_session_set_session_type(session, has_mode2 ? MIRAGE_SESSION_CDROM_XA : has_data ? MIRAGE_SESSION_CDROM : MIRAGE_SESSION_CDDA);
+
+        /* Lead-out (and lead-in of the following session) */
+        if (layout->medium_type == MIRAGE_MEDIUM_CD && s < layout->sessions->len - 1) {
+            mirage_session_set_leadout_length(session, s == 0 ? 11250 : 6750);
+        }
+
+        mirage_disc_add_session_by_index(disc, -1, session);
+
+        for (guint t = 0; t < tracks->len; t++) {
+            const TrackSpec *spec = &g_array_index(tracks, TrackSpec, t);
+            MirageTrack *track = _create_track(writer, disc, session, spec, error);
+
+            if (!track) {
+                succeeded = FALSE;
+                break;
+            }
+
+            g_printerr("  session #%d, track #%d: %s, %d sectors at %d\n", s + 1, mirage_track_layout_get_track_number(track), spec->type->name, spec->length, mirage_track_layout_get_start_sector(track) + mirage_track_get_track_start(track));
+
+            succeeded = _write_track(track, spec, options, sector, buffer, error);
+            g_object_unref(track);
+            if (!succeeded) {
+                break;
+            }
+        }
+
+        g_object_unref(session);
+    }
+
+    g_free(buffer);
+    g_object_unref(sector);
+
+    if (!succeeded) {
+        return FALSE;
+    }
+
+    return mirage_writer_finalize_image(writer, disc, error);
+}
+
+/* Collects names of all main channel data files that make up the image */
+static GPtrArray *_collect_data_files (MirageDisc *disc)
+{
+    GPtrArray *filenames = g_ptr_array_new_with_free_func(g_free);
+    gint num_tracks = mirage_disc_get_number_of_tracks(disc);
+
+    for (gint t = 0; t < num_tracks; t++) {
+        MirageTrack *track = mirage_disc_get_track_by_index(disc, t, NULL);
+        gint num_fragments = mirage_track_get_number_of_fragments(track);
+
+        for (gint f = 0; f < num_fragments; f++) {
+            MirageFragment *fragment = mirage_track_get_fragment_by_index(track, f, NULL);
+            const gchar *filename = mirage_fragment_main_data_get_filename(fragment);
+            gboolean found = FALSE;
+
+            for (guint i = 0; filename && i < filenames->len; i++) {
+                found |= !g_strcmp0(g_ptr_array_index(filenames, i), filename);
+            }
+            if (filename && !found) {
+                g_ptr_array_add(filenames, g_strdup(filename));
+            }
+
+            g_object_unref(fragment);
+        }
+
+        g_object_unref(track);
+    }
+
+    return filenames;
+}
+
+
+/**********************************************************************\
+ *                         External encoders                          *
+\**********************************************************************/
+typedef struct
+{
+    const gchar *name;
+    const gchar *suffix;
+    gboolean whole_image; /* Operates on image descriptor rather than on data files */
+} EncoderInfo;
+
+/* DAA, ISZ, NRG, MDS and CCD have neither libMirage writer nor a freely
+ * available encoder, so they cannot be generated here */
+static const EncoderInfo encoders[] = {
+    {"gzip", ".gz", FALSE},
+    {"xz", ".xz", FALSE},
+    {"cso", ".cso", FALSE},
+    {"zso", ".zso", FALSE},
+    {"ecm", ".ecm", FALSE},
+    {"chd", ".chd", TRUE},
+};
+
+static gboolean _run_encoder (const EncoderInfo *encoder, const gchar *input, gint xz_block_size)
+{
+    gchar *output = g_strconcat(input, encoder->suffix, NULL);
+    gchar *block_size_arg = g_strdup_printf("--block-size=%d", xz_block_size);
+    const gchar *argv[16] = { NULL };
+    GError *error = NULL;
+    gint wait_status;
+    gboolean succeeded;
+
+    if (!g_strcmp0(encoder->name, "gzip")) {
+        /* -n omits name and timestamp, so that output is reproducible */
+        const gchar *args[] = { "gzip", "-n", "-9", "-k", "-f", input, NULL };
+        memcpy(argv, args, sizeof(args));
+    } else if (!g_strcmp0(encoder->name, "xz")) {
+        /* Fixed block size gives multi-block stream with index, which
+         * is what allows random access in the XZ filter */
+        const gchar *args[] = { "xz", "-k", "-f", "-T0", block_size_arg, input, NULL };
+        memcpy(argv, args, sizeof(args));
+    } else if (!g_strcmp0(encoder->name, "cso")) {
+        const gchar *args[] = { "maxcso", "--format=cso1", input, "-o", output, NULL };
+        memcpy(argv, args, sizeof(args));
+    } else if (!g_strcmp0(encoder->name, "zso")) {
+        const gchar *args[] = { "maxcso", "--format=zso", input, "-o", output, NULL };
+        memcpy(argv, args, sizeof(args));
+    } else if (!g_strcmp0(encoder->name, "ecm")) {
+        const gchar *args[] = { "ecm", input, output, NULL };
+        memcpy(argv, args, sizeof(args));
+    } else if (!g_strcmp0(encoder->name, "chd")) {
+        const gchar *args[] = { "chdman", "createcd", "-f", "-i", input, "-o", output, NULL };
+        memcpy(argv, args, sizeof(args));
+    }
+
+    g_printerr("Encoding %s -> %s (%s)\n", input, output, argv[0]);
+
+    succeeded = g_spawn_sync(NULL, (gchar **)argv, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, NULL, &wait_status, &error);
+    if (succeeded) {
+#if GLIB_CHECK_VERSION(2, 70, 0)
+        succeeded = g_spawn_check_wait_status(wait_status, &error);
+#else
+        succeeded = g_spawn_check_exit_status(wait_status, &error);
+#endif
+    }
+    if (!succeeded) {
+        g_printerr("Failed to run encoder '%s': %s\n", argv[0], error->message);
+        g_error_free(error);
+    }
+
+    g_free(block_size_arg);
+    g_free(output);
+
+    return succeeded;
+}
+
+
+/**********************************************************************\
+ *                         Debug mask helpers                         *
+\**********************************************************************/
+struct _name_value_entry_t
+{
+    gchar *name;
+    gint value;
+};
+
+/* Short names, as used in GI bindings */
+static const struct _name_value_entry_t _DEBUG_MASK_ENTRIES_SHORT[] = {
+    {"PARSER", MIRAGE_DEBUG_PARSER},
+    {"DISC", MIRAGE_DEBUG_DISC},
+    {"SESSION", MIRAGE_DEBUG_SESSION},
+    {"TRACK", MIRAGE_DEBUG_TRACK},
+    {"SECTOR", MIRAGE_DEBUG_SECTOR},
+    {"FRAGMENT", MIRAGE_DEBUG_FRAGMENT},
+    {"CDTEXT", MIRAGE_DEBUG_CDTEXT},
+    {"STREAM", MIRAGE_DEBUG_STREAM},
+    {"IMAGE_ID", MIRAGE_DEBUG_IMAGE_ID},
+    {"WRITER", MIRAGE_DEBUG_WRITER}
+};
+
+/* Full names with MIRAGE_DEBUG_ prefix */
+static const struct _name_value_entry_t _DEBUG_MASK_ENTRIES_LONG[] = {
+    {"MIRAGE_DEBUG_PARSER", MIRAGE_DEBUG_PARSER},
+    {"MIRAGE_DEBUG_DISC", MIRAGE_DEBUG_DISC},
+    {"MIRAGE_DEBUG_SESSION", MIRAGE_DEBUG_SESSION},
+    {"MIRAGE_DEBUG_TRACK", MIRAGE_DEBUG_TRACK},
+    {"MIRAGE_DEBUG_SECTOR", MIRAGE_DEBUG_SECTOR},
+    {"MIRAGE_DEBUG_FRAGMENT", MIRAGE_DEBUG_FRAGMENT},
+    {"MIRAGE_DEBUG_CDTEXT", MIRAGE_DEBUG_CDTEXT},
+    {"MIRAGE_DEBUG_STREAM", MIRAGE_DEBUG_STREAM},
+    {"MIRAGE_DEBUG_IMAGE_ID", MIRAGE_DEBUG_IMAGE_ID},
+    {"MIRAGE_DEBUG_WRITER", MIRAGE_DEBUG_WRITER},
+};
+
+static gboolean _match_debug_mask_name (const gchar *name, const guint len, const struct _name_value_entry_t *entries, const guint num_entries, glong *out_value)
+{
+    for (guint i = 0; i < num_entries; i++) {
+        const struct _name_value_entry_t *entry = &entries[i];
+        if (g_ascii_strncasecmp(entry->name, name, len) == 0) {
+            *out_value |= entry->value;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static gboolean _parse_debug_mask_string (const gchar *mask_str, gint *mask)
+{
+    *mask = 0;
+
+    /* No string or empty string */
+    if (!mask_str || !mask_str[0]) {
+        return TRUE;
+    }
+
+    /* Try to parse as integer */
+    gchar *end_ptr;
+    glong tmp_value = strtol(mask_str, &end_ptr, 0);
+    if (*end_ptr == 0) {
+        *mask = tmp_value;
+        return TRUE;
+    }
+
+    /* Try to parse as NAME1|NAME2|... */
+    tmp_value = 0;
+    const gchar *ptr = mask_str;
+
+    while (ptr && *ptr != 0) {
+        gboolean valid = FALSE;
+        guint len;
+
+        end_ptr = strchr(ptr, '|');
+        if (end_ptr) {
+            len = end_ptr - ptr;
+        } else {
+            len = strlen(ptr);
+        }
+
+        /* Try to match short name */
+        valid = _match_debug_mask_name(ptr, len, _DEBUG_MASK_ENTRIES_SHORT, G_N_ELEMENTS(_DEBUG_MASK_ENTRIES_SHORT), &tmp_value);
+        if (!valid) {
+            valid = _match_debug_mask_name(ptr, len, _DEBUG_MASK_ENTRIES_LONG, G_N_ELEMENTS(_DEBUG_MASK_ENTRIES_LONG), &tmp_value);
+        }
+        if (!valid) {
+            g_printerr("Unhandled debug mask string: %.*s\n", len, ptr);
+            return FALSE;
+        }
+
+        ptr = end_ptr ? (end_ptr + 1) : NULL;
+    }
+
+    *mask = tmp_value;
+    return TRUE;
+}
+
+
+/**********************************************************************\
+ *                                Main                                *
+\**********************************************************************/
+static void _libmirage_log_handler (
+    const gchar *log_domain,
+    GLogLevelFlags log_level,
+    const gchar *message,
+    gpointer unused_data G_GNUC_UNUSED
+)
+{
+    switch (log_level) {
+        case G_LOG_LEVEL_ERROR: {
+            g_printerr("%s [ERROR]: %s\n", log_domain, message);
+            break;
+        }
+        case G_LOG_LEVEL_WARNING: {
+            g_printerr("%s [WARNING]: %s\n", log_domain, message);
+            break;
+        }
+        default: {
+            g_printerr("%s: %s\n", log_domain, message);
+            break;
+        }
+    }
+}
+
+static gboolean _add_writer_parameter (MirageWriter *writer, GHashTable *parameters, const gchar *id, const gchar *value_str)
+{
+    const MirageWriterParameter *info = mirage_writer_lookup_parameter_info(writer, id);
+    GVariant *value;
+
+    if (!info) {
+        g_printerr("Writer does not support parameter '%s'!\n", id);
+        return FALSE;
+    }
+
+    /* Parameter type is determined by the type of its default value */
+    if (g_variant_is_of_type(info->default_value, G_VARIANT_TYPE_BOOLEAN)) {
+        value = g_variant_new_boolean(!g_ascii_strcasecmp(value_str, "true") || !g_strcmp0(value_str, "1"));
+    } else if (g_variant_is_of_type(info->default_value, G_VARIANT_TYPE_INT32)) {
+        value = g_variant_new_int32(strtol(value_str, NULL, 0));
+    } else {
+        value = g_variant_new_string(value_str);
+    }
+
+    g_hash_table_insert(parameters, g_strdup(id), g_variant_ref_sink(value));
+
+    return TRUE;
+}
+
+int main (int argc, char **argv)
+{
+    GError *error = NULL;
+    gboolean succeeded;
+    MirageContext *context;
+    MirageWriter *writer;
+    MirageDisc *disc;
+    GHashTable *parameters;
+    LayoutSpec *layout;
+    GPtrArray *data_files;
+    gint medium_type;
+
+    gchar *writer_id = NULL;
+    gchar *layout_str = NULL;
+    gchar *medium_str = NULL;
+    gchar **writer_params = NULL;
+    gchar **encode_formats = NULL;
+    gchar *debug_mask_str = NULL;
+    gint debug_mask;
+    gint64 seed = 1;
+    gint compressibility = 50;
+    gint xz_block_size = 1024*1024;
+    gboolean write_raw = FALSE;
+    gboolean write_subchannel = FALSE;
+    gboolean rw_subchannel = FALSE;
+
+    GOptionContext *option_context;
+    GOptionEntry option_entries[] = {
+        {"writer", 'w', 0, G_OPTION_ARG_STRING, &writer_id, "Image writer ID (default: WRITER-TOC).", "id"},
+        {"layout", 'l', 0, G_OPTION_ARG_STRING, &layout_str, "Disc layout; sessions separated by ';', tracks by ',', each track as type:length. Types: audio, mode1, mode2, mode2-form1, mode2-form2, mode2-mixed (default: mode1:10000).", "layout"},
+        {"medium", 'm', 0, G_OPTION_ARG_STRING, &medium_str, "Medium type: cd, dvd or bd (default: cd).", "medium"},
+        {"seed", 's', 0, G_OPTION_ARG_INT64, &seed, "Seed for data pattern (default: 1).", "seed"},
+        {"compressibility", 'c', 0, G_OPTION_ARG_INT, &compressibility, "Percentage of compressible data blocks (default: 50).", "percent"},
+        {"raw", 'r', 0, G_OPTION_ARG_NONE, &write_raw, "Write raw sectors.", NULL},
+        {"subchannel", 'S', 0, G_OPTION_ARG_NONE, &write_subchannel, "Write subchannel data.", NULL},
+        {"rw-subchannel", 0, 0, G_OPTION_ARG_NONE, &rw_subchannel, "Fill R-W subchannel with pattern data (implies --subchannel).", NULL},
+        {"param", 'p', 0, G_OPTION_ARG_STRING_ARRAY, &writer_params, "Additional writer parameter (may be given multiple times).", "key=value"},
+        {"encode", 'e', 0, G_OPTION_ARG_STRING_ARRAY, &encode_formats, "Post-process image with external encoder: gzip, xz, cso, zso (maxcso), ecm, chd (chdman). May be given multiple times.", "format"},
+        {"xz-block-size", 0, 0, G_OPTION_ARG_INT, &xz_block_size, "XZ block size, in bytes (default: 1 MiB).", "size"},
+        {"debug-mask", 'd', 0, G_OPTION_ARG_STRING, &debug_mask_str, "Debug mask for libMirage.", "mask"},
+        {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
+    };
+
+    /* Parse command-line */
+    option_context = g_option_context_new("<image filename> - synthetic optical disc image generator");
+    g_option_context_add_main_entries(option_context, option_entries, NULL);
+    succeeded = g_option_context_parse(option_context, &argc, &argv, &error);
+    g_option_context_free(option_context);
+
+    if (!succeeded) {
+        g_printerr("Failed to parse options: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    if (argc != 2) {
+        g_printerr("Exactly one image filename must be given!\n");
+        return 1;
+    }
+
+    /* Parse debug mask */
+    succeeded = _parse_debug_mask_string(debug_mask_str, &debug_mask);
+    if (!succeeded) {
+        g_printerr("Failed to parse debug-mask argument: %s\n", debug_mask_str);
+        g_free(debug_mask_str);
+        return 1;
+    }
+    g_free(debug_mask_str);
+
+    if (compressibility < 0 || compressibility > 100) {
+        g_printerr("Compressibility must be between 0 and 100!\n");
+        return 1;
+    }
+
+    if (!medium_str || !g_ascii_strcasecmp(medium_str, "cd")) {
+        medium_type = MIRAGE_MEDIUM_CD;
+    } else if (!g_ascii_strcasecmp(medium_str, "dvd")) {
+        medium_type = MIRAGE_MEDIUM_DVD;
+    } else if (!g_ascii_strcasecmp(medium_str, "bd")) {
+        medium_type = MIRAGE_MEDIUM_BD;
+    } else {
+        g_printerr("Invalid medium type '%s'!\n", medium_str);
+        return 1;
+    }
+
+    if (rw_subchannel && medium_type != MIRAGE_MEDIUM_CD) {
+        g_printerr("Subchannel is supported only on CD media!\n");
+        return 1;
+    }
+    write_subchannel |= rw_subchannel;
+
+    layout = _parse_layout_string(layout_str ? layout_str : "mode1:10000", medium_type);
+    if (!layout) {
+        return 1;
+    }
+
+    for (gint i = 0; encode_formats && encode_formats[i]; i++) {
+        gboolean found = FALSE;
+        for (guint e = 0; e < G_N_ELEMENTS(encoders); e++) {
+            found |= !g_ascii_strcasecmp(encode_formats[i], encoders[e].name);
+        }
+        if (!found) {
+            g_printerr("Unsupported encoder '%s'!\n", encode_formats[i]);
+            _layout_spec_free(layout);
+            return 1;
+        }
+    }
+
+    /* Set up log handler */
+    g_log_set_handler(
+        "libMirage",
+        G_LOG_LEVEL_MASK | G_LOG_FLAG_FATAL | G_LOG_FLAG_RECURSION,
+        _libmirage_log_handler,
+        NULL
+    );
+
+    /* Initialize libMirage */
+    if (!mirage_initialize(&error)) {
+        g_printerr("Failed to initialize libMirage: %s!\n", error->message);
+        g_error_free(error);
+        _layout_spec_free(layout);
+        return 2;
+    }
+
+    /* Create context */
+    context = g_object_new(MIRAGE_TYPE_CONTEXT, NULL);
+    mirage_context_set_debug_domain(context, "libMirage");
+    mirage_context_set_debug_mask(context, debug_mask);
+
+    /* Create writer */
+    writer = mirage_create_writer(writer_id ? writer_id : "WRITER-TOC", &error);
+    if (!writer) {
+        g_printerr("Failed to create image writer: %s\n", error->message);
+        g_error_free(error);
+        g_object_unref(context);
+        _layout_spec_free(layout);
+        mirage_shutdown(NULL);
+        return 2;
+    }
+    mirage_contextual_set_context(MIRAGE_CONTEXTUAL(writer), context);
+
+    /* Writer parameters */
+    parameters = g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify)g_free, (GDestroyNotify)g_variant_unref);
+    succeeded = TRUE;
+    if (write_raw) {
+        succeeded &= _add_writer_parameter(writer, parameters, "writer.write_raw", "true");
+    }
+    if (write_subchannel) {
+        succeeded &= _add_writer_parameter(writer, parameters, "writer.write_subchannel", "true");
+    }
+    for (gint i = 0; writer_params && writer_params[i]; i++) {
+        gchar **pair = g_strsplit(writer_params[i], "=", 2);
+        if (g_strv_length(pair) == 2) {
+            succeeded &= _add_writer_parameter(writer, parameters, pair[0], pair[1]);
+        } else {
+            g_printerr("Invalid writer parameter '%s' (expected key=value)!\n", writer_params[i]);
+            succeeded = FALSE;
+        }
+        g_strfreev(pair);
+    }
+
+    /* Create blank disc */
+    disc = g_object_new(MIRAGE_TYPE_DISC, NULL);
+    mirage_contextual_set_context(MIRAGE_CONTEXTUAL(disc), context);
+    mirage_disc_set_filename(disc, argv[1]);
+    mirage_disc_set_medium_type(disc, medium_type);
+    mirage_disc_layout_set_start_sector(disc, medium_type == MIRAGE_MEDIUM_CD ? -150 : 0);
+
+    if (succeeded) {
+        g_printerr("Generating image %s (%s)\n", argv[1], mirage_writer_get_info(writer)->id);
+
+        PatternOptions pattern_options = {
+            .seed = seed,
+            .compressibility = compressibility,
+            .rw_subchannel = rw_subchannel,
+        };
+
+        succeeded = mirage_writer_open_image(writer, disc, parameters, &error) && _generate_disc(writer, disc, layout, &pattern_options, &error);
+        if (!succeeded) {
+            g_printerr("Failed to generate image: %s\n", error->message);
+            g_error_free(error);
+        }
+    }
+    g_hash_table_unref(parameters);
+
+    /* Release the disc before running encoders, so that all data is
+     * flushed and files are closed */
+    data_files = _collect_data_files(disc);
+    g_object_unref(disc);
+    g_object_unref(writer);
+
+    for (gint i = 0; succeeded && encode_formats && encode_formats[i]; i++) {
+        for (guint e = 0; e < G_N_ELEMENTS(encoders); e++) {
+            if (g_ascii_strcasecmp(encode_formats[i], encoders[e].name)) {
+                continue;
+            }
+
+            if (encoders[e].whole_image) {
+                succeeded = _run_encoder(&encoders[e], argv[1], xz_block_size);
+            } else {
+                for (guint f = 0; f < data_files->len && succeeded; f++) {
+                    succeeded = _run_encoder(&encoders[e], g_ptr_array_index(data_files, f), xz_block_size);
+                }
+            }
+        }
+    }
+
+    g_ptr_array_unref(data_files);
+    g_strfreev(encode_formats);
+    g_strfreev(writer_params);
+    g_free(medium_str);
+    g_free(layout_str);
+    g_free(writer_id);
+    _layout_spec_free(layout);
+    g_object_unref(context);
+
+    /* Shutdown libMirage */
+    mirage_shutdown(NULL);
+
+    return succeeded ? 0 : 3;
+}
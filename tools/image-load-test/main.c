@@ -17,7 +17,10 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <glib.h>
@@ -63,6 +66,19 @@ static gchar *_subchannel_format_to_string (gint format);
 
 static void _run_interative_mode (MirageDisc *disc);
 
+typedef struct _BenchmarkOptions BenchmarkOptions;
+struct _BenchmarkOptions
+{
+    gchar *patterns;
+    gint num_sectors;
+    gint stride;
+    gint seed;
+    gboolean reuse_sector;
+    gchar *json_filename;
+};
+
+static gboolean _run_benchmark (MirageDisc *disc, const BenchmarkOptions *options, gchar **filenames);
+
 int main (int argc, char **argv)
 {
     GError *error = NULL;
@@ -75,11 +91,26 @@ int main (int argc, char **argv)
     gboolean interactive_mode = FALSE;
     gint debug_mask;
 
+    BenchmarkOptions bench_options = {
+        .patterns = NULL,
+        .num_sectors = 10000,
+        .stride = 16,
+        .seed = 1,
+        .reuse_sector = FALSE,
+        .json_filename = NULL,
+    };
+
     GOptionContext *option_context;
     GOptionEntry option_entries[] = {
         {"debug-mask", 'd', 0, G_OPTION_ARG_STRING, &debug_mask_str, "Debug mask for libMirage.", "mask"},
         {"password", 'p', 0, G_OPTION_ARG_STRING, &password, "Password to use when loading image.", "pasword"},
         {"interactive", 'i', 0, G_OPTION_ARG_NONE, &interactive_mode, "Enter interactive mode after image is loaded.", NULL},
+        {"bench", 'b', 0, G_OPTION_ARG_STRING, &bench_options.patterns, "Run benchmark with given comma-separated access patterns (sequential, random, strided, mixed, all).", "patterns"},
+        {"bench-sectors", 0, 0, G_OPTION_ARG_INT, &bench_options.num_sectors, "Number of sectors to read per benchmark pattern (default: 10000).", "N"},
+        {"bench-stride", 0, 0, G_OPTION_ARG_INT, &bench_options.stride, "Stride (in sectors) for strided benchmark pattern (default: 16).", "N"},
+        {"bench-seed", 0, 0, G_OPTION_ARG_INT, &bench_options.seed, "Random seed for random and mixed benchmark patterns (default: 1).", "N"},
+        {"bench-reuse-sector", 0, 0, G_OPTION_ARG_NONE, &bench_options.reuse_sector, "Read sectors into a single sector object (mirage_disc_read_sector()) instead of allocating new one for each read (mirage_disc_get_sector()).", NULL},
+        {"bench-json", 0, 0, G_OPTION_ARG_FILENAME, &bench_options.json_filename, "Write benchmark results in JSON format to given file ('-' for standard output).", "filename"},
         {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
     };
 
@@ -118,7 +149,16 @@ int main (int argc, char **argv)
     }
     g_printerr(" - debug mask: 0x%08X (%s)\n", debug_mask, _debug_mask_to_string(debug_mask));
     g_printerr(" - password: %s\n", password ? "[REDACTED]" : "N/A");
-    g_printerr(" - interactive mode: %s\n\n", interactive_mode ? "yes" : "no");
+    g_printerr(" - interactive mode: %s\n", interactive_mode ? "yes" : "no");
+    g_printerr(" - benchmark patterns: %s\n", bench_options.patterns ? bench_options.patterns : "N/A");
+    if (bench_options.patterns) {
+        g_printerr(" - benchmark sectors: %d\n", bench_options.num_sectors);
+        g_printerr(" - benchmark stride: %d\n", bench_options.stride);
+        g_printerr(" - benchmark seed: %d\n", bench_options.seed);
+        g_printerr(" - benchmark sector reuse: %s\n", bench_options.reuse_sector ? "yes" : "no");
+        g_printerr(" - benchmark JSON output: %s\n", bench_options.json_filename ? bench_options.json_filename : "N/A");
+    }
+    g_printerr("\n");
 
     /* Set up log handler */
     g_log_set_handler(
@@ -164,6 +204,14 @@ int main (int argc, char **argv)
     }
     g_printerr("Image successfully loaded!\n\n");
 
+    gint ret = 0;
+
+    if (bench_options.patterns) {
+        if (!_run_benchmark(disc, &bench_options, argv + 1)) {
+            ret = 4;
+        }
+    }
+
     if (interactive_mode) {
         _run_interative_mode(disc);
     }
@@ -173,12 +221,15 @@ int main (int argc, char **argv)
     g_object_unref(disc);
     g_object_unref(context);
 
+    g_free(bench_options.patterns);
+    g_free(bench_options.json_filename);
+
     if (!mirage_shutdown(&error)) {
         g_printerr("Failed to shut down libMirage: %s!\n", error->message);
         g_error_free(error);
     }
 
-    return 0;
+    return ret;
 }
 
 
@@ -579,6 +630,486 @@ void _run_interative_mode (MirageDisc *disc)
 }
 
 
+/**********************************************************************\
+ *                         Allocation counting                        *
+\**********************************************************************/
+/* With glibc, we interpose the allocator entry points so that benchmark
+ * can report the number of heap allocations performed per sector read.
+ * Aligned allocations are counted as well, since GLib's slice allocator
+ * and some of the compression libraries use them. */
+#if defined(__GLIBC__)
+#define HAVE_ALLOCATION_COUNTING 1
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+extern void *__libc_memalign (size_t alignment, size_t size);
+extern void *__libc_valloc (size_t size);
+extern void *__libc_pvalloc (size_t size);
+
+static guint64 _allocation_count = 0;
+
+void *malloc (size_t size)
+{
+    __atomic_add_fetch(&_allocation_count, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc (size_t nmemb, size_t size)
+{
+    __atomic_add_fetch(&_allocation_count, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc (void *ptr, size_t size)
+{
+    __atomic_add_fetch(&_allocation_count, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign (size_t alignment, size_t size)
+{
+    __atomic_add_fetch(&_allocation_count, 1, __ATOMIC_RELAXED);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc (size_t alignment, size_t size)
+{
+    __atomic_add_fetch(&_allocation_count, 1, __ATOMIC_RELAXED);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign (void **memptr, size_t alignment, size_t size)
+{
+    void *ptr;
+
+    /* Alignment must be a power of two multiple of sizeof(void *) */
+    if (alignment % sizeof(void *) || (alignment & (alignment - 1)) || !alignment) {
+        return EINVAL;
+    }
+
+    __atomic_add_fetch(&_allocation_count, 1, __ATOMIC_RELAXED);
+    ptr = __libc_memalign(alignment, size);
+    if (!ptr && size) {
+        return ENOMEM;
+    }
+
+    *memptr = ptr;
+    return 0;
+}
+
+void *valloc (size_t size)
+{
+    __atomic_add_fetch(&_allocation_count, 1, __ATOMIC_RELAXED);
+    return __libc_valloc(size);
+}
+
+void *pvalloc (size_t size)
+{
+    __atomic_add_fetch(&_allocation_count, 1, __ATOMIC_RELAXED);
+    return __libc_pvalloc(size);
+}
+
+static guint64 _get_allocation_count (void)
+{
+    return __atomic_load_n(&_allocation_count, __ATOMIC_RELAXED);
+}
+#else
+#define HAVE_ALLOCATION_COUNTING 0
+
+static guint64 _get_allocation_count (void)
+{
+    return 0;
+}
+#endif
+
+
+/**********************************************************************\
+ *                           Benchmark mode                           *
+\**********************************************************************/
+typedef enum
+{
+    BENCHMARK_SEQUENTIAL,
+    BENCHMARK_RANDOM,
+    BENCHMARK_STRIDED,
+    BENCHMARK_MIXED,
+} BenchmarkPattern;
+
+static const struct {
+    const gchar *name;
+    BenchmarkPattern pattern;
+} _BENCHMARK_PATTERNS[] = {
+    {"sequential", BENCHMARK_SEQUENTIAL},
+    {"random", BENCHMARK_RANDOM},
+    {"strided", BENCHMARK_STRIDED},
+    {"mixed", BENCHMARK_MIXED},
+};
+
+typedef struct
+{
+    const gchar *pattern;
+
+    gint num_sectors;
+    gint num_failed;
+    guint64 num_bytes;
+    guint64 num_allocations;
+
+    gdouble elapsed; /* s */
+    gdouble sectors_per_second;
+    gdouble megabytes_per_second;
+
+    gdouble latency_min; /* us */
+    gdouble latency_p50;
+    gdouble latency_p99;
+    gdouble latency_max;
+} BenchmarkResult;
+
+static inline gint64 _get_time_ns (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (gint64)ts.tv_sec * G_GINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+static gint _compare_gint64 (gconstpointer a, gconstpointer b)
+{
+    gint64 value_a = *(const gint64 *)a;
+    gint64 value_b = *(const gint64 *)b;
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+static void _generate_addresses (BenchmarkPattern pattern, const BenchmarkOptions *options, gint start_sector, gint length, gint *addresses)
+{
+    GRand *rng = g_rand_new_with_seed(options->seed);
+
+    switch (pattern) {
+        case BENCHMARK_SEQUENTIAL: {
+            /* Read from start to end; wrap around if needed */
+            for (gint i = 0; i < options->num_sectors; i++) {
+                addresses[i] = start_sector + i % length;
+            }
+            break;
+        }
+        case BENCHMARK_RANDOM: {
+            /* Uniformly distributed addresses over whole disc */
+            for (gint i = 0; i < options->num_sectors; i++) {
+                addresses[i] = start_sector + g_rand_int_range(rng, 0, length);
+            }
+            break;
+        }
+        case BENCHMARK_STRIDED: {
+            /* Every stride-th sector; wrap around if needed */
+            gint64 offset = 0;
+            for (gint i = 0; i < options->num_sectors; i++) {
+                addresses[i] = start_sector + offset;
+                offset = (offset + MAX(options->stride, 1)) % length;
+            }
+            break;
+        }
+        case BENCHMARK_MIXED: {
+            /* Game-like access: mostly streaming runs (level data, videos,
+             * audio) from random locations, interleaved with short bursts
+             * of reads near the beginning of the disc (file system
+             * metadata, directory lookups) */
+            gint metadata_area = MIN(length, 1024);
+            gint i = 0;
+
+            while (i < options->num_sectors) {
+                gint run_start, run_length;
+
+                if (g_rand_int_range(rng, 0, 100) < 20) {
+                    run_start = g_rand_int_range(rng, 0, metadata_area);
+                    run_length = g_rand_int_range(rng, 1, 5);
+                } else {
+                    run_start = g_rand_int_range(rng, 0, length);
+                    run_length = g_rand_int_range(rng, 32, 513);
+                }
+
+                for (gint j = 0; j < run_length && i < options->num_sectors; j++, i++) {
+                    addresses[i] = start_sector + (run_start + j) % length;
+                }
+            }
+            break;
+        }
+    }
+
+    g_rand_free(rng);
+}
+
+static void _run_benchmark_pattern (MirageDisc *disc, BenchmarkPattern pattern, const BenchmarkOptions *options, gint *addresses, gint64 *latencies, BenchmarkResult *result)
+{
+    MirageSector *sector = NULL;
+    GError *error = NULL;
+
+    gint start_sector = mirage_disc_layout_get_start_sector(disc);
+    gint length = mirage_disc_layout_get_length(disc);
+
+    _generate_addresses(pattern, options, start_sector, length, addresses);
+
+    if (options->reuse_sector) {
+        sector = g_object_new(MIRAGE_TYPE_SECTOR, NULL);
+    }
+
+    result->num_sectors = options->num_sectors;
+    result->num_failed = 0;
+    result->num_bytes = 0;
+
+    guint64 allocations_start = _get_allocation_count();
+    gint64 time_start = _get_time_ns();
+
+    for (gint i = 0; i < options->num_sectors; i++) {
+        gint64 t0 = _get_time_ns();
+        gboolean succeeded;
+
+        if (options->reuse_sector) {
+            succeeded = mirage_disc_read_sector(disc, addresses[i], sector, &error);
+        } else {
+            sector = mirage_disc_get_sector(disc, addresses[i], &error);
+            succeeded = sector != NULL;
+        }
+
+        if (succeeded) {
+            const guint8 *buffer;
+            gint buffer_length;
+
+            if (mirage_sector_get_data(sector, &buffer, &buffer_length, NULL)) {
+                result->num_bytes += buffer_length;
+            }
+        } else {
+            result->num_failed++;
+            g_clear_error(&error);
+        }
+
+        if (!options->reuse_sector && sector) {
+            g_object_unref(sector);
+            sector = NULL;
+        }
+
+        latencies[i] = _get_time_ns() - t0;
+    }
+
+    gint64 time_end = _get_time_ns();
+    result->num_allocations = _get_allocation_count() - allocations_start;
+
+    if (sector) {
+        g_object_unref(sector);
+    }
+
+    /* Statistics */
+    result->elapsed = (time_end - time_start) / 1e9;
+    result->sectors_per_second = result->elapsed > 0 ? result->num_sectors / result->elapsed : 0;
+    result->megabytes_per_second = result->elapsed > 0 ? result->num_bytes / result->elapsed / (1024.0*1024.0) : 0;
+
+    qsort(latencies, options->num_sectors, sizeof(gint64), _compare_gint64);
+    result->latency_min = latencies[0] / 1e3;
+    result->latency_p50 = latencies[(gint64)(options->num_sectors - 1) * 50 / 100] / 1e3;
+    result->latency_p99 = latencies[(gint64)(options->num_sectors - 1) * 99 / 100] / 1e3;
+    result->latency_max = latencies[options->num_sectors - 1] / 1e3;
+}
+
+static void _print_benchmark_result (const BenchmarkResult *result, gboolean to_stderr)
+{
+    /* If JSON results are written to standard output, keep human-readable
+     * results out of the way */
+    void (*print) (const gchar *format, ...) = to_stderr ? g_printerr : g_print;
+
+    print("Pattern: %s\n", result->pattern);
+    print(" - sectors read: %d (%d failed)\n", result->num_sectors, result->num_failed);
+    print(" - data read: %" G_GUINT64_FORMAT " bytes\n", result->num_bytes);
+    print(" - elapsed time: %.3f s\n", result->elapsed);
+    print(" - throughput: %.1f sectors/s, %.2f MB/s\n", result->sectors_per_second, result->megabytes_per_second);
+    print(" - latency per sector: min %.2f us, p50 %.2f us, p99 %.2f us, max %.2f us\n", result->latency_min, result->latency_p50, result->latency_p99, result->latency_max);
+    if (HAVE_ALLOCATION_COUNTING) {
+        print(" - allocations: %" G_GUINT64_FORMAT " (%.2f per sector)\n", result->num_allocations, (gdouble)result->num_allocations / result->num_sectors);
+    } else {
+        print(" - allocations: N/A\n");
+    }
+    print("\n");
+}
+
+/* Appends UTF-8 string @str to @json as a JSON string literal */
+static void _append_json_string (GString *json, const gchar *str)
+{
+    g_string_append_c(json, '"');
+    for (const gchar *ptr = str; *ptr; ptr++) {
+        guchar c = *ptr;
+
+        switch (c) {
+            case '"': {
+                g_string_append(json, "\\\"");
+                break;
+            }
+            case '\\': {
+                g_string_append(json, "\\\\");
+                break;
+            }
+            case '\n': {
+                g_string_append(json, "\\n");
+                break;
+            }
+            case '\r': {
+                g_string_append(json, "\\r");
+                break;
+            }
+            case '\t': {
+                g_string_append(json, "\\t");
+                break;
+            }
+            default: {
+                /* Remaining control characters must be escaped; everything
+                 * else (including multi-byte UTF-8 sequences) is copied */
+                if (c < 0x20) {
+                    g_string_append_printf(json, "\\u%04X", c);
+                } else {
+                    g_string_append_c(json, c);
+                }
+                break;
+            }
+        }
+    }
+    g_string_append_c(json, '"');
+}
+
+static gchar *_format_benchmark_json (MirageDisc *disc, const BenchmarkOptions *options, gchar **filenames, const BenchmarkResult *results, gint num_results)
+{
+    GString *json = g_string_new("{\n");
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append(json, "  \"libmirage_version\": ");
+    _append_json_string(json, mirage_version_long);
+    g_string_append(json, ",\n");
+
+    g_string_append(json, "  \"filenames\": [");
+    for (gint i = 0; filenames[i]; i++) {
+        /* Filenames need not be valid UTF-8 */
+        gchar *display_name = g_filename_display_name(filenames[i]);
+
+        if (i) {
+            g_string_append(json, ", ");
+        }
+        _append_json_string(json, display_name);
+        g_free(display_name);
+    }
+    g_string_append(json, "],\n");
+
+    g_string_append_printf(json, "  \"medium_type\": %d,\n", mirage_disc_get_medium_type(disc));
+    g_string_append_printf(json, "  \"disc_length\": %d,\n", mirage_disc_layout_get_length(disc));
+    g_string_append_printf(json, "  \"num_sectors\": %d,\n", options->num_sectors);
+    g_string_append_printf(json, "  \"stride\": %d,\n", options->stride);
+    g_string_append_printf(json, "  \"seed\": %d,\n", options->seed);
+    g_string_append_printf(json, "  \"reuse_sector\": %s,\n", options->reuse_sector ? "true" : "false");
+
+    g_string_append(json, "  \"results\": [\n");
+    for (gint i = 0; i < num_results; i++) {
+        const BenchmarkResult *result = &results[i];
+
+        g_string_append(json, "    {\n");
+        g_string_append(json, "      \"pattern\": ");
+        _append_json_string(json, result->pattern);
+        g_string_append(json, ",\n");
+        g_string_append_printf(json, "      \"sectors\": %d,\n", result->num_sectors);
+        g_string_append_printf(json, "      \"failed\": %d,\n", result->num_failed);
+        g_string_append_printf(json, "      \"bytes\": %" G_GUINT64_FORMAT ",\n", result->num_bytes);
+        g_string_append_printf(json, "      \"elapsed_s\": %s,\n", g_ascii_dtostr(buf, sizeof(buf), result->elapsed));
+        g_string_append_printf(json, "      \"sectors_per_s\": %s,\n", g_ascii_dtostr(buf, sizeof(buf), result->sectors_per_second));
+        g_string_append_printf(json, "      \"mb_per_s\": %s,\n", g_ascii_dtostr(buf, sizeof(buf), result->megabytes_per_second));
+        g_string_append_printf(json, "      \"latency_min_us\": %s,\n", g_ascii_dtostr(buf, sizeof(buf), result->latency_min));
+        g_string_append_printf(json, "      \"latency_p50_us\": %s,\n", g_ascii_dtostr(buf, sizeof(buf), result->latency_p50));
+        g_string_append_printf(json, "      \"latency_p99_us\": %s,\n", g_ascii_dtostr(buf, sizeof(buf), result->latency_p99));
+        g_string_append_printf(json, "      \"latency_max_us\": %s,\n", g_ascii_dtostr(buf, sizeof(buf), result->latency_max));
+        if (HAVE_ALLOCATION_COUNTING) {
+            g_string_append_printf(json, "      \"allocations\": %" G_GUINT64_FORMAT "\n", result->num_allocations);
+        } else {
+            g_string_append(json, "      \"allocations\": null\n");
+        }
+        g_string_append_printf(json, "    }%s\n", i < num_results - 1 ? "," : "");
+    }
+    g_string_append(json, "  ]\n");
+    g_string_append(json, "}\n");
+
+    return g_string_free(json, FALSE);
+}
+
+static gboolean _run_benchmark (MirageDisc *disc, const BenchmarkOptions *options, gchar **filenames)
+{
+    GError *error = NULL;
+
+    if (options->num_sectors <= 0) {
+        g_printerr("Invalid number of benchmark sectors: %d\n", options->num_sectors);
+        return FALSE;
+    }
+
+    if (mirage_disc_layout_get_length(disc) <= 0) {
+        g_printerr("Disc layout is empty; nothing to benchmark!\n");
+        return FALSE;
+    }
+
+    /* Parse pattern list */
+    gchar **pattern_names = g_strsplit(options->patterns, ",", -1);
+    GArray *patterns = g_array_new(FALSE, FALSE, sizeof(gint));
+
+    for (gint i = 0; pattern_names[i]; i++) {
+        const gchar *name = g_strstrip(pattern_names[i]);
+        gboolean valid = FALSE;
+
+        for (guint j = 0; j < G_N_ELEMENTS(_BENCHMARK_PATTERNS); j++) {
+            if (!g_ascii_strcasecmp(name, "all") || !g_ascii_strcasecmp(name, _BENCHMARK_PATTERNS[j].name)) {
+                g_array_append_val(patterns, j);
+                valid = TRUE;
+            }
+        }
+
+        if (!valid) {
+            g_printerr("Unknown benchmark pattern: %s\n", name);
+            g_strfreev(pattern_names);
+            g_array_free(patterns, TRUE);
+            return FALSE;
+        }
+    }
+    g_strfreev(pattern_names);
+
+    /* Run */
+    gint *addresses = g_new(gint, options->num_sectors);
+    gint64 *latencies = g_new(gint64, options->num_sectors);
+    BenchmarkResult *results = g_new0(BenchmarkResult, patterns->len);
+
+    g_printerr("Running benchmark...\n\n");
+
+    for (guint i = 0; i < patterns->len; i++) {
+        gint pattern_index = g_array_index(patterns, gint, i);
+
+        results[i].pattern = _BENCHMARK_PATTERNS[pattern_index].name;
+        _run_benchmark_pattern(disc, _BENCHMARK_PATTERNS[pattern_index].pattern, options, addresses, latencies, &results[i]);
+        _print_benchmark_result(&results[i], !g_strcmp0(options->json_filename, "-"));
+    }
+
+    g_free(addresses);
+    g_free(latencies);
+
+    /* JSON output */
+    gboolean succeeded = TRUE;
+
+    if (options->json_filename) {
+        gchar *json = _format_benchmark_json(disc, options, filenames, results, patterns->len);
+
+        if (!g_strcmp0(options->json_filename, "-")) {
+            g_print("%s", json);
+        } else if (!g_file_set_contents(options->json_filename, json, -1, &error)) {
+            g_printerr("Failed to write benchmark results to '%s': %s\n", options->json_filename, error->message);
+            g_error_free(error);
+            succeeded = FALSE;
+        }
+
+        g_free(json);
+    }
+
+    g_free(results);
+    g_array_free(patterns, TRUE);
+
+    return succeeded;
+}
+
+
 /**********************************************************************\
  *                         Debug mask helpers                         *
 \**********************************************************************/